@@ -37,6 +37,7 @@ static const char* const STATE_STRINGS[] = {
 
 Application::Application() {
     event_group_ = xEventGroupCreate();
+    xEventGroupSetBits(event_group_, MAIN_EVENT_PREWARM_DONE);
 
 #if CONFIG_USE_DEVICE_AEC && CONFIG_USE_SERVER_AEC
 #error "CONFIG_USE_DEVICE_AEC and CONFIG_USE_SERVER_AEC cannot be enabled at the same time"
@@ -59,6 +60,14 @@ Application::Application() {
         .skip_unhandled_events = true
     };
     esp_timer_create(&clock_timer_args, &clock_timer_handle_);
+
+    AudioChannelBudget budget;
+    budget.idle_hold_ms = CONFIG_AUDIO_CHANNEL_IDLE_HOLD_SECONDS * 1000;
+    budget.warm_ms_per_period = CONFIG_AUDIO_CHANNEL_WARM_BUDGET_SECONDS * 1000;
+#if CONFIG_USE_AUDIO_CHANNEL_PREWARM
+    budget.prewarm = true;
+#endif
+    channel_policy_ = AudioChannelPolicy(budget);
 }
 
 Application::~Application() {
@@ -213,7 +222,7 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         digit_sound{'9', Lang::Sounds::OGG_9}
     }};
 
-    // This sentence uses 9KB of SRAM, so we need to wait for it to finish
+    // The alert sound has priority, the digits are queued behind it
     Alert(Lang::Strings::ACTIVATION, message.c_str(), "link", Lang::Sounds::OGG_ACTIVATION);
 
     for (const auto& digit : code) {
@@ -232,7 +241,7 @@ void Application::Alert(const char* status, const char* message, const char* emo
     display->SetEmotion(emotion);
     display->SetChatMessage("system", message);
     if (!sound.empty()) {
-        audio_service_.PlaySound(sound);
+        audio_service_.PlaySound(sound, kSoundPriorityAlert);
     }
 }
 
@@ -265,15 +274,22 @@ void Application::ToggleChatState() {
     }
 
     if (device_state_ == kDeviceStateIdle) {
-        Schedule([this]() {
-            if (!protocol_->IsAudioChannelOpened()) {
+        /* The channel takes a while to open, power up the codec meanwhile */
+        audio_service_.PrepareForInteraction(kAudioPowerHintButton);
+        Schedule([this, start_ms = esp_timer_get_time() / 1000]() {
+            auto mode = aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime;
+            bool opened = IsAudioChannelReady();
+            if (!opened) {
                 SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
-                    return;
-                }
+                StartEarlyUplink(mode);
+                opened = WaitForPrewarm();
+            }
+            channel_policy_.OnInteractionStart(start_ms, opened);
+            if (!opened && !protocol_->OpenAudioChannel()) {
+                return;
             }
 
-            SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
+            SetListeningMode(mode);
         });
     } else if (device_state_ == kDeviceStateSpeaking) {
         Schedule([this]() {
@@ -302,12 +318,18 @@ void Application::StartListening() {
     }
     
     if (device_state_ == kDeviceStateIdle) {
-        Schedule([this]() {
-            if (!protocol_->IsAudioChannelOpened()) {
+        /* The channel takes a while to open, power up the codec meanwhile */
+        audio_service_.PrepareForInteraction(kAudioPowerHintButton);
+        Schedule([this, start_ms = esp_timer_get_time() / 1000]() {
+            bool opened = IsAudioChannelReady();
+            if (!opened) {
                 SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
-                    return;
-                }
+                StartEarlyUplink(kListeningModeManualStop);
+                opened = WaitForPrewarm();
+            }
+            channel_policy_.OnInteractionStart(start_ms, opened);
+            if (!opened && !protocol_->OpenAudioChannel()) {
+                return;
             }
 
             SetListeningMode(kListeningModeManualStop);
@@ -360,6 +382,23 @@ void Application::Start() {
     audio_service_.Initialize(codec);
     audio_service_.Start();
 
+    /* The codec stays powered through a session and powers down sooner when idle */
+    DeviceStateEventManager::GetInstance().RegisterStateChangeCallback([this](DeviceState previous, DeviceState current) {
+        switch (current) {
+            case kDeviceStateIdle:
+                audio_service_.SetPowerMode(kAudioPowerModeIdle);
+                break;
+            case kDeviceStateConnecting:
+            case kDeviceStateListening:
+            case kDeviceStateSpeaking:
+                audio_service_.SetPowerMode(kAudioPowerModeSession);
+                break;
+            default:
+                audio_service_.SetPowerMode(kAudioPowerModeDefault);
+                break;
+        }
+    });
+
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
@@ -416,10 +455,16 @@ void Application::Start() {
     });
 
     protocol_->OnNetworkError([this](const std::string& message) {
+        // Only the errors of the pre-warm open itself, a failure elsewhere meanwhile is still shown
+        if (prewarm_task_handle_ != nullptr && xTaskGetCurrentTaskHandle() == prewarm_task_handle_) {
+            ESP_LOGW(TAG, "Failed to pre-warm the audio channel: %s", message.c_str());
+            return;
+        }
         last_error_message_ = message;
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
-    protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
+    protocol_->OnIncomingAudio([this](AudioStreamPacketPtr packet) {
+        packet->trace_time_us = audio_service_.GetTracer().Timestamp();
         if (device_state_ == kDeviceStateSpeaking) {
             audio_service_.PushPacketToDecodeQueue(std::move(packet));
         }
@@ -571,9 +616,14 @@ void Application::MainEventLoop() {
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
             while (auto packet = audio_service_.PopPacketFromSendQueue()) {
+                int64_t trace_time_us = packet->trace_time_us;
                 if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
+                    link_sample_.send_failures++;
                     break;
                 }
+                link_sample_.packets_sent++;
+                audio_service_.GetTracer().Record(kAudioTraceSent, trace_time_us);
+                channel_policy_.OnAudioSent(esp_timer_get_time() / 1000);
             }
         }
 
@@ -601,31 +651,126 @@ void Application::MainEventLoop() {
             clock_ticks_++;
             auto display = Board::GetInstance().GetDisplay();
             display->UpdateStatusBar();
+#if CONFIG_USE_LINK_RATE_CONTROL
+            UpdateLinkRate();
+#endif
+            UpdateAudioChannel();
         
             // Print the debug info every 10 seconds
             if (clock_ticks_ % 10 == 0) {
                 // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
                 // SystemInfo::PrintTaskList();
                 SystemInfo::PrintHeapStats();
+                audio_service_.PrintStatistics();
+                PrintAudioChannelStatistics();
             }
         }
     }
 }
 
+// Called every second, keeps the audio channel open between interactions as long as the policy allows
+void Application::UpdateAudioChannel() {
+    // Other states (activating, audio testing...) are neither idle nor reported to the policy as active,
+    // it must not count a close or a prewarm it is not allowed to make
+    if (!protocol_ || device_state_ != kDeviceStateIdle) {
+        return;
+    }
+    // A pre-warm is still opening
+    if (!(xEventGroupGetBits(event_group_) & MAIN_EVENT_PREWARM_DONE)) {
+        return;
+    }
+    auto action = channel_policy_.Update(esp_timer_get_time() / 1000, protocol_->IsAudioChannelOpened());
+    if (action == kAudioChannelActionClose) {
+        ESP_LOGI(TAG, "Closing the idle audio channel");
+        protocol_->CloseAudioChannel();
+    } else if (action == kAudioChannelActionOpen) {
+        ESP_LOGI(TAG, "Pre-warming the audio channel");
+        // The open may wait seconds for the server hello, the main loop keeps handling wake words and buttons
+        xEventGroupClearBits(event_group_, MAIN_EVENT_PREWARM_DONE);
+        auto ret = xTaskCreate([](void* arg) {
+            Application* app = (Application*)arg;
+            app->protocol_->OpenAudioChannel();
+            app->prewarm_task_handle_ = nullptr;
+            xEventGroupSetBits(app->event_group_, MAIN_EVENT_PREWARM_DONE);
+            vTaskDelete(NULL);
+        }, "prewarm", 4096 * 2, this, 2, &prewarm_task_handle_);
+        if (ret != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create the pre-warm task");
+            prewarm_task_handle_ = nullptr;
+            xEventGroupSetBits(event_group_, MAIN_EVENT_PREWARM_DONE);
+        }
+    }
+}
+
+// A channel a pre-warm is still opening may be connected without the server hello yet
+bool Application::IsAudioChannelReady() {
+    return (xEventGroupGetBits(event_group_) & MAIN_EVENT_PREWARM_DONE) && protocol_->IsAudioChannelOpened();
+}
+
+// An interaction that finds a pre-warm opening waits for it, returns whether the channel is open
+bool Application::WaitForPrewarm() {
+    if (!(xEventGroupGetBits(event_group_) & MAIN_EVENT_PREWARM_DONE)) {
+        ESP_LOGI(TAG, "Waiting for the audio channel pre-warm");
+        xEventGroupWaitBits(event_group_, MAIN_EVENT_PREWARM_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    return protocol_->IsAudioChannelOpened();
+}
+
+void Application::PrintAudioChannelStatistics() {
+    auto& stats = channel_policy_.stats();
+    if (stats.warm_starts + stats.cold_starts == 0) {
+        return;
+    }
+    auto average = [](const AudioChannelTtfab& ttfab) {
+        return ttfab.count > 0 ? uint32_t(ttfab.total_ms / ttfab.count) : 0;
+    };
+    ESP_LOGI(TAG, "Audio channel: warm=%lu cold=%lu, first audio warm avg=%lums max=%lums, cold avg=%lums max=%lums",
+        stats.warm_starts, stats.cold_starts, average(stats.ttfab_warm), stats.ttfab_warm.max_ms,
+        average(stats.ttfab_cold), stats.ttfab_cold.max_ms);
+    ESP_LOGI(TAG, "Audio channel: prewarm opens=%lu hits=%lu misses=%lu, closes hold=%lu budget=%lu, warm idle=%lus, budget left=%lus",
+        stats.prewarm_opens, stats.prewarm_hits, stats.prewarm_misses, stats.hold_closes, stats.budget_closes,
+        uint32_t(stats.warm_idle_ms / 1000), channel_policy_.budget_left_ms() / 1000);
+}
+
+// Called every second, retunes the uplink encoder to what the link carried in that second
+void Application::UpdateLinkRate() {
+    LinkSample sample = link_sample_;
+    link_sample_ = {};
+    sample.send_queue_peak = audio_service_.TakeSendQueuePeak();
+    sample.send_queue_capacity = MAX_SEND_PACKETS_IN_QUEUE;
+    if (!protocol_) {
+        return;
+    }
+    protocol_->TakeAudioLinkStats(sample.packets_received, sample.packets_lost);
+    if (!protocol_->IsAudioChannelOpened() || !link_rate_controller_.Update(sample)) {
+        return;
+    }
+
+    auto& profile = link_rate_controller_.profile();
+    ESP_LOGI(TAG, "Link quality: %s", LinkRateController::QualityName(link_rate_controller_.quality()));
+    audio_service_.SetUplinkProfile(profile);
+    protocol_->SetUplinkProfile(profile);
+}
+
 void Application::OnWakeWordDetected() {
     if (!protocol_) {
         return;
     }
 
     if (device_state_ == kDeviceStateIdle) {
+        int64_t start_ms = esp_timer_get_time() / 1000;
         audio_service_.EncodeWakeWord();
 
-        if (!protocol_->IsAudioChannelOpened()) {
+        bool opened = IsAudioChannelReady();
+        if (!opened) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
-                audio_service_.EnableWakeWordDetection(true);
-                return;
-            }
+            StartEarlyUplink(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
+            opened = WaitForPrewarm();
+        }
+        channel_policy_.OnInteractionStart(start_ms, opened);
+        if (!opened && !protocol_->OpenAudioChannel()) {
+            audio_service_.EnableWakeWordDetection(true);
+            return;
         }
 
         auto wake_word = audio_service_.GetLastWakeWord();
@@ -633,7 +778,9 @@ void Application::OnWakeWordDetected() {
 #if CONFIG_USE_AFE_WAKE_WORD || CONFIG_USE_CUSTOM_WAKE_WORD
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            if (protocol_->SendAudio(std::move(packet))) {
+                channel_policy_.OnAudioSent(esp_timer_get_time() / 1000);
+            }
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -650,6 +797,17 @@ void Application::OnWakeWordDetected() {
     }
 }
 
+// Captures and encodes while the audio channel opens, the packets wait in the uplink stage until listening starts
+void Application::StartEarlyUplink(ListeningMode mode) {
+#if CONFIG_USE_EARLY_UPLINK
+    listening_mode_ = mode;
+    audio_service_.StageUplink();
+    audio_service_.EnableSilenceSuppression(mode == kListeningModeRealtime);
+    audio_service_.EnableVoiceProcessing(true);
+    audio_service_.EnableWakeWordDetection(false);
+#endif
+}
+
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
@@ -680,12 +838,20 @@ void Application::SetDeviceState(DeviceState state) {
     auto display = board.GetDisplay();
     auto led = board.GetLed();
     led->OnStateChanged();
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    if (state == kDeviceStateIdle) {
+        channel_policy_.OnIdle(now_ms);
+    } else if (state == kDeviceStateConnecting || state == kDeviceStateListening || state == kDeviceStateSpeaking) {
+        channel_policy_.OnActive(now_ms);
+    }
     switch (state) {
         case kDeviceStateUnknown:
         case kDeviceStateIdle:
             display->SetStatus(Lang::Strings::STANDBY);
             display->SetEmotion("neutral");
             audio_service_.EnableVoiceProcessing(false);
+            // Speech staged for a channel that did not open
+            audio_service_.DiscardStagedUplink();
             audio_service_.EnableWakeWordDetection(true);
             break;
         case kDeviceStateConnecting:
@@ -701,8 +867,13 @@ void Application::SetDeviceState(DeviceState state) {
             if (!audio_service_.IsAudioProcessorRunning()) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
+                audio_service_.EnableSilenceSuppression(listening_mode_ == kListeningModeRealtime);
                 audio_service_.EnableVoiceProcessing(true);
                 audio_service_.EnableWakeWordDetection(false);
+            } else if (audio_service_.IsUplinkStaged()) {
+                // Started while connecting, the speech staged since then follows the start listening command
+                protocol_->SendStartListening(listening_mode_);
+                audio_service_.ReleaseStagedUplink();
             }
             break;
         case kDeviceStateSpeaking:
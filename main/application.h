@@ -12,6 +12,7 @@
 #include <memory>
 
 #include "protocol.h"
+#include "audio_channel_policy.h"
 #include "ota.h"
 #include "audio_service.h"
 #include "device_state_event.h"
@@ -24,6 +25,8 @@
 #define MAIN_EVENT_ERROR (1 << 4)
 #define MAIN_EVENT_CHECK_NEW_VERSION_DONE (1 << 5)
 #define MAIN_EVENT_CLOCK_TICK (1 << 6)
+// Set while no audio channel pre-warm is running
+#define MAIN_EVENT_PREWARM_DONE (1 << 7)
 
 
 enum AecMode {
@@ -78,14 +81,25 @@ private:
     AecMode aec_mode_ = kAecOff;
     std::string last_error_message_;
     AudioService audio_service_;
+    LinkRateController link_rate_controller_;
+    LinkSample link_sample_;
+    AudioChannelPolicy channel_policy_;
 
     bool has_server_time_ = false;
     bool aborted_ = false;
     int clock_ticks_ = 0;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
     TaskHandle_t main_event_loop_task_handle_ = nullptr;
+    // Runs a speculative OpenAudioChannel(), its errors are not shown
+    TaskHandle_t prewarm_task_handle_ = nullptr;
 
     void OnWakeWordDetected();
+    void UpdateLinkRate();
+    void UpdateAudioChannel();
+    bool IsAudioChannelReady();
+    bool WaitForPrewarm();
+    void StartEarlyUplink(ListeningMode mode);
+    void PrintAudioChannelStatistics();
     void CheckNewVersion(Ota& ota);
     void CheckAssetsVersion();
     void ShowActivationCode(const std::string& code, const std::string& message);
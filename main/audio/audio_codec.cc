@@ -3,7 +3,10 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
 #include <cstring>
+#include <algorithm>
 #include <driver/i2s_common.h>
 
 #define TAG "AudioCodec"
@@ -14,8 +17,46 @@ AudioCodec::AudioCodec() {
 AudioCodec::~AudioCodec() {
 }
 
-void AudioCodec::OutputData(std::vector<int16_t>& data) {
+void AudioCodec::OutputData(const std::vector<int16_t>& data) {
+    if (output_dma_tracked_) {
+        // Counted before the write, the interrupt may already send part of it while we block
+        output_pending_frames_.fetch_add(data.size() / output_channels_, std::memory_order_relaxed);
+    }
     Write(data.data(), data.size());
+    if (output_dma_tracked_) {
+        // Once the write returns, no more than the DMA ring is pending; more means frames were lost
+        // while the channel was stopped
+        const uint32_t capacity = AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM;
+        uint32_t pending = output_pending_frames_.load(std::memory_order_relaxed);
+        while (pending > capacity && !output_pending_frames_.compare_exchange_weak(pending, capacity,
+            std::memory_order_relaxed)) {
+        }
+    }
+}
+
+int AudioCodec::GetOutputDelayFrames(int64_t now_us) const {
+    if (!output_dma_tracked_) {
+        return -1;
+    }
+    uint32_t pending = output_pending_frames_.load(std::memory_order_relaxed);
+    if (pending == 0) {
+        return 0;
+    }
+    // Part of the DMA buffer being sent has already been played
+    uint32_t elapsed_us = uint32_t(now_us) - output_sent_time_us_.load(std::memory_order_relaxed);
+    uint32_t played = std::min<uint64_t>(uint64_t(elapsed_us) * output_sample_rate_ / 1000000, AUDIO_CODEC_DMA_FRAME_NUM);
+    return pending > played ? int(pending - played) : 0;
+}
+
+bool IRAM_ATTR AudioCodec::OnOutputSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    auto codec = (AudioCodec*)user_ctx;
+    // Every DMA buffer holds AUDIO_CODEC_DMA_FRAME_NUM frames; silence sent after an underrun is not ours
+    uint32_t pending = codec->output_pending_frames_.load(std::memory_order_relaxed);
+    while (pending > 0 && !codec->output_pending_frames_.compare_exchange_weak(pending,
+        pending - std::min<uint32_t>(pending, AUDIO_CODEC_DMA_FRAME_NUM), std::memory_order_relaxed)) {
+    }
+    codec->output_sent_time_us_.store(uint32_t(esp_timer_get_time()), std::memory_order_relaxed);
+    return false;
 }
 
 bool AudioCodec::InputData(std::vector<int16_t>& data) {
@@ -33,8 +74,16 @@ void AudioCodec::Start() {
         ESP_LOGW(TAG, "Output volume value (%d) is too small, setting to default (10)", output_volume_);
         output_volume_ = 10;
     }
+    output_gain_.Configure(output_sample_rate_, output_volume_);
 
     if (tx_handle_ != nullptr) {
+        /* Track the DMA position, so the playout time of every sample is known (server AEC) */
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_sent = OnOutputSent;
+        output_dma_tracked_ = i2s_channel_register_event_callback(tx_handle_, &callbacks, this) == ESP_OK;
+        if (!output_dma_tracked_) {
+            ESP_LOGW(TAG, "Failed to register the output DMA callback, playout times are estimated");
+        }
         ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     }
 
@@ -49,6 +98,7 @@ void AudioCodec::Start() {
 
 void AudioCodec::SetOutputVolume(int volume) {
     output_volume_ = volume;
+    output_gain_.SetVolume(volume);
     ESP_LOGI(TAG, "Set output volume to %d", output_volume_);
     
     Settings settings("audio", true);
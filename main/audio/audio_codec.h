@@ -8,8 +8,10 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <atomic>
 
 #include "board.h"
+#include "output_gain.h"
 
 #define AUDIO_CODEC_DMA_DESC_NUM 6
 #define AUDIO_CODEC_DMA_FRAME_NUM 240
@@ -24,7 +26,7 @@ public:
     virtual void EnableInput(bool enable);
     virtual void EnableOutput(bool enable);
 
-    virtual void OutputData(std::vector<int16_t>& data);
+    virtual void OutputData(const std::vector<int16_t>& data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
 
@@ -37,6 +39,8 @@ public:
     inline int output_volume() const { return output_volume_; }
     inline bool input_enabled() const { return input_enabled_; }
     inline bool output_enabled() const { return output_enabled_; }
+    // Frames written by OutputData() that the DAC has not played yet at `now_us`, -1 if the DMA position is not tracked
+    int GetOutputDelayFrames(int64_t now_us) const;
 
 protected:
     i2s_chan_handle_t tx_handle_ = nullptr;
@@ -51,9 +55,19 @@ protected:
     int input_channels_ = 1;
     int output_channels_ = 1;
     int output_volume_ = 70;
+    // For codecs without a hardware volume: scale the output in Write() through it
+    OutputGain output_gain_;
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
+
+private:
+    // Output DMA position, kept by the I2S on_sent interrupt
+    bool output_dma_tracked_ = false;
+    std::atomic<uint32_t> output_pending_frames_{0};
+    std::atomic<uint32_t> output_sent_time_us_{0};
+
+    static bool OnOutputSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
 };
 
 #endif // _AUDIO_CODEC_H
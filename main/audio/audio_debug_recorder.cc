@@ -0,0 +1,309 @@
+#include "audio_debug_recorder.h"
+#include "sdkconfig.h"
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#endif
+
+#define TAG "AudioDebugRecorder"
+
+#define AUDIO_DEBUG_VERSION 1
+#define AUDIO_DEBUG_CODEC_PCM 0
+#define AUDIO_DEBUG_CODEC_OPUS 1
+#define AUDIO_DEBUG_FLAG_PRE_TRIGGER 0x01
+#define AUDIO_DEBUG_OPUS_FRAME_MS 20
+#define AUDIO_DEBUG_OPUS_BITRATE 48000
+#define AUDIO_DEBUG_OPUS_COMPLEXITY 3
+
+// The Opus encoder needs about as much stack as the uplink encode task
+#if CONFIG_AUDIO_DEBUG_OPUS
+#define AUDIO_DEBUG_TASK_STACK_SIZE (4096 * 7)
+#else
+#define AUDIO_DEBUG_TASK_STACK_SIZE 4096
+#endif
+
+
+AudioDebugRecorder::AudioDebugRecorder() {
+}
+
+AudioDebugRecorder::~AudioDebugRecorder() {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    if (drain_task_ != nullptr) {
+        vTaskDelete(drain_task_);
+    }
+    if (drain_task_stack_ != nullptr) {
+        heap_caps_free(drain_task_stack_);
+    }
+    if (drain_task_buffer_ != nullptr) {
+        heap_caps_free(drain_task_buffer_);
+    }
+    for (auto& tap : taps_) {
+        if (tap.encoder != nullptr) {
+            opus_encoder_destroy(tap.encoder);
+        }
+    }
+    if (buffer_ != nullptr) {
+        heap_caps_free(buffer_);
+    }
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+#endif
+}
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+
+static void PutLe16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+static void PutLe32(uint8_t* p, uint32_t value) {
+    PutLe16(p, value & 0xffff);
+    PutLe16(p + 2, value >> 16);
+}
+
+bool AudioDebugRecorder::Start() {
+    if (drain_task_ != nullptr) {
+        return true;
+    }
+
+    // 解析配置的服务器地址 "IP:PORT"
+    std::string server = CONFIG_AUDIO_DEBUG_UDP_SERVER;
+    size_t colon_pos = server.find(':');
+    if (colon_pos == std::string::npos) {
+        ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+        return false;
+    }
+    memset(&server_addr_, 0, sizeof(server_addr_));
+    server_addr_.sin_family = AF_INET;
+    server_addr_.sin_port = htons(std::stoi(server.substr(colon_pos + 1)));
+    if (inet_pton(AF_INET, server.substr(0, colon_pos).c_str(), &server_addr_.sin_addr) != 1) {
+        ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0) {
+        ESP_LOGW(TAG, "Failed to create UDP socket: %d", errno);
+        return false;
+    }
+
+    // Every tap gets an equal slice, 512 KB hold 4 s of each tap at 16 kHz
+    size_t buffer_size = CONFIG_AUDIO_DEBUG_BUFFER_KB * 1024;
+    buffer_ = (uint8_t*)heap_caps_malloc(buffer_size, MALLOC_CAP_SPIRAM);
+    if (buffer_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes of PSRAM for the recording", (unsigned)buffer_size);
+        close(socket_);
+        socket_ = -1;
+        return false;
+    }
+    size_t slice = buffer_size / kAudioTapCount;
+    for (int i = 0; i < kAudioTapCount; i++) {
+        taps_[i].ring.Attach(buffer_ + i * slice, slice);
+    }
+
+    drain_task_stack_ = (StackType_t*)heap_caps_malloc(AUDIO_DEBUG_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    assert(drain_task_stack_ != nullptr);
+    drain_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    assert(drain_task_buffer_ != nullptr);
+
+    // Below every audio task, the recording takes what CPU they leave
+    drain_task_ = xTaskCreateStatic([](void* arg) {
+        auto this_ = (AudioDebugRecorder*)arg;
+        this_->DrainTask();
+        vTaskDelete(NULL);
+    }, "audio_debug", AUDIO_DEBUG_TASK_STACK_SIZE, this, 1, drain_task_stack_, drain_task_buffer_);
+
+    ESP_LOGI(TAG, "Recording to %s, %u KB per tap", CONFIG_AUDIO_DEBUG_UDP_SERVER,
+        (unsigned)(taps_[0].ring.capacity() / 1024));
+    return true;
+}
+
+void AudioDebugRecorder::Record(AudioTap tap, const int16_t* pcm, size_t samples, int sample_rate,
+    size_t channels, size_t channel) {
+    if (buffer_ == nullptr || samples == 0) {
+        return;
+    }
+    RecordHeader header;
+    header.sample_rate = sample_rate;
+    header.samples = samples;
+    // The frame has just been captured or decoded, so it started its duration ago
+    header.time_us = esp_timer_get_time() - int64_t(samples) * 1000000 / sample_rate;
+    taps_[tap].ring.Push(header, pcm, channels, channel);
+}
+
+void AudioDebugRecorder::Trigger() {
+    triggers_.fetch_add(1, std::memory_order_relaxed);
+    trigger_pending_.store(true, std::memory_order_release);
+}
+
+AudioDebugRecorderStats AudioDebugRecorder::GetStats() const {
+    AudioDebugRecorderStats stats;
+    for (int i = 0; i < kAudioTapCount; i++) {
+        stats.sent[i] = taps_[i].sent.load(std::memory_order_relaxed);
+        stats.dropped[i] = taps_[i].ring.dropped();
+    }
+    stats.send_errors = send_errors_.load(std::memory_order_relaxed);
+    stats.triggers = triggers_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioDebugRecorder::DrainTask() {
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(AUDIO_DEBUG_DRAIN_INTERVAL_MS));
+
+#if CONFIG_AUDIO_DEBUG_TRIGGERED
+        int64_t now = esp_timer_get_time();
+        if (trigger_pending_.exchange(false, std::memory_order_acquire)) {
+            if (!capturing_) {
+                capturing_ = true;
+                trigger_time_us_ = now;
+                trigger_number_++;
+                ESP_LOGI(TAG, "Trigger %u, sending %d ms before it", trigger_number_,
+                    CONFIG_AUDIO_DEBUG_PRE_TRIGGER_MS);
+            }
+            // A trigger during a capture extends it
+            capture_end_us_ = now + int64_t(CONFIG_AUDIO_DEBUG_POST_TRIGGER_MS) * 1000;
+        }
+
+        if (!capturing_) {
+            // Armed: the rings only keep the pre-trigger window
+            int64_t window_start_us = now - int64_t(CONFIG_AUDIO_DEBUG_PRE_TRIGGER_MS) * 1000;
+            for (auto& tap : taps_) {
+                RecordHeader header;
+                while (tap.ring.Peek(header) && header.time_us < window_start_us) {
+                    tap.ring.Drop();
+                }
+                tap.pending.clear();
+            }
+            continue;
+        }
+
+        for (int i = 0; i < kAudioTapCount; i++) {
+            DrainTap(AudioTap(i), capture_end_us_);
+        }
+        if (now >= capture_end_us_) {
+            capturing_ = false;
+            ESP_LOGI(TAG, "Trigger %u sent", trigger_number_);
+        }
+#else
+        trigger_pending_.store(false, std::memory_order_relaxed);
+        for (int i = 0; i < kAudioTapCount; i++) {
+            DrainTap(AudioTap(i), INT64_MAX);
+        }
+#endif
+    }
+}
+
+void AudioDebugRecorder::DrainTap(AudioTap tap, int64_t until_us) {
+    RecordHeader header;
+    while (taps_[tap].ring.Peek(header) && header.time_us < until_us) {
+        taps_[tap].ring.Pop(header, pcm_buffer_);
+        SendRecord(tap, header, pcm_buffer_);
+    }
+}
+
+void AudioDebugRecorder::SendRecord(AudioTap tap, const RecordHeader& header, const std::vector<int16_t>& pcm) {
+#if CONFIG_AUDIO_DEBUG_OPUS
+    if (SendOpus(tap, header, pcm)) {
+        return;
+    }
+#endif
+    const size_t max_samples = (AUDIO_DEBUG_MAX_DATAGRAM_BYTES - AUDIO_DEBUG_HEADER_BYTES) / sizeof(int16_t);
+    for (size_t offset = 0; offset < pcm.size(); offset += max_samples) {
+        size_t count = std::min(max_samples, pcm.size() - offset);
+        int64_t time_us = header.time_us + int64_t(offset) * 1000000 / header.sample_rate;
+        SendDatagram(tap, AUDIO_DEBUG_CODEC_PCM, header.sample_rate, time_us, pcm.data() + offset,
+            count * sizeof(int16_t));
+    }
+}
+
+bool AudioDebugRecorder::SendOpus(AudioTap tap, const RecordHeader& header, const std::vector<int16_t>& pcm) {
+    auto& state = taps_[tap];
+    int sample_rate = header.sample_rate;
+    if (sample_rate != 8000 && sample_rate != 12000 && sample_rate != 16000 && sample_rate != 24000 &&
+        sample_rate != 48000) {
+        return false;
+    }
+    if (state.encoder == nullptr || state.encoder_sample_rate != sample_rate) {
+        if (state.encoder != nullptr) {
+            opus_encoder_destroy(state.encoder);
+        }
+        int error = 0;
+        state.encoder = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_AUDIO, &error);
+        if (state.encoder == nullptr) {
+            ESP_LOGW(TAG, "Failed to create the Opus encoder: %d", error);
+            state.encoder_sample_rate = 0;
+            return false;
+        }
+        opus_encoder_ctl(state.encoder, OPUS_SET_BITRATE(AUDIO_DEBUG_OPUS_BITRATE));
+        opus_encoder_ctl(state.encoder, OPUS_SET_COMPLEXITY(AUDIO_DEBUG_OPUS_COMPLEXITY));
+        state.encoder_sample_rate = sample_rate;
+        state.pending.clear();
+    }
+
+    // A gap (dropped frames, a trimmed window) must not glue unrelated audio into one packet
+    size_t frame_samples = sample_rate * AUDIO_DEBUG_OPUS_FRAME_MS / 1000;
+    if (!state.pending.empty()) {
+        int64_t expected_us = state.pending_time_us + int64_t(state.pending.size()) * 1000000 / sample_rate;
+        if (std::abs(header.time_us - expected_us) > AUDIO_DEBUG_OPUS_FRAME_MS * 1000 / 2) {
+            state.pending.clear();
+        }
+    }
+    if (state.pending.empty()) {
+        state.pending_time_us = header.time_us;
+    }
+    state.pending.insert(state.pending.end(), pcm.begin(), pcm.end());
+
+    size_t offset = 0;
+    while (state.pending.size() - offset >= frame_samples) {
+        int bytes = opus_encode(state.encoder, state.pending.data() + offset, frame_samples, opus_buffer_,
+            sizeof(opus_buffer_));
+        int64_t time_us = state.pending_time_us + int64_t(offset) * 1000000 / sample_rate;
+        if (bytes > 0) {
+            SendDatagram(tap, AUDIO_DEBUG_CODEC_OPUS, sample_rate, time_us, opus_buffer_, bytes);
+        }
+        offset += frame_samples;
+    }
+    state.pending.erase(state.pending.begin(), state.pending.begin() + offset);
+    state.pending_time_us += int64_t(offset) * 1000000 / sample_rate;
+    return true;
+}
+
+void AudioDebugRecorder::SendDatagram(AudioTap tap, uint8_t codec, uint32_t sample_rate, int64_t time_us,
+    const void* payload, size_t bytes) {
+    auto& state = taps_[tap];
+    datagram_[0] = 'X';
+    datagram_[1] = 'A';
+    datagram_[2] = AUDIO_DEBUG_VERSION;
+    datagram_[3] = tap;
+    datagram_[4] = codec;
+    datagram_[5] = time_us < trigger_time_us_ ? AUDIO_DEBUG_FLAG_PRE_TRIGGER : 0;
+    PutLe16(datagram_ + 6, trigger_number_);
+    PutLe32(datagram_ + 8, sample_rate);
+    PutLe32(datagram_ + 12, state.sequence++);
+    PutLe32(datagram_ + 16, uint32_t(time_us / 1000));
+    memcpy(datagram_ + AUDIO_DEBUG_HEADER_BYTES, payload, bytes);
+
+    ssize_t sent = sendto(socket_, datagram_, AUDIO_DEBUG_HEADER_BYTES + bytes, 0,
+        (struct sockaddr*)&server_addr_, sizeof(server_addr_));
+    if (sent < 0) {
+        send_errors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        state.sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#endif // CONFIG_USE_AUDIO_DEBUGGER
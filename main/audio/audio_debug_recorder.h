@@ -0,0 +1,114 @@
+#ifndef AUDIO_DEBUG_RECORDER_H
+#define AUDIO_DEBUG_RECORDER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <opus.h>
+#include <netinet/in.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "record_ring.h"
+
+// How often the drain task empties the rings
+#define AUDIO_DEBUG_DRAIN_INTERVAL_MS 20
+// Datagram size, header included, below the usual WiFi MTU
+#define AUDIO_DEBUG_MAX_DATAGRAM_BYTES 1400
+#define AUDIO_DEBUG_HEADER_BYTES 20
+
+enum AudioTap {
+    kAudioTapMic,           // Microphone as read from the codec, resampled to 16 kHz
+    kAudioTapReference,     // Playback reference of codecs that capture it, 16 kHz
+    kAudioTapProcessed,     // Audio processor (AFE) output, what the encoder gets
+    kAudioTapDownlink,      // Decoded server voice at the codec output rate, before mixing
+    kAudioTapCount
+};
+
+struct AudioDebugRecorderStats {
+    uint32_t sent[kAudioTapCount] = {};     // Datagrams
+    uint32_t dropped[kAudioTapCount] = {};  // Frames that found their ring full
+    uint32_t send_errors = 0;
+    uint32_t triggers = 0;
+};
+
+/*
+ * Records audio from several points of the pipeline and sends it to scripts/audio_debug_server.py.
+ *
+ * Record() is called on the audio tasks and only copies the frame into its tap's ring, a slice of
+ * one PSRAM buffer. A low priority task drains the rings every AUDIO_DEBUG_DRAIN_INTERVAL_MS and
+ * sends UDP datagrams, as PCM or (AUDIO_DEBUG_OPUS) as 20 ms Opus packets. When the ring of a tap
+ * is full because the network or the drain task cannot keep up, its frames are dropped and counted.
+ *
+ * With AUDIO_DEBUG_TRIGGERED, nothing is sent until Trigger(): the rings keep the last
+ * AUDIO_DEBUG_PRE_TRIGGER_MS, and a trigger sends them followed by AUDIO_DEBUG_POST_TRIGGER_MS of
+ * live audio.
+ *
+ * Every datagram starts with a 20 byte little-endian header:
+ *   0  "XA"        magic
+ *   2  uint8       version, 1
+ *   3  uint8       tap (AudioTap)
+ *   4  uint8       codec, 0 = 16-bit PCM, 1 = Opus
+ *   5  uint8       flags, bit 0 = before the trigger
+ *   6  uint16      trigger number, 0 when streaming continuously
+ *   8  uint32      sample rate
+ *   12 uint32      sequence number, per tap
+ *   16 uint32      capture time of the first sample in milliseconds
+ */
+class AudioDebugRecorder {
+public:
+    AudioDebugRecorder();
+    ~AudioDebugRecorder();
+
+    // Allocates the rings and starts the drain task, returns false if it cannot
+    bool Start();
+    // One task per tap. Keeps `channel` of `channels` interleaved channels
+    void Record(AudioTap tap, const int16_t* pcm, size_t samples, int sample_rate, size_t channels = 1,
+        size_t channel = 0);
+    // Any task, sends the pre-trigger window and what follows; extends a running capture
+    void Trigger();
+    AudioDebugRecorderStats GetStats() const;
+
+private:
+    struct Tap {
+        RecordRing ring;
+        std::atomic<uint32_t> sent{0};
+        uint32_t sequence = 0;
+        // Opus encoding, drain task only
+        OpusEncoder* encoder = nullptr;
+        int encoder_sample_rate = 0;
+        std::vector<int16_t> pending;   // Samples waiting for a full Opus frame
+        int64_t pending_time_us = 0;    // Capture time of pending[0]
+    };
+
+    uint8_t* buffer_ = nullptr;
+    Tap taps_[kAudioTapCount];
+    int socket_ = -1;
+    struct sockaddr_in server_addr_;
+    TaskHandle_t drain_task_ = nullptr;
+    StaticTask_t* drain_task_buffer_ = nullptr;
+    StackType_t* drain_task_stack_ = nullptr;
+
+    std::atomic<bool> trigger_pending_{false};
+    std::atomic<uint32_t> send_errors_{0};
+    std::atomic<uint32_t> triggers_{0};
+
+    // Drain task side
+    bool capturing_ = false;
+    int64_t trigger_time_us_ = 0;
+    int64_t capture_end_us_ = 0;
+    uint16_t trigger_number_ = 0;
+    std::vector<int16_t> pcm_buffer_;
+    uint8_t datagram_[AUDIO_DEBUG_MAX_DATAGRAM_BYTES];
+    uint8_t opus_buffer_[AUDIO_DEBUG_MAX_DATAGRAM_BYTES - AUDIO_DEBUG_HEADER_BYTES];
+
+    void DrainTask();
+    void DrainTap(AudioTap tap, int64_t until_us);
+    void SendRecord(AudioTap tap, const RecordHeader& header, const std::vector<int16_t>& pcm);
+    bool SendOpus(AudioTap tap, const RecordHeader& header, const std::vector<int16_t>& pcm);
+    void SendDatagram(AudioTap tap, uint8_t codec, uint32_t sample_rate, int64_t time_us,
+        const void* payload, size_t bytes);
+};
+
+#endif // AUDIO_DEBUG_RECORDER_H
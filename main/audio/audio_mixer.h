@@ -0,0 +1,309 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dsp_kernels.h"
+#include "spsc_queue.h"
+
+#define AUDIO_MIXER_UNITY_GAIN DSP_Q16_UNITY    // Gains are Q16, as for the output volume
+// Time a gain change (ducking, a stream coming back) takes to ramp, in samples
+#define AUDIO_MIXER_DEFAULT_RAMP_SAMPLES 240
+
+// Logical output streams, each with its own queue in the mixer
+enum MixerStream {
+    kMixerStreamMedia,  // Local media
+    kMixerStreamVoice,  // TTS and audio testing, from the server
+    kMixerStreamSound,  // Prompt and alert sounds
+    kMixerStreamCount,
+};
+
+struct MixerStreamConfig {
+    int priority = 0;                           // Streams with a higher priority duck or pause this one
+    int32_t duck_q16 = AUDIO_MIXER_UNITY_GAIN;  // Gain of the lower priority streams while this one plays
+    bool pause_lower = false;                   // Lower priority streams are held, not mixed, while this one plays
+};
+
+/*
+ * Mixes the frames of the logical output streams in front of the codec.
+ *
+ * Every stream is an SPSC queue of PCM frames at the codec's output rate. Frames of different
+ * streams need not line up: the mix keeps a sample position in the head frame of every stream,
+ * so streams are mixed sample-accurately across frame boundaries. A stream's gain is its own
+ * gain times the lowest duck gain of the higher priority streams playing, and gain changes are
+ * ramped over a few milliseconds. While a stream with pause_lower plays, the streams below it
+ * are not consumed and continue where they stopped.
+ *
+ * When a single stream plays at unity gain from the start of its head frame, that frame is
+ * handed to the output as is, without a copy.
+ *
+ * FramePtr is a pointer-like handle to a type with a free function FrameBuffer(T&) returning
+ * its PCM vector (as for FramePool). Each stream has one producer task calling Push() / Full(),
+ * and Mix() is called by the one output task. SetGain() and Clear() may be called from any task.
+ */
+template <typename FramePtr, size_t QueueFrames>
+class AudioMixer {
+public:
+    using Frame = std::remove_reference_t<decltype(*std::declval<FramePtr&>())>;
+
+    void Configure(size_t frame_samples, size_t ramp_samples = AUDIO_MIXER_DEFAULT_RAMP_SAMPLES) {
+        frame_samples_ = frame_samples;
+        ramp_step_ = ramp_samples > 0 ? std::max<int32_t>(1, AUDIO_MIXER_UNITY_GAIN / int32_t(ramp_samples))
+            : AUDIO_MIXER_UNITY_GAIN;
+        accumulator_.assign(frame_samples_, 0);
+        mix_buffer_.reserve(frame_samples_);
+        retired_.reserve(kMixerStreamCount * (QueueFrames + 1));
+    }
+
+    // Call before the output task runs
+    void SetStreamConfig(MixerStream stream, const MixerStreamConfig& config) { streams_[stream].config = config; }
+    void SetGain(MixerStream stream, int32_t gain_q16) { streams_[stream].gain.store(gain_q16, std::memory_order_relaxed); }
+    int32_t gain(MixerStream stream) const { return streams_[stream].gain.load(std::memory_order_relaxed); }
+
+    // Producer side
+    bool Push(MixerStream stream, FramePtr&& frame) { return streams_[stream].queue.Push(std::move(frame)); }
+    bool Full(MixerStream stream) const { return streams_[stream].queue.Size() >= QueueFrames; }
+    size_t Size(MixerStream stream) const { return streams_[stream].queue.Size(); }
+
+    // Any side, the queued frames and the partly played one are dropped
+    void Clear(MixerStream stream) {
+        streams_[stream].queue.Clear();
+        streams_[stream].reset_pending.store(true, std::memory_order_release);
+    }
+    void Clear() {
+        for (int i = 0; i < kMixerStreamCount; i++) {
+            Clear(MixerStream(i));
+        }
+    }
+
+    bool Empty(MixerStream stream) const { return streams_[stream].queue.Empty(); }
+    bool Empty() const {
+        for (auto& stream : streams_) {
+            if (!stream.queue.Empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Outputs the next block, up to frame_samples samples (a passed-through frame may be longer).
+     * Calls output(const std::vector<int16_t>& pcm) once, then release(MixerStream, FramePtr&)
+     * for every frame that finished playing in this block, in the order they finished.
+     * Returns false without calling either if no stream has anything to play.
+     */
+    template <typename Output, typename Release>
+    bool Mix(Output&& output, Release&& release) {
+        if (frame_samples_ == 0) {
+            return false;
+        }
+        for (auto& stream : streams_) {
+            stream.span_count = 0;
+        }
+
+        // Find the playing streams and their gains
+        Stream* playing[kMixerStreamCount];
+        int playing_count = 0;
+        for (int i = 0; i < kMixerStreamCount; i++) {
+            auto& stream = streams_[i];
+            if (stream.reset_pending.exchange(false, std::memory_order_acquire)) {
+                stream.active = false;
+                // A recycled frame may come back at the address of the cleared one, it starts from the beginning
+                stream.offset = 0;
+                stream.offset_owner = nullptr;
+            }
+            stream.head = Head(stream);
+            if (stream.head == nullptr && stream.active) {
+                stream.active = false;
+            }
+        }
+        for (int i = 0; i < kMixerStreamCount; i++) {
+            auto& stream = streams_[i];
+            if (stream.head == nullptr) {
+                continue;
+            }
+            int32_t duck = AUDIO_MIXER_UNITY_GAIN;
+            bool paused = false;
+            for (auto& other : streams_) {
+                if (other.head != nullptr && other.config.priority > stream.config.priority) {
+                    duck = std::min(duck, other.config.duck_q16);
+                    paused = paused || other.config.pause_lower;
+                }
+            }
+            if (paused) {
+                // Comes back with a ramp from silence
+                stream.current_gain = 0;
+                stream.active = true;
+                continue;
+            }
+            stream.target_gain = int32_t((int64_t(stream.gain.load(std::memory_order_relaxed)) * duck + 0x8000) >> 16);
+            if (!stream.active) {
+                // A stream starting from silence starts at its gain
+                stream.current_gain = stream.target_gain;
+                stream.active = true;
+            }
+            playing[playing_count++] = &stream;
+        }
+        if (playing_count == 0) {
+            return false;
+        }
+
+        // A lone stream at unity gain from the start of a frame is passed through
+        if (playing_count == 1) {
+            auto& stream = *playing[0];
+            if (stream.offset == 0 && stream.current_gain == AUDIO_MIXER_UNITY_GAIN &&
+                stream.target_gain == AUDIO_MIXER_UNITY_GAIN) {
+                FramePtr frame;
+                stream.queue.Pop(frame);
+                stream.offset_owner = nullptr;
+                AddSpan(stream, *frame, 0, 0, FrameBuffer(*frame).size());
+                output(static_cast<const std::vector<int16_t>&>(FrameBuffer(*frame)));
+                release(MixerStream(&stream - streams_), frame);
+                return true;
+            }
+        }
+
+        // The block is as long as the longest head frame has left, so no playing stream runs dry early
+        size_t samples = 0;
+        for (int i = 0; i < playing_count; i++) {
+            samples = std::max(samples, FrameBuffer(**playing[i]->head).size() - playing[i]->offset);
+        }
+        samples = std::min(samples, frame_samples_);
+
+        std::fill(accumulator_.begin(), accumulator_.begin() + samples, 0);
+        for (int i = 0; i < playing_count; i++) {
+            MixStream(*playing[i], samples);
+        }
+
+        mix_buffer_.resize(samples);
+        for (size_t i = 0; i < samples; i++) {
+            mix_buffer_[i] = int16_t(std::clamp<int32_t>(accumulator_[i], INT16_MIN, INT16_MAX));
+        }
+        output(static_cast<const std::vector<int16_t>&>(mix_buffer_));
+
+        for (auto& retired : retired_) {
+            release(retired.stream, retired.frame);
+        }
+        retired_.clear();
+        return true;
+    }
+
+    size_t frame_samples() const { return frame_samples_; }
+
+    /*
+     * Only valid inside the output callback: calls fn(Frame& frame, size_t frame_offset,
+     * size_t block_offset, size_t samples) for every run of the stream's frames in the block,
+     * e.g. to find when each sample of a frame is played.
+     */
+    template <typename Fn>
+    void ForEachSpan(MixerStream stream, Fn&& fn) const {
+        auto& s = streams_[stream];
+        for (size_t i = 0; i < s.span_count; i++) {
+            auto& span = s.spans[i];
+            fn(*span.frame, span.frame_offset, span.block_offset, span.samples);
+        }
+    }
+
+private:
+    struct Span {
+        Frame* frame;
+        size_t frame_offset;
+        size_t block_offset;
+        size_t samples;
+    };
+
+    struct Stream {
+        SpscQueue<FramePtr, QueueFrames> queue;
+        MixerStreamConfig config;
+        std::atomic<int32_t> gain{AUDIO_MIXER_UNITY_GAIN};
+        std::atomic<bool> reset_pending{false};
+        // Output task side
+        FramePtr* head = nullptr;
+        size_t offset = 0;                  // Samples of the head frame already played
+        const void* offset_owner = nullptr; // The frame `offset` belongs to
+        int32_t current_gain = AUDIO_MIXER_UNITY_GAIN;
+        int32_t target_gain = AUDIO_MIXER_UNITY_GAIN;
+        bool active = false;
+        // Frames played in the current block, a block spans at most every queued frame plus the one popped
+        Span spans[QueueFrames + 1];
+        size_t span_count = 0;
+    };
+
+    struct Retired {
+        MixerStream stream;
+        FramePtr frame;
+    };
+
+    Stream streams_[kMixerStreamCount];
+    size_t frame_samples_ = 0;
+    int32_t ramp_step_ = AUDIO_MIXER_UNITY_GAIN;
+    std::vector<int32_t> accumulator_;
+    std::vector<int16_t> mix_buffer_;
+    // Frames finished in the current block, released after the output
+    std::vector<Retired> retired_;
+
+    // Adds up to `samples` samples of the stream, moving on to its next frames as they finish
+    void MixStream(Stream& stream, size_t samples) {
+        size_t position = 0;
+        while (position < samples) {
+            FramePtr* head = Head(stream);
+            if (head == nullptr) {
+                // Underrun, the rest of the block is silence for this stream
+                break;
+            }
+            auto& pcm = FrameBuffer(**head);
+            size_t count = std::min(samples - position, pcm.size() - stream.offset);
+            AddSpan(stream, **head, stream.offset, position, count);
+            AddScaled(stream, pcm.data() + stream.offset, accumulator_.data() + position, count);
+            position += count;
+            stream.offset += count;
+            if (stream.offset == pcm.size()) {
+                Retired retired{MixerStream(&stream - streams_), FramePtr()};
+                stream.queue.Pop(retired.frame);
+                retired_.push_back(std::move(retired));
+                stream.offset = 0;
+                stream.offset_owner = nullptr;
+            }
+        }
+    }
+
+    void AddSpan(Stream& stream, Frame& frame, size_t frame_offset, size_t block_offset, size_t samples) {
+        if (stream.span_count < QueueFrames + 1) {
+            stream.spans[stream.span_count++] = Span{&frame, frame_offset, block_offset, samples};
+        }
+    }
+
+    // The head frame of the stream, the sample position restarts when the head is a new frame (e.g. after a Clear())
+    FramePtr* Head(Stream& stream) {
+        FramePtr* head = stream.queue.Front();
+        const void* owner = head != nullptr ? &FrameBuffer(**head) : nullptr;
+        if (owner != stream.offset_owner || (head != nullptr && stream.offset > FrameBuffer(**head).size())) {
+            stream.offset = 0;
+            stream.offset_owner = owner;
+        }
+        return head;
+    }
+
+    void AddScaled(Stream& stream, const int16_t* src, int32_t* dst, size_t count) {
+        size_t i = 0;
+        // Ramp towards the target gain, one step per sample
+        while (i < count && stream.current_gain != stream.target_gain) {
+            if (stream.current_gain < stream.target_gain) {
+                stream.current_gain = std::min(stream.current_gain + ramp_step_, stream.target_gain);
+            } else {
+                stream.current_gain = std::max(stream.current_gain - ramp_step_, stream.target_gain);
+            }
+            dst[i] += DspScaleQ16(src[i], stream.current_gain);
+            i++;
+        }
+        DspMixGainQ16(src + i, dst + i, count - i, stream.current_gain);
+    }
+};
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,199 @@
+#include "audio_power_policy.h"
+
+#include <algorithm>
+
+const char* AudioPowerPolicy::ModeName(AudioPowerMode mode) {
+    switch (mode) {
+        case kAudioPowerModeDefault: return "default";
+        case kAudioPowerModeIdle: return "idle";
+        case kAudioPowerModeSession: return "session";
+        default: return "unknown";
+    }
+}
+
+const char* AudioPowerPolicy::ReasonName(AudioPowerReason reason) {
+    switch (reason) {
+        case kAudioPowerReasonDemand: return "demand";
+        case kAudioPowerReasonSession: return "session";
+        case kAudioPowerReasonWakeWord: return "wake_word";
+        case kAudioPowerReasonButton: return "button";
+        case kAudioPowerReasonTimeout: return "timeout";
+        case kAudioPowerReasonExpected: return "expected";
+        case kAudioPowerReasonDeepIdle: return "deep_idle";
+        default: return "unknown";
+    }
+}
+
+uint32_t AudioPowerPolicy::IdleTimeoutMs(AudioPowerReason* reason) const {
+    *reason = kAudioPowerReasonTimeout;
+    if (history_count_ < AUDIO_POWER_MIN_HISTORY) {
+        return AUDIO_POWER_TIMEOUT_MS;
+    }
+    size_t quick = 0;
+    uint32_t longest_quick = 0;
+    for (size_t i = 0; i < history_count_; i++) {
+        if (history_[i] <= AUDIO_POWER_TIMEOUT_MS) {
+            quick++;
+            longest_quick = std::max(longest_quick, history_[i]);
+        }
+    }
+    if (quick * 2 < history_count_) {
+        *reason = kAudioPowerReasonDeepIdle;
+        return AUDIO_POWER_MIN_TIMEOUT_MS;
+    }
+    *reason = kAudioPowerReasonExpected;
+    return std::clamp<uint32_t>(longest_quick + AUDIO_POWER_RETURN_MARGIN_MS,
+        AUDIO_POWER_MIN_TIMEOUT_MS, AUDIO_POWER_TIMEOUT_MS);
+}
+
+int64_t AudioPowerPolicy::TimeoutMs() const {
+    AudioPowerReason reason;
+    switch (mode_) {
+        case kAudioPowerModeSession: return -1;
+        case kAudioPowerModeIdle: return IdleTimeoutMs(&reason);
+        default: return AUDIO_POWER_TIMEOUT_MS;
+    }
+}
+
+AudioPowerAction AudioPowerPolicy::SetMode(AudioPowerMode mode, int64_t now_ms, const AudioPowerState& state) {
+    AudioPowerAction action;
+    if (mode == mode_) {
+        return action;
+    }
+
+    // The user came back: remember after how long, it sets the next idle timeout
+    if (mode_ == kAudioPowerModeIdle && mode == kAudioPowerModeSession && idle_since_ms_ >= 0) {
+        int64_t away_ms = now_ms - idle_since_ms_;
+        history_[history_next_] = uint32_t(std::min<int64_t>(away_ms, UINT32_MAX));
+        history_next_ = (history_next_ + 1) % AUDIO_POWER_HISTORY_SIZE;
+        history_count_ = std::min<size_t>(history_count_ + 1, AUDIO_POWER_HISTORY_SIZE);
+    }
+    idle_since_ms_ = mode == kAudioPowerModeIdle ? now_ms : -1;
+    mode_ = mode;
+
+    AudioPowerReason reason;
+    stats_.idle_timeout_ms = IdleTimeoutMs(&reason);
+    if (mode == kAudioPowerModeSession) {
+        // A session listens and answers, have both directions ready before the first frame
+        PowerOn(kAudioPowerInput, kAudioPowerReasonSession, now_ms, false, state, action);
+        PowerOn(kAudioPowerOutput, kAudioPowerReasonSession, now_ms, false, state, action);
+    }
+    return action;
+}
+
+AudioPowerAction AudioPowerPolicy::OnHint(AudioPowerHint hint, int64_t now_ms, const AudioPowerState& state) {
+    AudioPowerAction action;
+    if (hint == kAudioPowerHintButton) {
+        // A button starts listening right away, or plays a sound first
+        PowerOn(kAudioPowerInput, kAudioPowerReasonButton, now_ms, true, state, action);
+        PowerOn(kAudioPowerOutput, kAudioPowerReasonButton, now_ms, true, state, action);
+    } else {
+        // The input is already on to hear the wake word, the reply needs the amplifier
+        PowerOn(kAudioPowerOutput, kAudioPowerReasonWakeWord, now_ms, true, state, action);
+    }
+    return action;
+}
+
+void AudioPowerPolicy::OnDemand(AudioPowerDirection direction, int64_t now_ms) {
+    stats_.cold_starts[direction]++;
+    counted_until_ms_[direction] = now_ms;
+    Record(direction, true, kAudioPowerReasonDemand, now_ms, 0);
+}
+
+AudioPowerAction AudioPowerPolicy::Update(int64_t now_ms, const AudioPowerState& state) {
+    AudioPowerAction action;
+    AudioPowerReason idle_reason = kAudioPowerReasonTimeout;
+    int64_t timeout_ms = AUDIO_POWER_TIMEOUT_MS;
+    if (mode_ == kAudioPowerModeIdle) {
+        timeout_ms = IdleTimeoutMs(&idle_reason);
+    }
+
+    for (int i = 0; i < kAudioPowerDirectionCount; i++) {
+        auto direction = AudioPowerDirection(i);
+        int64_t idle_ms = state.idle_ms[i];
+        Prewarm& prewarm = prewarm_[i];
+        if (!state.on[i]) {
+            if (prewarm.since_ms >= 0) {
+                // Switched off by someone else before it was used
+                EndPrewarm(direction, false);
+            }
+            counted_until_ms_[i] = -1;
+            continue;
+        }
+
+        // Powered by someone else (the codec starts powered) counts from the first time it is seen
+        if (counted_until_ms_[i] >= 0) {
+            int64_t powered_ms = std::max<int64_t>(now_ms - counted_until_ms_[i], 0);
+            stats_.powered_ms[i] += powered_ms;
+            stats_.idle_powered_ms[i] += std::clamp<int64_t>(idle_ms, 0, powered_ms);
+        }
+        counted_until_ms_[i] = now_ms;
+
+        if (prewarm.since_ms >= 0) {
+            if (now_ms - idle_ms >= prewarm.since_ms) {
+                EndPrewarm(direction, true);
+            } else if (now_ms < prewarm.until_ms) {
+                continue;
+            } else {
+                EndPrewarm(direction, false);
+            }
+        }
+
+        if (mode_ == kAudioPowerModeSession || idle_ms < timeout_ms) {
+            continue;
+        }
+        action.power_off[i] = true;
+        action.reason[i] = idle_reason;
+        counted_until_ms_[i] = -1;
+        Record(direction, false, idle_reason, now_ms, idle_ms);
+    }
+    return action;
+}
+
+size_t AudioPowerPolicy::GetDecisions(AudioPowerDecision* decisions, size_t max) const {
+    size_t count = std::min(max, log_count_);
+    size_t first = (log_next_ + AUDIO_POWER_LOG_SIZE - count) % AUDIO_POWER_LOG_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        decisions[i] = log_[(first + i) % AUDIO_POWER_LOG_SIZE];
+    }
+    return count;
+}
+
+void AudioPowerPolicy::PowerOn(AudioPowerDirection direction, AudioPowerReason reason, int64_t now_ms, bool hold,
+    const AudioPowerState& state, AudioPowerAction& action) {
+    if (state.on[direction]) {
+        return;
+    }
+    if (hold) {
+        prewarm_[direction].since_ms = now_ms;
+        prewarm_[direction].until_ms = now_ms + AUDIO_POWER_PREWARM_HOLD_MS;
+    }
+    action.power_on[direction] = true;
+    action.reason[direction] = reason;
+    counted_until_ms_[direction] = now_ms;
+    Record(direction, true, reason, now_ms, 0);
+}
+
+void AudioPowerPolicy::EndPrewarm(AudioPowerDirection direction, bool used) {
+    if (used) {
+        stats_.prewarm_hits++;
+    } else {
+        stats_.prewarm_misses++;
+    }
+    prewarm_[direction].since_ms = -1;
+    prewarm_[direction].until_ms = -1;
+}
+
+void AudioPowerPolicy::Record(AudioPowerDirection direction, bool power_on, AudioPowerReason reason, int64_t now_ms,
+    int64_t idle_ms) {
+    AudioPowerDecision& decision = log_[log_next_];
+    decision.time_ms = uint32_t(now_ms);
+    decision.direction = direction;
+    decision.power_on = power_on;
+    decision.reason = reason;
+    decision.mode = mode_;
+    decision.idle_ms = uint32_t(std::min<int64_t>(idle_ms, UINT32_MAX));
+    log_next_ = (log_next_ + 1) % AUDIO_POWER_LOG_SIZE;
+    log_count_ = std::min<size_t>(log_count_ + 1, AUDIO_POWER_LOG_SIZE);
+    stats_.decisions[reason]++;
+}
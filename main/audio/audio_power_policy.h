@@ -0,0 +1,151 @@
+#ifndef AUDIO_POWER_POLICY_H
+#define AUDIO_POWER_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Idle time before a direction is powered down when nothing better is known (the former fixed timeout)
+#define AUDIO_POWER_TIMEOUT_MS 15000
+#define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+// Shortest idle time before powering down, used when the user is not expected back soon
+#define AUDIO_POWER_MIN_TIMEOUT_MS 3000
+// Added to the longest quick return seen, so that a return just as quick finds the codec on
+#define AUDIO_POWER_RETURN_MARGIN_MS 1000
+// How long a direction powered ahead of an interaction is kept on before it counts as a miss
+#define AUDIO_POWER_PREWARM_HOLD_MS 8000
+// Idle periods remembered, and how many are needed before they change the timeout
+#define AUDIO_POWER_HISTORY_SIZE 8
+#define AUDIO_POWER_MIN_HISTORY 3
+#define AUDIO_POWER_LOG_SIZE 32
+
+enum AudioPowerMode {
+    kAudioPowerModeDefault,   // Starting, configuring, upgrading: the fixed timeout
+    kAudioPowerModeIdle,      // Waiting for a wake word or a button
+    kAudioPowerModeSession,   // Connecting, listening or speaking: stays powered
+};
+
+enum AudioPowerHint {
+    kAudioPowerHintWakeWord,
+    kAudioPowerHintButton,
+};
+
+enum AudioPowerReason {
+    kAudioPowerReasonDemand,      // Audio had to be read or played while the direction was off
+    kAudioPowerReasonSession,     // A session started
+    kAudioPowerReasonWakeWord,    // Powered ahead of the reply to a wake word
+    kAudioPowerReasonButton,      // Powered ahead of a button interaction
+    kAudioPowerReasonTimeout,     // Idle for the fixed timeout
+    kAudioPowerReasonExpected,    // Idle past the time the user usually comes back in
+    kAudioPowerReasonDeepIdle,    // Idle, and the user is not expected back soon
+    kAudioPowerReasonCount,
+};
+
+enum AudioPowerDirection {
+    kAudioPowerInput,
+    kAudioPowerOutput,
+    kAudioPowerDirectionCount,
+};
+
+// A change the policy asks for, or one it was told of (kAudioPowerReasonDemand)
+struct AudioPowerDecision {
+    uint32_t time_ms = 0;
+    AudioPowerDirection direction = kAudioPowerInput;
+    bool power_on = false;
+    AudioPowerReason reason = kAudioPowerReasonDemand;
+    AudioPowerMode mode = kAudioPowerModeDefault;
+    uint32_t idle_ms = 0;       // Idle time of the direction when it was powered down
+};
+
+struct AudioPowerStats {
+    uint32_t decisions[kAudioPowerReasonCount] = {};
+    // Interactions that paid the power-up latency: audio needed a direction that was off
+    uint32_t cold_starts[kAudioPowerDirectionCount] = {};
+    // Powered ahead of an interaction: used while held on, or powered down again unused
+    uint32_t prewarm_hits = 0;
+    uint32_t prewarm_misses = 0;
+    // Time each direction spent powered, and powered without audio, the battery side of the trade-off
+    uint64_t powered_ms[kAudioPowerDirectionCount] = {};
+    uint64_t idle_powered_ms[kAudioPowerDirectionCount] = {};
+    uint32_t idle_timeout_ms = AUDIO_POWER_TIMEOUT_MS;  // What the idle mode uses now
+};
+
+// What the service sees of the codec when it asks the policy
+struct AudioPowerState {
+    bool on[kAudioPowerDirectionCount] = {};
+    // Since the direction last carried audio
+    int64_t idle_ms[kAudioPowerDirectionCount] = {};
+};
+
+// What the caller should do after a call, the decisions are already logged
+struct AudioPowerAction {
+    bool power_on[kAudioPowerDirectionCount] = {};
+    bool power_off[kAudioPowerDirectionCount] = {};
+    AudioPowerReason reason[kAudioPowerDirectionCount] = {};
+
+    bool Empty() const {
+        return !power_on[kAudioPowerInput] && !power_on[kAudioPowerOutput] &&
+            !power_off[kAudioPowerInput] && !power_off[kAudioPowerOutput];
+    }
+};
+
+/*
+ * Decides when the codec input (ADC) and output (amplifier) are powered, instead of a fixed timeout.
+ *
+ * During a session both directions stay on. In idle, the timeout follows how long the user has
+ * recently stayed away before the next session: if at least half of the recent idle periods ended
+ * within AUDIO_POWER_TIMEOUT_MS, the codec stays on a little longer than the longest of those, so
+ * the quick return finds it warm; otherwise it powers down after AUDIO_POWER_MIN_TIMEOUT_MS. A wake
+ * word or a button press powers the directions the interaction is about to use right away, ahead
+ * of the connection and the reply.
+ *
+ * The codec may also be switched by others (on demand, power save), so every call takes its
+ * current state. Every decision goes into a small log with its reason, and the stats weigh the
+ * powered time against the cold starts. Not thread safe, times are milliseconds on any monotonic clock.
+ */
+class AudioPowerPolicy {
+public:
+    AudioPowerAction SetMode(AudioPowerMode mode, int64_t now_ms, const AudioPowerState& state);
+    AudioPowerAction OnHint(AudioPowerHint hint, int64_t now_ms, const AudioPowerState& state);
+    // A direction was powered on demand, because audio needed it while it was off
+    void OnDemand(AudioPowerDirection direction, int64_t now_ms);
+    // Periodically, while any direction is powered
+    AudioPowerAction Update(int64_t now_ms, const AudioPowerState& state);
+
+    AudioPowerMode mode() const { return mode_; }
+    const AudioPowerStats& stats() const { return stats_; }
+    // Idle time before a direction powers down in the current mode, -1 if it stays powered
+    int64_t TimeoutMs() const;
+    // Copies up to `max` of the latest decisions, oldest first, returns how many
+    size_t GetDecisions(AudioPowerDecision* decisions, size_t max) const;
+
+    static const char* ModeName(AudioPowerMode mode);
+    static const char* ReasonName(AudioPowerReason reason);
+
+private:
+    struct Prewarm {
+        int64_t since_ms = -1;  // -1 if the direction was not powered ahead
+        int64_t until_ms = -1;
+    };
+
+    AudioPowerMode mode_ = kAudioPowerModeDefault;
+    Prewarm prewarm_[kAudioPowerDirectionCount];
+    // Powered time is counted up to here, -1 while the direction is off
+    int64_t counted_until_ms_[kAudioPowerDirectionCount] = {-1, -1};
+    int64_t idle_since_ms_ = -1;
+    uint32_t history_[AUDIO_POWER_HISTORY_SIZE] = {};
+    size_t history_count_ = 0;
+    size_t history_next_ = 0;
+    AudioPowerDecision log_[AUDIO_POWER_LOG_SIZE];
+    size_t log_count_ = 0;
+    size_t log_next_ = 0;
+    AudioPowerStats stats_;
+
+    uint32_t IdleTimeoutMs(AudioPowerReason* reason) const;
+    void PowerOn(AudioPowerDirection direction, AudioPowerReason reason, int64_t now_ms, bool hold,
+        const AudioPowerState& state, AudioPowerAction& action);
+    void EndPrewarm(AudioPowerDirection direction, bool used);
+    void Record(AudioPowerDirection direction, bool power_on, AudioPowerReason reason, int64_t now_ms,
+        int64_t idle_ms);
+};
+
+#endif // AUDIO_POWER_POLICY_H
@@ -1,6 +1,7 @@
 #include "audio_service.h"
+#include "dsp_kernels.h"
 #include <esp_log.h>
-#include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -17,15 +18,29 @@
 
 #define TAG "AudioService"
 
+// A core that does not exist on this chip means no affinity
+static BaseType_t TaskCoreId(int core) {
+    return core >= 0 && core < portNUM_PROCESSORS ? core : tskNO_AFFINITY;
+}
+
+static void RecordPeak(std::atomic<size_t>& peak, size_t depth) {
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (depth > current && !peak.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
+    queue_event_group_ = xEventGroupCreate();
 }
 
 AudioService::~AudioService() {
     if (event_group_ != nullptr) {
         vEventGroupDelete(event_group_);
     }
+    if (queue_event_group_ != nullptr) {
+        vEventGroupDelete(queue_event_group_);
+    }
 }
 
 
@@ -34,15 +49,30 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_->Start();
 
     /* Setup the audio codec */
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    voice_decoders_.Initialize(codec->output_sample_rate());
+    voice_decoders_.Select(codec->output_sample_rate(), OPUS_FRAME_DURATION_MS);
+    sound_decoders_.Initialize(codec->output_sample_rate());
+    sound_decoders_.Select(codec->output_sample_rate(), SOUND_FRAME_DURATION_MS);
+    opus_encoder_ = std::make_unique<OpusUplinkEncoder>(16000, 0, LinkRateController::ProfileOf(kLinkQualityNormal));
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
 
+    /* Preallocate the frames used by the encode / decode path */
+    int max_sample_rate = std::max(16000, codec->output_sample_rate());
+    task_pool_.Initialize(max_sample_rate * OPUS_FRAME_DURATION_MS / 1000, AUDIO_TASK_POOL_SIZE);
+    packet_pool_.Initialize(AUDIO_PACKET_POOL_PAYLOAD_BYTES, MAX_SEND_PACKETS_IN_QUEUE);
+    sound_packet_.payload.reserve(AUDIO_PACKET_POOL_PAYLOAD_BYTES);
+    silence_gate_.Configure(16000 * OPUS_FRAME_DURATION_MS / 1000);
+
+    /* The voice ducks local media, a sound ducks both */
+    mixer_.Configure(codec->output_sample_rate() * OPUS_FRAME_DURATION_MS / 1000);
+    mixer_.SetStreamConfig(kMixerStreamMedia, {0, AUDIO_MIXER_UNITY_GAIN, false});
+    mixer_.SetStreamConfig(kMixerStreamVoice, {1, AUDIO_MIXER_VOICE_DUCK_GAIN, false});
+    mixer_.SetStreamConfig(kMixerStreamSound, {2, AUDIO_MIXER_SOUND_DUCK_GAIN, false});
+
 #if CONFIG_USE_AUDIO_PROCESSOR
     audio_processor_ = std::make_unique<AfeAudioProcessor>();
 #else
@@ -50,7 +80,31 @@ void AudioService::Initialize(AudioCodec* codec) {
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+        UplinkFrameTag tag;
+        tag.trace_time_us = tracer_.OnProcessorOutput(data.size());
+        tracer_.Record(kAudioTraceProcessed, tag.trace_time_us);
+#if CONFIG_USE_AUDIO_DEBUGGER
+        if (debug_recorder_ != nullptr) {
+            debug_recorder_->Record(kAudioTapProcessed, data.data(), data.size(), 16000);
+        }
+#endif
+#if CONFIG_USE_SERVER_AEC
+        /* Stamp the frame with the server time of the voice that was playing while it was captured */
+        int64_t capture_us = playback_clock_.OnCaptureOutput(data.size());
+        if (capture_us != 0) {
+            tag.timestamp = playback_clock_.ServerTimeAt(capture_us, int64_t(data.size()) * 1000000 / 16000);
+        }
+#endif
+#if CONFIG_USE_AUDIO_PROCESSOR
+        // Device AEC turns the VAD off, every frame is speech then
+        bool speaking = voice_detected_ || device_aec_enabled_;
+#else
+        bool speaking = true;
+#endif
+        silence_gate_.Process(data, tag, speaking,
+            [this](const std::vector<int16_t>& pcm, const UplinkFrameTag& tag, bool silent) {
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, pcm.data(), pcm.size(), tag, silent);
+            });
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -71,6 +125,16 @@ void AudioService::Initialize(AudioCodec* codec) {
         .skip_unhandled_events = true,
     };
     esp_timer_create(&audio_power_timer_args, &audio_power_timer_);
+
+#if CONFIG_USE_AUDIO_TRACER
+    tracer_.SetEnabled(true);
+#endif
+#if CONFIG_USE_AUDIO_DEBUGGER
+    debug_recorder_ = std::make_unique<AudioDebugRecorder>();
+    if (!debug_recorder_->Start()) {
+        debug_recorder_.reset();
+    }
+#endif
 }
 
 void AudioService::Start() {
@@ -109,12 +173,20 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
-    xTaskCreate([](void* arg) {
+    /* Start the Opus workers, each with its own core, priority and stack (see Kconfig) */
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncodeTask();
+        vTaskDelete(NULL);
+    }, "opus_encode", CONFIG_OPUS_ENCODE_TASK_STACK_SIZE, this, CONFIG_OPUS_ENCODE_TASK_PRIORITY,
+        &opus_encode_task_handle_, TaskCoreId(CONFIG_OPUS_ENCODE_TASK_CORE));
+
+    xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusDecodeTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+    }, "opus_decode", CONFIG_OPUS_DECODE_TASK_STACK_SIZE, this, CONFIG_OPUS_DECODE_TASK_PRIORITY,
+        &opus_decode_task_handle_, TaskCoreId(CONFIG_OPUS_DECODE_TASK_CORE));
 }
 
 void AudioService::Stop() {
@@ -124,19 +196,19 @@ void AudioService::Stop() {
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    mixer_.Clear();
+    audio_testing_queue_.Clear();
+    jitter_buffer_.Reset();
+    sound_player_.CancelAll();
+    /* Wake up every task waiting on a queue so that it can see service_stopped_ */
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_ALL_BITS);
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
     if (!codec_->input_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableInput(true);
+        PowerOnDemand(kAudioPowerInput);
     }
 
     if (codec_->input_sample_rate() != sample_rate) {
@@ -144,26 +216,23 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
         if (!codec_->InputData(data)) {
             return false;
         }
+        /* The scratch buffers keep their capacity, so no allocation happens after the first frame */
+        std::lock_guard<std::mutex> lock(input_buffer_mutex_);
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
+            input_mic_buffer_.resize(data.size() / 2);
+            input_reference_buffer_.resize(data.size() / 2);
+            DspDeinterleave2(data.data(), input_mic_buffer_.data(), input_reference_buffer_.data(), input_mic_buffer_.size());
+            resampled_mic_buffer_.resize(input_resampler_.GetOutputSamples(input_mic_buffer_.size()));
+            resampled_reference_buffer_.resize(reference_resampler_.GetOutputSamples(input_reference_buffer_.size()));
+            input_resampler_.Process(input_mic_buffer_.data(), input_mic_buffer_.size(), resampled_mic_buffer_.data());
+            reference_resampler_.Process(input_reference_buffer_.data(), input_reference_buffer_.size(), resampled_reference_buffer_.data());
+            data.resize(resampled_mic_buffer_.size() + resampled_reference_buffer_.size());
+            DspInterleave2(resampled_mic_buffer_.data(), resampled_reference_buffer_.data(), data.data(),
+                resampled_mic_buffer_.size());
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            resampled_mic_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+            input_resampler_.Process(data.data(), data.size(), resampled_mic_buffer_.data());
+            data.assign(resampled_mic_buffer_.begin(), resampled_mic_buffer_.end());
         }
     } else {
         data.resize(samples * codec_->input_channels());
@@ -177,11 +246,13 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
     debug_statistics_.input_count++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
-    // 音频调试：发送原始音频数据
-    if (audio_debugger_ == nullptr) {
-        audio_debugger_ = std::make_unique<AudioDebugger>();
+    if (debug_recorder_ != nullptr) {
+        size_t channels = codec_->input_channels();
+        debug_recorder_->Record(kAudioTapMic, data.data(), data.size() / channels, sample_rate, channels, 0);
+        if (channels == 2 && codec_->input_reference()) {
+            debug_recorder_->Record(kAudioTapReference, data.data(), data.size() / 2, sample_rate, 2, 1);
+        }
     }
-    audio_debugger_->Feed(data);
 #endif
 
     return true;
@@ -202,238 +273,412 @@ void AudioService::AudioInputTask() {
             continue;
         }
 
-        /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
-        if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
-                ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
-                EnableAudioTesting(false);
-                continue;
-            }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
-            if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
-                if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
-                }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
-                continue;
-            }
+        if ((bits & AS_EVENT_AUDIO_TESTING_RUNNING) && audio_testing_queue_.Size() >= MAX_TESTING_PACKETS_IN_QUEUE) {
+            ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
+            EnableAudioTesting(false);
+            continue;
         }
 
-        /* Feed the wake word */
+        /* Every running consumer takes chunks of its own size from the same capture */
+        size_t chunks[kCaptureReaderCount] = {};
+        if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
+            chunks[kCaptureReaderTesting] = OPUS_FRAME_DURATION_MS * 16000 / 1000;
+        }
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
-            int samples = wake_word_->GetFeedSize();
-            if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
-                    continue;
-                }
-            }
+            chunks[kCaptureReaderWakeWord] = wake_word_->GetFeedSize();
         }
-
-        /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
-            int samples = audio_processor_->GetFeedSize();
-            if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    audio_processor_->Feed(std::move(data));
-                    continue;
-                }
+            chunks[kCaptureReaderProcessor] = audio_processor_->GetFeedSize();
+        }
+        size_t max_chunk = *std::max_element(chunks, chunks + kCaptureReaderCount);
+        if (max_chunk == 0) {
+            ESP_LOGE(TAG, "Should not be here, bits: %lx", bits);
+            break;
+        }
+        capture_ring_.Configure(codec_->input_channels(), max_chunk);
+
+        /* Read only what the consumer closest to a full chunk misses, the others keep it for later */
+        size_t missing = max_chunk;
+        for (int reader = 0; reader < kCaptureReaderCount; reader++) {
+            capture_ring_.SetActive(reader, chunks[reader] > 0);
+            if (chunks[reader] > 0) {
+                missing = std::min(missing, chunks[reader] - std::min(chunks[reader], capture_ring_.Available(reader)));
             }
         }
-
-        ESP_LOGE(TAG, "Should not be here, bits: %lx", bits);
-        break;
+        if (missing > 0) {
+            if (!ReadAudioData(capture_buffer_, 16000, missing)) {
+                ESP_LOGE(TAG, "Failed to read audio data, bits: %lx", bits);
+                break;
+            }
+            capture_ring_.Write(capture_buffer_.data(), capture_buffer_.size() / capture_ring_.channels(),
+                esp_timer_get_time());
+        }
+        FeedCaptureReaders(chunks);
     }
 
     ESP_LOGW(TAG, "Audio input task stopped");
 }
 
+void AudioService::FeedCaptureReaders(const size_t chunks[kCaptureReaderCount]) {
+    /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
+    size_t samples = chunks[kCaptureReaderTesting];
+    if (const int16_t* pcm = capture_ring_.Peek(kCaptureReaderTesting, samples)) {
+        // If input channels is 2, we need to fetch the left channel data
+        if (capture_ring_.channels() == 2) {
+            testing_buffer_.resize(samples);
+            DspExtractChannel(pcm, testing_buffer_.data(), samples, 2, 0);
+            pcm = testing_buffer_.data();
+        }
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, pcm, samples, UplinkFrameTag());
+        capture_ring_.Consume(kCaptureReaderTesting, samples);
+    }
+
+    samples = chunks[kCaptureReaderWakeWord];
+    if (const int16_t* pcm = capture_ring_.Peek(kCaptureReaderWakeWord, samples)) {
+        wake_word_->Feed(pcm, samples);
+        capture_ring_.Consume(kCaptureReaderWakeWord, samples);
+    }
+
+    samples = chunks[kCaptureReaderProcessor];
+    if (const int16_t* pcm = capture_ring_.Peek(kCaptureReaderProcessor, samples)) {
+        tracer_.OnProcessorInput(samples);
+#if CONFIG_USE_SERVER_AEC
+        playback_clock_.OnCapture(samples, capture_ring_.EndTimeUs(kCaptureReaderProcessor, samples, 16000));
+#endif
+        audio_processor_->Feed(pcm, samples);
+        capture_ring_.Consume(kCaptureReaderProcessor, samples);
+    }
+}
+
 void AudioService::AudioOutputTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
-
-        if (!codec_->output_enabled()) {
-            esp_timer_stop(audio_power_timer_);
-            esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-            codec_->EnableOutput(true);
-        }
-        codec_->OutputData(task->pcm);
-
-        /* Update the last output time */
-        last_output_time_ = std::chrono::steady_clock::now();
-        debug_statistics_.playback_count++;
-
+        bool played = mixer_.Mix([this](const std::vector<int16_t>& pcm) {
+            if (!codec_->output_enabled()) {
+                PowerOnDemand(kAudioPowerOutput);
+            }
+            codec_->OutputData(pcm);
 #if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
-        }
+            RecordPlayout(pcm.size());
 #endif
+
+            /* Update the last output time */
+            last_output_time_ = std::chrono::steady_clock::now();
+            debug_statistics_.playback_count++;
+        }, [this](MixerStream, AudioTaskPtr& task) {
+            xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_NOT_FULL);
+            tracer_.Record(kAudioTraceOutput, task->trace_time_us);
+        });
+        if (!played) {
+            xEventGroupWaitBits(queue_event_group_, AS_QUEUE_PLAYBACK_NOT_EMPTY, pdTRUE, pdFALSE, portMAX_DELAY);
+        }
     }
 
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
+void AudioService::RecordPlayout(size_t block_samples) {
+    /* Called right after the block was written: it plays after the frames still ahead of it in the DMA ring */
+    int64_t now_us = esp_timer_get_time();
+    int sample_rate = codec_->output_sample_rate();
+    int delay = codec_->GetOutputDelayFrames(now_us);
+    // Without the DMA position, the block is taken to start playing when the write returns
+    int64_t ahead = delay < 0 ? 0 : int64_t(delay) - int64_t(block_samples);
+    int64_t block_start_us = now_us + ahead * 1000000 / sample_rate;
+
+    mixer_.ForEachSpan(kMixerStreamVoice, [this, sample_rate, block_start_us](AudioTask& task, size_t frame_offset,
+        size_t block_offset, size_t samples) {
+        if (task.timestamp == 0) {
+            return;
+        }
+        uint32_t server_ms = task.timestamp + uint32_t(frame_offset * 1000 / sample_rate);
+        playback_clock_.OnPlayout(server_ms, block_start_us + int64_t(block_offset) * 1000000 / sample_rate,
+            samples, sample_rate);
+    });
+}
+
+void AudioService::OpusDecodeTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
         if (service_stopped_) {
             break;
         }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+        /* Move arrived packets into the jitter buffer, the decode queue keeps the back-pressure */
+        AudioStreamPacketPtr packet;
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        while (!jitter_buffer_.Full() && audio_decode_queue_.Pop(packet)) {
+            xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_NOT_FULL);
+            jitter_buffer_.Put(std::move(packet), now_ms);
+        }
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+        /* Local sounds have their own decoder and mixer stream, so they play over the voice instead of waiting behind it */
+        bool decoded = false;
+        bool sound_start = false;
+        if (!mixer_.Full(kMixerStreamSound) && sound_player_.Next(sound_packet_, sound_start)) {
+            auto& sound = sound_decoders_.Select(sound_packet_.sample_rate, sound_packet_.frame_duration);
+            if (sound_start) {
+                // Every sound is an independent Opus stream
+                sound.decoder->ResetState();
             }
-            debug_statistics_.decode_count++;
+            DecodeToMixer(kMixerStreamSound, *sound.decoder, sound.resampler, &sound_packet_);
+            decoded = true;
         }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
+        if (!mixer_.Full(kMixerStreamVoice)) {
+            JitterBufferOutput output = jitter_buffer_.Get(packet, now_ms);
+            if (output != kJitterBufferWait) {
+                /* A missing frame is concealed by the decoder (PLC) */
+                AudioStreamPacket* source = output == kJitterBufferPacket ? packet.get() : nullptr;
+                /* Concealment continues the current format */
+                auto& voice = source != nullptr ? voice_decoders_.Select(source->sample_rate, source->frame_duration)
+                    : *voice_decoders_.current();
+                DecodeToMixer(kMixerStreamVoice, *voice.decoder, voice.resampler, source);
+                decoded = true;
             }
-            debug_statistics_.encode_count++;
-            lock.lock();
+        }
+
+        if (!decoded) {
+            /* While the jitter buffer is filling up, wake up in time to release it */
+            TickType_t timeout = jitter_buffer_.Empty() ? portMAX_DELAY : pdMS_TO_TICKS(jitter_buffer_.frame_duration());
+            xEventGroupWaitBits(queue_event_group_, AS_QUEUE_DECODE_NOT_EMPTY | AS_QUEUE_PLAYBACK_NOT_FULL,
+                pdTRUE, pdFALSE, timeout);
         }
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    ESP_LOGW(TAG, "Opus decode task stopped");
 }
 
-void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
-    if (opus_decoder_->sample_rate() == sample_rate && opus_decoder_->duration_ms() == frame_duration) {
-        return;
+void AudioService::DecodeToMixer(MixerStream stream, OpusDecoderWrapper& decoder, OpusResampler& resampler,
+    AudioStreamPacket* source) {
+    int64_t start_time = esp_timer_get_time();
+    auto task = task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    if (source != nullptr) {
+        task->timestamp = source->timestamp;
+        task->trace_time_us = source->trace_time_us;
     }
 
-    opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    // An empty payload makes the decoder conceal the frame
+    std::vector<uint8_t> no_payload;
+    auto& payload = source != nullptr ? source->payload : no_payload;
+    // Resample if the sample rate is different, decoding into the scratch buffer first
+    bool need_resample = decoder.sample_rate() != codec_->output_sample_rate();
+    auto& decoded = need_resample ? decode_buffer_ : task->pcm;
+    if (decoder.Decode(std::move(payload), decoded)) {
+        tracer_.Record(kAudioTraceDecoded, task->trace_time_us);
+        if (need_resample) {
+            task->pcm.resize(resampler.GetOutputSamples(decoded.size()));
+            resampler.Process(decoded.data(), decoded.size(), task->pcm.data());
+            tracer_.Record(kAudioTraceResampled, task->trace_time_us);
+        }
+        decode_latency_.Record(esp_timer_get_time() - start_time);
+#if CONFIG_USE_AUDIO_DEBUGGER
+        if (debug_recorder_ != nullptr && stream == kMixerStreamVoice) {
+            debug_recorder_->Record(kAudioTapDownlink, task->pcm.data(), task->pcm.size(),
+                codec_->output_sample_rate());
+        }
+#endif
 
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+        if (!mixer_.Push(stream, std::move(task))) {
+            debug_statistics_.playback_drop_count++;
+            ESP_LOGW(TAG, "Mixer stream %d is full, dropping frame", stream);
+        } else if (stream == kMixerStreamVoice) {
+            RecordPeak(playback_queue_max_, mixer_.Size(stream));
+        }
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_NOT_EMPTY);
+    } else {
+        ESP_LOGE(TAG, "Failed to decode audio");
     }
+    debug_statistics_.decode_count++;
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
-    task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+void AudioService::OpusEncodeTask() {
+    while (true) {
+        if (service_stopped_) {
+            break;
+        }
+
+        opus_encoder_->ApplyPendingProfile();
+
+        AudioTaskPtr task;
+        if (audio_send_queue_.Full() || !audio_encode_queue_.Pop(task)) {
+            xEventGroupWaitBits(queue_event_group_, AS_QUEUE_ENCODE_NOT_EMPTY | AS_QUEUE_SEND_NOT_FULL,
+                pdTRUE, pdFALSE, portMAX_DELAY);
+            continue;
+        }
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_ENCODE_NOT_FULL);
+
+        /* Encode the audio to send queue */
+        debug_statistics_.encode_count++;
+        int64_t start_time = esp_timer_get_time();
+        auto packet = packet_pool_.Acquire();
+        packet->frame_duration = opus_encoder_->frame_duration();
+        packet->sample_rate = 16000;
+        packet->timestamp = task->timestamp;
+        packet->trace_time_us = task->trace_time_us;
+        // Room for the transport header in front of the packets to send, testing packets are decoded
+        packet->headroom = task->type == kAudioTaskTypeEncodeToSendQueue ? AUDIO_PACKET_HEADROOM : 0;
+        bool encoded = task->silent
+            ? opus_encoder_->EncodeSilence(task->pcm.data(), packet->payload, packet->headroom)
+            : opus_encoder_->Encode(task->pcm.data(), packet->payload, packet->headroom);
+        if (!encoded) {
+            ESP_LOGE(TAG, "Failed to encode audio");
+            continue;
+        }
+        if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+            auto& bytes = task->silent ? uplink_bytes_.silent : uplink_bytes_.speech;
+            bytes.packets++;
+            bytes.bytes += packet->size();
+            if (task->silent && packet->size() <= 2) {
+                uplink_bytes_.dtx_packets++;
+            }
+        }
+        encode_latency_.Record(esp_timer_get_time() - start_time);
+        tracer_.Record(kAudioTraceEncoded, packet->trace_time_us);
+
+        if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+            if (uplink_stage_pending_.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+                if (uplink_stage_.Push(packet, esp_timer_get_time())) {
+                    continue;
+                }
+            }
+            audio_send_queue_.Push(std::move(packet));
+            size_t depth = audio_send_queue_.Size();
+            RecordPeak(send_queue_peak_, depth);
+            RecordPeak(send_queue_max_, depth);
+            if (callbacks_.on_send_queue_available) {
+                callbacks_.on_send_queue_available();
+            }
+        } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+            if (!audio_testing_queue_.Push(std::move(packet))) {
+                debug_statistics_.testing_drop_count++;
+            }
         }
-        timestamp_queue_.pop_front();
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    ESP_LOGW(TAG, "Opus encode task stopped");
 }
 
-bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+void AudioService::SetUplinkProfile(const LinkAudioProfile& profile) {
+    opus_encoder_->SetProfile(profile);
+    ESP_LOGI(TAG, "Uplink profile: %d ms, %d bps, fec %d, dtx %d", profile.frame_duration_ms, LinkAudioBitrate(profile),
+        profile.fec, profile.dtx);
+}
+
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, const int16_t* pcm, size_t samples,
+    const UplinkFrameTag& tag, bool silent) {
+    // Copy into a pooled frame, the caller keeps its buffer for the next frame
+    auto task = task_pool_.Acquire();
+    task->type = type;
+    task->pcm.assign(pcm, pcm + samples);
+    task->trace_time_us = tag.trace_time_us;
+    task->timestamp = tag.timestamp;
+    task->silent = silent;
+
+    while (!service_stopped_) {
+        {
+            std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+            if (!audio_encode_queue_.Full()) {
+                audio_encode_queue_.Push(std::move(task));
+                RecordPeak(encode_queue_max_, audio_encode_queue_.Size());
+                xEventGroupSetBits(queue_event_group_, AS_QUEUE_ENCODE_NOT_EMPTY);
+                return;
+            }
+        }
+        xEventGroupWaitBits(queue_event_group_, AS_QUEUE_ENCODE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
+    }
+}
+
+bool AudioService::PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait) {
+    while (!service_stopped_) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            if (audio_decode_queue_.Size() < MAX_DECODE_PACKETS_IN_QUEUE) {
+                audio_decode_queue_.Push(std::move(packet));
+                RecordPeak(decode_queue_max_, audio_decode_queue_.Size());
+                xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_NOT_EMPTY);
+                return true;
+            }
+        }
+        if (!wait) {
             return false;
         }
+        xEventGroupWaitBits(queue_event_group_, AS_QUEUE_DECODE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
-    return true;
+    return false;
+}
+
+AudioQueuePeaks AudioService::GetQueuePeaks() const {
+    AudioQueuePeaks peaks;
+    peaks.encode = encode_queue_max_.load(std::memory_order_relaxed);
+    peaks.send = send_queue_max_.load(std::memory_order_relaxed);
+    peaks.decode = decode_queue_max_.load(std::memory_order_relaxed);
+    peaks.playback = playback_queue_max_.load(std::memory_order_relaxed);
+    return peaks;
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+AudioStreamPacketPtr AudioService::PopPacketFromSendQueue() {
+    if (uplink_stage_pending_.load(std::memory_order_acquire)) {
+        // Staged packets were all encoded before the ones in the send queue
+        std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+        if (!uplink_stage_.Empty() && !uplink_stage_.active()) {
+            auto packet = uplink_stage_.Pop();
+            uplink_stage_pending_.store(!uplink_stage_.Empty(), std::memory_order_release);
+            return packet;
+        }
+    }
+    AudioStreamPacketPtr packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_SEND_NOT_FULL);
     return packet;
 }
 
+void AudioService::StageUplink() {
+    std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+    uplink_stage_.Start(esp_timer_get_time());
+    uplink_stage_pending_.store(true, std::memory_order_release);
+}
+
+void AudioService::ReleaseStagedUplink() {
+    bool backlog;
+    {
+        std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+        if (!uplink_stage_.active()) {
+            return;
+        }
+        uplink_stage_.Release(esp_timer_get_time());
+        backlog = !uplink_stage_.Empty();
+        uplink_stage_pending_.store(backlog, std::memory_order_release);
+        ESP_LOGI(TAG, "Releasing %u staged packets (%lums), the oldest waited %lums", uplink_stage_.Size(),
+            uplink_stage_.duration_ms(), uplink_stage_.stats().last_wait_ms);
+    }
+    if (backlog && callbacks_.on_send_queue_available) {
+        callbacks_.on_send_queue_available();
+    }
+}
+
+void AudioService::DiscardStagedUplink() {
+    std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+    uplink_stage_.Discard();
+    uplink_stage_pending_.store(false, std::memory_order_release);
+}
+
+bool AudioService::IsUplinkStaged() {
+    std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+    return uplink_stage_.active();
+}
+
+UplinkStageStats AudioService::GetUplinkStageStats() {
+    std::lock_guard<std::mutex> lock(uplink_stage_mutex_);
+    return uplink_stage_.stats();
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -444,8 +689,8 @@ const std::string& AudioService::GetLastWakeWord() const {
     return wake_word_->GetLastDetectedWakeWord();
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
+AudioStreamPacketPtr AudioService::PopWakeWordPacket() {
+    auto packet = packet_pool_.Acquire();
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
         return packet;
     }
@@ -485,6 +730,9 @@ void AudioService::EnableVoiceProcessing(bool enable) {
         /* We should make sure no audio is playing */
         ResetDecoder();
         audio_input_need_warmup_ = true;
+        tracer_.ResetProcessorClock();
+        playback_clock_.ResetCapture();
+        silence_gate_.Reset();
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
@@ -499,10 +747,14 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_ */
+        std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+        audio_decode_queue_.Clear();
+        AudioStreamPacketPtr packet;
+        while (audio_testing_queue_.Pop(packet)) {
+            audio_decode_queue_.Push(std::move(packet));
+        }
+        xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_NOT_EMPTY);
     }
 }
 
@@ -514,136 +766,150 @@ void AudioService::EnableDeviceAec(bool enable) {
     }
 
     audio_processor_->EnableDeviceAec(enable);
+    device_aec_enabled_ = enable;
+}
+
+void AudioService::EnableSilenceSuppression(bool enable) {
+    SilenceGateMode mode = kSilenceGateOff;
+#if CONFIG_SILENCE_SUPPRESSION_DTX
+    mode = kSilenceGateDtx;
+#elif CONFIG_SILENCE_SUPPRESSION_DROP
+    mode = kSilenceGateDrop;
+#endif
+    silence_gate_.SetMode(enable ? mode : kSilenceGateOff);
 }
 
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
 
-void AudioService::PlaySound(const std::string_view& ogg) {
+uint32_t AudioService::PlaySound(const std::string_view& ogg, SoundPriority priority, SoundCallback callback) {
     if (!codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableOutput(true);
+        PowerOnDemand(kAudioPowerOutput);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
+    uint32_t id = sound_player_.Play(ogg, priority, std::move(callback));
+    /* Wake up the Opus decode task to start pulling the frames */
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_NOT_EMPTY);
+    return id;
+}
 
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
-        }
-        return static_cast<size_t>(-1);
-    };
+void AudioService::CancelSound(uint32_t id) {
+    sound_player_.Cancel(id);
+}
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
+bool AudioService::PushMediaFrame(const std::vector<int16_t>& pcm) {
+    if (mixer_.Full(kMixerStreamMedia)) {
+        return false;
+    }
+    auto task = task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->pcm.assign(pcm.begin(), pcm.end());
+    if (!mixer_.Push(kMixerStreamMedia, std::move(task))) {
+        return false;
+    }
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_PLAYBACK_NOT_EMPTY);
+    return true;
+}
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
-            }
+bool AudioService::IsIdle() {
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && jitter_buffer_.Empty() &&
+        sound_player_.Empty() && mixer_.Empty() && audio_testing_queue_.Empty();
+}
+
+void AudioService::ResetDecoder() {
+    voice_decoders_.current()->decoder->ResetState();
+    playback_clock_.ResetPlayout();
+    audio_decode_queue_.Clear();
+    mixer_.Clear(kMixerStreamVoice);
+    mixer_.Clear(kMixerStreamSound);
+    audio_testing_queue_.Clear();
+    jitter_buffer_.Reset();
+    sound_player_.CancelAll();
+    /* Let the consumers drop the discarded entries and the blocked producers continue */
+    xEventGroupSetBits(queue_event_group_, AS_QUEUE_DECODE_NOT_FULL | AS_QUEUE_PLAYBACK_NOT_FULL | AS_QUEUE_PLAYBACK_NOT_EMPTY);
+}
 
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
+static int64_t PowerClockMs(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+AudioPowerState AudioService::GetPowerState(int64_t now_ms) const {
+    AudioPowerState state;
+    state.on[kAudioPowerInput] = codec_->input_enabled();
+    state.on[kAudioPowerOutput] = codec_->output_enabled();
+    state.idle_ms[kAudioPowerInput] = now_ms - PowerClockMs(last_input_time_);
+    state.idle_ms[kAudioPowerOutput] = now_ms - PowerClockMs(last_output_time_);
+    return state;
+}
+
+void AudioService::PowerOn(AudioPowerDirection direction) {
+    /* The power check starts over, it stops by itself once both directions are off */
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+    if (direction == kAudioPowerInput) {
+        codec_->EnableInput(true);
+    } else {
+        codec_->EnableOutput(true);
+    }
+}
+
+void AudioService::PowerOnDemand(AudioPowerDirection direction) {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    bool enabled = direction == kAudioPowerInput ? codec_->input_enabled() : codec_->output_enabled();
+    if (enabled) {
+        return;
+    }
+    power_policy_.OnDemand(direction, PowerClockMs(std::chrono::steady_clock::now()));
+    ESP_LOGI(TAG, "Audio %s on: demand, %s mode", direction == kAudioPowerInput ? "input" : "output",
+        AudioPowerPolicy::ModeName(power_policy_.mode()));
+    PowerOn(direction);
+}
+
+void AudioService::ApplyPowerAction(const AudioPowerAction& action) {
+    for (int i = 0; i < kAudioPowerDirectionCount; i++) {
+        auto direction = AudioPowerDirection(i);
+        if (!action.power_on[i] && !action.power_off[i]) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Audio %s %s: %s, %s mode", direction == kAudioPowerInput ? "input" : "output",
+            action.power_on[i] ? "on" : "off", AudioPowerPolicy::ReasonName(action.reason[i]),
+            AudioPowerPolicy::ModeName(power_policy_.mode()));
+        if (action.power_on[i]) {
+            PowerOn(direction);
+        } else if (direction == kAudioPowerInput) {
+            codec_->EnableInput(false);
+        } else {
+            codec_->EnableOutput(false);
         }
+    }
+}
 
-        offset = body_off + body_size;
+void AudioService::SetPowerMode(AudioPowerMode mode) {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    if (power_policy_.mode() == mode) {
+        return;
     }
+    int64_t now_ms = PowerClockMs(std::chrono::steady_clock::now());
+    ApplyPowerAction(power_policy_.SetMode(mode, now_ms, GetPowerState(now_ms)));
+    ESP_LOGI(TAG, "Audio power mode: %s, timeout %dms", AudioPowerPolicy::ModeName(mode), int(power_policy_.TimeoutMs()));
 }
 
-bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+void AudioService::PrepareForInteraction(AudioPowerHint hint) {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    int64_t now_ms = PowerClockMs(std::chrono::steady_clock::now());
+    ApplyPowerAction(power_policy_.OnHint(hint, now_ms, GetPowerState(now_ms)));
 }
 
-void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+AudioPowerStats AudioService::GetPowerStats() {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    return power_policy_.stats();
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
-    auto now = std::chrono::steady_clock::now();
-    auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
-    auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
-    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
-        codec_->EnableInput(false);
-    }
-    if (output_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->output_enabled()) {
-        codec_->EnableOutput(false);
-    }
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    int64_t now_ms = PowerClockMs(std::chrono::steady_clock::now());
+    ApplyPowerAction(power_policy_.Update(now_ms, GetPowerState(now_ms)));
     if (!codec_->input_enabled() && !codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
     }
@@ -670,6 +936,8 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 
     if (wake_word_) {
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+            TriggerDebugRecording();
+            PrepareForInteraction(kAudioPowerHintWakeWord);
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
@@ -684,3 +952,97 @@ bool AudioService::IsAfeWakeWord() {
     return false;
 #endif
 }
+
+void AudioService::PrintStatistics() {
+    auto tasks = task_pool_.GetStats();
+    auto packets = packet_pool_.GetStats();
+    ESP_LOGI(TAG, "Frame pools: pcm acquired=%lu malloc=%lu cached=%u, opus acquired=%lu malloc=%lu cached=%u",
+        tasks.acquired, tasks.allocated + tasks.grown, tasks.cached,
+        packets.acquired, packets.allocated + packets.grown, packets.cached);
+
+    /* Codec latencies are per frame and cover the last statistics interval */
+    auto encode = encode_latency_.GetPercentiles();
+    auto decode = decode_latency_.GetPercentiles();
+    encode_latency_.Reset();
+    decode_latency_.Reset();
+    ESP_LOGI(TAG, "Opus encode: n=%lu p50=%luus p90=%luus p99=%luus max=%luus, decode: n=%lu p50=%luus p90=%luus p99=%luus max=%luus",
+        encode.count, encode.p50_us, encode.p90_us, encode.p99_us, encode.max_us,
+        decode.count, decode.p50_us, decode.p90_us, decode.p99_us, decode.max_us);
+
+    tracer_.PrintStatistics();
+
+    /* What the silence gate kept off the air since boot: the Opus bytes sent for the suppressed frames,
+       against what the speech packets measured per 60 ms */
+    auto& gate = silence_gate_.stats();
+    if (gate.silent + gate.dropped > 0) {
+        auto& silent = uplink_bytes_.silent;
+        uint32_t speech_per_frame = gate.passed > 0 ? uplink_bytes_.speech.bytes / gate.passed : 0;
+        uint64_t unsuppressed = uint64_t(gate.silent + gate.dropped) * speech_per_frame;
+        uint32_t saved = unsuppressed > silent.bytes ? uint32_t(unsuppressed - silent.bytes) : 0;
+        ESP_LOGI(TAG, "Silence gate: speech=%lu dtx=%lu dropped=%lu frames, silent packets=%lu (%lu DTX) %lu bytes, "
+            "speech %lu bytes/frame, %lu bytes saved", gate.passed, gate.silent, gate.dropped, silent.packets,
+            uplink_bytes_.dtx_packets, silent.bytes, speech_per_frame, saved);
+    }
+
+    auto jitter = jitter_buffer_.GetStats();
+    ESP_LOGI(TAG, "Jitter buffer: depth=%lu/%lu jitter=%lums late=%lu lost=%lu concealed=%lu underruns=%lu",
+        jitter.depth, jitter.target_depth, jitter.jitter_ms, jitter.late, jitter.lost, jitter.concealed, jitter.underruns);
+
+    /* Speech that waited for the audio channel to open, against what did not fit */
+    auto stage = GetUplinkStageStats();
+    if (stage.sessions > 0) {
+        ESP_LOGI(TAG, "Uplink stage: sessions=%lu staged=%lu flushed=%lu dropped=%lu discarded=%lu, peak=%lums, "
+            "wait last=%lums max=%lums", stage.sessions, stage.staged, stage.flushed, stage.dropped, stage.discarded,
+            stage.peak_ms, stage.last_wait_ms, stage.max_wait_ms);
+    }
+
+    auto peaks = GetQueuePeaks();
+    ESP_LOGI(TAG, "Queue peaks: encode=%u/%d send=%u/%d decode=%u/%d playback=%u/%d",
+        peaks.encode, MAX_ENCODE_TASKS_IN_QUEUE, peaks.send, MAX_SEND_PACKETS_IN_QUEUE,
+        peaks.decode, MAX_DECODE_PACKETS_IN_QUEUE, peaks.playback, MAX_PLAYBACK_TASKS_IN_QUEUE);
+    if (debug_statistics_.playback_drop_count + debug_statistics_.testing_drop_count > 0) {
+        ESP_LOGW(TAG, "Queue drops: playback=%lu testing=%lu", debug_statistics_.playback_drop_count,
+            debug_statistics_.testing_drop_count);
+    }
+
+    /* A format switch either finds its decoder cached or creates one */
+    auto& voice = voice_decoders_.stats();
+    auto& sound = sound_decoders_.stats();
+    ESP_LOGI(TAG, "Opus decoders: voice hits=%lu created=%lu evicted=%lu, sound hits=%lu created=%lu evicted=%lu",
+        voice.hits, voice.created, voice.evicted, sound.hits, sound.created, sound.evicted);
+
+    auto power = GetPowerStats();
+    ESP_LOGI(TAG, "Audio power: on input=%lus output=%lus (idle %lus/%lus), cold starts input=%lu output=%lu, "
+        "prewarm hits=%lu misses=%lu, idle timeout=%lums, deep idle=%lu expected=%lu timeout=%lu",
+        uint32_t(power.powered_ms[kAudioPowerInput] / 1000), uint32_t(power.powered_ms[kAudioPowerOutput] / 1000),
+        uint32_t(power.idle_powered_ms[kAudioPowerInput] / 1000), uint32_t(power.idle_powered_ms[kAudioPowerOutput] / 1000),
+        power.cold_starts[kAudioPowerInput], power.cold_starts[kAudioPowerOutput], power.prewarm_hits,
+        power.prewarm_misses, power.idle_timeout_ms, power.decisions[kAudioPowerReasonDeepIdle],
+        power.decisions[kAudioPowerReasonExpected], power.decisions[kAudioPowerReasonTimeout]);
+
+#if CONFIG_USE_SERVER_AEC
+    auto clock = playback_clock_.GetStats();
+    ESP_LOGI(TAG, "Playback clock: slip=%ldus drift=%ldppm resyncs=%lu, uplink stamped=%lu unstamped=%lu",
+        clock.slip_us, clock.drift_ppm, clock.resyncs, clock.stamped, clock.unstamped);
+#endif
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+    if (debug_recorder_ != nullptr) {
+        auto recorder = debug_recorder_->GetStats();
+        ESP_LOGI(TAG, "Debug recorder: sent mic=%lu ref=%lu afe=%lu down=%lu, dropped mic=%lu ref=%lu afe=%lu down=%lu, "
+            "send errors=%lu triggers=%lu",
+            recorder.sent[kAudioTapMic], recorder.sent[kAudioTapReference], recorder.sent[kAudioTapProcessed],
+            recorder.sent[kAudioTapDownlink], recorder.dropped[kAudioTapMic], recorder.dropped[kAudioTapReference],
+            recorder.dropped[kAudioTapProcessed], recorder.dropped[kAudioTapDownlink], recorder.send_errors,
+            recorder.triggers);
+    }
+#endif
+}
+
+void AudioService::TriggerDebugRecording() {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    if (debug_recorder_ != nullptr) {
+        debug_recorder_->Trigger();
+    }
+#endif
+}
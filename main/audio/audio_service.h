@@ -2,10 +2,9 @@
 #define AUDIO_SERVICE_H
 
 #include <memory>
-#include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -13,13 +12,26 @@
 #include <esp_timer.h>
 #include <model_path.h>
 
-#include <opus_encoder.h>
 #include <opus_decoder.h>
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
 #include "audio_processor.h"
-#include "processors/audio_debugger.h"
+#include "spsc_queue.h"
+#include "frame_pool.h"
+#include "jitter_buffer.h"
+#include "sound_player.h"
+#include "latency_histogram.h"
+#include "audio_tracer.h"
+#include "opus_uplink_encoder.h"
+#include "silence_gate.h"
+#include "audio_mixer.h"
+#include "playback_clock.h"
+#include "decoder_cache.h"
+#include "capture_ring.h"
+#include "audio_debug_recorder.h"
+#include "audio_power_policy.h"
+#include "uplink_stage.h"
 #include "wake_word.h"
 #include "protocol.h"
 
@@ -27,31 +39,69 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Voice Stream} -> [Mixer] -> (Speaker)
+ *    (Sounds) -> [Sound Player] -> [Opus Decoder] -> {Sound Stream} -^
+ *    (Media) -> {Media Stream} -^
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Speaker / Processors, and one task each for the Opus Encoder and the Opus Decoder,
+ * so that uplink and downlink do not stall each other in realtime mode and can run on different cores.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
- * 
+ *
+ * Every queue is a lock-free SPSC ring with its own wakeup bits in queue_event_group_, so a push or pop
+ * only wakes the task that is waiting on that particular queue.
+ *
+ * The MIC is read once into a capture ring, which the wake word, the audio processor and audio testing
+ * read in chunks of their own size, so that running both the wake word and the processor costs no extra read.
  */
 
 #define OPUS_FRAME_DURATION_MS 60
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
+// Per mixer stream
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
+// Speech encoded while the audio channel opens waits for it, beyond this the oldest is dropped
+#define AUDIO_UPLINK_STAGE_MAX_MS 4000
+// Every uplink packet is one OPUS_FRAME_DURATION_MS frame
+#define AUDIO_UPLINK_STAGE_CAPACITY (AUDIO_UPLINK_STAGE_MAX_MS / OPUS_FRAME_DURATION_MS)
+#define MAX_TESTING_PACKETS_IN_QUEUE (AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS)
+
+// Frame pools keep enough frames for full queues plus the ones being processed
+#define AUDIO_TASK_POOL_SIZE (MAX_ENCODE_TASKS_IN_QUEUE + MAX_PLAYBACK_TASKS_IN_QUEUE * kMixerStreamCount + 4)
+#define AUDIO_PACKET_POOL_SIZE (MAX_DECODE_PACKETS_IN_QUEUE + MAX_SEND_PACKETS_IN_QUEUE + 4)
+// Opus payloads are reserved for this bitrate, larger packets grow their buffer once and keep it
+#define AUDIO_PACKET_POOL_BITRATE 32000
+#define AUDIO_PACKET_POOL_PAYLOAD_BYTES (AUDIO_PACKET_HEADROOM + AUDIO_PACKET_POOL_BITRATE / 8 * OPUS_FRAME_DURATION_MS / 1000)
 
-#define AUDIO_POWER_TIMEOUT_MS 15000
-#define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+// Q16 gain of the lower priority streams while the voice / a sound plays
+#define AUDIO_MIXER_VOICE_DUCK_GAIN 16384   // -12 dB
+#define AUDIO_MIXER_SOUND_DUCK_GAIN 23253   // -9 dB
 
 
+// Readers of the capture ring, all on the audio input task
+enum CaptureReader {
+    kCaptureReaderTesting,
+    kCaptureReaderWakeWord,
+    kCaptureReaderProcessor,
+    kCaptureReaderCount,
+};
+
 #define AS_EVENT_AUDIO_TESTING_RUNNING      (1 << 0)
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
 
+#define AS_QUEUE_ENCODE_NOT_EMPTY           (1 << 0)
+#define AS_QUEUE_ENCODE_NOT_FULL            (1 << 1)
+#define AS_QUEUE_DECODE_NOT_EMPTY           (1 << 2)
+#define AS_QUEUE_DECODE_NOT_FULL            (1 << 3)
+#define AS_QUEUE_PLAYBACK_NOT_EMPTY         (1 << 4)
+#define AS_QUEUE_PLAYBACK_NOT_FULL          (1 << 5)
+#define AS_QUEUE_SEND_NOT_FULL              (1 << 6)
+#define AS_QUEUE_ALL_BITS                   (0x7F)
+
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
@@ -67,16 +117,50 @@ enum AudioTaskType {
 };
 
 struct AudioTask {
-    AudioTaskType type;
+    AudioTaskType type = kAudioTaskTypeEncodeToSendQueue;
     std::vector<int16_t> pcm;
-    uint32_t timestamp;
+    uint32_t timestamp = 0;
+    int64_t trace_time_us = 0;  // When the frame entered the device, 0 if not traced
+    bool silent = false;        // Suppressed by the silence gate, sent as DTX frames
+};
+
+inline std::vector<int16_t>& FrameBuffer(AudioTask& task) {
+    return task.pcm;
+}
+
+// Travels with an uplink frame through the silence gate
+struct UplinkFrameTag {
+    int64_t trace_time_us = 0;
+    uint32_t timestamp = 0;     // Server time of the voice played during capture, for server AEC
 };
 
+using AudioTaskPtr = FramePool<AudioTask>::Ptr;
+
 struct DebugStatistics {
     uint32_t input_count = 0;
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    uint32_t playback_drop_count = 0;   // Decoded frames the mixer had no room for
+    uint32_t testing_drop_count = 0;    // Recorded test packets over the testing queue
+};
+
+// Opus packets and bytes the encoder produced for the send queue since boot, the measured side of
+// what the silence gate saves
+struct UplinkByteCounts {
+    struct {
+        uint32_t packets = 0;
+        uint32_t bytes = 0;
+    } speech, silent;
+    uint32_t dtx_packets = 0;   // Silent packets of at most 2 bytes, the frames libopus sent as DTX
+};
+
+// Deepest every queue has been since boot
+struct AudioQueuePeaks {
+    size_t encode = 0;      // PCM frames waiting for the Opus encoder
+    size_t send = 0;        // Opus packets waiting to be sent
+    size_t decode = 0;      // Opus packets waiting for the Opus decoder
+    size_t playback = 0;    // Decoded voice frames waiting for the mixer
 };
 
 class AudioService {
@@ -88,7 +172,7 @@ public:
     void Start();
     void Stop();
     void EncodeWakeWord();
-    std::unique_ptr<AudioStreamPacket> PopWakeWordPacket();
+    AudioStreamPacketPtr PopWakeWordPacket();
     const std::string& GetLastWakeWord() const;
     bool IsVoiceDetected() const { return voice_detected_; }
     bool IsIdle();
@@ -100,62 +184,153 @@ public:
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    // Gates the uplink by the VAD (see SILENCE_SUPPRESSION in Kconfig), takes effect at the next frame
+    void EnableSilenceSuppression(bool enable);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
-    bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
-    std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
-    void PlaySound(const std::string_view& sound);
+    bool PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait = false);
+    // The staged packets first once they are released, then the send queue
+    AudioStreamPacketPtr PopPacketFromSendQueue();
+    // The uplink packets encoded from now on wait for the audio channel (see UplinkStage)
+    void StageUplink();
+    // The channel is open, the staged packets are sent ahead of the new ones
+    void ReleaseStagedUplink();
+    // The channel did not open
+    void DiscardStagedUplink();
+    bool IsUplinkStaged();
+    UplinkStageStats GetUplinkStageStats();
+    // Returns right away, the sound is streamed frame by frame by the Opus decode task
+    uint32_t PlaySound(const std::string_view& sound, SoundPriority priority = kSoundPriorityNormal,
+        SoundCallback callback = nullptr);
+    void CancelSound(uint32_t id);
+    // PCM at the codec's output rate, mixed under the voice and the sounds. Returns false if the media stream is full.
+    // Only one task may push media.
+    bool PushMediaFrame(const std::vector<int16_t>& pcm);
+    void SetStreamGain(MixerStream stream, int32_t gain_q16) { mixer_.SetGain(stream, gain_q16); }
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    JitterBufferStats GetJitterBufferStats() const { return jitter_buffer_.GetStats(); }
+    AudioTracer& GetTracer() { return tracer_; }
+    // Takes effect at the next frame the encoder picks up
+    void SetUplinkProfile(const LinkAudioProfile& profile);
+    // Deepest the send queue has been since the last call
+    size_t TakeSendQueuePeak() { return send_queue_peak_.exchange(0); }
+    AudioQueuePeaks GetQueuePeaks() const;
+    void PrintStatistics();
+    // Sends the debug recorder's pre-trigger window (AUDIO_DEBUG_TRIGGERED), the wake word also triggers it
+    void TriggerDebugRecording();
+    // Codec power follows the device state (see AudioPowerPolicy)
+    void SetPowerMode(AudioPowerMode mode);
+    // Powers the codec ahead of an interaction that is about to start
+    void PrepareForInteraction(AudioPowerHint hint);
+    AudioPowerStats GetPowerStats();
 
 private:
     AudioCodec* codec_ = nullptr;
     AudioServiceCallbacks callbacks_;
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
-    std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
-    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    std::unique_ptr<AudioDebugRecorder> debug_recorder_;
+    std::unique_ptr<OpusUplinkEncoder> opus_encoder_;
+    // Decoders and output resamplers of the voice and sound streams, one per recent packet format
+    DecoderCache<OpusDecoderWrapper, OpusResampler> voice_decoders_;
+    DecoderCache<OpusDecoderWrapper, OpusResampler> sound_decoders_;
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
-    OpusResampler output_resampler_;
     DebugStatistics debug_statistics_;
+    UplinkByteCounts uplink_bytes_;   // Written by the Opus encode task only
+    LatencyHistogram encode_latency_;
+    LatencyHistogram decode_latency_;
+    AudioTracer tracer_;
+    // Between the audio processor and the encode queue, only used by the processor's output task
+    SilenceGate<UplinkFrameTag> silence_gate_;
+    // Server time of the voice being played, stamps the uplink frames for server AEC
+    PlaybackClock playback_clock_;
+    FramePool<AudioTask> task_pool_{AUDIO_TASK_POOL_SIZE};
+    FramePool<AudioStreamPacket> packet_pool_{AUDIO_PACKET_POOL_SIZE};
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
+    EventGroupHandle_t queue_event_group_;
 
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
-    // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    // The encode and decode queues have more than one producer, the producers are serialized by these mutexes
+    std::mutex encode_producer_mutex_;
+    std::mutex decode_producer_mutex_;
+    // The decode queue also takes the whole testing queue when audio testing stops
+    SpscQueue<AudioStreamPacketPtr, MAX_TESTING_PACKETS_IN_QUEUE> audio_decode_queue_;
+    // Owned by the Opus decode task, reorders the decode queue and conceals lost packets
+    JitterBuffer jitter_buffer_;
+    // Local sounds are pulled by the Opus decode task a frame at a time, ahead of the jitter buffer
+    SoundPlayer sound_player_;
+    AudioStreamPacket sound_packet_;
+    SpscQueue<AudioStreamPacketPtr, MAX_SEND_PACKETS_IN_QUEUE> audio_send_queue_;
+    std::atomic<size_t> send_queue_peak_{0};
+    // Filled by the Opus encode task instead of the send queue while the channel opens
+    std::mutex uplink_stage_mutex_;
+    UplinkStage uplink_stage_{AUDIO_UPLINK_STAGE_MAX_MS, AUDIO_UPLINK_STAGE_CAPACITY};
+    // Staging or staged packets left to send, so the encode and send paths skip the mutex otherwise.
+    // Written with uplink_stage_mutex_ held
+    std::atomic<bool> uplink_stage_pending_{false};
+    // High-water marks for GetQueuePeaks()
+    std::atomic<size_t> encode_queue_max_{0};
+    std::atomic<size_t> send_queue_max_{0};
+    std::atomic<size_t> decode_queue_max_{0};
+    std::atomic<size_t> playback_queue_max_{0};
+    SpscQueue<AudioStreamPacketPtr, MAX_TESTING_PACKETS_IN_QUEUE> audio_testing_queue_;
+    SpscQueue<AudioTaskPtr, MAX_ENCODE_TASKS_IN_QUEUE> audio_encode_queue_;
+    // Consumed by the audio output task, the voice and sound streams are fed by the Opus decode task
+    AudioMixer<AudioTaskPtr, MAX_PLAYBACK_TASKS_IN_QUEUE> mixer_;
+
+    // Scratch buffers reused by every frame, so that the hot path does not allocate
+    std::mutex input_buffer_mutex_;
+    std::vector<int16_t> input_mic_buffer_;
+    std::vector<int16_t> input_reference_buffer_;
+    std::vector<int16_t> resampled_mic_buffer_;
+    std::vector<int16_t> resampled_reference_buffer_;
+    std::vector<int16_t> decode_buffer_;
+    // Owned by the audio input task
+    CaptureRing capture_ring_;
+    std::vector<int16_t> capture_buffer_;
+    std::vector<int16_t> testing_buffer_;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
+    bool device_aec_enabled_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
+    // Asked from the device state events, the audio tasks and the power timer
+    std::mutex power_mutex_;
+    AudioPowerPolicy power_policy_;
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
-    void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    void OpusEncodeTask();
+    void OpusDecodeTask();
+    void PushTaskToEncodeQueue(AudioTaskType type, const int16_t* pcm, size_t samples, const UplinkFrameTag& tag,
+        bool silent = false);
+    void FeedCaptureReaders(const size_t chunks[kCaptureReaderCount]);
+    void RecordPlayout(size_t block_samples);
+    void DecodeToMixer(MixerStream stream, OpusDecoderWrapper& decoder, OpusResampler& resampler,
+        AudioStreamPacket* source);
     void CheckAndUpdateAudioPowerState();
+    // Called with power_mutex_ held
+    AudioPowerState GetPowerState(int64_t now_ms) const;
+    void ApplyPowerAction(const AudioPowerAction& action);
+    void PowerOn(AudioPowerDirection direction);
+    // Audio needs a direction that is off
+    void PowerOnDemand(AudioPowerDirection direction);
 };
 
 #endif
\ No newline at end of file
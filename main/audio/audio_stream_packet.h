@@ -0,0 +1,49 @@
+#ifndef AUDIO_STREAM_PACKET_H
+#define AUDIO_STREAM_PACKET_H
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_pool.h"
+
+// Room the uplink encoder leaves in front of the Opus data for the largest transport header:
+// the 16-byte nonce of MQTT+UDP and the 16-byte BinaryProtocol2 header
+#define AUDIO_PACKET_HEADROOM 16
+
+struct AudioStreamPacket {
+    int sample_rate = 0;
+    int frame_duration = 0;
+    uint32_t timestamp = 0;
+    uint32_t sequence = 0;  // 0 if the transport has no sequence numbers
+    int64_t trace_time_us = 0;  // When the frame entered the device, 0 if not traced
+    // Unused bytes at the start of `payload`. Packets from the uplink encoder have AUDIO_PACKET_HEADROOM,
+    // so that the transport writes its header in place and sends one buffer; packets that are decoded
+    // (received, audio testing) have none, their payload is the Opus data alone
+    size_t headroom = 0;
+    std::vector<uint8_t> payload;
+
+    // The bytes after the headroom: the Opus data, with the headers in front that transports prepended
+    const uint8_t* data() const { return payload.data() + headroom; }
+    uint8_t* data() { return payload.data() + headroom; }
+    size_t size() const { return payload.size() - headroom; }
+
+    // Takes `size` bytes of the headroom for a header in front of data(). A packet without enough
+    // headroom (not from the encoder) has its payload moved once to make room
+    uint8_t* PrependHeader(size_t size) {
+        if (headroom < size) {
+            payload.insert(payload.begin(), size - headroom, 0);
+            headroom = size;
+        }
+        headroom -= size;
+        return payload.data() + headroom;
+    }
+};
+
+inline std::vector<uint8_t>& FrameBuffer(AudioStreamPacket& packet) {
+    return packet.payload;
+}
+
+// Packets from AudioService's pool return to it when released
+using AudioStreamPacketPtr = FramePool<AudioStreamPacket>::Ptr;
+
+#endif // AUDIO_STREAM_PACKET_H
@@ -0,0 +1,113 @@
+#include "audio_tracer.h"
+
+#include <esp_log.h>
+
+#define TAG "AudioTracer"
+
+void AudioTracer::SetEnabled(bool enabled) {
+    if (enabled && !windows_) {
+        windows_ = std::make_unique<Window[]>(AUDIO_TRACE_WINDOWS);
+    }
+    ESP_LOGI(TAG, "%s audio tracer", enabled ? "Enabling" : "Disabling");
+    enabled_.store(enabled, std::memory_order_release);
+}
+
+void AudioTracer::RecordLatency(AudioTraceStage stage, int64_t latency_us) {
+    if (latency_us < 0) {
+        latency_us = 0;
+    } else if (latency_us > UINT32_MAX) {
+        latency_us = UINT32_MAX;
+    }
+    windows_[current_window_.load(std::memory_order_relaxed)].stages[stage].Record(latency_us);
+}
+
+void AudioTracer::OnProcessorInput(uint32_t samples) {
+    uint32_t start = input_samples_.fetch_add(samples, std::memory_order_relaxed);
+    if (!enabled()) {
+        return;
+    }
+    // When the ring is full the block is simply not traced
+    marks_.Push(Mark{start, samples, esp_timer_get_time()});
+}
+
+int64_t AudioTracer::OnProcessorOutput(uint32_t samples) {
+    uint32_t start = output_samples_.fetch_add(samples, std::memory_order_relaxed);
+
+    // Skip the blocks that start at or before the first sample, the last one holds it
+    Mark* mark;
+    while ((mark = marks_.Front()) != nullptr && static_cast<int32_t>(mark->sample - start) <= 0) {
+        last_mark_ = *mark;
+        has_last_mark_ = true;
+        Mark discarded;
+        marks_.Pop(discarded);
+    }
+    if (has_last_mark_ && start - last_mark_.sample < last_mark_.samples) {
+        return last_mark_.time_us;
+    }
+    return 0;
+}
+
+void AudioTracer::ResetProcessorClock() {
+    input_samples_.store(0, std::memory_order_relaxed);
+    output_samples_.store(0, std::memory_order_relaxed);
+    marks_.Clear();
+    has_last_mark_ = false;
+}
+
+LatencyPercentiles AudioTracer::GetPercentiles(AudioTraceStage stage) const {
+    if (!windows_) {
+        return LatencyPercentiles();
+    }
+    LatencyHistogram merged;
+    for (size_t i = 0; i < AUDIO_TRACE_WINDOWS; ++i) {
+        merged.Add(windows_[i].stages[stage]);
+    }
+    return merged.GetPercentiles();
+}
+
+void AudioTracer::PrintStatistics() {
+    if (!enabled()) {
+        return;
+    }
+
+    size_t current = current_window_.load(std::memory_order_relaxed);
+    auto& stages = windows_[current].stages;
+    auto up_processed = stages[kAudioTraceProcessed].GetPercentiles();
+    auto up_encoded = stages[kAudioTraceEncoded].GetPercentiles();
+    auto up_sent = stages[kAudioTraceSent].GetPercentiles();
+    auto down_decoded = stages[kAudioTraceDecoded].GetPercentiles();
+    auto down_resampled = stages[kAudioTraceResampled].GetPercentiles();
+    auto down_output = stages[kAudioTraceOutput].GetPercentiles();
+    ESP_LOGI(TAG, "Uplink p50/p99 ms: processed=%lu/%lu encoded=%lu/%lu sent=%lu/%lu (n=%lu), "
+        "downlink: decoded=%lu/%lu resampled=%lu/%lu output=%lu/%lu (n=%lu)",
+        up_processed.p50_us / 1000, up_processed.p99_us / 1000, up_encoded.p50_us / 1000, up_encoded.p99_us / 1000,
+        up_sent.p50_us / 1000, up_sent.p99_us / 1000, up_sent.count,
+        down_decoded.p50_us / 1000, down_decoded.p99_us / 1000, down_resampled.p50_us / 1000, down_resampled.p99_us / 1000,
+        down_output.p50_us / 1000, down_output.p99_us / 1000, down_output.count);
+
+    /* The oldest window is cleared and becomes the current one */
+    size_t next = (current + 1) % AUDIO_TRACE_WINDOWS;
+    for (auto& histogram : windows_[next].stages) {
+        histogram.Reset();
+    }
+    current_window_.store(next, std::memory_order_relaxed);
+}
+
+const char* AudioTracer::StageName(AudioTraceStage stage) {
+    switch (stage) {
+        case kAudioTraceProcessed:
+            return "processed";
+        case kAudioTraceEncoded:
+            return "encoded";
+        case kAudioTraceSent:
+            return "sent";
+        case kAudioTraceDecoded:
+            return "decoded";
+        case kAudioTraceResampled:
+            return "resampled";
+        case kAudioTraceOutput:
+            return "output";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef AUDIO_TRACER_H
+#define AUDIO_TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <esp_timer.h>
+
+#include "latency_histogram.h"
+#include "spsc_queue.h"
+
+// Each window covers one statistics interval, the oldest one is overwritten
+#define AUDIO_TRACE_WINDOWS 3
+#define AUDIO_TRACE_MAX_MARKS 16
+
+/*
+ * Every stage measures the time since the frame entered the device:
+ * the uplink from ReadAudioData() and the downlink from Protocol::OnIncomingAudio().
+ */
+enum AudioTraceStage {
+    kAudioTraceProcessed,   // Uplink: audio processor output
+    kAudioTraceEncoded,     // Uplink: Opus packet encoded
+    kAudioTraceSent,        // Uplink: Protocol::SendAudio() returned
+    kAudioTraceDecoded,     // Downlink: Opus packet decoded (includes the jitter buffer)
+    kAudioTraceResampled,   // Downlink: decoded PCM resampled to the codec rate
+    kAudioTraceOutput,      // Downlink: codec OutputData() returned
+    kAudioTraceStageCount,
+};
+
+/*
+ * Per-stage latency histograms of the audio pipeline.
+ *
+ * Frames carry the time they entered the device (trace_time_us, 0 when not traced) and each
+ * stage records its distance from it. The histograms live in a fixed ring of windows that is
+ * allocated the first time the tracer is enabled and never freed, so recording never allocates.
+ * While disabled, the hooks only load one atomic flag.
+ */
+class AudioTracer {
+public:
+    void SetEnabled(bool enabled);
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+    // Time to stamp a frame entering the device with, 0 while disabled
+    int64_t Timestamp() const { return enabled() ? esp_timer_get_time() : 0; }
+
+    // Records the stage of a frame that entered the device at `origin_us`, frames without origin are ignored
+    void Record(AudioTraceStage stage, int64_t origin_us) {
+        if (origin_us != 0 && enabled()) {
+            RecordLatency(stage, esp_timer_get_time() - origin_us);
+        }
+    }
+
+    /*
+     * The audio processor buffers and rechunks its input, so the origin of an output frame is found
+     * by sample position: the input task marks where each fed block starts, the output side looks up
+     * the block holding the first sample of each output frame. Both sides count samples even while
+     * disabled, so enabling the tracer mid-stream stays aligned.
+     */
+    void OnProcessorInput(uint32_t samples);
+    // Returns the origin of an output frame of `samples` samples, 0 if unknown
+    int64_t OnProcessorOutput(uint32_t samples);
+    // The processor dropped its buffered input (restarted), must not race with the two calls above
+    void ResetProcessorClock();
+
+    // Merged over all windows of the ring
+    LatencyPercentiles GetPercentiles(AudioTraceStage stage) const;
+    // Logs the current window, then starts the next one
+    void PrintStatistics();
+
+    static const char* StageName(AudioTraceStage stage);
+
+private:
+    struct Window {
+        LatencyHistogram stages[kAudioTraceStageCount];
+    };
+
+    struct Mark {
+        uint32_t sample;    // Position of the first sample of the block, wraps around
+        uint32_t samples;
+        int64_t time_us;
+    };
+
+    std::atomic<bool> enabled_{false};
+    std::unique_ptr<Window[]> windows_;
+    std::atomic<size_t> current_window_{0};
+
+    std::atomic<uint32_t> input_samples_{0};
+    std::atomic<uint32_t> output_samples_{0};
+    SpscQueue<Mark, AUDIO_TRACE_MAX_MARKS> marks_;
+    // Output side, the block the previous output frame started in
+    Mark last_mark_{};
+    bool has_last_mark_ = false;
+
+    void RecordLatency(AudioTraceStage stage, int64_t latency_us);
+};
+
+#endif // AUDIO_TRACER_H
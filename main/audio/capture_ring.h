@@ -0,0 +1,121 @@
+#ifndef CAPTURE_RING_H
+#define CAPTURE_RING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define CAPTURE_RING_MAX_READERS 4
+// The ring holds this many chunks of the largest reader, readers are served as soon as they have one
+#define CAPTURE_RING_CHUNKS 3
+
+/*
+ * One capture, several readers with chunk sizes of their own.
+ *
+ * The input task reads the codec once and writes the frames here; the wake word, the audio
+ * processor and audio testing then each take chunks of their own size. The storage holds the
+ * ring plus a mirror of its first max_chunk frames behind the end, so a chunk of up to max_chunk
+ * frames is contiguous wherever it starts, and a reader gets a pointer into the ring instead of
+ * a copy. A reader that falls a whole ring behind loses its oldest frames.
+ *
+ * Frames are interleaved samples of all channels. Only used by the input task, not thread safe.
+ */
+class CaptureRing {
+public:
+    // Allocates, and starts over, only when the channels change or a reader needs a larger chunk
+    void Configure(size_t channels, size_t max_chunk_frames) {
+        if (channels == channels_ && max_chunk_frames <= max_chunk_) {
+            return;
+        }
+        channels_ = channels;
+        max_chunk_ = std::max(max_chunk_frames, max_chunk_);
+        capacity_ = max_chunk_ * CAPTURE_RING_CHUNKS;
+        buffer_.assign((capacity_ + max_chunk_) * channels_, 0);
+        write_pos_ = 0;
+        for (auto& reader : readers_) {
+            reader.pos = 0;
+        }
+    }
+
+    // An inactive reader does not hold frames; it starts at the newest frame when activated
+    void SetActive(int reader, bool active) {
+        if (active && !readers_[reader].active) {
+            readers_[reader].pos = write_pos_;
+        }
+        readers_[reader].active = active;
+    }
+
+    // `end_us` is the capture time of the last frame
+    void Write(const int16_t* frames, size_t count, int64_t end_us) {
+        count = std::min(count, capacity_);
+        size_t index = write_pos_ % capacity_;
+        size_t first = std::min(count, capacity_ - index);
+        Store(index, frames, first);
+        Store(0, frames + first * channels_, count - first);
+        write_pos_ += count;
+        write_end_us_ = end_us;
+
+        for (auto& reader : readers_) {
+            if (reader.active && write_pos_ - reader.pos > capacity_) {
+                reader.overrun_frames += write_pos_ - capacity_ - reader.pos;
+                reader.pos = write_pos_ - capacity_;
+            }
+        }
+    }
+
+    size_t Available(int reader) const { return size_t(write_pos_ - readers_[reader].pos); }
+
+    // The reader's next `count` frames, contiguous, nullptr if fewer are available. `count` <= max_chunk
+    const int16_t* Peek(int reader, size_t count) const {
+        if (count == 0 || count > max_chunk_ || Available(reader) < count) {
+            return nullptr;
+        }
+        return buffer_.data() + (readers_[reader].pos % capacity_) * channels_;
+    }
+
+    void Consume(int reader, size_t count) {
+        readers_[reader].pos += std::min(count, Available(reader));
+    }
+
+    // Capture time of the last of the reader's next `count` frames
+    int64_t EndTimeUs(int reader, size_t count, int sample_rate) const {
+        int64_t behind = int64_t(Available(reader)) - int64_t(count);
+        return write_end_us_ - behind * 1000000 / sample_rate;
+    }
+
+    size_t channels() const { return channels_; }
+    size_t capacity() const { return capacity_; }
+    uint64_t overrun_frames(int reader) const { return readers_[reader].overrun_frames; }
+
+private:
+    struct Reader {
+        uint64_t pos = 0;
+        bool active = false;
+        uint64_t overrun_frames = 0;
+    };
+
+    std::vector<int16_t> buffer_;
+    size_t channels_ = 0;
+    size_t max_chunk_ = 0;
+    size_t capacity_ = 0;
+    uint64_t write_pos_ = 0;
+    int64_t write_end_us_ = 0;
+    Reader readers_[CAPTURE_RING_MAX_READERS];
+
+    // Frames at ring index `index` and on, and again in the mirror if they fall in its range
+    void Store(size_t index, const int16_t* frames, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        std::memcpy(buffer_.data() + index * channels_, frames, count * channels_ * sizeof(int16_t));
+        if (index < max_chunk_) {
+            size_t mirrored = std::min(count, max_chunk_ - index);
+            std::memcpy(buffer_.data() + (capacity_ + index) * channels_, frames,
+                mirrored * channels_ * sizeof(int16_t));
+        }
+    }
+};
+
+#endif // CAPTURE_RING_H
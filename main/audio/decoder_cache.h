@@ -0,0 +1,99 @@
+#ifndef DECODER_CACHE_H
+#define DECODER_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Stream formats kept per decode stream, e.g. server TTS and 16 kHz audio testing on the voice stream
+#define DECODER_CACHE_SLOTS 2
+
+struct DecoderCacheStats {
+    uint32_t hits = 0;      // Format switches served by a cached decoder
+    uint32_t created = 0;   // Decoders created (and resamplers configured) for a format not in the cache
+    uint32_t evicted = 0;   // Cached formats dropped to make room for another one
+};
+
+/*
+ * Decoders and output resamplers of one decode stream, keyed by sample rate and frame duration.
+ *
+ * Opus packets carry their format, and a stream may switch between formats now and then.
+ * Instead of destroying the decoder and creating one for the new format on every switch, the
+ * last Slots formats keep their decoder and resampler, so switching back is a lookup. The least
+ * recently used format is dropped when a new one does not fit. A cached decoder starts a new
+ * Opus stream when it is selected again, so its state is reset.
+ *
+ * Decoder is constructed as Decoder(sample_rate, channels, frame_duration) and has ResetState(),
+ * Resampler has Configure(input_rate, output_rate). Only used by the task that decodes the stream.
+ */
+template <typename Decoder, typename Resampler, size_t Slots = DECODER_CACHE_SLOTS>
+class DecoderCache {
+public:
+    struct Entry {
+        int sample_rate = 0;
+        int frame_duration = 0;
+        std::unique_ptr<Decoder> decoder;
+        Resampler resampler;    // Configured to the output rate if the sample rate differs from it
+        uint32_t last_used = 0;
+    };
+
+    // Call once before Select(), `output_sample_rate` is what the resamplers convert to
+    void Initialize(int output_sample_rate, int channels = 1) {
+        output_sample_rate_ = output_sample_rate;
+        channels_ = channels;
+    }
+
+    // The entry for the format, the current one if the format did not change
+    Entry& Select(int sample_rate, int frame_duration) {
+        if (current_ != nullptr && current_->sample_rate == sample_rate && current_->frame_duration == frame_duration) {
+            return *current_;
+        }
+
+        Entry* victim = &entries_[0];
+        for (auto& entry : entries_) {
+            if (entry.decoder != nullptr && entry.sample_rate == sample_rate && entry.frame_duration == frame_duration) {
+                entry.decoder->ResetState();
+                stats_.hits++;
+                return Use(entry);
+            }
+            // Empty slots first, then the least recently used
+            if (victim->decoder != nullptr && (entry.decoder == nullptr || entry.last_used < victim->last_used)) {
+                victim = &entry;
+            }
+        }
+
+        if (victim->decoder != nullptr) {
+            stats_.evicted++;
+        }
+        victim->decoder.reset();
+        victim->decoder = std::make_unique<Decoder>(sample_rate, channels_, frame_duration);
+        victim->sample_rate = sample_rate;
+        victim->frame_duration = frame_duration;
+        if (sample_rate != output_sample_rate_) {
+            victim->resampler.Configure(sample_rate, output_sample_rate_);
+        }
+        stats_.created++;
+        return Use(*victim);
+    }
+
+    // The last selected entry, nullptr before the first Select()
+    Entry* current() { return current_; }
+
+    const DecoderCacheStats& stats() const { return stats_; }
+
+private:
+    Entry entries_[Slots];
+    Entry* current_ = nullptr;
+    uint32_t use_count_ = 0;
+    int output_sample_rate_ = 0;
+    int channels_ = 1;
+    DecoderCacheStats stats_;
+
+    Entry& Use(Entry& entry) {
+        entry.last_used = ++use_count_;
+        current_ = &entry;
+        return entry;
+    }
+};
+
+#endif // DECODER_CACHE_H
@@ -0,0 +1,151 @@
+#include "dsp_kernels.h"
+
+#include <cstring>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The word kernels assume little-endian samples");
+
+static inline bool IsWordAligned(const void* pointer) {
+    return (reinterpret_cast<uintptr_t>(pointer) & 3) == 0;
+}
+
+// The caller checked the alignment, so these compile to single 32-bit loads and stores
+static inline uint32_t LoadWord(const int16_t* pointer) {
+    uint32_t word;
+    std::memcpy(&word, __builtin_assume_aligned(pointer, 4), sizeof(word));
+    return word;
+}
+
+static inline void StoreWord(int16_t* pointer, uint32_t word) {
+    std::memcpy(__builtin_assume_aligned(pointer, 4), &word, sizeof(word));
+}
+
+static inline int16_t Saturate16(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return static_cast<int16_t>(value);
+}
+
+void DspDeinterleave2(const int16_t* in, int16_t* left, int16_t* right, size_t frames) {
+    size_t i = 0;
+    if (IsWordAligned(in) && IsWordAligned(left) && IsWordAligned(right)) {
+        // Two frames per iteration: a = L0 | R0 << 16, b = L1 | R1 << 16
+        for (; i + 2 <= frames; i += 2) {
+            uint32_t a = LoadWord(in + 2 * i);
+            uint32_t b = LoadWord(in + 2 * i + 2);
+            StoreWord(left + i, (a & 0xFFFF) | (b << 16));
+            StoreWord(right + i, (a >> 16) | (b & 0xFFFF0000));
+        }
+    }
+    for (; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void DspInterleave2(const int16_t* left, const int16_t* right, int16_t* out, size_t frames) {
+    size_t i = 0;
+    if (IsWordAligned(left) && IsWordAligned(right) && IsWordAligned(out)) {
+        for (; i + 2 <= frames; i += 2) {
+            uint32_t l = LoadWord(left + i);
+            uint32_t r = LoadWord(right + i);
+            StoreWord(out + 2 * i, (l & 0xFFFF) | (r << 16));
+            StoreWord(out + 2 * i + 2, (l >> 16) | (r & 0xFFFF0000));
+        }
+    }
+    for (; i < frames; ++i) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void DspExtractChannel(const int16_t* in, int16_t* out, size_t frames, size_t channels, size_t channel) {
+    if (channels == 2 && channel == 0 && IsWordAligned(in) && IsWordAligned(out)) {
+        // In place is safe: word i / 2 of the output is written after words i and i + 1 of the input are read
+        size_t i = 0;
+        for (; i + 2 <= frames; i += 2) {
+            uint32_t a = LoadWord(in + 2 * i);
+            uint32_t b = LoadWord(in + 2 * i + 2);
+            StoreWord(out + i, (a & 0xFFFF) | (b << 16));
+        }
+        for (; i < frames; ++i) {
+            out[i] = in[2 * i];
+        }
+        return;
+    }
+    for (size_t i = 0, j = channel; i < frames; ++i, j += channels) {
+        out[i] = in[j];
+    }
+}
+
+void DspInt16ToFloat(const int16_t* in, float* out, size_t count, float scale) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        out[i] = static_cast<float>(in[i]) * scale;
+        out[i + 1] = static_cast<float>(in[i + 1]) * scale;
+        out[i + 2] = static_cast<float>(in[i + 2]) * scale;
+        out[i + 3] = static_cast<float>(in[i + 3]) * scale;
+    }
+    for (; i < count; ++i) {
+        out[i] = static_cast<float>(in[i]) * scale;
+    }
+}
+
+void DspGainQ16(const int16_t* in, int16_t* out, size_t count, int32_t gain_q16) {
+    if (gain_q16 == DSP_Q16_UNITY) {
+        if (out != in) {
+            std::memmove(out, in, count * sizeof(int16_t));
+        }
+        return;
+    }
+    size_t i = 0;
+    if (IsWordAligned(in) && IsWordAligned(out)) {
+        // Each word is loaded before it is stored, so in place is safe.
+        // Below unity the result always fits 16 bits and the saturation is never taken
+        for (; i + 2 <= count; i += 2) {
+            uint32_t word = LoadWord(in + i);
+            int32_t low = DspScaleQ16(int16_t(word & 0xFFFF), gain_q16);
+            int32_t high = DspScaleQ16(int16_t(word >> 16), gain_q16);
+            StoreWord(out + i, (uint32_t(low) & 0xFFFF) | (uint32_t(high) << 16));
+        }
+    }
+    for (; i < count; ++i) {
+        out[i] = Saturate16(DspScaleQ16(in[i], gain_q16));
+    }
+}
+
+void DspGainQ16ToInt32(const int16_t* in, int32_t* out, size_t count, int32_t gain_q16) {
+    size_t i = 0;
+    if (IsWordAligned(in)) {
+        for (; i + 4 <= count; i += 4) {
+            uint32_t a = LoadWord(in + i);
+            uint32_t b = LoadWord(in + i + 2);
+            out[i] = int32_t(int16_t(a & 0xFFFF)) * gain_q16;
+            out[i + 1] = int32_t(int16_t(a >> 16)) * gain_q16;
+            out[i + 2] = int32_t(int16_t(b & 0xFFFF)) * gain_q16;
+            out[i + 3] = int32_t(int16_t(b >> 16)) * gain_q16;
+        }
+    }
+    for (; i < count; ++i) {
+        out[i] = int32_t(in[i]) * gain_q16;
+    }
+}
+
+void DspMixGainQ16(const int16_t* in, int32_t* acc, size_t count, int32_t gain_q16) {
+    if (gain_q16 == 0) {
+        return;
+    }
+    if (gain_q16 == DSP_Q16_UNITY) {
+        // At unity the rounding adds nothing, the sample is added as it is
+        for (size_t i = 0; i < count; ++i) {
+            acc[i] += in[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += DspScaleQ16(in[i], gain_q16);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Every gain in the audio paths (mixer streams, output volume) is Q16, 65536 is unity
+#define DSP_Q16_UNITY 65536
+
+/*
+ * Sample-format kernels shared by the audio paths.
+ *
+ * Every kernel produces exactly the same output as the plain per-sample loop it replaces
+ * (tests/host/dsp_kernels_test.cc checks this). Where the buffers are word aligned, two
+ * 16-bit samples are moved per 32-bit load / store.
+ */
+
+// in = L0 R0 L1 R1 ... -> left = L0 L1 ..., right = R0 R1 ...
+void DspDeinterleave2(const int16_t* in, int16_t* left, int16_t* right, size_t frames);
+
+// left = L0 L1 ..., right = R0 R1 ... -> out = L0 R0 L1 R1 ...
+void DspInterleave2(const int16_t* left, const int16_t* right, int16_t* out, size_t frames);
+
+// Copies one channel out of `channels` interleaved channels. `out` may be `in` (in place).
+void DspExtractChannel(const int16_t* in, int16_t* out, size_t frames, size_t channels, size_t channel);
+
+// out = in * scale. With a power-of-two scale such as 1 / 32768 this equals in / 32768.
+void DspInt16ToFloat(const int16_t* in, float* out, size_t count, float scale = 1.0f);
+
+// One sample times a Q16 gain, rounded to nearest. The kernels below and the gain ramps all scale this way.
+inline int32_t DspScaleQ16(int32_t sample, int32_t gain_q16) {
+    return (sample * gain_q16 + 0x8000) >> 16;
+}
+
+// out = saturate(DspScaleQ16(in, gain_q16)), gain_q16 in [0, 65536]. `out` may be `in`.
+void DspGainQ16(const int16_t* in, int16_t* out, size_t count, int32_t gain_q16);
+
+// out = in * gain_q16, gain_q16 in [0, 65536]: the sample left-justified in a 32-bit I2S slot.
+// Cannot overflow, INT16_MIN * 65536 is INT32_MIN.
+void DspGainQ16ToInt32(const int16_t* in, int32_t* out, size_t count, int32_t gain_q16);
+
+// acc += DspScaleQ16(in, gain_q16), gain_q16 in [0, 65536]: adds one stream to a mix
+void DspMixGainQ16(const int16_t* in, int32_t* acc, size_t count, int32_t gain_q16);
+
+#endif // DSP_KERNELS_H
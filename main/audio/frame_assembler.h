@@ -0,0 +1,96 @@
+#ifndef FRAME_ASSEMBLER_H
+#define FRAME_ASSEMBLER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#define FRAME_ASSEMBLER_DEFAULT_FRAMES 2
+
+/*
+ * Cuts a stream of arbitrarily sized chunks (e.g. AFE fetches) into fixed-size frames.
+ *
+ * The frames are a ring of preallocated buffers. Every sample is copied once, from the chunk
+ * into its frame, and a completed frame is handed out in place, so there is no memmove and no
+ * allocation per frame. The frame handed to the callback stays untouched until the ring comes
+ * back to it. If the callback takes the vector's storage, the slot is reallocated once.
+ * A callback that returns false did not keep the frame (e.g. its queue was full): the ring does
+ * not move on and the slot is filled again, so a dropped frame never wraps the ring onto a frame
+ * still in use.
+ *
+ * Append() must only be called by one task. Reset() may be called from any task and
+ * drops the partial frame on the next Append().
+ */
+class FrameAssembler {
+public:
+    void Configure(size_t frame_samples, size_t frames = FRAME_ASSEMBLER_DEFAULT_FRAMES) {
+        frame_samples_ = frame_samples;
+        frames_.resize(std::max<size_t>(frames, 1));
+        for (auto& frame : frames_) {
+            frame.clear();
+            frame.reserve(frame_samples_);
+        }
+        current_ = 0;
+        fill_ = 0;
+        reset_pending_ = false;
+    }
+
+    // Calls on_frame(std::vector<int16_t>& frame) for every frame completed by these samples,
+    // on_frame returns void or whether it kept the frame
+    template <typename Callback>
+    void Append(const int16_t* samples, size_t count, Callback&& on_frame) {
+        if (frame_samples_ == 0) {
+            return;
+        }
+        if (reset_pending_.exchange(false, std::memory_order_acquire)) {
+            fill_ = 0;
+        }
+
+        while (count > 0) {
+            auto& frame = frames_[current_];
+            if (frame.capacity() < frame_samples_) {
+                frame.reserve(frame_samples_);
+            }
+            frame.resize(frame_samples_);
+
+            size_t n = std::min(count, frame_samples_ - fill_);
+            std::memcpy(frame.data() + fill_, samples, n * sizeof(int16_t));
+            fill_ += n;
+            samples += n;
+            count -= n;
+
+            if (fill_ == frame_samples_) {
+                fill_ = 0;
+                if constexpr (std::is_same_v<std::invoke_result_t<Callback&, std::vector<int16_t>&>, bool>) {
+                    if (on_frame(frame)) {
+                        current_ = (current_ + 1) % frames_.size();
+                    }
+                } else {
+                    current_ = (current_ + 1) % frames_.size();
+                    on_frame(frame);
+                }
+            }
+        }
+    }
+
+    void Reset() {
+        reset_pending_.store(true, std::memory_order_release);
+    }
+
+    size_t frame_samples() const { return frame_samples_; }
+    // Samples of the partial frame, only meaningful on the appending task
+    size_t pending() const { return fill_; }
+
+private:
+    std::vector<std::vector<int16_t>> frames_;
+    size_t frame_samples_ = 0;
+    size_t current_ = 0;
+    size_t fill_ = 0;
+    std::atomic<bool> reset_pending_{false};
+};
+
+#endif // FRAME_ASSEMBLER_H
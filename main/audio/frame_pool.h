@@ -0,0 +1,148 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Recycling pool for audio frame objects (AudioTask, AudioStreamPacket).
+ *
+ * The pooled type must have a free function FrameBuffer(T&) returning its frame buffer vector.
+ * Objects are handed out as std::unique_ptr with a FramePoolDeleter, so whoever drops the last
+ * reference returns the object, with its buffer capacity intact, to the pool. Once the pool has
+ * warmed up, acquiring and releasing a frame does not touch the heap.
+ *
+ * `allocated` counts objects created because the pool was empty and `grown` counts frames whose
+ * buffer had to be reallocated while in use. Both stop increasing in steady state.
+ */
+struct FramePoolStats {
+    uint32_t acquired = 0;
+    uint32_t allocated = 0;
+    uint32_t grown = 0;
+    uint32_t released = 0;
+    size_t cached = 0;
+};
+
+template <typename T>
+class FramePool;
+
+template <typename T>
+struct FramePoolDeleter {
+    FramePool<T>* pool = nullptr;
+    size_t capacity = 0;
+
+    FramePoolDeleter() = default;
+    FramePoolDeleter(FramePool<T>* pool, size_t capacity) : pool(pool), capacity(capacity) {}
+    // Objects from std::make_unique<T>() can still be stored in a pooled handle, they are deleted as usual
+    FramePoolDeleter(const std::default_delete<T>&) {}
+
+    void operator()(T* object) const;
+};
+
+template <typename T>
+class FramePool {
+public:
+    using Ptr = std::unique_ptr<T, FramePoolDeleter<T>>;
+
+    explicit FramePool(size_t max_cached) : max_cached_(max_cached) {
+        free_.reserve(max_cached_);
+    }
+
+    ~FramePool() {
+        for (auto object : free_) {
+            delete object;
+        }
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Set the frame buffer capacity for new objects and create `count` of them up front
+    void Initialize(size_t buffer_capacity, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_capacity_ = buffer_capacity;
+        for (auto object : free_) {
+            FrameBuffer(*object).reserve(buffer_capacity_);
+        }
+        while (free_.size() < count && free_.size() < max_cached_) {
+            auto object = new T();
+            FrameBuffer(*object).reserve(buffer_capacity_);
+            free_.push_back(object);
+        }
+    }
+
+    Ptr Acquire() {
+        T* object = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.acquired++;
+            if (!free_.empty()) {
+                object = free_.back();
+                free_.pop_back();
+            } else {
+                stats_.allocated++;
+            }
+        }
+        if (object == nullptr) {
+            object = new T();
+            FrameBuffer(*object).reserve(buffer_capacity_);
+        }
+        return Ptr(object, FramePoolDeleter<T>(this, FrameBuffer(*object).capacity()));
+    }
+
+    FramePoolStats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FramePoolStats stats = stats_;
+        stats.cached = free_.size();
+        return stats;
+    }
+
+private:
+    friend struct FramePoolDeleter<T>;
+
+    mutable std::mutex mutex_;
+    std::vector<T*> free_;
+    size_t buffer_capacity_ = 0;
+    size_t max_cached_;
+    FramePoolStats stats_;
+
+    void Recycle(T* object, size_t acquired_capacity) {
+        // Reset every field but keep the frame buffer storage
+        auto buffer = std::move(FrameBuffer(*object));
+        bool grown = buffer.capacity() > acquired_capacity;
+        buffer.clear();
+        if (buffer.capacity() < buffer_capacity_) {
+            grown = true;
+            buffer.reserve(buffer_capacity_);
+        }
+        *object = T();
+        FrameBuffer(*object) = std::move(buffer);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (grown) {
+                stats_.grown++;
+            }
+            if (free_.size() < max_cached_) {
+                free_.push_back(object);
+                return;
+            }
+            stats_.released++;
+        }
+        delete object;
+    }
+};
+
+template <typename T>
+void FramePoolDeleter<T>::operator()(T* object) const {
+    if (pool != nullptr) {
+        pool->Recycle(object, capacity);
+    } else {
+        delete object;
+    }
+}
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,175 @@
+#include "jitter_buffer.h"
+
+#include <cstdlib>
+
+// A sequence this far from the expected one means the server restarted the stream
+#define JITTER_BUFFER_RESYNC_DISTANCE 64
+// Arrivals further apart than this start a new talk spurt and do not count as jitter
+#define JITTER_BUFFER_SPURT_GAP_MS 1000
+
+void JitterBuffer::Put(AudioStreamPacketPtr packet, int64_t now_ms) {
+    ApplyReset();
+
+    if (packet->frame_duration > 0) {
+        frame_duration_ = packet->frame_duration;
+    }
+    if (packet->sequence == 0) {
+        packet->sequence = newest_sequence_ + 1;
+    }
+    uint32_t sequence = packet->sequence;
+
+    if (has_next_) {
+        int32_t distance = static_cast<int32_t>(sequence - next_sequence_);
+        if (distance <= -JITTER_BUFFER_RESYNC_DISTANCE || distance >= JITTER_BUFFER_RESYNC_DISTANCE) {
+            Flush();
+            playing_ = false;
+            has_next_ = false;
+            has_transit_ = false;
+        } else if (distance < 0) {
+            stats_.late++;
+            return;
+        } else if (distance >= JITTER_BUFFER_SLOTS) {
+            // We fell behind the sender, give up the oldest frames to make room
+            uint32_t first_kept = sequence - JITTER_BUFFER_SLOTS + 1;
+            while (next_sequence_ != first_kept) {
+                auto& slot = slots_[next_sequence_ % JITTER_BUFFER_SLOTS];
+                if (slot) {
+                    slot.reset();
+                    count_--;
+                }
+                stats_.lost++;
+                next_sequence_++;
+            }
+        }
+    }
+
+    auto& slot = slots_[sequence % JITTER_BUFFER_SLOTS];
+    if (slot) {
+        if (slot->sequence == sequence) {
+            stats_.late++;
+            return;
+        }
+        // Only possible before playback starts, when the window is not anchored yet
+        slot.reset();
+        count_--;
+        stats_.lost++;
+    }
+
+    if (count_ == 0) {
+        newest_sequence_ = sequence;
+        if (!playing_) {
+            buffering_since_ms_ = now_ms;
+        }
+    } else if (static_cast<int32_t>(sequence - newest_sequence_) > 0) {
+        newest_sequence_ = sequence;
+    }
+    slot = std::move(packet);
+    count_++;
+
+    UpdateJitter(sequence, now_ms);
+}
+
+JitterBufferOutput JitterBuffer::Get(AudioStreamPacketPtr& packet, int64_t now_ms) {
+    ApplyReset();
+
+    if (count_ == 0) {
+        if (playing_) {
+            playing_ = false;
+            stats_.underruns++;
+        }
+        return kJitterBufferWait;
+    }
+
+    if (!playing_) {
+        if (count_ < target_depth_ && now_ms - buffering_since_ms_ < int64_t(target_depth_) * frame_duration_) {
+            return kJitterBufferWait;
+        }
+        playing_ = true;
+        if (!has_next_) {
+            FindOldest(next_sequence_);
+            has_next_ = true;
+        }
+    }
+
+    auto& slot = slots_[next_sequence_ % JITTER_BUFFER_SLOTS];
+    if (!slot || slot->sequence != next_sequence_) {
+        // The next frame is missing but later ones are here, it is lost
+        stats_.lost++;
+        if (concealed_in_row_ < JITTER_BUFFER_MAX_CONCEALED_FRAMES) {
+            concealed_in_row_++;
+            stats_.concealed++;
+            next_sequence_++;
+            return kJitterBufferConceal;
+        }
+
+        // Concealing a long burst sounds worse than skipping it
+        uint32_t oldest = next_sequence_;
+        FindOldest(oldest);
+        stats_.lost += oldest - next_sequence_ - 1;
+        next_sequence_ = oldest;
+    }
+
+    auto& next = slots_[next_sequence_ % JITTER_BUFFER_SLOTS];
+    packet = std::move(next);
+    count_--;
+    next_sequence_++;
+    concealed_in_row_ = 0;
+    return kJitterBufferPacket;
+}
+
+JitterBufferStats JitterBuffer::GetStats() const {
+    JitterBufferStats stats = stats_;
+    stats.depth = count_;
+    stats.target_depth = target_depth_;
+    stats.jitter_ms = jitter_q4_ >> 4;
+    return stats;
+}
+
+void JitterBuffer::ApplyReset() {
+    if (!reset_pending_.exchange(false)) {
+        return;
+    }
+    Flush();
+    playing_ = false;
+    has_next_ = false;
+    has_transit_ = false;
+    concealed_in_row_ = 0;
+    // The measured jitter belongs to the network, keep it for the next stream
+}
+
+void JitterBuffer::Flush() {
+    for (auto& slot : slots_) {
+        slot.reset();
+    }
+    count_ = 0;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_ms) {
+    int64_t transit_ms = now_ms - int64_t(sequence) * frame_duration_;
+    if (has_transit_ && now_ms - last_arrival_ms_ < JITTER_BUFFER_SPURT_GAP_MS) {
+        // RFC 3550: J += (|D| - J) / 16, kept in 1/16 ms
+        int32_t d = static_cast<int32_t>(std::llabs(transit_ms - last_transit_ms_));
+        jitter_q4_ += d - ((jitter_q4_ + 8) >> 4);
+    }
+    has_transit_ = true;
+    last_arrival_ms_ = now_ms;
+    last_transit_ms_ = transit_ms;
+
+    // Hold about twice the jitter on top of the frame being played
+    uint32_t jitter_ms = jitter_q4_ >> 4;
+    target_depth_ = JITTER_BUFFER_MIN_DEPTH + (2 * jitter_ms + frame_duration_ - 1) / frame_duration_;
+    if (target_depth_ > JITTER_BUFFER_MAX_DEPTH) {
+        target_depth_ = JITTER_BUFFER_MAX_DEPTH;
+    }
+}
+
+bool JitterBuffer::FindOldest(uint32_t& sequence) const {
+    bool found = false;
+    for (auto& slot : slots_) {
+        if (slot && (!found || static_cast<int32_t>(slot->sequence - sequence) < 0)) {
+            sequence = slot->sequence;
+            found = true;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,78 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "audio_stream_packet.h"
+
+#define JITTER_BUFFER_SLOTS 16
+#define JITTER_BUFFER_MIN_DEPTH 1
+#define JITTER_BUFFER_MAX_DEPTH 6
+#define JITTER_BUFFER_MAX_CONCEALED_FRAMES 3
+
+struct JitterBufferStats {
+    uint32_t late = 0;          // Arrived after their turn (or duplicated), dropped
+    uint32_t lost = 0;          // Never arrived in time
+    uint32_t concealed = 0;     // Lost frames replaced by Opus PLC
+    uint32_t underruns = 0;     // Buffer ran dry while playing
+    uint32_t depth = 0;         // Packets currently buffered
+    uint32_t target_depth = 0;  // Packets to buffer before playing
+    uint32_t jitter_ms = 0;     // Smoothed inter-arrival jitter
+};
+
+enum JitterBufferOutput {
+    kJitterBufferWait,      // Nothing to play yet
+    kJitterBufferPacket,    // Decode the returned packet
+    kJitterBufferConceal,   // The next frame is missing, decode with PLC
+};
+
+/*
+ * Reorders incoming Opus packets by sequence number and releases them at a depth that
+ * follows the measured inter-arrival jitter (RFC 3550 estimator, using the sequence
+ * number times the frame duration as the media clock).
+ *
+ * Packets without a sequence number (WebSocket, local sounds) are numbered in arrival order.
+ * Only the Opus decode task may call Put() / Get(); Reset() may be called from any task and
+ * takes effect on the next Put() / Get().
+ */
+class JitterBuffer {
+public:
+    void Put(AudioStreamPacketPtr packet, int64_t now_ms);
+    JitterBufferOutput Get(AudioStreamPacketPtr& packet, int64_t now_ms);
+    void Reset() { reset_pending_ = true; }
+
+    bool Empty() const { return count_ == 0; }
+    bool Full() const { return count_ >= JITTER_BUFFER_SLOTS; }
+    int frame_duration() const { return frame_duration_; }
+    // Statistics are only written by the Opus decode task, reading them elsewhere is for logging
+    JitterBufferStats GetStats() const;
+
+private:
+    std::array<AudioStreamPacketPtr, JITTER_BUFFER_SLOTS> slots_;
+    uint32_t count_ = 0;
+    bool playing_ = false;
+    bool has_next_ = false;
+    uint32_t next_sequence_ = 0;
+    uint32_t newest_sequence_ = 0;
+    int concealed_in_row_ = 0;
+    int frame_duration_ = 60;
+    int64_t buffering_since_ms_ = 0;
+
+    bool has_transit_ = false;
+    int64_t last_arrival_ms_ = 0;
+    int64_t last_transit_ms_ = 0;
+    int32_t jitter_q4_ = 0;     // Jitter in 1/16 ms
+    uint32_t target_depth_ = JITTER_BUFFER_MIN_DEPTH;
+
+    JitterBufferStats stats_;
+    std::atomic<bool> reset_pending_{false};
+
+    void ApplyReset();
+    void Flush();
+    void UpdateJitter(uint32_t sequence, int64_t now_ms);
+    bool FindOldest(uint32_t& sequence) const;
+};
+
+#endif // JITTER_BUFFER_H
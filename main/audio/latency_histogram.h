@@ -0,0 +1,111 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// 4 buckets per octave up to ~2 s, larger values land in the last bucket
+#define LATENCY_HISTOGRAM_BUCKETS 80
+
+struct LatencyPercentiles {
+    uint32_t count = 0;
+    uint32_t p50_us = 0;
+    uint32_t p90_us = 0;
+    uint32_t p99_us = 0;
+    uint32_t max_us = 0;
+};
+
+/*
+ * Fixed-size, log-scale histogram of durations in microseconds.
+ *
+ * Values below 8 us are exact, above that every octave is split into 4 buckets, so a
+ * percentile is accurate to within 25%. Record() is wait-free and meant for a single
+ * writer task; the counters are atomic so another task can read them for logging.
+ */
+class LatencyHistogram {
+public:
+    void Record(uint32_t us) {
+        auto& bucket = buckets_[BucketOf(us)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (us > max_us_.load(std::memory_order_relaxed)) {
+            max_us_.store(us, std::memory_order_relaxed);
+        }
+    }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint32_t Percentile(uint32_t percentile) const {
+        uint32_t count = count_.load(std::memory_order_relaxed);
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t(count) * percentile + 99) / 100;
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return i + 1 < buckets_.size() ? LowerBound(i + 1) - 1 : max_us_.load(std::memory_order_relaxed);
+            }
+        }
+        return max_us_.load(std::memory_order_relaxed);
+    }
+
+    LatencyPercentiles GetPercentiles() const {
+        LatencyPercentiles result;
+        result.count = count_.load(std::memory_order_relaxed);
+        result.p50_us = Percentile(50);
+        result.p90_us = Percentile(90);
+        result.p99_us = Percentile(99);
+        result.max_us = max_us_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // Adds the samples of another histogram, e.g. to merge time windows
+    void Add(const LatencyHistogram& other) {
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint32_t max_us = other.max_us_.load(std::memory_order_relaxed);
+        if (max_us > max_us_.load(std::memory_order_relaxed)) {
+            max_us_.store(max_us, std::memory_order_relaxed);
+        }
+    }
+
+    // Not synchronized with Record(), a frame recorded at the same time may be lost
+    void Reset() {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        max_us_.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t BucketOf(uint32_t us) {
+        if (us < 8) {
+            return us;
+        }
+        int msb = 31 - __builtin_clz(us);
+        size_t index = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+        return index < LATENCY_HISTOGRAM_BUCKETS ? index : LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+
+    static uint32_t LowerBound(size_t index) {
+        if (index < 8) {
+            return index;
+        }
+        int msb = index / 4 + 1;
+        return uint32_t(4 + index % 4) << (msb - 2);
+    }
+
+private:
+    std::array<std::atomic<uint32_t>, LATENCY_HISTOGRAM_BUCKETS> buckets_{};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> max_us_{0};
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,105 @@
+#include "link_rate_controller.h"
+
+#include <algorithm>
+
+static const LinkAudioProfile kProfiles[kLinkQualityCount] = {
+    // frame_duration_ms, bitrate, fec, packet_loss_percent, dtx
+    {60, LINK_AUDIO_BITRATE_AUTO, false, 0, false},
+    {60, 12000, true, 10, false},
+    {60, 8000, true, 20, true},
+};
+
+LinkRateController::LinkRateController(LinkQuality initial) {
+    Reset(initial);
+}
+
+void LinkRateController::Reset(LinkQuality quality) {
+    quality_ = quality;
+    clean_windows_ = 0;
+    upgrade_windows_ = LINK_RATE_UPGRADE_WINDOWS;
+    hold_windows_ = 0;
+    windows_since_upgrade_ = -1;
+    pending_received_ = 0;
+    pending_lost_ = 0;
+}
+
+const LinkAudioProfile& LinkRateController::ProfileOf(LinkQuality quality) {
+    return kProfiles[quality];
+}
+
+const char* LinkRateController::QualityName(LinkQuality quality) {
+    switch (quality) {
+        case kLinkQualityNormal: return "normal";
+        case kLinkQualityPoor: return "poor";
+        case kLinkQualityBad: return "bad";
+        default: return "unknown";
+    }
+}
+
+void LinkRateController::SetQuality(LinkQuality quality) {
+    if (quality < quality_) {
+        windows_since_upgrade_ = 0;
+    } else {
+        // Stepping down soon after a step up means the better level does not hold on this link
+        if (windows_since_upgrade_ >= 0 && windows_since_upgrade_ < upgrade_windows_) {
+            upgrade_windows_ = std::min(upgrade_windows_ * 2, LINK_RATE_MAX_UPGRADE_WINDOWS);
+        }
+        windows_since_upgrade_ = -1;
+    }
+    quality_ = quality;
+    clean_windows_ = 0;
+    hold_windows_ = LINK_RATE_HOLD_WINDOWS;
+}
+
+bool LinkRateController::Update(const LinkSample& sample) {
+    // Downlink loss seen while the server was talking counts in the next window with uplink audio
+    uint32_t received = pending_received_ + sample.packets_received;
+    uint32_t lost = pending_lost_ + sample.packets_lost;
+    if (sample.packets_sent == 0 && sample.send_failures == 0) {
+        pending_received_ = received;
+        pending_lost_ = lost;
+        return false;
+    }
+    pending_received_ = 0;
+    pending_lost_ = 0;
+
+    if (windows_since_upgrade_ >= 0 && ++windows_since_upgrade_ >= upgrade_windows_) {
+        // The last step up held, the next one may come at the normal pace
+        upgrade_windows_ = LINK_RATE_UPGRADE_WINDOWS;
+        windows_since_upgrade_ = -1;
+    }
+    if (hold_windows_ > 0) {
+        hold_windows_--;
+        return false;
+    }
+
+    uint32_t loss_total = received + lost;
+    uint32_t loss_percent = loss_total >= LINK_RATE_MIN_LOSS_PACKETS ? lost * 100 / loss_total : 0;
+    bool congested = sample.send_failures > 0 ||
+        (sample.send_queue_capacity > 0 && sample.send_queue_peak * 2 >= sample.send_queue_capacity);
+
+    bool clean = !congested && loss_percent == 0 && sample.send_queue_peak <= LINK_RATE_CLEAN_QUEUE_PACKETS;
+
+    LinkQuality target = quality_;
+    if (congested || loss_percent >= LINK_RATE_DEGRADE_LOSS_PERCENT) {
+        clean_windows_ = 0;
+        target = static_cast<LinkQuality>(std::min<int>(quality_ + 1, kLinkQualityBad));
+    } else if (loss_percent >= LINK_RATE_FEC_LOSS_PERCENT) {
+        clean_windows_ = 0;
+        target = std::max(quality_, kLinkQualityPoor);
+    } else if (!clean && windows_since_upgrade_ >= 0) {
+        // The level we just stepped up to is already falling behind, go back before the queue fills up
+        target = static_cast<LinkQuality>(quality_ + 1);
+    } else {
+        clean_windows_ = clean ? clean_windows_ + 1 : 0;
+        if (clean_windows_ >= upgrade_windows_ && quality_ > kLinkQualityNormal) {
+            target = static_cast<LinkQuality>(quality_ - 1);
+        }
+    }
+
+    if (target == quality_) {
+        return false;
+    }
+    SetQuality(target);
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef LINK_RATE_CONTROLLER_H
+#define LINK_RATE_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Consecutive clean windows before stepping up one level, doubled after every failed step up
+#define LINK_RATE_UPGRADE_WINDOWS 10
+#define LINK_RATE_MAX_UPGRADE_WINDOWS 160
+// Windows after a change in which the link is not judged again, so that the send queue can drain
+#define LINK_RATE_HOLD_WINDOWS 3
+// Packets a window needs before its loss rate counts
+#define LINK_RATE_MIN_LOSS_PACKETS 10
+#define LINK_RATE_FEC_LOSS_PERCENT 3
+#define LINK_RATE_DEGRADE_LOSS_PERCENT 10
+// A send queue that never holds more than this keeps up with the encoder
+#define LINK_RATE_CLEAN_QUEUE_PACKETS 2
+// Profile bitrate that leaves the choice to libopus (OPUS_AUTO), as the encoder did before rate control
+#define LINK_AUDIO_BITRATE_AUTO 0
+
+// Uplink Opus encoder settings, announced to the server in the hello and audio_params messages
+struct LinkAudioProfile {
+    int frame_duration_ms;
+    int bitrate;  // bps, or LINK_AUDIO_BITRATE_AUTO
+    bool fec;
+    int packet_loss_percent;  // Expected loss, sets how much redundancy the in-band FEC carries
+    bool dtx;
+};
+
+// Average bitrate of a profile on 16 kHz mono. libopus sets OPUS_AUTO to Fs + 60 frames' worth per second
+inline int LinkAudioBitrate(const LinkAudioProfile& profile) {
+    if (profile.bitrate != LINK_AUDIO_BITRATE_AUTO) {
+        return profile.bitrate;
+    }
+    return 16000 + 60 * 1000 / profile.frame_duration_ms;
+}
+
+// Every level keeps the 60 ms frames of the audio processor, a shorter packet would not leave any sooner
+enum LinkQuality {
+    kLinkQualityNormal,   // The settings used before rate control existed, libopus default bitrate
+    kLinkQualityPoor,     // Lower bitrate, in-band FEC
+    kLinkQualityBad,      // Lowest bitrate, FEC and DTX
+    kLinkQualityCount,
+};
+
+// What happened on the link during one window (one second)
+struct LinkSample {
+    uint32_t packets_sent = 0;
+    uint32_t send_failures = 0;
+    uint32_t packets_received = 0;  // Downlink packets, their loss is the best estimate of the uplink loss
+    uint32_t packets_lost = 0;
+    size_t send_queue_peak = 0;
+    size_t send_queue_capacity = 0;
+};
+
+/*
+ * Picks the uplink encoder settings from the send queue depth, SendAudio failures and packet loss.
+ *
+ * A congested or lossy window steps down right away, a step up needs a run of clean windows.
+ * A step up is a probe: if the send queue starts to grow before the new level has held for as
+ * long as it took to get there, it is undone and the next attempt waits twice as long, so that
+ * a link right at the edge of a level does not flap. Windows without uplink audio change nothing,
+ * their downlink loss is carried over to the next window with uplink audio.
+ */
+class LinkRateController {
+public:
+    explicit LinkRateController(LinkQuality initial = kLinkQualityNormal);
+
+    // Returns true if the profile changed
+    bool Update(const LinkSample& sample);
+    void Reset(LinkQuality quality = kLinkQualityNormal);
+
+    LinkQuality quality() const { return quality_; }
+    const LinkAudioProfile& profile() const { return ProfileOf(quality_); }
+
+    static const LinkAudioProfile& ProfileOf(LinkQuality quality);
+    static const char* QualityName(LinkQuality quality);
+
+private:
+    LinkQuality quality_;
+    int clean_windows_ = 0;
+    int upgrade_windows_ = LINK_RATE_UPGRADE_WINDOWS;
+    int hold_windows_ = 0;
+    int windows_since_upgrade_ = -1;  // -1 if the last change was not a step up
+    uint32_t pending_received_ = 0;
+    uint32_t pending_lost_ = 0;
+
+    void SetQuality(LinkQuality quality);
+};
+
+#endif // LINK_RATE_CONTROLLER_H
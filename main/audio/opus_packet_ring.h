@@ -0,0 +1,72 @@
+#ifndef OPUS_PACKET_RING_H
+#define OPUS_PACKET_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Bounded ring of the most recent Opus packets. A push into a full ring overwrites the oldest
+ * packet. Slots keep their buffers, and Pop() swaps them with the caller's, so once warmed up
+ * neither side allocates. Not thread-safe, the owner locks.
+ */
+class OpusPacketRing {
+public:
+    explicit OpusPacketRing(size_t capacity = 0, size_t packet_bytes = 0) {
+        Configure(capacity, packet_bytes);
+    }
+
+    void Configure(size_t capacity, size_t packet_bytes) {
+        slots_.resize(capacity);
+        for (auto& slot : slots_) {
+            slot.reserve(packet_bytes);
+        }
+        head_ = 0;
+        count_ = 0;
+        overwritten_ = 0;
+    }
+
+    void Push(const std::vector<uint8_t>& packet) {
+        if (slots_.empty()) {
+            return;
+        }
+        if (count_ == slots_.size()) {
+            head_ = (head_ + 1) % slots_.size();
+            count_--;
+            overwritten_++;
+        }
+        slots_[(head_ + count_) % slots_.size()].assign(packet.begin(), packet.end());
+        count_++;
+    }
+
+    // Moves the oldest packet into `packet`, whose old buffer is kept for a later push
+    bool Pop(std::vector<uint8_t>& packet) {
+        if (count_ == 0) {
+            return false;
+        }
+        packet.swap(slots_[head_]);
+        head_ = (head_ + 1) % slots_.size();
+        count_--;
+        return true;
+    }
+
+    void Clear() {
+        head_ = 0;
+        count_ = 0;
+        overwritten_ = 0;
+    }
+
+    size_t Size() const { return count_; }
+    bool Empty() const { return count_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+    // Packets lost to overwriting since Configure() or Clear()
+    uint32_t overwritten() const { return overwritten_; }
+
+private:
+    std::vector<std::vector<uint8_t>> slots_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint32_t overwritten_ = 0;
+};
+
+#endif // OPUS_PACKET_RING_H
@@ -0,0 +1,98 @@
+#include "opus_uplink_encoder.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+
+#define TAG "OpusUplinkEncoder"
+
+OpusUplinkEncoder::OpusUplinkEncoder(int sample_rate, int complexity, const LinkAudioProfile& profile)
+    : sample_rate_(sample_rate), profile_(profile), pending_profile_(profile) {
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+    opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+    Configure(profile);
+}
+
+OpusUplinkEncoder::~OpusUplinkEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+}
+
+void OpusUplinkEncoder::Configure(const LinkAudioProfile& profile) {
+    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(profile.bitrate != LINK_AUDIO_BITRATE_AUTO ? profile.bitrate : OPUS_AUTO));
+    opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(profile.fec ? 1 : 0));
+    opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(profile.packet_loss_percent));
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(profile.dtx ? 1 : 0));
+    dtx_ = profile.dtx;
+    profile_ = profile;
+}
+
+void OpusUplinkEncoder::SetProfile(const LinkAudioProfile& profile) {
+    std::lock_guard<std::mutex> lock(profile_mutex_);
+    pending_profile_ = profile;
+    profile_pending_ = true;
+}
+
+void OpusUplinkEncoder::ApplyPendingProfile() {
+    // Checked without the lock first, so that the encoding task only locks when there is a change
+    if (encoder_ == nullptr || !profile_pending_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(profile_mutex_);
+    profile_pending_ = false;
+    Configure(pending_profile_);
+}
+
+bool OpusUplinkEncoder::Encode(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom) {
+    if (encoder_ == nullptr) {
+        return false;
+    }
+    SetDtx(profile_.dtx);
+    return EncodeFrame(pcm, opus, headroom);
+}
+
+bool OpusUplinkEncoder::EncodeSilence(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom) {
+    if (encoder_ == nullptr) {
+        return false;
+    }
+    // libopus decides when the frame is a DTX frame and writes it, so decoders see the real thing
+    SetDtx(true);
+    return EncodeFrame(pcm, opus, headroom);
+}
+
+bool OpusUplinkEncoder::EncodeFrame(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom) {
+    // Encoded in place, so the budget is what the pooled buffer holds anyway, at least the peak the
+    // profile needs; libopus fits its output into it rather than failing
+    size_t peak_bytes = size_t(LinkAudioBitrate(profile_)) / 8 * profile_.frame_duration_ms / 1000 * OPUS_UPLINK_PEAK_FACTOR;
+    size_t max_bytes = std::clamp(opus.capacity() - std::min(opus.capacity(), headroom), peak_bytes,
+        size_t(OPUS_UPLINK_MAX_PACKET_BYTES));
+    opus.resize(headroom + max_bytes);
+    int frame_size = frame_samples();
+    int ret = opus_encode(encoder_, pcm, frame_size, opus.data() + headroom, max_bytes);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        opus.clear();
+        return false;
+    }
+    opus.resize(headroom + ret);
+    return true;
+}
+
+void OpusUplinkEncoder::SetDtx(bool dtx) {
+    if (dtx != dtx_) {
+        opus_encoder_ctl(encoder_, OPUS_SET_DTX(dtx ? 1 : 0));
+        dtx_ = dtx;
+    }
+}
+
+void OpusUplinkEncoder::ResetState() {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+}
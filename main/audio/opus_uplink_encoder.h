@@ -0,0 +1,60 @@
+#ifndef OPUS_UPLINK_ENCODER_H
+#define OPUS_UPLINK_ENCODER_H
+
+#include <opus.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "link_rate_controller.h"
+
+// Largest packet we accept from the encoder, well above what the profiles' bitrates produce
+#define OPUS_UPLINK_MAX_PACKET_BYTES 1500
+// Encode budget in times the profile's average packet size, when the packet buffer holds less
+#define OPUS_UPLINK_PEAK_FACTOR 2
+
+/*
+ * The uplink Opus encoder, on libopus directly because the wrapper of the other encoders
+ * cannot change the bitrate or the in-band FEC.
+ *
+ * SetProfile() may be called from any task. The profile is applied by the encoding task at the
+ * next frame boundary; libopus takes a new frame size on any call, so nothing is recreated.
+ */
+class OpusUplinkEncoder {
+public:
+    OpusUplinkEncoder(int sample_rate, int complexity, const LinkAudioProfile& profile);
+    ~OpusUplinkEncoder();
+
+    void SetProfile(const LinkAudioProfile& profile);
+    // Applies a pending profile, call before a frame is encoded
+    void ApplyPendingProfile();
+
+    int sample_rate() const { return sample_rate_; }
+    int frame_duration() const { return profile_.frame_duration_ms; }
+    int bitrate() const { return LinkAudioBitrate(profile_); }
+    size_t frame_samples() const { return sample_rate_ / 1000 * profile_.frame_duration_ms; }
+
+    // Encodes frame_samples() samples into `opus`, directly after `headroom` bytes left for the transport
+    bool Encode(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom = 0);
+    // Encodes a frame the silence gate suppressed with libopus DTX on, whatever the profile says. After
+    // a run of silence libopus sends 1-byte DTX frames, with a comfort noise update now and then
+    bool EncodeSilence(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom = 0);
+    void ResetState();
+
+private:
+    OpusEncoder* encoder_ = nullptr;
+    int sample_rate_;
+    LinkAudioProfile profile_;
+    std::mutex profile_mutex_;
+    LinkAudioProfile pending_profile_;
+    std::atomic<bool> profile_pending_{false};
+    bool dtx_ = false;  // What OPUS_SET_DTX is at now
+
+    void Configure(const LinkAudioProfile& profile);
+    void SetDtx(bool dtx);
+    bool EncodeFrame(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom);
+};
+
+#endif // OPUS_UPLINK_ENCODER_H
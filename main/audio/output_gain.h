@@ -0,0 +1,83 @@
+#ifndef OUTPUT_GAIN_H
+#define OUTPUT_GAIN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp_kernels.h"
+
+#define OUTPUT_GAIN_UNITY DSP_Q16_UNITY
+// Time a volume change takes from silence to full scale
+#define OUTPUT_GAIN_RAMP_MS 20
+
+/*
+ * Software volume of the codecs without a hardware volume control.
+ *
+ * The volume (0-100) maps to a Q16 gain of (volume / 100)^2 once, when it is set, instead of on
+ * every write. SetVolume() may be called from any task; the write path moves the gain towards it
+ * one step per sample, so a change does not click (zipper noise). Once the gain has settled the
+ * frame is scaled by a DSP kernel.
+ */
+class OutputGain {
+public:
+    // Same curve as the former per-write pow(volume / 100, 2) * 65536, exactly
+    static int32_t VolumeToGain(int volume) {
+        volume = std::clamp(volume, 0, 100);
+        return int32_t(int64_t(volume) * volume * OUTPUT_GAIN_UNITY / 10000);
+    }
+
+    // Before the first write: the ramp length follows the output rate, and the gain starts at `volume`
+    void Configure(int sample_rate, int volume) {
+        int ramp_samples = std::max(1, sample_rate * OUTPUT_GAIN_RAMP_MS / 1000);
+        ramp_step_ = std::max(1, OUTPUT_GAIN_UNITY / ramp_samples);
+        current_ = VolumeToGain(volume);
+        target_.store(current_, std::memory_order_relaxed);
+    }
+
+    void SetVolume(int volume) { target_.store(VolumeToGain(volume), std::memory_order_relaxed); }
+
+    int32_t gain() const { return current_; }
+    int32_t target_gain() const { return target_.load(std::memory_order_relaxed); }
+
+    // Writing task only. `out` may be `in`
+    void Process(const int16_t* in, int16_t* out, size_t count) {
+        size_t i = Ramp(in, out, count, [](int16_t sample, int32_t gain) {
+            return int16_t(DspScaleQ16(sample, gain));
+        });
+        DspGainQ16(in + i, out + i, count - i, current_);
+    }
+
+    // Writing task only, for codecs with 32-bit I2S slots
+    void Process(const int16_t* in, int32_t* out, size_t count) {
+        size_t i = Ramp(in, out, count, [](int16_t sample, int32_t gain) {
+            return int32_t(sample) * gain;
+        });
+        DspGainQ16ToInt32(in + i, out + i, count - i, current_);
+    }
+
+private:
+    std::atomic<int32_t> target_{OUTPUT_GAIN_UNITY};
+    int32_t current_ = OUTPUT_GAIN_UNITY;
+    int32_t ramp_step_ = OUTPUT_GAIN_UNITY;
+
+    // Scales the samples until the gain reaches the target, returns how many
+    template <typename Sample, typename Scale>
+    size_t Ramp(const int16_t* in, Sample* out, size_t count, Scale scale) {
+        int32_t target = target_.load(std::memory_order_relaxed);
+        size_t i = 0;
+        while (i < count && current_ != target) {
+            if (current_ < target) {
+                current_ = std::min(current_ + ramp_step_, target);
+            } else {
+                current_ = std::max(current_ - ramp_step_, target);
+            }
+            out[i] = scale(in[i], current_);
+            i++;
+        }
+        return i;
+    }
+};
+
+#endif // OUTPUT_GAIN_H
@@ -0,0 +1,109 @@
+#include "playback_clock.h"
+
+#include <cstdlib>
+
+void PlaybackClock::OnPlayout(uint32_t server_ms, int64_t start_us, uint32_t samples, int sample_rate) {
+    if (samples == 0 || sample_rate <= 0) {
+        return;
+    }
+    int64_t duration_us = int64_t(samples) * 1000000 / sample_rate;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_[segment_head_] = Segment{server_ms, start_us, duration_us};
+    segment_head_ = (segment_head_ + 1) % PLAYBACK_CLOCK_SEGMENTS;
+    if (segment_count_ < PLAYBACK_CLOCK_SEGMENTS) {
+        segment_count_++;
+    }
+
+    // Server timestamps are whole milliseconds, the run keeps the exact position instead
+    int64_t server_us = int64_t(server_ms) * 1000;
+    bool contiguous = in_run_ && std::llabs(server_us - next_server_us_) <= 1000;
+    if (contiguous) {
+        int64_t slip_us = (start_us - run_start_us_) - (next_server_us_ - run_server_us_);
+        if (std::llabs(slip_us - last_slip_us_) <= PLAYBACK_CLOCK_MAX_SLIP_US) {
+            last_slip_us_ = slip_us;
+            stats_.slip_us = int32_t(slip_us);
+            int64_t elapsed_us = next_server_us_ - run_server_us_;
+            if (elapsed_us >= int64_t(PLAYBACK_CLOCK_MIN_DRIFT_SPAN_MS) * 1000) {
+                stats_.drift_ppm = int32_t(slip_us * 1000000 / elapsed_us);
+            }
+            next_server_us_ += duration_us;
+            return;
+        }
+        // The playout jumped (e.g. an underrun), measure again from here
+    }
+
+    if (in_run_) {
+        stats_.resyncs++;
+    }
+    in_run_ = true;
+    run_server_us_ = server_us;
+    run_start_us_ = start_us;
+    last_slip_us_ = 0;
+    stats_.slip_us = 0;
+    next_server_us_ = server_us + duration_us;
+}
+
+void PlaybackClock::ResetPlayout() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segment_head_ = 0;
+    segment_count_ = 0;
+    in_run_ = false;
+}
+
+void PlaybackClock::OnCapture(uint32_t samples, int64_t end_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    captured_samples_ += samples;
+    captured_end_us_ = end_us;
+    has_capture_ = true;
+}
+
+int64_t PlaybackClock::OnCaptureOutput(uint32_t samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t start = output_samples_;
+    output_samples_ += samples;
+    if (!has_capture_) {
+        return 0;
+    }
+    // Samples are captured at a steady rate, so the time of any sample follows from the last read
+    int64_t behind = static_cast<int32_t>(captured_samples_ - start);
+    return captured_end_us_ - behind * 1000000 / capture_sample_rate_;
+}
+
+void PlaybackClock::ResetCapture() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    captured_samples_ = 0;
+    output_samples_ = 0;
+    has_capture_ = false;
+}
+
+uint32_t PlaybackClock::ServerTimeAt(int64_t start_us, int64_t duration_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Segment* later = nullptr;
+    for (size_t i = 0; i < segment_count_; i++) {
+        auto& segment = segments_[(segment_head_ + PLAYBACK_CLOCK_SEGMENTS - 1 - i) % PLAYBACK_CLOCK_SEGMENTS];
+        if (segment.start_us <= start_us && start_us < segment.start_us + segment.duration_us) {
+            stats_.stamped++;
+            return segment.server_ms + uint32_t((start_us - segment.start_us) / 1000);
+        }
+        // The voice started during the frame, its first segment is the earliest one starting in the frame
+        if (segment.start_us > start_us && segment.start_us < start_us + duration_us &&
+            (later == nullptr || segment.start_us < later->start_us)) {
+            later = &segment;
+        }
+    }
+    if (later != nullptr) {
+        int64_t lead_ms = (later->start_us - start_us) / 1000;
+        if (lead_ms < later->server_ms) {
+            stats_.stamped++;
+            return later->server_ms - uint32_t(lead_ms);
+        }
+    }
+    stats_.unstamped++;
+    return 0;
+}
+
+PlaybackClockStats PlaybackClock::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,87 @@
+#ifndef PLAYBACK_CLOCK_H
+#define PLAYBACK_CLOCK_H
+
+#include <cstdint>
+#include <mutex>
+
+// Voice segments remembered for lookups, about 2 s of 60 ms frames
+#define PLAYBACK_CLOCK_SEGMENTS 32
+// A playout that slips by more than this against the server timeline starts a new drift measurement
+#define PLAYBACK_CLOCK_MAX_SLIP_US 5000
+// Shortest run of contiguous server time the drift is computed over
+#define PLAYBACK_CLOCK_MIN_DRIFT_SPAN_MS 1000
+
+struct PlaybackClockStats {
+    int32_t slip_us = 0;        // Playout minus server time since the current run started
+    int32_t drift_ppm = 0;      // Playout clock against the server timeline over the current run
+    uint32_t resyncs = 0;       // Runs started because the server timestamps or the playout jumped
+    uint32_t stamped = 0;       // Uplink frames that overlapped played voice
+    uint32_t unstamped = 0;     // Uplink frames captured while no voice was playing
+};
+
+/*
+ * Maps local time onto the server timestamps of the voice being played, for server AEC.
+ *
+ * The output task reports every run of voice samples it hands to the codec with the time its
+ * first sample reaches the DAC (from the I2S DMA position), so the clock knows what server time
+ * is audible at any moment of the last PLAYBACK_CLOCK_SEGMENTS frames. The capture side counts
+ * the samples read from the microphone and stamps each processed frame with the time its first
+ * sample was captured; together they give every uplink frame the server timestamp of the
+ * downlink audio it overlaps, to the sample rather than by queue order.
+ *
+ * While a run of contiguous server timestamps plays, the difference between the playout
+ * and the server timeline is the slip; its slope is the drift between the two clocks.
+ */
+class PlaybackClock {
+public:
+    explicit PlaybackClock(int capture_sample_rate = 16000) : capture_sample_rate_(capture_sample_rate) {}
+
+    /* Downlink, called by the output task */
+    // `samples` voice samples at `sample_rate`, starting at server time `server_ms`, play from `start_us` on
+    void OnPlayout(uint32_t server_ms, int64_t start_us, uint32_t samples, int sample_rate);
+    // The downlink was flushed, forget what was played
+    void ResetPlayout();
+
+    /* Uplink */
+    // The input task read `samples` samples, the last one captured at `end_us`
+    void OnCapture(uint32_t samples, int64_t end_us);
+    // Capture time of the first sample of the next processed frame of `samples` samples, 0 if unknown
+    int64_t OnCaptureOutput(uint32_t samples);
+    // The processor dropped its buffered input, must not race with the two calls above
+    void ResetCapture();
+
+    // Server timestamp of a frame captured from `start_us` for `duration_us`, 0 if no voice played then
+    uint32_t ServerTimeAt(int64_t start_us, int64_t duration_us);
+
+    PlaybackClockStats GetStats();
+
+private:
+    struct Segment {
+        uint32_t server_ms;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    std::mutex mutex_;
+    PlaybackClockStats stats_;
+
+    Segment segments_[PLAYBACK_CLOCK_SEGMENTS];
+    size_t segment_head_ = 0;   // Next slot to write
+    size_t segment_count_ = 0;
+
+    // The run of contiguous server time the slip and drift are measured over
+    bool in_run_ = false;
+    int64_t run_server_us_ = 0;
+    int64_t run_start_us_ = 0;
+    int64_t last_slip_us_ = 0;
+    // Server time right after the last segment, in microseconds so that fractional frame lengths add up
+    int64_t next_server_us_ = 0;
+
+    int capture_sample_rate_;
+    uint32_t captured_samples_ = 0;     // Position of the sample after the last one read
+    int64_t captured_end_us_ = 0;
+    bool has_capture_ = false;
+    uint32_t output_samples_ = 0;       // Position of the first sample of the next processed frame
+};
+
+#endif // PLAYBACK_CLOCK_H
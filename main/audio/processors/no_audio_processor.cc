@@ -1,28 +1,30 @@
 #include "no_audio_processor.h"
 #include <esp_log.h>
 
+#include "dsp_kernels.h"
+
 #define TAG "NoAudioProcessor"
 
 void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
+    output_assembler_.Configure(frame_samples_);
 }
 
-void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
+void NoAudioProcessor::Feed(const int16_t* data, size_t samples) {
     if (!is_running_ || !output_callback_) {
         return;
     }
 
     if (codec_->input_channels() == 2) {
         // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
-        }
-        output_callback_(std::move(mono_data));
-    } else {
-        output_callback_(std::move(data));
+        mono_buffer_.resize(samples);
+        DspExtractChannel(data, mono_buffer_.data(), samples, 2, 0);
+        data = mono_buffer_.data();
     }
+    output_assembler_.Append(data, samples, [this](std::vector<int16_t>& frame) {
+        output_callback_(std::move(frame));
+    });
 }
 
 void NoAudioProcessor::Start() {
@@ -31,6 +33,7 @@ void NoAudioProcessor::Start() {
 
 void NoAudioProcessor::Stop() {
     is_running_ = false;
+    output_assembler_.Reset();
 }
 
 bool NoAudioProcessor::IsRunning() {
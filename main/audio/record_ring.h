@@ -0,0 +1,142 @@
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Describes one block of PCM in a RecordRing
+struct RecordHeader {
+    uint32_t sample_rate = 0;
+    uint32_t samples = 0;
+    int64_t time_us = 0;        // Capture time of the first sample
+};
+
+/*
+ * Single-producer / single-consumer ring of variable-length PCM records on caller-owned memory
+ * (a slice of a PSRAM buffer), so a tap copies a frame without allocating.
+ *
+ * Push() copies one channel out of interleaved PCM and fails when the record does not fit, which
+ * the ring counts as a drop; the producer never waits for the consumer. Records wrap around the
+ * end of the buffer. Only the consumer frees records, by Pop() or Drop().
+ */
+class RecordRing {
+public:
+    RecordRing() = default;
+    RecordRing(const RecordRing&) = delete;
+    RecordRing& operator=(const RecordRing&) = delete;
+
+    // Call before the producer and consumer start. Uses the largest power of two that fits, so
+    // that the running positions stay consistent when they wrap around
+    void Attach(uint8_t* buffer, size_t capacity) {
+        buffer_ = buffer;
+        capacity_ = 0;
+        if (capacity > 0) {
+            capacity_ = 1;
+            while (capacity_ <= capacity / 2) {
+                capacity_ *= 2;
+            }
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Producer side: samples `header.samples` frames of `channels` interleaved channels, keeps `channel`
+    bool Push(const RecordHeader& header, const int16_t* pcm, size_t channels = 1, size_t channel = 0) {
+        size_t bytes = sizeof(RecordHeader) + header.samples * sizeof(int16_t);
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (buffer_ == nullptr || capacity_ - (head - tail_.load(std::memory_order_acquire)) < bytes) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        CopyIn(head, &header, sizeof(header));
+        size_t offset = head + sizeof(header);
+        if (channels == 1) {
+            CopyIn(offset, pcm, header.samples * sizeof(int16_t));
+        } else {
+            // Gathered through a small stack block, so the copy into the ring stays a memcpy
+            int16_t block[64];
+            for (size_t i = 0; i < header.samples;) {
+                size_t count = header.samples - i < 64 ? header.samples - i : 64;
+                for (size_t j = 0; j < count; j++) {
+                    block[j] = pcm[(i + j) * channels + channel];
+                }
+                CopyIn(offset, block, count * sizeof(int16_t));
+                offset += count * sizeof(int16_t);
+                i += count;
+            }
+        }
+        head_.store(head + bytes, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: the header of the oldest record
+    bool Peek(RecordHeader& header) const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        CopyOut(tail, &header, sizeof(header));
+        return true;
+    }
+
+    // Consumer side: moves the oldest record out, `pcm` keeps its capacity
+    bool Pop(RecordHeader& header, std::vector<int16_t>& pcm) {
+        if (!Peek(header)) {
+            return false;
+        }
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        pcm.resize(header.samples);
+        CopyOut(tail + sizeof(header), pcm.data(), header.samples * sizeof(int16_t));
+        tail_.store(tail + sizeof(header) + header.samples * sizeof(int16_t), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: frees the oldest record unread
+    bool Drop() {
+        RecordHeader header;
+        if (!Peek(header)) {
+            return false;
+        }
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(tail + sizeof(header) + header.samples * sizeof(int16_t), std::memory_order_release);
+        return true;
+    }
+
+    // Bytes in use, any side
+    size_t Used() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Records that did not fit
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    uint8_t* buffer_ = nullptr;
+    size_t capacity_ = 0;
+    // Running byte positions, masked by the capacity when the buffer is accessed
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<uint32_t> dropped_{0};
+
+    void CopyIn(size_t position, const void* data, size_t bytes) {
+        size_t offset = position & (capacity_ - 1);
+        size_t first = bytes < capacity_ - offset ? bytes : capacity_ - offset;
+        memcpy(buffer_ + offset, data, first);
+        memcpy(buffer_, static_cast<const uint8_t*>(data) + first, bytes - first);
+    }
+
+    void CopyOut(size_t position, void* data, size_t bytes) const {
+        size_t offset = position & (capacity_ - 1);
+        size_t first = bytes < capacity_ - offset ? bytes : capacity_ - offset;
+        memcpy(data, buffer_ + offset, first);
+        memcpy(static_cast<uint8_t*>(data) + first, buffer_, bytes - first);
+    }
+};
+
+#endif // RECORD_RING_H
@@ -0,0 +1,145 @@
+#ifndef SILENCE_GATE_H
+#define SILENCE_GATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Frames held back while silent, sent ahead of the speech that follows so that its onset is not clipped
+#define SILENCE_GATE_PREROLL_FRAMES 5
+// Frames still sent as speech after the VAD reports silence
+#define SILENCE_GATE_HANGOVER_FRAMES 10
+
+enum SilenceGateMode {
+    kSilenceGateOff,    // Every frame is speech
+    kSilenceGateDtx,    // Silent frames are passed on marked as silent, to be sent as DTX frames
+    kSilenceGateDrop,   // Silent frames are dropped
+};
+
+struct SilenceGateStats {
+    uint32_t passed = 0;    // Sent as speech
+    uint32_t silent = 0;    // Passed on marked as silent
+    uint32_t dropped = 0;
+};
+
+/*
+ * Suppresses the uplink frames between utterances, following the VAD.
+ *
+ * While the gate is closed, the last SILENCE_GATE_PREROLL_FRAMES frames are kept in a ring of
+ * preallocated frames; the oldest one leaves as silence when a new one comes in, and the whole
+ * ring is flushed as speech when the VAD reports speech. After speech ends, the gate stays
+ * open for SILENCE_GATE_HANGOVER_FRAMES frames. In DTX mode every frame comes out exactly
+ * once and in order, only delayed by the pre-roll while the gate is closed.
+ *
+ * Every frame carries a Tag (e.g. its trace and capture times) that comes out with it.
+ *
+ * Process() must only be called by one task. SetMode() and Reset() may be called from any
+ * task and take effect on the next Process(). A reset gate is open.
+ */
+template <typename Tag = int64_t>
+class SilenceGate {
+public:
+    void Configure(size_t frame_samples, size_t preroll_frames = SILENCE_GATE_PREROLL_FRAMES,
+        size_t hangover_frames = SILENCE_GATE_HANGOVER_FRAMES) {
+        ring_.resize(preroll_frames);
+        for (auto& slot : ring_) {
+            slot.pcm.reserve(frame_samples);
+        }
+        head_ = 0;
+        count_ = 0;
+        hangover_frames_ = hangover_frames;
+        hangover_left_ = hangover_frames;
+        open_ = true;
+        reset_pending_ = false;
+    }
+    void SetMode(SilenceGateMode mode) { mode_.store(mode, std::memory_order_relaxed); }
+    SilenceGateMode mode() const { return mode_.load(std::memory_order_relaxed); }
+    void Reset() { reset_pending_.store(true, std::memory_order_release); }
+
+    // Calls emit(const std::vector<int16_t>& pcm, const Tag& tag, bool silent) for every frame to pass on
+    template <typename Emit>
+    void Process(const std::vector<int16_t>& pcm, const Tag& tag, bool speaking, Emit&& emit) {
+        if (reset_pending_.exchange(false, std::memory_order_acquire)) {
+            // Held frames belong to the previous session
+            count_ = 0;
+            open_ = true;
+            hangover_left_ = hangover_frames_;
+        }
+
+        SilenceGateMode mode = this->mode();
+        if (mode == kSilenceGateOff || speaking) {
+            FlushPreroll(emit);
+            open_ = true;
+            hangover_left_ = hangover_frames_;
+            stats_.passed++;
+            emit(pcm, tag, false);
+            return;
+        }
+        if (open_ && hangover_left_ > 0) {
+            hangover_left_--;
+            stats_.passed++;
+            emit(pcm, tag, false);
+            return;
+        }
+        open_ = false;
+
+        if (ring_.empty()) {
+            PassSilence(mode, pcm, tag, emit);
+            return;
+        }
+        if (count_ == ring_.size()) {
+            auto& oldest = ring_[head_];
+            PassSilence(mode, oldest.pcm, oldest.tag, emit);
+            head_ = (head_ + 1) % ring_.size();
+            count_--;
+        }
+        auto& slot = ring_[(head_ + count_) % ring_.size()];
+        slot.pcm.assign(pcm.begin(), pcm.end());
+        slot.tag = tag;
+        count_++;
+    }
+
+    const SilenceGateStats& stats() const { return stats_; }
+    // Frames currently held back, only meaningful on the processing task
+    size_t held_frames() const { return count_; }
+
+private:
+    struct Slot {
+        std::vector<int16_t> pcm;
+        Tag tag{};
+    };
+
+    std::vector<Slot> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t hangover_frames_ = SILENCE_GATE_HANGOVER_FRAMES;
+    size_t hangover_left_ = SILENCE_GATE_HANGOVER_FRAMES;
+    bool open_ = true;
+    std::atomic<SilenceGateMode> mode_{kSilenceGateOff};
+    std::atomic<bool> reset_pending_{false};
+    SilenceGateStats stats_;
+
+    template <typename Emit>
+    void FlushPreroll(Emit& emit) {
+        while (count_ > 0) {
+            auto& slot = ring_[head_];
+            stats_.passed++;
+            emit(slot.pcm, slot.tag, false);
+            head_ = (head_ + 1) % ring_.size();
+            count_--;
+        }
+    }
+
+    template <typename Emit>
+    void PassSilence(SilenceGateMode mode, const std::vector<int16_t>& pcm, const Tag& tag, Emit& emit) {
+        if (mode == kSilenceGateDtx) {
+            stats_.silent++;
+            emit(pcm, tag, true);
+        } else {
+            stats_.dropped++;
+        }
+    }
+};
+
+#endif // SILENCE_GATE_H
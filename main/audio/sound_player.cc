@@ -0,0 +1,261 @@
+#include "sound_player.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "SoundPlayer"
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_HEADER_TYPE_CONTINUED 0x01
+
+bool SoundIndex::Build(std::string_view ogg, SoundIndex& index) {
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
+    size_t size = ogg.size();
+    index.data = buf;
+    index.size = size;
+    index.sample_rate = 16000;
+    index.packets.clear();
+
+    bool seen_head = false;
+    bool seen_tags = false;
+    bool skip_continued = false;
+    size_t split_packets = 0;
+    size_t offset = 0;
+
+    while (offset + OGG_PAGE_HEADER_SIZE <= size) {
+        // Pages normally follow each other, only search for the capture pattern after garbage
+        if (std::memcmp(buf + offset, "OggS", 4) != 0) {
+            size_t pos = ogg.find("OggS", offset + 1);
+            if (pos == std::string_view::npos) {
+                break;
+            }
+            offset = pos;
+            continue;
+        }
+
+        const uint8_t* page = buf + offset;
+        uint8_t page_segments = page[26];
+        size_t body_off = offset + OGG_PAGE_HEADER_SIZE + page_segments;
+        if (body_off > size) {
+            break;
+        }
+        size_t body_size = 0;
+        for (size_t i = 0; i < page_segments; ++i) {
+            body_size += page[OGG_PAGE_HEADER_SIZE + i];
+        }
+        if (body_off + body_size > size) {
+            break;
+        }
+
+        // A packet continued from the previous page is not contiguous in flash, it is skipped
+        bool continued = skip_continued && (page[5] & OGG_HEADER_TYPE_CONTINUED);
+        skip_continued = false;
+
+        size_t cur = body_off;
+        size_t seg_idx = 0;
+        while (seg_idx < page_segments) {
+            size_t pkt_start = cur;
+            size_t pkt_len = 0;
+            uint8_t lacing = 0;
+            do {
+                lacing = page[OGG_PAGE_HEADER_SIZE + seg_idx++];
+                pkt_len += lacing;
+            } while (lacing == 255 && seg_idx < page_segments);
+            cur += pkt_len;
+
+            if (continued) {
+                continued = false;
+                continue;
+            }
+            if (lacing == 255) {
+                // The packet goes on in the next page
+                skip_continued = true;
+            }
+            if (pkt_len == 0) {
+                continue;
+            }
+
+            const uint8_t* pkt_ptr = buf + pkt_start;
+            if (!seen_head) {
+                // OpusHead: [0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip,
+                // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
+                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
+                    seen_head = true;
+                    index.sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
+                }
+                continue;
+            }
+            if (!seen_tags) {
+                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
+                    seen_tags = true;
+                }
+                continue;
+            }
+            if (skip_continued) {
+                split_packets++;
+                continue;
+            }
+            index.packets.push_back({static_cast<uint32_t>(pkt_start), static_cast<uint32_t>(pkt_len)});
+        }
+
+        offset = body_off + body_size;
+    }
+
+    if (split_packets > 0) {
+        ESP_LOGW(TAG, "Skipped %u packets split across Ogg pages", split_packets);
+    }
+    index.packets.shrink_to_fit();
+    return !index.packets.empty();
+}
+
+std::shared_ptr<const SoundIndex> SoundPlayer::GetIndex(std::string_view ogg) {
+    auto data = reinterpret_cast<const uint8_t*>(ogg.data());
+    for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+        if ((*it)->data == data && (*it)->size == ogg.size()) {
+            cache_.splice(cache_.begin(), cache_, it);
+            return cache_.front();
+        }
+    }
+
+    auto index = std::make_shared<SoundIndex>();
+    if (!SoundIndex::Build(ogg, *index)) {
+        return nullptr;
+    }
+    ESP_LOGD(TAG, "Indexed sound: %u bytes, %u packets, %d Hz", ogg.size(), index->packets.size(), index->sample_rate);
+
+    cache_.push_front(index);
+    if (cache_.size() > SOUND_INDEX_CACHE_SIZE) {
+        // A request that is still queued keeps its own reference
+        cache_.pop_back();
+    }
+    return index;
+}
+
+uint32_t SoundPlayer::Play(std::string_view ogg, SoundPriority priority, SoundCallback callback) {
+    SoundCallback cancelled;
+    uint32_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto index = GetIndex(ogg);
+        if (index) {
+            id = next_id_++;
+            if (next_id_ == 0) {
+                next_id_ = 1;
+            }
+            Request request{id, priority, std::move(index), std::move(callback)};
+
+            if (playing_ && priority > current_.priority) {
+                // Interrupt the current sound, the new one starts with the next frame
+                ESP_LOGI(TAG, "Sound %lu interrupts sound %lu", id, current_.id);
+                cancelled = std::move(current_.callback);
+                current_ = std::move(request);
+                cursor_ = 0;
+                first_frame_ = true;
+            } else {
+                auto it = std::find_if(queue_.begin(), queue_.end(), [priority](const Request& r) {
+                    return r.priority < priority;
+                });
+                queue_.insert(it, std::move(request));
+            }
+        }
+    }
+
+    if (id == 0) {
+        ESP_LOGW(TAG, "No audio in sound (%u bytes)", ogg.size());
+        if (callback) {
+            callback(false);
+        }
+    }
+    if (cancelled) {
+        cancelled(false);
+    }
+    return id;
+}
+
+void SoundPlayer::Cancel(uint32_t id) {
+    SoundCallback cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (playing_ && current_.id == id) {
+            cancelled = std::move(current_.callback);
+            current_ = Request();
+            playing_ = false;
+        } else {
+            auto it = std::find_if(queue_.begin(), queue_.end(), [id](const Request& r) {
+                return r.id == id;
+            });
+            if (it != queue_.end()) {
+                cancelled = std::move(it->callback);
+                queue_.erase(it);
+            }
+        }
+    }
+    if (cancelled) {
+        cancelled(false);
+    }
+}
+
+void SoundPlayer::CancelAll() {
+    std::vector<SoundCallback> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (playing_ && current_.callback) {
+            cancelled.push_back(std::move(current_.callback));
+        }
+        current_ = Request();
+        playing_ = false;
+        for (auto& request : queue_) {
+            if (request.callback) {
+                cancelled.push_back(std::move(request.callback));
+            }
+        }
+        queue_.clear();
+    }
+    for (auto& callback : cancelled) {
+        callback(false);
+    }
+}
+
+bool SoundPlayer::Empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !playing_ && queue_.empty();
+}
+
+bool SoundPlayer::Next(AudioStreamPacket& packet, bool& first) {
+    SoundCallback completed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!playing_) {
+            if (queue_.empty()) {
+                return false;
+            }
+            current_ = std::move(queue_.front());
+            queue_.pop_front();
+            cursor_ = 0;
+            playing_ = true;
+            first_frame_ = true;
+        }
+
+        const auto& index = *current_.index;
+        const auto& ref = index.packets[cursor_++];
+        packet.sample_rate = index.sample_rate;
+        packet.frame_duration = SOUND_FRAME_DURATION_MS;
+        packet.timestamp = 0;
+        packet.sequence = 0;
+        packet.payload.assign(index.data + ref.offset, index.data + ref.offset + ref.size);
+        first = first_frame_;
+        first_frame_ = false;
+
+        if (cursor_ == index.packets.size()) {
+            completed = std::move(current_.callback);
+            current_ = Request();
+            playing_ = false;
+        }
+    }
+    // The last frame has been handed to the decoder
+    if (completed) {
+        completed(true);
+    }
+    return true;
+}
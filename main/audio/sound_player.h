@@ -0,0 +1,89 @@
+#ifndef SOUND_PLAYER_H
+#define SOUND_PLAYER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "audio_stream_packet.h"
+
+#define SOUND_INDEX_CACHE_SIZE 16
+#define SOUND_FRAME_DURATION_MS 60
+
+enum SoundPriority {
+    kSoundPriorityNormal = 0,   // Prompts and digit readouts, played in order
+    kSoundPriorityAlert = 1,    // Interrupts a normal sound that is playing
+};
+
+// Called once per sound: true if it played to the end, false if it was cancelled or invalid
+using SoundCallback = std::function<void(bool completed)>;
+
+struct SoundPacketRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+/*
+ * Position of every Opus packet in an Ogg/Opus asset. The asset itself stays where it is
+ * (embedded in the app image or mmapped from the assets partition) and must outlive the index.
+ */
+struct SoundIndex {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    int sample_rate = 16000;
+    std::vector<SoundPacketRef> packets;
+
+    // Walks the Ogg pages once, returns false if no audio packet was found
+    static bool Build(std::string_view ogg, SoundIndex& index);
+};
+
+/*
+ * Non-blocking queue of Ogg/Opus sounds.
+ *
+ * Play() indexes the asset (once, the index is cached) and returns right away. The Opus decode task
+ * pulls one frame at a time with Next() whenever the playback queue has room, so a sound never
+ * holds more than a frame of RAM and never blocks the caller.
+ *
+ * Sounds play in priority order, FIFO within a priority. A sound with a higher priority than the
+ * one playing cancels it. Callbacks run without the lock held, on the task that completed or
+ * cancelled the sound, so they should be short (e.g. Application::Schedule()).
+ */
+class SoundPlayer {
+public:
+    // Returns the sound id, or 0 if the asset has no audio
+    uint32_t Play(std::string_view ogg, SoundPriority priority = kSoundPriorityNormal, SoundCallback callback = nullptr);
+    void Cancel(uint32_t id);
+    void CancelAll();
+    bool Empty() const;
+
+    // Copies the next frame into `packet`, returns false if no sound is pending.
+    // `first` is set on the first frame of a sound, the decoder state should be reset before it.
+    bool Next(AudioStreamPacket& packet, bool& first);
+
+private:
+    struct Request {
+        uint32_t id = 0;
+        SoundPriority priority = kSoundPriorityNormal;
+        std::shared_ptr<const SoundIndex> index;
+        SoundCallback callback;
+    };
+
+    mutable std::mutex mutex_;
+    std::deque<Request> queue_;
+    Request current_;
+    size_t cursor_ = 0;
+    bool playing_ = false;
+    bool first_frame_ = false;
+    uint32_t next_id_ = 1;
+    // Most recently used first
+    std::list<std::shared_ptr<const SoundIndex>> cache_;
+
+    std::shared_ptr<const SoundIndex> GetIndex(std::string_view ogg);
+};
+
+#endif // SOUND_PLAYER_H
@@ -0,0 +1,129 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/*
+ * Fixed-capacity, preallocated single-producer / single-consumer ring.
+ *
+ * Push() must only be called by one producer task and Pop() / Front() by one
+ * consumer task. Neither side takes a lock. Clear() may be called from any task:
+ * it records the producer position and the consumer discards everything up to
+ * that position on its next access, so items pushed after Clear() survive.
+ *
+ * The ring does not block. Callers pair it with their own wakeup (an event group
+ * bit per queue in AudioService) so that only the task waiting on a given queue
+ * is woken when it changes.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0, "Capacity must be greater than zero");
+
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side
+    bool Push(T&& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        // Slots awaiting a pending Clear() are still owned by the consumer
+        if (head - tail_.load(std::memory_order_acquire) >= kSlots || Used(head) >= Capacity) {
+            return false;
+        }
+        slots_[head & kMask] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T& item) {
+        uint32_t tail = ApplyClear();
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        item = std::move(slots_[tail & kMask]);
+        slots_[tail & kMask] = T();
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, the returned pointer is valid until the next Pop()
+    T* Front() {
+        uint32_t tail = ApplyClear();
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return nullptr;
+        }
+        return &slots_[tail & kMask];
+    }
+
+    // Any side
+    void Clear() {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t until = clear_until_.load(std::memory_order_relaxed);
+        while (static_cast<int32_t>(head - until) > 0 &&
+            !clear_until_.compare_exchange_weak(until, head, std::memory_order_relaxed)) {
+        }
+        clear_pending_.store(true, std::memory_order_release);
+    }
+
+    size_t Size() const {
+        return Used(head_.load(std::memory_order_acquire));
+    }
+
+    bool Empty() const { return Size() == 0; }
+    bool Full() const { return Size() >= Capacity; }
+
+private:
+    static constexpr size_t RoundUpPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static constexpr size_t kSlots = RoundUpPowerOfTwo(Capacity);
+    static constexpr uint32_t kMask = kSlots - 1;
+
+    // Items a pending Clear() will discard are not counted
+    size_t Used(uint32_t head) const {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (clear_pending_.load(std::memory_order_acquire)) {
+            uint32_t until = clear_until_.load(std::memory_order_relaxed);
+            if (static_cast<int32_t>(until - tail) > 0) {
+                tail = until;
+            }
+        }
+        return head - tail;
+    }
+
+    uint32_t ApplyClear() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (clear_pending_.exchange(false, std::memory_order_acquire)) {
+            uint32_t until = clear_until_.load(std::memory_order_relaxed);
+            while (static_cast<int32_t>(until - tail) > 0) {
+                slots_[tail & kMask] = T();
+                tail++;
+            }
+            tail_.store(tail, std::memory_order_release);
+        }
+        return tail;
+    }
+
+    std::array<T, kSlots> slots_{};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> clear_until_{0};
+    std::atomic<bool> clear_pending_{false};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,117 @@
+#ifndef UPLINK_STAGE_H
+#define UPLINK_STAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio_stream_packet.h"
+
+struct UplinkStageStats {
+    uint32_t sessions = 0;      // Interactions that started before the channel was open
+    uint32_t staged = 0;        // Packets that waited for the channel
+    uint32_t dropped = 0;       // Oldest packets dropped over the limit
+    uint32_t discarded = 0;     // Staged packets thrown away, the channel did not open
+    uint32_t flushed = 0;       // Staged packets handed to the transport
+    uint32_t peak_ms = 0;       // Most audio staged at once
+    uint32_t last_wait_ms = 0;  // How long the oldest packet had waited when the channel opened
+    uint32_t max_wait_ms = 0;
+};
+
+/*
+ * Holds the uplink packets encoded while the audio channel opens.
+ *
+ * Between Start() and Release() every packet pushed is kept, with the time it was staged, instead
+ * of going to the send queue; the packets keep their capture time and server timestamp. Past
+ * `max_ms` of audio (or `capacity` packets) the oldest packet is dropped, so the backlog, and the
+ * delay it adds to the reply, stays bounded while the encoder never waits. After Release() the
+ * backlog is popped ahead of the send queue, as fast as the transport takes it.
+ *
+ * Not thread-safe, the owner locks.
+ */
+class UplinkStage {
+public:
+    UplinkStage(uint32_t max_ms, size_t capacity) : max_ms_(max_ms), slots_(capacity), staged_us_(capacity) {}
+
+    void Start(int64_t now_us) {
+        Discard();
+        active_ = true;
+        start_us_ = now_us;
+        stats_.sessions++;
+    }
+
+    // Takes the packet if staging, otherwise leaves it to the caller
+    bool Push(AudioStreamPacketPtr& packet, int64_t now_us) {
+        if (!active_ || slots_.empty()) {
+            return false;
+        }
+        while (count_ > 0 && (count_ == slots_.size() || duration_ms_ + packet->frame_duration > max_ms_)) {
+            PopOldest();
+            stats_.dropped++;
+        }
+        size_t tail = (head_ + count_) % slots_.size();
+        duration_ms_ += packet->frame_duration;
+        slots_[tail] = std::move(packet);
+        staged_us_[tail] = now_us;
+        count_++;
+        stats_.staged++;
+        stats_.peak_ms = std::max(stats_.peak_ms, duration_ms_);
+        return true;
+    }
+
+    // The channel is open, the backlog may be popped
+    void Release(int64_t now_us) {
+        if (!active_) {
+            return;
+        }
+        active_ = false;
+        int64_t since_us = count_ > 0 ? staged_us_[head_] : start_us_;
+        stats_.last_wait_ms = uint32_t(std::max<int64_t>(now_us - since_us, 0) / 1000);
+        stats_.max_wait_ms = std::max(stats_.max_wait_ms, stats_.last_wait_ms);
+    }
+
+    AudioStreamPacketPtr Pop() {
+        if (active_ || count_ == 0) {
+            return nullptr;
+        }
+        stats_.flushed++;
+        return PopOldest();
+    }
+
+    // The channel did not open, or closed before the backlog was sent
+    void Discard() {
+        active_ = false;
+        while (count_ > 0) {
+            PopOldest();
+            stats_.discarded++;
+        }
+    }
+
+    bool active() const { return active_; }
+    size_t Size() const { return count_; }
+    bool Empty() const { return count_ == 0; }
+    uint32_t duration_ms() const { return duration_ms_; }
+    const UplinkStageStats& stats() const { return stats_; }
+
+private:
+    uint32_t max_ms_;
+    std::vector<AudioStreamPacketPtr> slots_;
+    std::vector<int64_t> staged_us_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint32_t duration_ms_ = 0;
+    bool active_ = false;
+    int64_t start_us_ = 0;
+    UplinkStageStats stats_;
+
+    AudioStreamPacketPtr PopOldest() {
+        auto packet = std::move(slots_[head_]);
+        duration_ms_ -= packet->frame_duration;
+        head_ = (head_ + 1) % slots_.size();
+        count_--;
+        return packet;
+    }
+};
+
+#endif // UPLINK_STAGE_H
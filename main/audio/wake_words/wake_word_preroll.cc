@@ -0,0 +1,150 @@
+#include "wake_word_preroll.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+#include <cassert>
+#include <chrono>
+
+#define TAG "WakeWordPreroll"
+
+#define PREROLL_EVENT_WORK 1
+#define PREROLL_SAMPLE_RATE 16000
+#define PREROLL_POP_TIMEOUT_MS 1000
+
+WakeWordPreroll::WakeWordPreroll() {
+    event_group_ = xEventGroupCreate();
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+    vEventGroupDelete(event_group_);
+}
+
+void WakeWordPreroll::Initialize(int frame_duration_ms) {
+    if (encode_task_ != nullptr) {
+        return;
+    }
+
+    LinkAudioProfile profile = LinkRateController::ProfileOf(kLinkQualityNormal);
+    profile.frame_duration_ms = frame_duration_ms;
+    encoder_ = std::make_unique<OpusUplinkEncoder>(PREROLL_SAMPLE_RATE, 0, profile); // 0 is the fastest
+    opus_buffer_.reserve(OPUS_UPLINK_MAX_PACKET_BYTES);
+
+    // The frame handed to the encoder stays untouched until the assembler comes back to it, and a
+    // dropped frame does not move the ring on, so it has a frame for each queue slot, one being
+    // encoded and one being filled
+    assembler_.Configure(encoder_->frame_samples(), WAKE_WORD_PREROLL_QUEUE_FRAMES + 2);
+    size_t packet_bytes = LinkAudioBitrate(profile) / 8 * frame_duration_ms / 1000;
+    packets_.Configure(WAKE_WORD_PREROLL_MS / frame_duration_ms, packet_bytes);
+
+    encode_task_stack_ = (StackType_t*)heap_caps_malloc(WAKE_WORD_PREROLL_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    assert(encode_task_stack_ != nullptr);
+    encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    assert(encode_task_buffer_ != nullptr);
+
+    encode_task_ = xTaskCreateStatic([](void* arg) {
+        auto this_ = (WakeWordPreroll*)arg;
+        this_->EncodeTask();
+        vTaskDelete(NULL);
+    }, "wake_word_preroll", WAKE_WORD_PREROLL_TASK_STACK_SIZE, this, 2, encode_task_stack_, encode_task_buffer_);
+}
+
+void WakeWordPreroll::Feed(const int16_t* samples, size_t count) {
+    if (encode_task_ == nullptr || !feeding_.load(std::memory_order_acquire)) {
+        return;
+    }
+    assembler_.Append(samples, count, [this](std::vector<int16_t>& frame) {
+        if (!frame_queue_.Push(&frame)) {
+            // The encoder is behind, the slot is refilled with the next frame
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        xEventGroupSetBits(event_group_, PREROLL_EVENT_WORK);
+        return true;
+    });
+}
+
+void WakeWordPreroll::Reset() {
+    feeding_.store(false, std::memory_order_release);
+    assembler_.Reset();
+    // Only the frames queued so far are discarded, the ones fed from now on belong to the new pre-roll
+    frame_queue_.Clear();
+    finish_pending_.store(false, std::memory_order_relaxed);
+    reset_pending_.store(true, std::memory_order_release);
+    {
+        // Nothing from the previous pre-roll is handed out after this
+        std::lock_guard<std::mutex> lock(mutex_);
+        packets_.Clear();
+        finished_ = false;
+    }
+    feeding_.store(true, std::memory_order_release);
+    xEventGroupSetBits(event_group_, PREROLL_EVENT_WORK);
+}
+
+void WakeWordPreroll::Finish() {
+    feeding_.store(false, std::memory_order_release);
+    finish_pending_.store(true, std::memory_order_release);
+    xEventGroupSetBits(event_group_, PREROLL_EVENT_WORK);
+}
+
+bool WakeWordPreroll::Pop(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool ready = cv_.wait_for(lock, std::chrono::milliseconds(PREROLL_POP_TIMEOUT_MS), [this]() {
+        return !packets_.Empty() || finished_;
+    });
+    if (!ready) {
+        ESP_LOGW(TAG, "Timed out waiting for the pre-roll");
+        opus.clear();
+        return false;
+    }
+    if (!packets_.Pop(opus)) {
+        opus.clear();
+        return false;
+    }
+    return true;
+}
+
+void WakeWordPreroll::EncodeTask() {
+    while (true) {
+        xEventGroupWaitBits(event_group_, PREROLL_EVENT_WORK, pdTRUE, pdFALSE, portMAX_DELAY);
+
+        if (reset_pending_.exchange(false, std::memory_order_acquire)) {
+            encoder_->ResetState();
+        }
+        // Taken before the queue is drained, so that every frame fed before Finish() is encoded
+        bool finishing = finish_pending_.exchange(false, std::memory_order_acquire);
+
+        std::vector<int16_t>* frame = nullptr;
+        while (frame_queue_.Pop(frame)) {
+            if (!encoder_->Encode(frame->data(), opus_buffer_)) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_) {
+                continue;
+            }
+            packets_.Push(opus_buffer_);
+            cv_.notify_all();
+        }
+
+        if (finishing) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // A Reset() since then has started a new pre-roll
+            if (!finished_ && !reset_pending_.load(std::memory_order_acquire)) {
+                finished_ = true;
+                ESP_LOGI(TAG, "Pre-roll ready: %u packets, %lu overwritten, %lu frames dropped",
+                    (unsigned)packets_.Size(), packets_.overwritten(), dropped_frames_.exchange(0));
+            }
+            cv_.notify_all();
+        }
+    }
+}
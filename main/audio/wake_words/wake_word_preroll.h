@@ -0,0 +1,73 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "frame_assembler.h"
+#include "opus_packet_ring.h"
+#include "opus_uplink_encoder.h"
+#include "spsc_queue.h"
+
+// Audio kept ahead of the detection, sent to the server for speaker recognition
+#define WAKE_WORD_PREROLL_MS 2000
+// Frames waiting for the encoder, more are dropped while it lags behind
+#define WAKE_WORD_PREROLL_QUEUE_FRAMES 2
+#define WAKE_WORD_PREROLL_TASK_STACK_SIZE (4096 * 7)
+
+/*
+ * Encodes the wake word engine's input into a bounded ring of Opus packets while detection
+ * runs, so the last WAKE_WORD_PREROLL_MS of audio is ready as soon as a wake word is detected.
+ *
+ * Feed() is called by the engine's feeding task and only copies the samples into preallocated
+ * frames. A low priority task encodes the frames and overwrites the oldest packets. Finish()
+ * marks the end of the pre-roll at detection, Pop() then returns the packets until the ring
+ * is empty. Reset() starts a new pre-roll, call it when detection starts again.
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll();
+    ~WakeWordPreroll();
+
+    void Initialize(int frame_duration_ms);
+    void Feed(const int16_t* samples, size_t count);
+    void Reset();
+    void Finish();
+    // Blocks until a packet is encoded, returns false once the finished pre-roll is drained
+    bool Pop(std::vector<uint8_t>& opus);
+
+private:
+    EventGroupHandle_t event_group_ = nullptr;
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+    std::unique_ptr<OpusUplinkEncoder> encoder_;
+
+    // Feeding task side
+    FrameAssembler assembler_;
+    std::atomic<bool> feeding_{false};
+    SpscQueue<std::vector<int16_t>*, WAKE_WORD_PREROLL_QUEUE_FRAMES> frame_queue_;
+    std::atomic<uint32_t> dropped_frames_{0};
+
+    // Encode task side
+    std::atomic<bool> reset_pending_{false};
+    std::atomic<bool> finish_pending_{false};
+    std::vector<uint8_t> opus_buffer_;
+
+    // Shared with the consumer, guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    OpusPacketRing packets_;
+    bool finished_ = false;
+
+    void EncodeTask();
+};
+
+#endif // WAKE_WORD_PREROLL_H
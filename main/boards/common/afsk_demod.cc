@@ -1,8 +1,9 @@
 #include "afsk_demod.h"
-#include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include "esp_log.h"
-#include "display.h"
+#include "dsp_kernels.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -12,360 +13,467 @@ namespace audio_wifi_config
 {
     static const char *kLogTag = "AUDIO_WIFI_CONFIG";
 
-    void ReceiveWifiCredentialsFromAudio(Application *app,
-                                        WifiConfigurationAp *wifi_ap,
-                                        Display *display,
-                                        size_t input_channels
-                                    )
-    {
-        const int kInputSampleRate = 16000;                                    // Input sampling rate
-        const float kDownsampleStep = static_cast<float>(kInputSampleRate) / static_cast<float>(kAudioSampleRate); // Downsampling step
-        std::vector<int16_t> audio_data;
-        AudioSignalProcessor signal_processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
-        AudioDataBuffer data_buffer;
-
-        while (true)
-        {
-            // 检查Application状态，只有在WiFi配置模式下才处理音频
-            if (app->GetDeviceState() != kDeviceStateWifiConfiguring) {
-                // 不在WiFi配置状态，休眠100ms后再检查
-                vTaskDelay(pdMS_TO_TICKS(100));
-                continue;
-            }
-            
-            if (!app->GetAudioService().ReadAudioData(audio_data, 16000, 480)) { // 16kHz, 480 samples corresponds to 30ms data
-                // 读取音频失败，短暂延迟后重试
-                ESP_LOGI(kLogTag, "Failed to read audio data, retrying.");
-                vTaskDelay(pdMS_TO_TICKS(10));
-                continue;
+    // Pole radius of the sliding Goertzel resonators, r^N stays above 0.96 for the longest window
+    static const float kGoertzelDamping = 0.9999f;
+    // Weight of the newest reading in the clarity average of a timing phase
+    static const float kClarityWeight = 0.25f;
+    // A timing phase must be this much clearer than the current one to take over
+    static const float kClarityHysteresis = 0.02f;
+
+    static const SonicModeConfig kSonicModes[] = {
+        {"AFSK 100", kAudioSampleRate / kBitRate, kSpaceFrequency * (kAudioSampleRate / kBitRate) / kAudioSampleRate,
+            (kMarkFrequency - kSpaceFrequency) * (kAudioSampleRate / kBitRate) / kAudioSampleRate, 2},
+        {"MFSK16 robust", 320, 20, 2, 16},
+        {"MFSK16 fast", 160, 8, 2, 16},
+    };
+
+    const SonicModeConfig &GetSonicModeConfig(SonicMode mode) {
+        return kSonicModes[static_cast<size_t>(mode)];
+    }
+
+    // SlidingGoertzelBank implementation
+    void SlidingGoertzelBank::Configure(size_t window_size, size_t first_bin, size_t bin_step, size_t tones) {
+        window_size_ = window_size < kMaxSymbolSamples ? window_size : kMaxSymbolSamples;
+        tones_ = tones < kMaxTones ? tones : kMaxTones;
+        damping_n_ = std::pow(kGoertzelDamping, static_cast<float>(window_size_));
+        damping_squared_ = kGoertzelDamping * kGoertzelDamping;
+        for (size_t i = 0; i < tones_; i++) {
+            float angular_frequency = 2.0f * M_PI * static_cast<float>(first_bin + i * bin_step) /
+                static_cast<float>(window_size_);
+            cosine_[i] = kGoertzelDamping * std::cos(angular_frequency);
+            sine_[i] = kGoertzelDamping * std::sin(angular_frequency);
+            coefficient_[i] = 2.0f * cosine_[i];
+        }
+        Reset();
+    }
+
+    void SlidingGoertzelBank::Reset() {
+        memset(window_, 0, sizeof(window_));
+        memset(state1_, 0, sizeof(state1_));
+        memset(state2_, 0, sizeof(state2_));
+        position_ = 0;
+    }
+
+    float SlidingGoertzelBank::GetPower(size_t tone) const {
+        // X[n] = y[n] - r e^(-jw) y[n - 1]
+        float real_part = state1_[tone] - cosine_[tone] * state2_[tone];
+        float imaginary_part = sine_[tone] * state2_[tone];
+        return real_part * real_part + imaginary_part * imaginary_part;
+    }
+
+    // SymbolDemodulator implementation
+    void SymbolDemodulator::Configure(const SonicModeConfig &config) {
+        bank_.Configure(config.symbol_samples, config.first_bin, config.bin_step, config.tones);
+        phase_samples_ = config.symbol_samples / kTimingPhases;
+        Reset();
+    }
+
+    void SymbolDemodulator::Reset() {
+        bank_.Reset();
+        sample_count_ = 0;
+        phase_ = 0;
+        best_phase_ = 0;
+        readings_left_ = 1;
+        memset(clarity_, 0, sizeof(clarity_));
+    }
+
+    bool SymbolDemodulator::ProcessSample(float sample, uint8_t &symbol) {
+        bank_.ProcessSample(sample);
+        if (++sample_count_ < phase_samples_) {
+            return false;
+        }
+        sample_count_ = 0;
+        size_t phase = phase_;
+        phase_ = (phase_ + 1) % kTimingPhases;
+
+        float best_power = 0.0f;
+        float second_power = 0.0f;
+        size_t best_tone = 0;
+        for (size_t i = 0; i < bank_.tones(); i++) {
+            float power = bank_.GetPower(i);
+            if (power > best_power) {
+                second_power = best_power;
+                best_power = power;
+                best_tone = i;
+            } else if (power > second_power) {
+                second_power = power;
             }
+        }
 
-            if (input_channels == 2) { // 如果是双声道输入，转换为单声道
-                auto mono_data = std::vector<int16_t>(audio_data.size() / 2);
-                for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                    mono_data[i] = audio_data[j];
-                }
-                audio_data = std::move(mono_data);
+        // 1 when one tone fills the window alone, near 0 when the window straddles two symbols
+        float clarity = (best_power - second_power) / (best_power + second_power + 1e-12f);
+        clarity_[phase] += kClarityWeight * (clarity - clarity_[phase]);
+        if (--readings_left_ > 0) {
+            return false;
+        }
+        symbol = static_cast<uint8_t>(best_tone);
+        readings_left_ = kTimingPhases;
+
+        // Step one phase towards the clearest boundary, so the next symbol comes 7/8 or 9/8 of a
+        // symbol later and none is read twice or skipped while the timing settles or drifts
+        size_t clearest = best_phase_;
+        for (size_t i = 0; i < kTimingPhases; i++) {
+            if (clarity_[i] > clarity_[clearest]) {
+                clearest = i;
             }
-            
-            // Downsample the audio data
-            std::vector<float> downsampled_data;
-            size_t last_index = 0;
-
-            if (kDownsampleStep > 1.0f) {
-                downsampled_data.reserve(audio_data.size() / static_cast<size_t>(kDownsampleStep));
-                for (size_t i = 0; i < audio_data.size(); ++i) {
-                    size_t sample_index = static_cast<size_t>(i / kDownsampleStep);
-                    if ((sample_index + 1) > last_index) {
-                        downsampled_data.push_back(static_cast<float>(audio_data[i]));
-                        last_index = sample_index + 1;
-                    }
-                }
+        }
+        if (clarity_[clearest] > clarity_[best_phase_] + kClarityHysteresis) {
+            size_t ahead = (clearest + kTimingPhases - best_phase_) % kTimingPhases;
+            if (ahead <= kTimingPhases / 2) {
+                best_phase_ = (best_phase_ + 1) % kTimingPhases;
+                readings_left_++;
             } else {
-                downsampled_data.reserve(audio_data.size());
-                for (int16_t sample : audio_data) {
-                    downsampled_data.push_back(static_cast<float>(sample));
-                }
+                best_phase_ = (best_phase_ + kTimingPhases - 1) % kTimingPhases;
+                readings_left_--;
             }
-            
-            // Process audio samples to get probability data
-            auto probabilities = signal_processor.ProcessAudioSamples(downsampled_data);
-            
-            // Feed probability data to the data buffer
-            if (data_buffer.ProcessProbabilityData(probabilities, 0.5f)) {
-                // If complete data was received, extract WiFi credentials
-                if (data_buffer.decoded_text.has_value()) {
-                    ESP_LOGI(kLogTag, "Received text data: %s", data_buffer.decoded_text->c_str());
-                    display->SetChatMessage("system", data_buffer.decoded_text->c_str());
-                    
-                    // Split SSID and password by newline character
-                    std::string wifi_ssid, wifi_password;
-                    size_t newline_position = data_buffer.decoded_text->find('\n');
-                    if (newline_position != std::string::npos) {
-                        wifi_ssid = data_buffer.decoded_text->substr(0, newline_position);
-                        wifi_password = data_buffer.decoded_text->substr(newline_position + 1);
-                        ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
-                    } else {
-                        ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
-                        continue;
-                    }
-                    
-                    if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
-                        wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
-                        esp_restart();                            // Restart device to apply new WiFi configuration
-                    } else {
-                        ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
-                    }
-                    data_buffer.decoded_text.reset();  // Clear processed data
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(1));  // 1ms delay
         }
+        return true;
     }
 
-    // Default start and end transmission identifiers
-    // \x01\x02 = 00000001 00000010
-    const std::vector<uint8_t> kDefaultStartTransmissionPattern = {
-        0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0};
-
-    // \x03\x04 = 00000011 00000100
-    const std::vector<uint8_t> kDefaultEndTransmissionPattern = {
-        0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 1, 0, 0};
-
-    // FrequencyDetector implementation
-    FrequencyDetector::FrequencyDetector(float frequency, size_t window_size)
-        : frequency_(frequency), window_size_(window_size) {
-        frequency_bin_ = std::floor(frequency_ * static_cast<float>(window_size_));
-        angular_frequency_ = 2.0f * M_PI * frequency_;
-        cos_coefficient_ = std::cos(angular_frequency_);
-        sin_coefficient_ = std::sin(angular_frequency_);
-        filter_coefficient_ = 2.0f * cos_coefficient_;
-
-        // Initialize state buffer
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
+    // AudioDataBuffer implementation
+    uint8_t AudioDataBuffer::CalculateChecksum(const std::string &text) {
+        uint8_t checksum = 0;
+        for (char character : text) {
+            checksum += static_cast<uint8_t>(character);
+        }
+        return checksum;
     }
 
-    void FrequencyDetector::Reset() {
-        state_buffer_.clear();
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
-    }
+    bool AudioDataBuffer::ProcessBit(uint8_t bit) {
+        identifier_ = static_cast<uint16_t>((identifier_ << 1) | (bit & 1));
+        if (!receiving_) {
+            if (identifier_ == kStartPattern) {
+                receiving_ = true;
+                bit_count_ = 0;
+                ESP_LOGI(kLogTag, "Entering Receiving state");
+            }
+            return false;
+        }
 
-    void FrequencyDetector::ProcessSample(float sample) {
-        if (state_buffer_.size() < 2) {
-            return;
+        size_t index = bit_count_ / 8;
+        bytes_[index] = static_cast<uint8_t>(((bit_count_ % 8) == 0 ? 0 : bytes_[index] << 1) | (bit & 1));
+        if (++bit_count_ % 8 != 0) {
+            return false;
         }
 
-        float s_minus_2 = state_buffer_.front();  // S[-2]
-        state_buffer_.pop_front();
-        float s_minus_1 = state_buffer_.front();  // S[-1]
-        state_buffer_.pop_front();
+        // The end pattern only counts on a byte boundary, after at least the checksum
+        size_t length = bit_count_ / 8;
+        if (length >= 3 && identifier_ == kEndPattern) {
+            receiving_ = false;
+            size_t text_length = length - 3;
+            std::string text(reinterpret_cast<const char *>(bytes_), text_length);
+            uint8_t received_checksum = bytes_[text_length];
+            uint8_t calculated_checksum = CalculateChecksum(text);
+            if (calculated_checksum != received_checksum) {
+                ESP_LOGW(kLogTag, "Checksum mismatch: expected %d, got %d", received_checksum, calculated_checksum);
+                return false;
+            }
+            decoded_text = std::move(text);
+            return true;
+        }
+        if (length == kMaxBytes) {
+            receiving_ = false;
+            ESP_LOGW(kLogTag, "Buffer overflow, clearing buffer");
+        }
+        return false;
+    }
 
-        float s_current = sample + filter_coefficient_ * s_minus_1 - s_minus_2;
+    // ReedSolomon15 implementation, GF(16) generated by x^4 + x + 1
+    static const uint8_t kGfExp[15] = {1, 2, 4, 8, 3, 6, 12, 11, 5, 10, 7, 14, 15, 13, 9};
+    static const uint8_t kGfLog[16] = {0, 0, 1, 4, 2, 8, 5, 10, 3, 14, 9, 7, 6, 13, 11, 12};
+    static const size_t kParityLength = ReedSolomon15::kLength - ReedSolomon15::kDataLength;
 
-        state_buffer_.push_back(s_minus_1);  // Put S[-1] back
-        state_buffer_.push_back(s_current);  // Add new S[0]
+    static inline uint8_t GfMul(uint8_t a, uint8_t b) {
+        if (a == 0 || b == 0) {
+            return 0;
+        }
+        return kGfExp[(kGfLog[a] + kGfLog[b]) % 15];
     }
 
-    float FrequencyDetector::GetAmplitude() const {
-        if (state_buffer_.size() < 2) {
-            return 0.0f;
+    static inline uint8_t GfDiv(uint8_t a, uint8_t b) {
+        if (a == 0) {
+            return 0;
         }
+        return kGfExp[(kGfLog[a] + 15 - kGfLog[b]) % 15];
+    }
 
-        float s_minus_1 = state_buffer_[1];                      // S[-1]
-        float s_minus_2 = state_buffer_[0];                      // S[-2]
-        float real_part = cos_coefficient_ * s_minus_1 - s_minus_2;  // Real part
-        float imaginary_part = sin_coefficient_ * s_minus_1;         // Imaginary part
-
-        return std::sqrt(real_part * real_part + imaginary_part * imaginary_part) / 
-               (static_cast<float>(window_size_) / 2.0f);
+    static inline uint8_t GfPow(int exponent) {
+        return kGfExp[((exponent % 15) + 15) % 15];
     }
 
-    // AudioSignalProcessor implementation
-    AudioSignalProcessor::AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
-                                             size_t bit_rate, size_t window_size)
-        : input_buffer_size_(window_size), output_sample_count_(0) {
-        if (sample_rate % bit_rate != 0) {
-            // On ESP32 we can continue execution, but log the error
-            ESP_LOGW(kLogTag, "Sample rate %zu is not divisible by bit rate %zu", sample_rate, bit_rate);
+    // Syndromes S1..S4, the codeword evaluated at a^1..a^4; returns true if they are all zero
+    static bool ComputeSyndromes(const uint8_t *codeword, uint8_t *syndromes) {
+        bool clean = true;
+        for (size_t i = 0; i < kParityLength; i++) {
+            uint8_t root = GfPow(static_cast<int>(i) + 1);
+            uint8_t value = 0;
+            for (size_t k = 0; k < ReedSolomon15::kLength; k++) {
+                value = GfMul(value, root) ^ codeword[k];
+            }
+            syndromes[i] = value;
+            clean = clean && value == 0;
         }
+        return clean;
+    }
 
-        float normalized_mark_freq = static_cast<float>(mark_frequency) / static_cast<float>(sample_rate);
-        float normalized_space_freq = static_cast<float>(space_frequency) / static_cast<float>(sample_rate);
-
-        mark_detector_ = std::make_unique<FrequencyDetector>(normalized_mark_freq, window_size);
-        space_detector_ = std::make_unique<FrequencyDetector>(normalized_space_freq, window_size);
+    void ReedSolomon15::Encode(const uint8_t *data, uint8_t *codeword) {
+        // g(x) = (x - a)(x - a^2)(x - a^3)(x - a^4), highest degree first
+        uint8_t generator[kParityLength + 1] = {1};
+        for (size_t i = 0; i < kParityLength; i++) {
+            uint8_t root = GfPow(static_cast<int>(i) + 1);
+            for (size_t j = i + 1; j > 0; j--) {
+                generator[j] ^= GfMul(generator[j - 1], root);
+            }
+        }
 
-        samples_per_bit_ = sample_rate / bit_rate;  // Number of samples per bit
+        uint8_t remainder[kParityLength] = {};
+        for (size_t i = 0; i < kDataLength; i++) {
+            uint8_t feedback = (data[i] & 0x0F) ^ remainder[0];
+            memmove(remainder, remainder + 1, kParityLength - 1);
+            remainder[kParityLength - 1] = 0;
+            for (size_t j = 0; j < kParityLength; j++) {
+                remainder[j] ^= GfMul(feedback, generator[j + 1]);
+            }
+            codeword[i] = data[i] & 0x0F;
+        }
+        memcpy(codeword + kDataLength, remainder, kParityLength);
     }
 
-    std::vector<float> AudioSignalProcessor::ProcessAudioSamples(const std::vector<float> &samples) {
-        std::vector<float> result;
+    int ReedSolomon15::Decode(uint8_t *codeword) {
+        uint8_t syndromes[kParityLength];
+        if (ComputeSyndromes(codeword, syndromes)) {
+            return 0;
+        }
 
-        for (float sample : samples) {
-            if (input_buffer_.size() < input_buffer_size_) {
-                input_buffer_.push_back(sample);  // Just add, don't process yet
+        // Berlekamp-Massey: the error locator, lowest degree first
+        uint8_t locator[kParityLength + 1] = {1};
+        uint8_t previous[kParityLength + 1] = {1};
+        size_t errors = 0;
+        size_t shift = 1;
+        uint8_t previous_discrepancy = 1;
+        for (size_t n = 0; n < kParityLength; n++) {
+            uint8_t discrepancy = syndromes[n];
+            for (size_t i = 1; i <= errors; i++) {
+                discrepancy ^= GfMul(locator[i], syndromes[n - i]);
+            }
+            if (discrepancy == 0) {
+                shift++;
+                continue;
+            }
+            uint8_t scale = GfDiv(discrepancy, previous_discrepancy);
+            uint8_t saved[kParityLength + 1];
+            memcpy(saved, locator, sizeof(saved));
+            for (size_t i = 0; i + shift <= kParityLength; i++) {
+                locator[i + shift] ^= GfMul(scale, previous[i]);
+            }
+            if (2 * errors <= n) {
+                errors = n + 1 - errors;
+                memcpy(previous, saved, sizeof(previous));
+                previous_discrepancy = discrepancy;
+                shift = 1;
             } else {
-                // Input buffer is full, process the data
-                input_buffer_.pop_front();   // Remove oldest sample
-                input_buffer_.push_back(sample);  // Add new sample
-                output_sample_count_++;
-
-                if (output_sample_count_ >= samples_per_bit_) {
-                    // Process all samples in the window using Goertzel algorithm
-                    for (float window_sample : input_buffer_) {
-                        mark_detector_->ProcessSample(window_sample);
-                        space_detector_->ProcessSample(window_sample);
-                    }
-
-                    float mark_amplitude = mark_detector_->GetAmplitude();   // Mark amplitude
-                    float space_amplitude = space_detector_->GetAmplitude(); // Space amplitude
+                shift++;
+            }
+        }
+        if (errors > kParityLength / 2) {
+            return -1;
+        }
 
-                    // Avoid division by zero
-                    float mark_probability = mark_amplitude / 
-                                           (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
-                    result.push_back(mark_probability);
+        // Error evaluator: S(x) * locator(x) mod x^4
+        uint8_t evaluator[kParityLength] = {};
+        for (size_t i = 0; i < kParityLength; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                evaluator[i] ^= GfMul(syndromes[i - j], locator[j]);
+            }
+        }
 
-                    // Reset detector windows
-                    mark_detector_->Reset();
-                    space_detector_->Reset();
-                    output_sample_count_ = 0;  // Reset output counter
+        // Chien search over every position, Forney for the error values
+        size_t found = 0;
+        for (size_t k = 0; k < kLength; k++) {
+            int degree = static_cast<int>(kLength - 1 - k);
+            uint8_t inverse = GfPow(-degree);   // X^-1 of an error at this position
+            uint8_t locator_value = 0;
+            uint8_t derivative_value = 0;
+            uint8_t evaluator_value = 0;
+            uint8_t power = 1;
+            for (size_t i = 0; i <= kParityLength; i++) {
+                locator_value ^= GfMul(locator[i], power);
+                // In characteristic 2 the derivative keeps the odd terms, one degree down
+                if (i % 2 == 1) {
+                    derivative_value ^= GfMul(locator[i], GfDiv(power, inverse));
+                }
+                if (i < kParityLength) {
+                    evaluator_value ^= GfMul(evaluator[i], power);
                 }
+                power = GfMul(power, inverse);
+            }
+            if (locator_value != 0) {
+                continue;
             }
+            if (derivative_value == 0) {
+                return -1;
+            }
+            codeword[k] ^= GfDiv(evaluator_value, derivative_value);
+            found++;
         }
 
-        return result;
-    }
-
-    // AudioDataBuffer implementation
-    AudioDataBuffer::AudioDataBuffer()
-        : current_state_(DataReceptionState::kInactive),
-          start_of_transmission_(kDefaultStartTransmissionPattern),
-          end_of_transmission_(kDefaultEndTransmissionPattern),
-          enable_checksum_validation_(true) {
-        identifier_buffer_size_ = std::max(start_of_transmission_.size(), end_of_transmission_.size());
-        max_bit_buffer_size_ = 776;  // Preset bit buffer size, 776 bits = (32 + 1 + 63 + 1) * 8 = 776
-
-        bit_buffer_.reserve(max_bit_buffer_size_);
-    }
-
-    AudioDataBuffer::AudioDataBuffer(size_t max_byte_size, const std::vector<uint8_t> &start_identifier,
-                                   const std::vector<uint8_t> &end_identifier, bool enable_checksum)
-        : current_state_(DataReceptionState::kInactive),
-          start_of_transmission_(start_identifier),
-          end_of_transmission_(end_identifier),
-          enable_checksum_validation_(enable_checksum) {
-        identifier_buffer_size_ = std::max(start_of_transmission_.size(), end_of_transmission_.size());
-        max_bit_buffer_size_ = max_byte_size * 8;  // Bit buffer size in bytes
-
-        bit_buffer_.reserve(max_bit_buffer_size_);
+        if (found != errors || !ComputeSyndromes(codeword, syndromes)) {
+            return -1;
+        }
+        return static_cast<int>(errors);
     }
 
-    uint8_t AudioDataBuffer::CalculateChecksum(const std::string &text) {
-        uint8_t checksum = 0;
-        for (char character : text) {
-            checksum += static_cast<uint8_t>(character);
+    uint16_t Crc16(const uint8_t *data, size_t length) {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; i++) {
+            crc ^= static_cast<uint16_t>(data[i]) << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
         }
-        return checksum;
+        return crc;
     }
 
-    void AudioDataBuffer::ClearBuffers() {
-        identifier_buffer_.clear();
-        bit_buffer_.clear();
-    }
+    // MfskFrameDecoder implementation
+    const uint8_t MfskFrameDecoder::kPreamble[8] = {0, 15, 0, 15, 0, 15, 0, 15};
+    const uint8_t MfskFrameDecoder::kSync[6] = {3, 12, 5, 10, 9, 6};
 
-    bool AudioDataBuffer::ProcessProbabilityData(const std::vector<float> &probabilities, float threshold) {
-        for (float probability : probabilities) {
-            uint8_t bit = (probability > threshold) ? 1 : 0;
+    bool MfskFrameDecoder::ProcessSymbol(uint8_t symbol) {
+        symbol &= 0x0F;
+        history_ = (history_ << 4) | symbol;
 
-            if (identifier_buffer_.size() >= identifier_buffer_size_) {
-                identifier_buffer_.pop_front();  // Maintain buffer size
+        switch (state_) {
+        case State::kHunting: {
+            size_t mismatches = 0;
+            for (size_t i = 0; i < sizeof(kSync); i++) {
+                uint8_t received = (history_ >> (4 * (sizeof(kSync) - 1 - i))) & 0x0F;
+                mismatches += received != kSync[i];
             }
-            identifier_buffer_.push_back(bit);
-
-            // Process received bit based on state machine
-            switch (current_state_) {
-            case DataReceptionState::kInactive:
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
-                    current_state_ = DataReceptionState::kWaiting;  // Enter waiting state
-                    ESP_LOGI(kLogTag, "Entering Waiting state");
-                }
-                break;
-
-            case DataReceptionState::kWaiting:
-                // Waiting state, possibly waiting for transmission end
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == start_of_transmission_)
-                    {
-                        ClearBuffers();                                // Clear buffers
-                        current_state_ = DataReceptionState::kReceiving;  // Enter receiving state
-                        ESP_LOGI(kLogTag, "Entering Receiving state");
-                    }
+            if (mismatches <= 1) {
+                state_ = State::kHeader;
+                symbol_count_ = 0;
+            }
+            return false;
+        }
+
+        case State::kHeader:
+            symbols_[symbol_count_++] = symbol;
+            if (symbol_count_ == ReedSolomon15::kLength) {
+                symbol_count_ = 0;
+                state_ = DecodeHeader() ? State::kBody : State::kHunting;
+                if (state_ == State::kBody) {
+                    ESP_LOGI(kLogTag, "Receiving %u bytes in %u codewords", (unsigned)text_length_, (unsigned)codewords_);
                 }
-                break;
-
-            case DataReceptionState::kReceiving:
-                bit_buffer_.push_back(bit);
-                if (identifier_buffer_.size() >= end_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == end_of_transmission_) {
-                        current_state_ = DataReceptionState::kInactive;  // Enter inactive state
-
-                        // Convert bits to bytes
-                        std::vector<uint8_t> bytes = ConvertBitsToBytes(bit_buffer_);
-
-                        uint8_t received_checksum = 0;
-                        size_t minimum_length = 0;
-
-                        if (enable_checksum_validation_) {
-                            // If checksum is required, last byte is checksum
-                            minimum_length = 1 + start_of_transmission_.size() / 8;
-                            if (bytes.size() >= minimum_length)
-                            {
-                                received_checksum = bytes[bytes.size() - start_of_transmission_.size() / 8 - 1];
-                            }
-                        } else {
-                            minimum_length = start_of_transmission_.size() / 8;
-                        }
+            }
+            return false;
 
-                        if (bytes.size() < minimum_length) {
-                            ClearBuffers();
-                            ESP_LOGW(kLogTag, "Data too short, clearing buffer");
-                            return false;  // Data too short, return failure
-                        }
+        case State::kBody:
+            symbols_[symbol_count_++] = symbol;
+            if (symbol_count_ == codewords_ * ReedSolomon15::kLength) {
+                state_ = State::kHunting;
+                return DecodeBody();
+            }
+            return false;
+        }
+        return false;
+    }
 
-                        // Extract text data (remove trailing identifier part)
-                        std::vector<uint8_t> text_bytes(
-                            bytes.begin(), bytes.begin() + bytes.size() - minimum_length);
-
-                        std::string result(text_bytes.begin(), text_bytes.end());
-
-                        // Validate checksum if required
-                        if (enable_checksum_validation_) {
-                            uint8_t calculated_checksum = CalculateChecksum(result);
-                            if (calculated_checksum != received_checksum) {
-                                // Checksum mismatch
-                                ESP_LOGW(kLogTag, "Checksum mismatch: expected %d, got %d", 
-                                        received_checksum, calculated_checksum);
-                                ClearBuffers();
-                                return false;
-                            }
-                        }
+    bool MfskFrameDecoder::DecodeHeader() {
+        int corrected = ReedSolomon15::Decode(symbols_);
+        if (corrected < 0 || symbols_[0] != kVersion) {
+            return false;
+        }
+        for (size_t i = 3; i < ReedSolomon15::kDataLength; i++) {
+            if (symbols_[i] != 0) {
+                return false;
+            }
+        }
+        text_length_ = (symbols_[1] << 4) | symbols_[2];
+        if (text_length_ == 0 || text_length_ > kMaxTextLength) {
+            return false;
+        }
+        codewords_ = ((text_length_ + 2) * 2 + ReedSolomon15::kDataLength - 1) / ReedSolomon15::kDataLength;
+        corrected_ = static_cast<uint32_t>(corrected);
+        return true;
+    }
 
-                        ClearBuffers();
-                        decoded_text = result;
-                        return true;  // Return success
-                    } else if (bit_buffer_.size() >= max_bit_buffer_size_) {
-                        // If not end identifier and bit buffer is full, reset
-                        ClearBuffers();
-                        ESP_LOGW(kLogTag, "Buffer overflow, clearing buffer");
-                        current_state_ = DataReceptionState::kInactive;  // Reset state machine
-                    }
+    bool MfskFrameDecoder::DecodeBody() {
+        uint8_t bytes[kMaxTextLength + 2] = {};
+        size_t byte_count = text_length_ + 2;
+        for (size_t j = 0; j < codewords_; j++) {
+            uint8_t codeword[ReedSolomon15::kLength];
+            for (size_t i = 0; i < ReedSolomon15::kLength; i++) {
+                codeword[i] = symbols_[i * codewords_ + j];
+            }
+            int corrected = ReedSolomon15::Decode(codeword);
+            if (corrected < 0) {
+                ESP_LOGW(kLogTag, "Codeword %u of %u has too many errors", (unsigned)j + 1, (unsigned)codewords_);
+                return false;
+            }
+            corrected_ += static_cast<uint32_t>(corrected);
+            for (size_t i = 0; i < ReedSolomon15::kDataLength; i++) {
+                size_t nibble = j * ReedSolomon15::kDataLength + i;
+                if (nibble / 2 < byte_count) {
+                    bytes[nibble / 2] |= (nibble % 2 == 0) ? codeword[i] << 4 : codeword[i];
                 }
-                break;
             }
         }
 
-        return false;
+        uint16_t received_crc = static_cast<uint16_t>((bytes[text_length_] << 8) | bytes[text_length_ + 1]);
+        if (Crc16(bytes, text_length_) != received_crc) {
+            ESP_LOGW(kLogTag, "CRC mismatch after error correction");
+            return false;
+        }
+        decoded_text = std::string(reinterpret_cast<const char *>(bytes), text_length_);
+        corrected_symbols = corrected_;
+        return true;
     }
 
-    std::vector<uint8_t> AudioDataBuffer::ConvertBitsToBytes(const std::vector<uint8_t> &bits) const {
-        std::vector<uint8_t> bytes;
+    // SonicReceiver implementation
+    SonicReceiver::SonicReceiver() {
+        for (size_t i = 0; i < static_cast<size_t>(SonicMode::kCount); i++) {
+            demodulators_[i].Configure(kSonicModes[i]);
+        }
+    }
 
-        // Ensure number of bits is a multiple of 8
-        size_t complete_bytes_count = bits.size() / 8;
-        bytes.reserve(complete_bytes_count);
+    bool SonicReceiver::ProcessSamples(const int16_t *samples, size_t count) {
+        bool decoded = false;
+        for (size_t start = 0; start < count; start += kBlockSamples) {
+            size_t block_samples = std::min(count - start, kBlockSamples);
+            DspInt16ToFloat(samples + start, block_, block_samples, 1.0f / 32768.0f);
+            for (size_t n = 0; n < block_samples; n++) {
+                float sample = block_[n];
+                for (size_t i = 0; i < static_cast<size_t>(SonicMode::kCount); i++) {
+                    uint8_t symbol;
+                    if (!demodulators_[i].ProcessSample(sample, symbol)) {
+                        continue;
+                    }
 
-        for (size_t i = 0; i < complete_bytes_count; ++i) {
-            uint8_t byte_value = 0;
-            for (size_t j = 0; j < 8; ++j) {
-                byte_value |= bits[i * 8 + j] << (7 - j);
+                    std::optional<std::string> *text;
+                    bool complete;
+                    uint32_t corrected = 0;
+                    if (static_cast<SonicMode>(i) == SonicMode::kAfsk100) {
+                        complete = afsk_buffer_.ProcessBit(symbol);
+                        text = &afsk_buffer_.decoded_text;
+                    } else {
+                        auto &decoder = mfsk_decoders_[i - 1];
+                        complete = decoder.ProcessSymbol(symbol);
+                        text = &decoder.decoded_text;
+                        corrected = decoder.corrected_symbols;
+                    }
+
+                    if (complete) {
+                        if (!decoded) {
+                            decoded = true;
+                            decoded_text = std::move(*text);
+                            decoded_mode = static_cast<SonicMode>(i);
+                            corrected_symbols = corrected;
+                        }
+                        text->reset();
+                    }
+                }
             }
-            bytes.push_back(byte_value);
         }
-
-        return bytes;
+        return decoded;
     }
 }
@@ -1,177 +1,255 @@
 #pragma once
 
-#include <vector>
-#include <deque>
-#include <string>
-#include <memory>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
-#include <cmath>
-#include "wifi_configuration_ap.h"
-#include "application.h"
-
-// Audio signal processing constants for WiFi configuration via audio
-const size_t kAudioSampleRate = 6400;
-const size_t kMarkFrequency = 1800;
-const size_t kSpaceFrequency = 1500;
-const size_t kBitRate = 100;
-const size_t kWindowSize = 64;
+#include <string>
 
+// Demodulators for acoustic WiFi provisioning (scripts/sonic_wifi_config.html), independent of ESP-IDF
 namespace audio_wifi_config
 {
-    // Main function to receive WiFi credentials through audio signal
-    void ReceiveWifiCredentialsFromAudio(Application *app, WifiConfigurationAp *wifi_ap, Display *display, 
-                                         size_t input_channels = 1);
+    // Everything runs on the 16 kHz microphone signal
+    const size_t kAudioSampleRate = 16000;
+
+    // Legacy AFSK: 100 bit/s, one tone per bit, framed by \x01\x02 <text> <checksum> \x03\x04
+    const size_t kMarkFrequency = 1800;
+    const size_t kSpaceFrequency = 1500;
+    const size_t kBitRate = 100;
+
+    const size_t kMaxTones = 16;
+    const size_t kMaxSymbolSamples = 320;
+    const size_t kTimingPhases = 8;             // Candidate symbol boundaries tried per symbol
+    const size_t kMaxTextLength = 32 + 1 + 63;  // SSID + '\n' + password
 
     /**
-     * Goertzel algorithm implementation for single frequency detection
-     * Used to detect specific audio frequencies in the AFSK demodulation process
+     * Transmission modes, the receiver listens for all of them at once and the page picks one.
+     * The MFSK modes send one of 16 tones per symbol (4 bits) with Reed-Solomon error correction.
      */
-    class FrequencyDetector
+    enum class SonicMode
     {
-    private:
-        float frequency_;              // Target frequency (normalized, i.e., f / fs)
-        size_t window_size_;           // Window size for analysis
-        float frequency_bin_;          // Frequency bin
-        float angular_frequency_;      // Angular frequency
-        float cos_coefficient_;        // cos(w)
-        float sin_coefficient_;        // sin(w)
-        float filter_coefficient_;     // 2 * cos(w)
-        std::deque<float> state_buffer_;  // Circular buffer for storing S[-1] and S[-2]
+        kAfsk100,        // 2 tones, 10 ms per bit: 100 bit/s, no error correction
+        kMfsk16Robust,   // 16 tones 100 Hz apart from 1000 Hz, 20 ms per symbol: 147 bit/s after FEC
+        kMfsk16Fast,     // 16 tones 200 Hz apart from 800 Hz, 10 ms per symbol: 293 bit/s after FEC
+        kCount
+    };
+
+    struct SonicModeConfig
+    {
+        const char *name;
+        size_t symbol_samples;  // Symbol length, also the analysis window; its DFT bins are 16000 / N Hz apart
+        size_t first_bin;       // Bin of symbol 0
+        size_t bin_step;        // Bins between the tones of consecutive symbols
+        size_t tones;
+    };
+
+    const SonicModeConfig &GetSonicModeConfig(SonicMode mode);
 
+    /**
+     * Sliding Goertzel filters on DFT bins of the last N samples.
+     * Each sample costs one comb update shared by all tones and one two-pole resonator step per tone,
+     * and the power of every bin over the window can be read after any sample. The poles sit just
+     * inside the unit circle so that rounding errors die out instead of accumulating.
+     */
+    class SlidingGoertzelBank
+    {
     public:
         /**
-         * Constructor
-         * @param frequency Normalized frequency (f / fs)
-         * @param window_size Window size for analysis
+         * @param window_size Window length N, at most kMaxSymbolSamples
+         * @param first_bin DFT bin (frequency * N / sample rate) of the first tone
+         * @param bin_step Bins between consecutive tones
+         * @param tones Number of tones, at most kMaxTones
          */
-        FrequencyDetector(float frequency, size_t window_size);
+        void Configure(size_t window_size, size_t first_bin, size_t bin_step, size_t tones);
+        void Reset();
 
-        /**
-         * Reset the detector state
-         */
+        inline void ProcessSample(float sample) {
+            float comb = sample - damping_n_ * window_[position_];
+            window_[position_] = sample;
+            if (++position_ == window_size_) {
+                position_ = 0;
+            }
+            for (size_t i = 0; i < tones_; i++) {
+                float state = comb + coefficient_[i] * state1_[i] - damping_squared_ * state2_[i];
+                state2_[i] = state1_[i];
+                state1_[i] = state;
+            }
+        }
+
+        // Squared DFT magnitude of a tone over the last window_size samples
+        float GetPower(size_t tone) const;
+        inline size_t tones() const { return tones_; }
+
+    private:
+        float window_[kMaxSymbolSamples] = {};
+        size_t window_size_ = 0;
+        size_t position_ = 0;
+        size_t tones_ = 0;
+        float damping_n_ = 1.0f;        // r^N
+        float damping_squared_ = 1.0f;  // r^2
+        float coefficient_[kMaxTones] = {};  // 2 r cos(w)
+        float cosine_[kMaxTones] = {};       // r cos(w)
+        float sine_[kMaxTones] = {};         // r sin(w)
+        float state1_[kMaxTones] = {};       // y[n]
+        float state2_[kMaxTones] = {};       // y[n - 1]
+    };
+
+    /**
+     * Symbol decisions of one mode: the strongest tone over the last symbol.
+     * The bank is read kTimingPhases times per symbol; every reading rates how clearly one tone
+     * wins, and after every symbol the read boundary moves one phase towards the one that has been
+     * clearest lately. That settles within the preamble and follows the drift of the sender's clock.
+     */
+    class SymbolDemodulator
+    {
+    public:
+        void Configure(const SonicModeConfig &config);
         void Reset();
 
         /**
          * Process one audio sample
          * @param sample Input audio sample
+         * @param symbol Set to the tone index when a symbol ends at this sample
+         * @return true if a symbol was decided
          */
-        void ProcessSample(float sample);
+        bool ProcessSample(float sample, uint8_t &symbol);
 
-        /**
-         * Calculate current amplitude
-         * @return Amplitude value
-         */
-        float GetAmplitude() const;
+    private:
+        SlidingGoertzelBank bank_;
+        size_t phase_samples_ = 0;   // Samples between two readings
+        size_t sample_count_ = 0;
+        size_t phase_ = 0;
+        size_t best_phase_ = 0;     // The phase symbols are read at
+        size_t readings_left_ = 1;  // Until the next symbol
+        float clarity_[kTimingPhases] = {};
     };
 
     /**
-     * Audio signal processor for Mark/Space frequency pair detection
-     * Processes audio signals to extract digital data using AFSK demodulation
+     * Legacy framing: \x01\x02 <text> <checksum> \x03\x04, 8 bits per byte MSB first.
+     * The checksum is the byte sum of the text. The page sends \x55\x55 ahead of it so that the
+     * bit timing has settled by the start pattern; it never matches the start pattern and is skipped.
      */
-    class AudioSignalProcessor
+    class AudioDataBuffer
     {
-    private:
-        std::deque<float> input_buffer_;             // Input sample buffer
-        size_t input_buffer_size_;                   // Input buffer size = window size
-        size_t output_sample_count_;                 // Output sample counter
-        size_t samples_per_bit_;                     // Samples per bit threshold
-        std::unique_ptr<FrequencyDetector> mark_detector_;   // Mark frequency detector
-        std::unique_ptr<FrequencyDetector> space_detector_;  // Space frequency detector
-
     public:
+        std::optional<std::string> decoded_text;  // Successfully decoded text data
+
         /**
-         * Constructor
-         * @param sample_rate Audio sampling rate
-         * @param mark_frequency Mark frequency for digital '1'
-         * @param space_frequency Space frequency for digital '0'
-         * @param bit_rate Data transmission bit rate
-         * @param window_size Analysis window size
+         * Feed one demodulated bit
+         * @return true if complete data was successfully received and decoded
          */
-        AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
-                           size_t bit_rate, size_t window_size);
+        bool ProcessBit(uint8_t bit);
+        inline bool receiving() const { return receiving_; }
 
         /**
-         * Process input audio samples
-         * @param samples Input audio sample vector
-         * @return Vector of Mark probability values (0.0 to 1.0)
+         * Calculate checksum for ASCII text
+         * @param text Input text string
+         * @return Checksum value (0-255)
          */
-        std::vector<float> ProcessAudioSamples(const std::vector<float> &samples);
+        static uint8_t CalculateChecksum(const std::string &text);
+
+    private:
+        static const uint16_t kStartPattern = 0x0102;
+        static const uint16_t kEndPattern = 0x0304;
+        static const size_t kMaxBytes = kMaxTextLength + 1 + 2;  // Text, checksum and end pattern
+
+        uint16_t identifier_ = 0;   // The last 16 bits
+        bool receiving_ = false;
+        uint8_t bytes_[kMaxBytes];
+        size_t bit_count_ = 0;      // Bits received since the start pattern
     };
 
     /**
-     * Data reception state machine states
+     * Reed-Solomon RS(15, 11) over GF(16): 11 data nibbles and 4 parity nibbles per codeword,
+     * corrects any 2 wrong nibbles. One nibble is one MFSK symbol, so a misread tone costs one
+     * correctable error however many of its bits are wrong.
      */
-    enum class DataReceptionState
+    class ReedSolomon15
     {
-        kInactive,  // Waiting for start signal
-        kWaiting,   // Detected potential start, waiting for confirmation
-        kReceiving  // Actively receiving data
+    public:
+        static const size_t kLength = 15;
+        static const size_t kDataLength = 11;
+
+        static void Encode(const uint8_t *data, uint8_t *codeword);
+
+        /**
+         * Correct a codeword in place
+         * @return Number of nibbles corrected, -1 if there are too many errors
+         */
+        static int Decode(uint8_t *codeword);
     };
 
+    uint16_t Crc16(const uint8_t *data, size_t length);
+
     /**
-     * Data buffer for managing audio-to-digital data conversion
-     * Handles the complete process from audio signal to decoded text data
+     * MFSK framing, every field in nibbles sent most significant first:
+     *
+     *   preamble  0 15 0 15 0 15 0 15     lets the symbol timing settle
+     *   sync      3 12 5 10 9 6           one wrong symbol is tolerated
+     *   header    one codeword            version (1), text length (2 nibbles), zeros
+     *   body      C codewords             text and CRC-16 (CCITT) of the text, zero padded,
+     *                                     interleaved: nibble i of every codeword, then nibble i + 1
+     *
+     * Interleaving spreads a burst of bad symbols (a knock, a dropout) over all codewords.
      */
-    class AudioDataBuffer
+    class MfskFrameDecoder
     {
-    private:
-        DataReceptionState current_state_;       // Current reception state
-        std::deque<uint8_t> identifier_buffer_;  // Buffer for start/end identifier detection
-        size_t identifier_buffer_size_;          // Identifier buffer size
-        std::vector<uint8_t> bit_buffer_;        // Buffer for storing bit stream
-        size_t max_bit_buffer_size_;             // Maximum bit buffer size
-        const std::vector<uint8_t> start_of_transmission_;  // Start-of-transmission identifier
-        const std::vector<uint8_t> end_of_transmission_;    // End-of-transmission identifier
-        bool enable_checksum_validation_;       // Whether to validate checksum
-
     public:
-        std::optional<std::string> decoded_text; // Successfully decoded text data
+        std::optional<std::string> decoded_text;  // Successfully decoded text data
+        uint32_t corrected_symbols = 0;           // Symbols the last decoded frame needed corrected
 
         /**
-         * Default constructor using predefined start and end identifiers
+         * Feed one demodulated symbol
+         * @return true if a frame was successfully received and decoded
          */
-        AudioDataBuffer();
+        bool ProcessSymbol(uint8_t symbol);
+        inline bool receiving() const { return state_ != State::kHunting; }
 
-        /**
-         * Constructor with custom parameters
-         * @param max_byte_size Expected maximum data size in bytes
-         * @param start_identifier Start-of-transmission identifier
-         * @param end_identifier End-of-transmission identifier
-         * @param enable_checksum Whether to enable checksum validation
-         */
-        AudioDataBuffer(size_t max_byte_size, const std::vector<uint8_t> &start_identifier,
-                      const std::vector<uint8_t> &end_identifier, bool enable_checksum = false);
+        static const uint8_t kVersion = 1;
+        static const uint8_t kPreamble[8];
+        static const uint8_t kSync[6];
+        static const size_t kMaxCodewords = ((kMaxTextLength + 2) * 2 + ReedSolomon15::kDataLength - 1) /
+            ReedSolomon15::kDataLength;
 
-        /**
-         * Process probability data and attempt to decode
-         * @param probabilities Vector of Mark probabilities
-         * @param threshold Decision threshold for bit detection
-         * @return true if complete data was successfully received and decoded
-         */
-        bool ProcessProbabilityData(const std::vector<float> &probabilities, float threshold = 0.5f);
+    private:
+        enum class State { kHunting, kHeader, kBody };
+
+        State state_ = State::kHunting;
+        uint32_t history_ = 0;      // The last 8 symbols, one per nibble
+        uint8_t symbols_[kMaxCodewords * ReedSolomon15::kLength];
+        size_t symbol_count_ = 0;
+        size_t codewords_ = 0;
+        size_t text_length_ = 0;
+        uint32_t corrected_ = 0;
+
+        bool DecodeHeader();
+        bool DecodeBody();
+    };
+
+    /**
+     * Demodulates all modes from the same samples and reports the first frame any of them decodes.
+     * No allocation after construction; per sample it costs 34 resonator steps and a comb update per mode.
+     */
+    class SonicReceiver
+    {
+    public:
+        SonicReceiver();
 
         /**
-         * Calculate checksum for ASCII text
-         * @param text Input text string
-         * @return Checksum value (0-255)
+         * Process 16 kHz mono samples
+         * @return true if a frame was decoded, its text is in decoded_text
          */
-        static uint8_t CalculateChecksum(const std::string &text);
+        bool ProcessSamples(const int16_t *samples, size_t count);
+
+        std::optional<std::string> decoded_text;
+        SonicMode decoded_mode = SonicMode::kAfsk100;
+        uint32_t corrected_symbols = 0;   // For MFSK frames, symbols fixed by the error correction
 
     private:
-        /**
-         * Convert bit vector to byte vector
-         * @param bits Input bit vector
-         * @return Converted byte vector
-         */
-        std::vector<uint8_t> ConvertBitsToBytes(const std::vector<uint8_t> &bits) const;
+        static const size_t kBlockSamples = 160;  // 10 ms
 
-        /**
-         * Clear all buffers and reset state
-         */
-        void ClearBuffers();
+        SymbolDemodulator demodulators_[static_cast<size_t>(SonicMode::kCount)];
+        float block_[kBlockSamples];  // The samples being demodulated, scaled to [-1, 1)
+        AudioDataBuffer afsk_buffer_;
+        MfskFrameDecoder mfsk_decoders_[2];
     };
-
-    // Default start and end transmission identifiers
-    extern const std::vector<uint8_t> kDefaultStartTransmissionPattern;
-    extern const std::vector<uint8_t> kDefaultEndTransmissionPattern;
-}
\ No newline at end of file
+}
@@ -0,0 +1,76 @@
+#include "audio_wifi_config.h"
+#include <vector>
+#include <string>
+#include "esp_log.h"
+#include "application.h"
+#include "wifi_configuration_ap.h"
+#include "display.h"
+#include "dsp_kernels.h"
+#include "afsk_demod.h"
+
+namespace audio_wifi_config
+{
+    static const char *kLogTag = "AUDIO_WIFI_CONFIG";
+
+    void ReceiveWifiCredentialsFromAudio(Application *app,
+                                        WifiConfigurationAp *wifi_ap,
+                                        Display *display,
+                                        size_t input_channels
+                                    )
+    {
+        std::vector<int16_t> audio_data;
+        SonicReceiver receiver;
+
+        while (true)
+        {
+            // 检查Application状态，只有在WiFi配置模式下才处理音频
+            if (app->GetDeviceState() != kDeviceStateWifiConfiguring) {
+                // 不在WiFi配置状态，休眠100ms后再检查
+                vTaskDelay(pdMS_TO_TICKS(100));
+                continue;
+            }
+            
+            if (!app->GetAudioService().ReadAudioData(audio_data, kAudioSampleRate, 480)) { // 16kHz, 480 samples corresponds to 30ms data
+                // 读取音频失败，短暂延迟后重试
+                ESP_LOGI(kLogTag, "Failed to read audio data, retrying.");
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+
+            if (input_channels == 2) { // 如果是双声道输入，转换为单声道
+                DspExtractChannel(audio_data.data(), audio_data.data(), audio_data.size() / 2, 2, 0);
+                audio_data.resize(audio_data.size() / 2);
+            }
+
+            // Every mode is demodulated from the same samples
+            if (receiver.ProcessSamples(audio_data.data(), audio_data.size()) && receiver.decoded_text.has_value()) {
+                const std::string &text = *receiver.decoded_text;
+                ESP_LOGI(kLogTag, "Received text data (%s, %lu symbols corrected): %s",
+                    GetSonicModeConfig(receiver.decoded_mode).name, receiver.corrected_symbols, text.c_str());
+                display->SetChatMessage("system", text.c_str());
+
+                // Split SSID and password by newline character
+                std::string wifi_ssid, wifi_password;
+                size_t newline_position = text.find('\n');
+                if (newline_position != std::string::npos) {
+                    wifi_ssid = text.substr(0, newline_position);
+                    wifi_password = text.substr(newline_position + 1);
+                    ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
+                } else {
+                    ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
+                    receiver.decoded_text.reset();
+                    continue;
+                }
+
+                if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
+                    wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
+                    esp_restart();                            // Restart device to apply new WiFi configuration
+                } else {
+                    ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
+                }
+                receiver.decoded_text.reset();  // Clear processed data
+            }
+            vTaskDelay(pdMS_TO_TICKS(1));  // 1ms delay
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+class Application;
+class WifiConfigurationAp;
+class Display;
+
+namespace audio_wifi_config
+{
+    // Main function to receive WiFi credentials through audio signal, see afsk_demod.h for the modes
+    void ReceiveWifiCredentialsFromAudio(Application *app, WifiConfigurationAp *wifi_ap, Display *display,
+                                         size_t input_channels = 1);
+}
@@ -15,7 +15,7 @@
 #include <wifi_station.h>
 #include <wifi_configuration_ap.h>
 #include <ssid_manager.h>
-#include "afsk_demod.h"
+#include "audio_wifi_config.h"
 
 static const char *TAG = "WifiBoard";
 
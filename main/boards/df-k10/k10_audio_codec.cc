@@ -3,7 +3,6 @@
 #include <esp_log.h>
 #include <driver/i2c_master.h>
 #include <driver/i2s_tdm.h>
-#include <cmath>
 
 static const char TAG[] = "K10AudioCodec";
 
@@ -201,20 +200,11 @@ int K10AudioCodec::Write(const int16_t* data, int samples) {
     if (output_enabled_) {
         std::vector<int32_t> buffer(samples * 2);  // Allocate buffer for 2x samples
 
-        // Apply volume adjustment (same as before)
-        int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
-        for (int i = 0; i < samples; i++) {
-            int64_t temp = int64_t(data[i]) * volume_factor;
-            if (temp > INT32_MAX) {
-            buffer[i * 2] = INT32_MAX;
-            } else if (temp < INT32_MIN) {
-            buffer[i * 2] = INT32_MIN;
-            } else {
-            buffer[i * 2] = static_cast<int32_t>(temp);
-            }
-
-            // Repeat each sample for slow playback (assuming mono audio)
-            buffer[i * 2 + 1] = buffer[i * 2];
+        output_gain_.Process(data, buffer.data(), samples);
+        // Repeat each sample for slow playback (assuming mono audio), from the end so nothing is overwritten unread
+        for (int i = samples - 1; i >= 0; i--) {
+            buffer[i * 2 + 1] = buffer[i];
+            buffer[i * 2] = buffer[i];
         }
 
         size_t bytes_written;
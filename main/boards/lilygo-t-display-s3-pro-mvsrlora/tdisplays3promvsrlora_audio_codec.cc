@@ -110,11 +110,6 @@ void Tdisplays3promvsrloraAudioCodec::CreateVoiceHardware(gpio_num_t mic_bclk, g
     ESP_LOGI(TAG, "Voice hardware created");
 }
 
-void Tdisplays3promvsrloraAudioCodec::SetOutputVolume(int volume) {
-    volume_ = volume;
-    AudioCodec::SetOutputVolume(volume);
-}
-
 void Tdisplays3promvsrloraAudioCodec::EnableInput(bool enable) {
     gpio_set_level(AUDIO_MIC_ENABLE, !enable);
     AudioCodec::EnableInput(enable);
@@ -140,9 +135,7 @@ int Tdisplays3promvsrloraAudioCodec::Write(const int16_t *data, int samples){
     if (output_enabled_){
         size_t bytes_read;
         auto output_data = (int16_t *)malloc(samples * sizeof(int16_t));
-        for (size_t i = 0; i < samples; i++){
-            output_data[i] = (float)data[i] * (float)(volume_ / 100.0);
-        }
+        output_gain_.Process(data, output_data, samples);
         i2s_channel_write(tx_handle_, output_data, samples * sizeof(int16_t), &bytes_read, portMAX_DELAY);
         free(output_data);
     }
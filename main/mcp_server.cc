@@ -148,6 +148,41 @@ void McpServer::AddUserOnlyTools() {
             return true;
         });
 
+    // Audio latency tracer
+    AddUserOnlyTool("self.audio_tracer.set_enabled", "Enable or disable the audio latency tracer",
+        PropertyList({
+            Property("enabled", kPropertyTypeBoolean)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& tracer = Application::GetInstance().GetAudioService().GetTracer();
+            tracer.SetEnabled(properties["enabled"].value<bool>());
+            return true;
+        });
+
+    AddUserOnlyTool("self.audio_tracer.get_latency",
+        "Get the audio latency added by the device, per pipeline stage, over the last ~30 seconds. "
+        "Uplink stages are measured from the microphone read, downlink stages from the packet arrival.",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& tracer = Application::GetInstance().GetAudioService().GetTracer();
+            cJSON *json = cJSON_CreateObject();
+            cJSON_AddBoolToObject(json, "enabled", tracer.enabled());
+            cJSON *stages = cJSON_CreateObject();
+            for (int i = 0; i < kAudioTraceStageCount; ++i) {
+                auto stage = static_cast<AudioTraceStage>(i);
+                auto percentiles = tracer.GetPercentiles(stage);
+                cJSON *item = cJSON_CreateObject();
+                cJSON_AddNumberToObject(item, "count", percentiles.count);
+                cJSON_AddNumberToObject(item, "p50_us", percentiles.p50_us);
+                cJSON_AddNumberToObject(item, "p90_us", percentiles.p90_us);
+                cJSON_AddNumberToObject(item, "p99_us", percentiles.p99_us);
+                cJSON_AddNumberToObject(item, "max_us", percentiles.max_us);
+                cJSON_AddItemToObject(stages, AudioTracer::StageName(stage), item);
+            }
+            cJSON_AddItemToObject(json, "stages", stages);
+            return json;
+        });
+
     // Firmware upgrade
     AddUserOnlyTool("self.upgrade_firmware", "Upgrade firmware from a specific URL. This will download and install the firmware, then reboot the device.",
         PropertyList({
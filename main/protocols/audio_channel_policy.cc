@@ -0,0 +1,112 @@
+#include "audio_channel_policy.h"
+
+#include <algorithm>
+
+AudioChannelPolicy::AudioChannelPolicy(const AudioChannelBudget& budget)
+    : budget_(budget), budget_ms_(budget.warm_ms_per_period) {
+}
+
+void AudioChannelPolicy::OnInteractionStart(int64_t now_ms, bool channel_open) {
+    Spend(now_ms, channel_open);
+    if (channel_open) {
+        stats_.warm_starts++;
+        if (speculative_) {
+            stats_.prewarm_hits++;
+        }
+    } else {
+        stats_.cold_starts++;
+        if (speculative_) {
+            stats_.prewarm_misses++;
+        }
+    }
+    speculative_ = false;
+    interaction_ms_ = now_ms;
+    interaction_warm_ = channel_open;
+}
+
+void AudioChannelPolicy::OnAudioSent(int64_t now_ms) {
+    if (interaction_ms_ < 0) {
+        return;
+    }
+    auto& ttfab = interaction_warm_ ? stats_.ttfab_warm : stats_.ttfab_cold;
+    uint32_t ms = uint32_t(std::max<int64_t>(now_ms - interaction_ms_, 0));
+    ttfab.count++;
+    ttfab.total_ms += ms;
+    ttfab.max_ms = std::max(ttfab.max_ms, ms);
+    ttfab.last_ms = ms;
+    interaction_ms_ = -1;
+}
+
+void AudioChannelPolicy::OnActive(int64_t now_ms) {
+    if (!idle_) {
+        return;
+    }
+    Spend(now_ms, false);
+    idle_ = false;
+    hold_until_ms_ = -1;
+}
+
+void AudioChannelPolicy::OnIdle(int64_t now_ms) {
+    if (idle_) {
+        return;
+    }
+    Spend(now_ms, false);
+    idle_ = true;
+    hold_until_ms_ = now_ms + budget_.idle_hold_ms;
+    prewarm_tried_ = false;
+    // An interaction that never sent audio (it failed to connect) has no time to first byte
+    interaction_ms_ = -1;
+}
+
+void AudioChannelPolicy::Spend(int64_t now_ms, bool channel_open) {
+    if (last_update_ms_ >= 0) {
+        int64_t elapsed = std::max<int64_t>(now_ms - last_update_ms_, 0);
+        if (idle_ && channel_open) {
+            budget_ms_ -= elapsed;
+            stats_.warm_idle_ms += elapsed;
+        } else {
+            budget_ms_ += elapsed * budget_.warm_ms_per_period / AUDIO_CHANNEL_BUDGET_PERIOD_MS;
+        }
+        budget_ms_ = std::clamp<int64_t>(budget_ms_, 0, budget_.warm_ms_per_period);
+    }
+    last_update_ms_ = now_ms;
+}
+
+AudioChannelAction AudioChannelPolicy::Update(int64_t now_ms, bool channel_open) {
+    Spend(now_ms, channel_open);
+    if (!idle_ || hold_until_ms_ < 0) {
+        return kAudioChannelActionNone;
+    }
+
+    if (channel_open) {
+        bool hold_over = now_ms >= hold_until_ms_;
+        if (!hold_over && budget_ms_ > 0) {
+            return kAudioChannelActionNone;
+        }
+        if (hold_over) {
+            stats_.hold_closes++;
+        } else {
+            stats_.budget_closes++;
+        }
+        if (speculative_) {
+            stats_.prewarm_misses++;
+            speculative_ = false;
+        }
+        hold_until_ms_ = -1;
+        return kAudioChannelActionClose;
+    }
+
+    // Closed by the server or the network while held
+    if (speculative_) {
+        stats_.prewarm_misses++;
+        speculative_ = false;
+    }
+    if (!budget_.prewarm || prewarm_tried_ || hold_until_ms_ - now_ms < AUDIO_CHANNEL_MIN_PREWARM_MS ||
+        budget_ms_ < AUDIO_CHANNEL_MIN_PREWARM_MS) {
+        return kAudioChannelActionNone;
+    }
+    prewarm_tried_ = true;
+    speculative_ = true;
+    stats_.prewarm_opens++;
+    return kAudioChannelActionOpen;
+}
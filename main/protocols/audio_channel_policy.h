@@ -0,0 +1,90 @@
+#ifndef AUDIO_CHANNEL_POLICY_H
+#define AUDIO_CHANNEL_POLICY_H
+
+#include <cstdint>
+
+// The warm budget is spent per this period, and refills over it
+#define AUDIO_CHANNEL_BUDGET_PERIOD_MS 3600000
+// A speculative open needs at least this much budget left, less is not worth the handshake
+#define AUDIO_CHANNEL_MIN_PREWARM_MS 10000
+
+// How long the channel may be kept open while idle, and the power spent on it
+struct AudioChannelBudget {
+    uint32_t idle_hold_ms = 60000;     // After an interaction, 0 closes the channel when it ends
+    uint32_t warm_ms_per_period = 600000;  // Idle time with the channel open per AUDIO_CHANNEL_BUDGET_PERIOD_MS
+    bool prewarm = false;              // Reopen a channel the server closed, for the rest of the hold
+};
+
+enum AudioChannelAction {
+    kAudioChannelActionNone,
+    kAudioChannelActionOpen,   // Speculatively, the device stays idle
+    kAudioChannelActionClose,
+};
+
+// Time to first audio byte: from a wake word or button to the first uplink packet sent
+struct AudioChannelTtfab {
+    uint32_t count = 0;
+    uint64_t total_ms = 0;
+    uint32_t max_ms = 0;
+    uint32_t last_ms = 0;
+};
+
+struct AudioChannelStats {
+    uint32_t warm_starts = 0;       // The channel was open when the interaction started
+    uint32_t cold_starts = 0;
+    uint32_t prewarm_opens = 0;
+    uint32_t prewarm_hits = 0;      // A speculative channel carried the next interaction
+    uint32_t prewarm_misses = 0;    // ...or was closed unused
+    uint32_t hold_closes = 0;       // Closed at the end of the idle hold
+    uint32_t budget_closes = 0;     // Closed early, the warm budget ran out
+    uint64_t warm_idle_ms = 0;      // Idle time with the channel open, the power side of the trade-off
+    AudioChannelTtfab ttfab_warm;
+    AudioChannelTtfab ttfab_cold;
+};
+
+/*
+ * Decides how long the audio channel stays open between interactions.
+ *
+ * Opening the channel costs DNS, TCP, TLS, the WebSocket upgrade (or the MQTT hello and the UDP
+ * setup) and the hello round trip, all before the first audio goes out. After an interaction the
+ * channel is held open for idle_hold_ms, so a follow-up within that time starts warm; with
+ * `prewarm`, a channel the server closed is reopened for the rest of the hold. Idle time with
+ * the channel open is paid from a budget of warm_ms_per_period that refills over the period, so
+ * a device that is talked to all day does not keep its radio awake all day.
+ *
+ * The caller reports the device state and interactions, and asks Update() every second.
+ * Not thread safe.
+ */
+class AudioChannelPolicy {
+public:
+    explicit AudioChannelPolicy(const AudioChannelBudget& budget = AudioChannelBudget());
+
+    // A wake word or button while idle, before the channel is opened
+    void OnInteractionStart(int64_t now_ms, bool channel_open);
+    // The device left idle (connecting, listening, speaking), the channel is in use
+    void OnActive(int64_t now_ms);
+    // Every uplink packet sent, the first one after an interaction start is its time to first audio byte
+    void OnAudioSent(int64_t now_ms);
+    // The device is idle again
+    void OnIdle(int64_t now_ms);
+    AudioChannelAction Update(int64_t now_ms, bool channel_open);
+
+    const AudioChannelStats& stats() const { return stats_; }
+    uint32_t budget_left_ms() const { return uint32_t(budget_ms_); }
+
+private:
+    AudioChannelBudget budget_;
+    AudioChannelStats stats_;
+    bool idle_ = true;
+    int64_t hold_until_ms_ = -1;     // -1 if nothing is held
+    bool prewarm_tried_ = false;     // Once per idle period, a server that keeps closing is not chased
+    bool speculative_ = false;       // Open because of a prewarm, not used yet
+    int64_t interaction_ms_ = -1;    // Start of the interaction waiting for its first audio byte
+    bool interaction_warm_ = false;
+    int64_t budget_ms_;
+    int64_t last_update_ms_ = -1;
+
+    void Spend(int64_t now_ms, bool channel_open);
+};
+
+#endif // AUDIO_CHANNEL_POLICY_H
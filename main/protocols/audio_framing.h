@@ -0,0 +1,118 @@
+#ifndef AUDIO_FRAMING_H
+#define AUDIO_FRAMING_H
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "audio_stream_packet.h"
+
+struct BinaryProtocol2 {
+    uint16_t version;
+    uint16_t type;          // Message type (0: OPUS, 1: JSON)
+    uint32_t reserved;      // Reserved for future use
+    uint32_t timestamp;     // Timestamp in milliseconds (used for server-side AEC)
+    uint32_t payload_size;  // Payload size in bytes
+    uint8_t payload[];      // Payload data
+} __attribute__((packed));
+
+struct BinaryProtocol3 {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t payload_size;
+    uint8_t payload[];
+} __attribute__((packed));
+
+// Room the downlink packets are pooled with, a 60 ms frame of 24 kHz TTS is well below it
+#define INCOMING_AUDIO_POOL_PAYLOAD_BYTES 512
+// Downlink packets kept for reuse: the decode queue and the jitter buffer
+#define INCOMING_AUDIO_POOL_SIZE 48
+
+// The MQTT+UDP nonce in front of every encrypted packet, also the initial AES-CTR counter
+#define UDP_AUDIO_NONCE_SIZE 16
+
+static_assert(sizeof(BinaryProtocol2) <= AUDIO_PACKET_HEADROOM, "BinaryProtocol2 does not fit the packet headroom");
+static_assert(UDP_AUDIO_NONCE_SIZE <= AUDIO_PACKET_HEADROOM, "The UDP nonce does not fit the packet headroom");
+
+/*
+ * Uplink framing of the audio transports.
+ *
+ * The headers are written in place into the packet's headroom (see AudioStreamPacket), so the
+ * Opus data is not copied; afterwards the packet's data() and size() are the whole frame.
+ */
+inline void FrameBinaryProtocol2(AudioStreamPacket& packet, uint16_t version) {
+    uint32_t payload_size = packet.size();
+    auto bp2 = reinterpret_cast<BinaryProtocol2*>(packet.PrependHeader(sizeof(BinaryProtocol2)));
+    bp2->version = htons(version);
+    bp2->type = 0;
+    bp2->reserved = 0;
+    bp2->timestamp = htonl(packet.timestamp);
+    bp2->payload_size = htonl(payload_size);
+}
+
+inline void FrameBinaryProtocol3(AudioStreamPacket& packet) {
+    uint16_t payload_size = packet.size();
+    auto bp3 = reinterpret_cast<BinaryProtocol3*>(packet.PrependHeader(sizeof(BinaryProtocol3)));
+    bp3->type = 0;
+    bp3->reserved = 0;
+    bp3->payload_size = htons(payload_size);
+}
+
+/*
+ * Downlink framing: the Opus data of a received binary frame, copied into a packet from `pool`.
+ *
+ * The frame is only read, not byte-swapped in place. The header's payload_size must fit in
+ * `len`, a frame that claims more is dropped (nullptr); bytes after the payload are ignored.
+ * Version 1 frames are the Opus data alone. Sample rate and frame duration are up to the caller.
+ */
+inline AudioStreamPacketPtr ReadBinaryFrame(FramePool<AudioStreamPacket>& pool, const uint8_t* data, size_t len,
+    int version) {
+    const uint8_t* payload = data;
+    size_t payload_size = len;
+    uint32_t timestamp = 0;
+    if (version == 2) {
+        if (len < sizeof(BinaryProtocol2)) {
+            return nullptr;
+        }
+        auto bp2 = reinterpret_cast<const BinaryProtocol2*>(data);
+        payload = bp2->payload;
+        payload_size = ntohl(bp2->payload_size);
+        timestamp = ntohl(bp2->timestamp);
+        if (payload_size > len - sizeof(BinaryProtocol2)) {
+            return nullptr;
+        }
+    } else if (version == 3) {
+        if (len < sizeof(BinaryProtocol3)) {
+            return nullptr;
+        }
+        auto bp3 = reinterpret_cast<const BinaryProtocol3*>(data);
+        payload = bp3->payload;
+        payload_size = ntohs(bp3->payload_size);
+        if (payload_size > len - sizeof(BinaryProtocol3)) {
+            return nullptr;
+        }
+    }
+
+    auto packet = pool.Acquire();
+    packet->timestamp = timestamp;
+    packet->payload.assign(payload, payload + payload_size);
+    return packet;
+}
+
+// The session nonce from the server with the payload size, timestamp and sequence of this packet
+inline void WriteUdpNonce(uint8_t* nonce, const std::string& session_nonce, uint16_t payload_size,
+    uint32_t timestamp, uint32_t sequence) {
+    std::memset(nonce, 0, UDP_AUDIO_NONCE_SIZE);
+    std::memcpy(nonce, session_nonce.data(), std::min<size_t>(session_nonce.size(), UDP_AUDIO_NONCE_SIZE));
+    payload_size = htons(payload_size);
+    timestamp = htonl(timestamp);
+    sequence = htonl(sequence);
+    std::memcpy(nonce + 2, &payload_size, sizeof(payload_size));
+    std::memcpy(nonce + 8, &timestamp, sizeof(timestamp));
+    std::memcpy(nonce + 12, &sequence, sizeof(sequence));
+}
+
+#endif // AUDIO_FRAMING_H
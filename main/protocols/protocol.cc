@@ -1,14 +1,24 @@
 #include "protocol.h"
 
 #include <esp_log.h>
+#include <mutex>
 
 #define TAG "Protocol"
 
+FramePool<AudioStreamPacket>& Protocol::IncomingPacketPool() {
+    static FramePool<AudioStreamPacket> pool(INCOMING_AUDIO_POOL_SIZE);
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        pool.Initialize(INCOMING_AUDIO_POOL_PAYLOAD_BYTES, 0);
+    });
+    return pool;
+}
+
 void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
     on_incoming_json_ = callback;
 }
 
-void Protocol::OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback) {
+void Protocol::OnIncomingAudio(std::function<void(AudioStreamPacketPtr packet)> callback) {
     on_incoming_audio_ = callback;
 }
 
@@ -78,6 +88,43 @@ void Protocol::SendMcpMessage(const std::string& payload) {
     SendText(message);
 }
 
+void Protocol::SetUplinkProfile(const LinkAudioProfile& profile) {
+    uplink_profile_ = profile;
+    if (!IsAudioChannelOpened()) {
+        return;
+    }
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "session_id", session_id_.c_str());
+    cJSON_AddStringToObject(root, "type", "audio_params");
+    cJSON_AddItemToObject(root, "audio_params", CreateAudioParams());
+    auto json_str = cJSON_PrintUnformatted(root);
+    std::string message(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    SendText(message);
+}
+
+cJSON* Protocol::CreateAudioParams() const {
+    cJSON* audio_params = cJSON_CreateObject();
+    cJSON_AddStringToObject(audio_params, "format", "opus");
+    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
+    cJSON_AddNumberToObject(audio_params, "channels", 1);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", uplink_profile_.frame_duration_ms);
+    // Without a bitrate the encoder runs at the libopus default
+    if (uplink_profile_.bitrate != LINK_AUDIO_BITRATE_AUTO) {
+        cJSON_AddNumberToObject(audio_params, "bitrate", uplink_profile_.bitrate);
+    }
+    cJSON_AddBoolToObject(audio_params, "fec", uplink_profile_.fec);
+    cJSON_AddBoolToObject(audio_params, "dtx", uplink_profile_.dtx);
+    return audio_params;
+}
+
+void Protocol::TakeAudioLinkStats(uint32_t& received, uint32_t& lost) {
+    received = audio_packets_received_.exchange(0);
+    lost = audio_packets_lost_.exchange(0);
+}
+
 bool Protocol::IsTimeout() const {
     const int kTimeoutSeconds = 120;
     auto now = std::chrono::steady_clock::now();
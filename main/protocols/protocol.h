@@ -6,29 +6,11 @@
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <atomic>
 
-struct AudioStreamPacket {
-    int sample_rate = 0;
-    int frame_duration = 0;
-    uint32_t timestamp = 0;
-    std::vector<uint8_t> payload;
-};
-
-struct BinaryProtocol2 {
-    uint16_t version;
-    uint16_t type;          // Message type (0: OPUS, 1: JSON)
-    uint32_t reserved;      // Reserved for future use
-    uint32_t timestamp;     // Timestamp in milliseconds (used for server-side AEC)
-    uint32_t payload_size;  // Payload size in bytes
-    uint8_t payload[];      // Payload data
-} __attribute__((packed));
-
-struct BinaryProtocol3 {
-    uint8_t type;
-    uint8_t reserved;
-    uint16_t payload_size;
-    uint8_t payload[];
-} __attribute__((packed));
+#include "audio_stream_packet.h"
+#include "audio_framing.h"
+#include "link_rate_controller.h"
 
 enum AbortReason {
     kAbortReasonNone,
@@ -54,8 +36,10 @@ public:
     inline const std::string& session_id() const {
         return session_id_;
     }
+    // Downlink packets received and lost since the last call, always lossless on a reliable transport
+    void TakeAudioLinkStats(uint32_t& received, uint32_t& lost);
 
-    void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
+    void OnIncomingAudio(std::function<void(AudioStreamPacketPtr packet)> callback);
     void OnIncomingJson(std::function<void(const cJSON* root)> callback);
     void OnAudioChannelOpened(std::function<void()> callback);
     void OnAudioChannelClosed(std::function<void()> callback);
@@ -67,16 +51,19 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    // Frames the packet in place in its headroom (see audio_framing.h)
+    virtual bool SendAudio(AudioStreamPacketPtr packet) = 0;
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
     virtual void SendAbortSpeaking(AbortReason reason);
     virtual void SendMcpMessage(const std::string& message);
+    // Announced in the hello message, and in an audio_params message if the audio channel is open
+    void SetUplinkProfile(const LinkAudioProfile& profile);
 
 protected:
     std::function<void(const cJSON* root)> on_incoming_json_;
-    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> on_incoming_audio_;
+    std::function<void(AudioStreamPacketPtr packet)> on_incoming_audio_;
     std::function<void()> on_audio_channel_opened_;
     std::function<void()> on_audio_channel_closed_;
     std::function<void(const std::string& message)> on_network_error_;
@@ -88,6 +75,14 @@ protected:
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    LinkAudioProfile uplink_profile_ = LinkRateController::ProfileOf(kLinkQualityNormal);
+    // Where received audio packets come from. It outlives the protocol, packets may still be queued
+    static FramePool<AudioStreamPacket>& IncomingPacketPool();
+    // Updated by the transport's receive task
+    std::atomic<uint32_t> audio_packets_received_{0};
+    std::atomic<uint32_t> audio_packets_lost_{0};
+
+    cJSON* CreateAudioParams() const;
 
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
@@ -0,0 +1,113 @@
+#include "udp_audio_crypto.h"
+
+#include <esp_log.h>
+
+#include <cstring>
+
+#define TAG "UdpAudioCrypto"
+
+UdpAudioCrypto::UdpAudioCrypto() {
+    mbedtls_aes_init(&aes_);
+}
+
+UdpAudioCrypto::~UdpAudioCrypto() {
+    mbedtls_aes_free(&aes_);
+}
+
+const char* UdpAudioCrypto::ResultName(UdpAudioOpenResult result) {
+    switch (result) {
+        case kUdpAudioOpenOk: return "ok";
+        case kUdpAudioOpenInvalid: return "invalid";
+        case kUdpAudioOpenReplayed: return "replayed";
+        case kUdpAudioOpenTooOld: return "too_old";
+        case kUdpAudioOpenFailed: return "failed";
+        default: return "unknown";
+    }
+}
+
+bool UdpAudioCrypto::Configure(const std::string& key, const std::string& nonce) {
+    configured_ = false;
+    if (key.size() != UDP_AUDIO_KEY_SIZE || nonce.size() != UDP_AUDIO_NONCE_SIZE) {
+        ESP_LOGE(TAG, "Invalid key (%u bytes) or nonce (%u bytes)", key.size(), nonce.size());
+        return false;
+    }
+    if (mbedtls_aes_setkey_enc(&aes_, reinterpret_cast<const unsigned char*>(key.data()), 128) != 0) {
+        ESP_LOGE(TAG, "Failed to set the key");
+        return false;
+    }
+    nonce_ = nonce;
+    local_sequence_ = 0;
+    window_.Reset();
+    configured_ = true;
+    return true;
+}
+
+bool UdpAudioCrypto::Crypt(const uint8_t* nonce, const uint8_t* input, size_t size, uint8_t* output) {
+    // The cipher advances the counter block, the nonce itself stays as it is
+    uint8_t counter[UDP_AUDIO_NONCE_SIZE];
+    uint8_t stream_block[16];
+    size_t nc_off = 0;
+    std::memcpy(counter, nonce, sizeof(counter));
+    return mbedtls_aes_crypt_ctr(&aes_, size, &nc_off, counter, stream_block, input, output) == 0;
+}
+
+const std::string* UdpAudioCrypto::Seal(const uint8_t* payload, size_t size, uint32_t timestamp) {
+    if (!configured_) {
+        return nullptr;
+    }
+    frame_.resize(UDP_AUDIO_NONCE_SIZE + size);
+    auto frame = reinterpret_cast<uint8_t*>(frame_.data());
+    WriteUdpNonce(frame, nonce_, size, timestamp, ++local_sequence_);
+    if (!Crypt(frame, payload, size, frame + UDP_AUDIO_NONCE_SIZE)) {
+        return nullptr;
+    }
+    stats_.sealed++;
+    return &frame_;
+}
+
+UdpAudioOpenResult UdpAudioCrypto::Open(const uint8_t* frame, size_t size, std::vector<uint8_t>& payload,
+    UdpAudioHeader& header) {
+    /*
+     * UDP Encrypted OPUS Packet Format:
+     * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
+     * |payload payload_len|
+     */
+    if (size < UDP_AUDIO_NONCE_SIZE || frame[0] != UDP_AUDIO_PACKET_TYPE) {
+        stats_.invalid++;
+        return kUdpAudioOpenInvalid;
+    }
+    uint32_t timestamp;
+    uint32_t sequence;
+    std::memcpy(&timestamp, frame + 8, sizeof(timestamp));
+    std::memcpy(&sequence, frame + 12, sizeof(sequence));
+    header.timestamp = ntohl(timestamp);
+    header.sequence = ntohl(sequence);
+    if (header.sequence == 0) {
+        stats_.invalid++;
+        return kUdpAudioOpenInvalid;
+    }
+    if (!configured_) {
+        return kUdpAudioOpenFailed;
+    }
+
+    auto result = window_.Check(header.sequence);
+    if (result == kUdpAudioOpenReplayed) {
+        stats_.replayed++;
+        return result;
+    } else if (result == kUdpAudioOpenTooOld) {
+        stats_.too_old++;
+        return result;
+    }
+
+    size_t payload_size = size - UDP_AUDIO_NONCE_SIZE;
+    payload.resize(payload_size);
+    if (!Crypt(frame, frame + UDP_AUDIO_NONCE_SIZE, payload_size, payload.data())) {
+        return kUdpAudioOpenFailed;
+    }
+    if (window_.highest() != 0 && static_cast<int32_t>(header.sequence - window_.highest()) < 0) {
+        stats_.reordered++;
+    }
+    window_.Accept(header.sequence);
+    stats_.opened++;
+    return kUdpAudioOpenOk;
+}
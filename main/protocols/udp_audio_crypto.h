@@ -0,0 +1,141 @@
+#ifndef UDP_AUDIO_CRYPTO_H
+#define UDP_AUDIO_CRYPTO_H
+
+#include <mbedtls/aes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_framing.h"
+
+// Received sequence numbers remembered behind the highest one; older packets are dropped
+#define UDP_AUDIO_REPLAY_WINDOW 64
+#define UDP_AUDIO_PACKET_TYPE 0x01
+#define UDP_AUDIO_KEY_SIZE 16
+
+enum UdpAudioOpenResult {
+    kUdpAudioOpenOk,
+    kUdpAudioOpenInvalid,   // Not an audio packet, or no sequence number
+    kUdpAudioOpenReplayed,  // Already received
+    kUdpAudioOpenTooOld,    // Behind the replay window
+    kUdpAudioOpenFailed,    // The cipher failed, or the session has no key
+};
+
+/*
+ * Sliding replay window over the received sequence numbers, as in RFC 4303.
+ *
+ * A bitmap remembers which of the last UDP_AUDIO_REPLAY_WINDOW sequence numbers arrived, so a
+ * packet that is only reordered is accepted while a duplicate is not. Sequence numbers are
+ * compared modulo 2^32.
+ */
+class UdpReplayWindow {
+public:
+    void Reset() {
+        highest_ = 0;
+        bitmap_ = 0;
+    }
+
+    UdpAudioOpenResult Check(uint32_t sequence) const {
+        if (highest_ == 0) {
+            return kUdpAudioOpenOk;
+        }
+        int32_t ahead = static_cast<int32_t>(sequence - highest_);
+        if (ahead > 0) {
+            return kUdpAudioOpenOk;
+        }
+        uint32_t behind = static_cast<uint32_t>(-static_cast<int64_t>(ahead));
+        if (behind >= UDP_AUDIO_REPLAY_WINDOW) {
+            return kUdpAudioOpenTooOld;
+        }
+        return (bitmap_ >> behind) & 1 ? kUdpAudioOpenReplayed : kUdpAudioOpenOk;
+    }
+
+    // Only for a packet that passed Check() and was decrypted
+    void Accept(uint32_t sequence) {
+        if (highest_ == 0) {
+            highest_ = sequence;
+            bitmap_ = 1;
+            return;
+        }
+        int32_t ahead = static_cast<int32_t>(sequence - highest_);
+        if (ahead > 0) {
+            bitmap_ = ahead >= UDP_AUDIO_REPLAY_WINDOW ? 0 : bitmap_ << ahead;
+            bitmap_ |= 1;
+            highest_ = sequence;
+        } else {
+            bitmap_ |= uint64_t(1) << -ahead;
+        }
+    }
+
+    uint32_t highest() const { return highest_; }
+
+private:
+    uint32_t highest_ = 0;  // 0 before the first packet, the server starts at 1
+    uint64_t bitmap_ = 0;   // Bit n: highest_ - n arrived
+};
+
+struct UdpAudioCryptoStats {
+    uint32_t sealed = 0;
+    uint32_t opened = 0;
+    uint32_t reordered = 0;  // Opened although behind the highest sequence
+    uint32_t invalid = 0;
+    uint32_t replayed = 0;
+    uint32_t too_old = 0;
+};
+
+// The header of an opened packet
+struct UdpAudioHeader {
+    uint32_t timestamp = 0;
+    uint32_t sequence = 0;
+};
+
+/*
+ * AES-128-CTR session of the MQTT+UDP audio channel.
+ *
+ * Every packet is the 16-byte nonce (the session nonce from the server hello with the payload
+ * size, timestamp and sequence filled in), which is also the initial counter block, followed by
+ * the encrypted Opus data. The key schedule is set up once per session and the send frame is
+ * kept between packets, so sealing and opening a packet do not allocate.
+ *
+ * The cipher is mbedtls, which ESP-IDF maps to the AES peripheral (with DMA on chips that have
+ * it) when CONFIG_MBEDTLS_HARDWARE_AES is set, the default.
+ *
+ * Seal() is called by the sending task and Open() by the receive task; they share only the key.
+ */
+class UdpAudioCrypto {
+public:
+    UdpAudioCrypto();
+    ~UdpAudioCrypto();
+
+    UdpAudioCrypto(const UdpAudioCrypto&) = delete;
+    UdpAudioCrypto& operator=(const UdpAudioCrypto&) = delete;
+
+    // Raw key and nonce bytes from the server hello; restarts both sequences
+    bool Configure(const std::string& key, const std::string& nonce);
+
+    // The frame to send, valid until the next call; nullptr if it could not be encrypted
+    const std::string* Seal(const uint8_t* payload, size_t size, uint32_t timestamp);
+    // Checks the header and the replay window, then decrypts into `payload`
+    UdpAudioOpenResult Open(const uint8_t* frame, size_t size, std::vector<uint8_t>& payload,
+        UdpAudioHeader& header);
+
+    const UdpAudioCryptoStats& stats() const { return stats_; }
+    static const char* ResultName(UdpAudioOpenResult result);
+
+private:
+    mbedtls_aes_context aes_;
+    bool configured_ = false;
+    std::string nonce_;
+    // Send side
+    std::string frame_;
+    uint32_t local_sequence_ = 0;
+    // Receive side
+    UdpReplayWindow window_;
+    UdpAudioCryptoStats stats_;
+
+    bool Crypt(const uint8_t* nonce, const uint8_t* input, size_t size, uint8_t* output);
+};
+
+#endif // UDP_AUDIO_CRYPTO_H
@@ -1,54 +1,168 @@
 import socket
+import struct
 import wave
 import argparse
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Receive the audio debug recording of the device (CONFIG_USE_AUDIO_DEBUGGER) on UDP port 8000
+  and save every tap (mic, ref, afe, down) to its own WAV file.
+
+  Every datagram starts with a 20 byte little-endian header (main/audio/audio_debug_recorder.h):
+    "XA", version, tap, codec (0 = PCM, 1 = Opus), flags, trigger number,
+    sample rate, sequence number, capture time in milliseconds
+  Taps are aligned by the capture time: lost or dropped audio is filled with silence, so the files
+  of one recording line up sample for sample. With triggered recording, every trigger goes to new files.
+
+  Datagrams without the header are the raw PCM of older firmware and go to one file as before.
 '''
-def main(samplerate, channels):
+
+HEADER = struct.Struct('<2sBBBBHIII')
+MAGIC = b'XA'
+VERSION = 1
+TAP_NAMES = ['mic', 'ref', 'afe', 'down']
+CODEC_PCM = 0
+CODEC_OPUS = 1
+# Capture times are taken when the frames reach the recorder: unless datagrams are missing,
+# gaps smaller than this are jitter
+GAP_TOLERANCE_MS = 30
+
+
+class TapWriter:
+    def __init__(self, filename, sample_rate, start_ms):
+        self.filename = filename
+        self.sample_rate = sample_rate
+        self.start_ms = start_ms
+        self.samples = 0
+        self.filled = 0
+        self.lost = 0
+        self.sequence = None
+        self.decoder = None
+        self.wav = wave.open(filename, 'wb')
+        self.wav.setnchannels(1)
+        self.wav.setsampwidth(2)
+        self.wav.setframerate(sample_rate)
+
+    def write(self, sequence, time_ms, pcm):
+        lost = self.sequence is not None and sequence != (self.sequence + 1) & 0xffffffff
+        if lost:
+            self.lost += (sequence - self.sequence - 1) & 0xffffffff
+        self.sequence = sequence
+
+        # Pad up to the capture time of this datagram, overlaps are only jitter and written as they come
+        expected_ms = self.start_ms + self.samples * 1000 // self.sample_rate
+        gap_ms = (time_ms - expected_ms + 2**31) % 2**32 - 2**31
+        if gap_ms > GAP_TOLERANCE_MS or (lost and gap_ms > 0):
+            silence = gap_ms * self.sample_rate // 1000
+            self.wav.writeframes(b'\0\0' * silence)
+            self.samples += silence
+            self.filled += silence
+        self.wav.writeframes(pcm)
+        self.samples += len(pcm) // 2
+
+    def close(self):
+        self.wav.close()
+        print(f"Saved {self.filename}: {self.samples / self.sample_rate:.1f}s, "
+              f"{self.filled / self.sample_rate:.1f}s filled with silence, {self.lost} datagrams lost")
+
+
+def create_opus_decoder(sample_rate):
+    try:
+        import opuslib
+    except ImportError:
+        raise SystemExit("The device sends Opus (CONFIG_AUDIO_DEBUG_OPUS), install opuslib: pip install opuslib")
+    return opuslib.Decoder(sample_rate, 1)
+
+
+class Recording:
+    def __init__(self, prefix):
+        self.prefix = prefix
+        self.writers = {}
+        self.trigger = None
+        # Shared by all taps, so that their files start at the same time
+        self.start_ms = None
+
+    def handle(self, tap, codec, flags, trigger, sample_rate, sequence, time_ms, payload):
+        if trigger != self.trigger:
+            self.close()
+            self.trigger = trigger
+            print(f"Trigger {trigger}" if trigger else "Recording")
+        writer = self.writers.get(tap)
+        if writer is not None and writer.sample_rate != sample_rate:
+            writer.close()
+            writer = None
+        if writer is None:
+            if self.start_ms is None:
+                self.start_ms = time_ms
+            name = TAP_NAMES[tap] if tap < len(TAP_NAMES) else f"tap{tap}"
+            suffix = f"_{trigger}" if trigger else ""
+            writer = TapWriter(f"{self.prefix}{name}{suffix}_{sample_rate}.wav", sample_rate, self.start_ms)
+            self.writers[tap] = writer
+
+        if codec == CODEC_OPUS:
+            if writer.decoder is None:
+                writer.decoder = create_opus_decoder(sample_rate)
+            pcm = writer.decoder.decode(payload, sample_rate * 60 // 1000)
+        elif codec == CODEC_PCM:
+            pcm = payload
+        else:
+            return
+        writer.write(sequence, time_ms, pcm)
+
+    def close(self):
+        for writer in self.writers.values():
+            writer.close()
+        self.writers = {}
+        self.start_ms = None
+
+
+def main(samplerate, channels, port, prefix):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
+    server_socket.bind(('0.0.0.0', port))
 
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
-
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    recording = Recording(prefix)
+    raw_wav = None
+    print(f"Start saving audio from 0.0.0.0:{port}...")
 
     try:
         while True:
-            # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+            message, address = server_socket.recvfrom(2048)
+            if len(message) >= HEADER.size and message[:2] == MAGIC and message[2] == VERSION:
+                _, _, tap, codec, flags, trigger, sample_rate, sequence, time_ms = HEADER.unpack_from(message)
+                recording.handle(tap, codec, flags, trigger, sample_rate, sequence, time_ms, message[HEADER.size:])
+                continue
+
+            # Firmware without the recorder sends headerless PCM
+            if raw_wav is None:
+                filename = f"{samplerate}_{channels}.wav"
+                raw_wav = wave.open(filename, "wb")
+                raw_wav.setnchannels(channels)
+                raw_wav.setsampwidth(2)
+                raw_wav.setframerate(samplerate)
+                print(f"Raw PCM from {address}, saving to {filename}")
+            raw_wav.writeframes(message)
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
-        # Close files and socket
-        wav_file.close()
+        recording.close()
+        if raw_wav is not None:
+            raw_wav.close()
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP音频调试数据接收器，每个采集点保存为一个WAV文件')
+    parser.add_argument('--samplerate', '-s', type=int, default=16000,
+                        help='无包头的原始 PCM 的采样率 (默认: 16000)')
+    parser.add_argument('--channels', '-c', type=int, default=2,
+                        help='无包头的原始 PCM 的声道数 (默认: 2)')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='UDP 端口 (默认: 8000)')
+    parser.add_argument('--prefix', default='',
+                        help='输出文件名前缀')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.samplerate, args.channels, args.port, args.prefix)
@@ -0,0 +1,317 @@
+#include "afsk_demod.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_wifi_config;
+
+namespace {
+
+const std::string kCredentials = "Xiaozhi-Lab 5G\nsecret pass-1234";
+
+// What scripts/sonic_wifi_config.html sends, as tone indices; older pages sent no AFSK preamble
+std::vector<uint8_t> BuildSymbols(SonicMode mode, const std::string& text, bool afsk_preamble = true) {
+    std::vector<uint8_t> symbols;
+    if (mode == SonicMode::kAfsk100) {
+        std::vector<uint8_t> bytes = {0x01, 0x02};
+        if (afsk_preamble) {
+            bytes.insert(bytes.begin(), {0x55, 0x55});
+        }
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        bytes.push_back(AudioDataBuffer::CalculateChecksum(text));
+        bytes.push_back(0x03);
+        bytes.push_back(0x04);
+        for (uint8_t byte : bytes) {
+            for (int bit = 7; bit >= 0; bit--) {
+                symbols.push_back((byte >> bit) & 1);
+            }
+        }
+        return symbols;
+    }
+
+    symbols.assign(std::begin(MfskFrameDecoder::kPreamble), std::end(MfskFrameDecoder::kPreamble));
+    symbols.insert(symbols.end(), std::begin(MfskFrameDecoder::kSync), std::end(MfskFrameDecoder::kSync));
+
+    uint8_t header[ReedSolomon15::kDataLength] = {MfskFrameDecoder::kVersion, uint8_t(text.size() >> 4),
+        uint8_t(text.size() & 0x0F)};
+    uint8_t codeword[ReedSolomon15::kLength];
+    ReedSolomon15::Encode(header, codeword);
+    for (uint8_t nibble : codeword) {
+        symbols.push_back(nibble);
+    }
+
+    std::vector<uint8_t> bytes(text.begin(), text.end());
+    uint16_t crc = Crc16(bytes.data(), bytes.size());
+    bytes.push_back(crc >> 8);
+    bytes.push_back(crc & 0xFF);
+    std::vector<uint8_t> nibbles;
+    for (uint8_t byte : bytes) {
+        nibbles.push_back(byte >> 4);
+        nibbles.push_back(byte & 0x0F);
+    }
+    size_t codewords = (nibbles.size() + ReedSolomon15::kDataLength - 1) / ReedSolomon15::kDataLength;
+    nibbles.resize(codewords * ReedSolomon15::kDataLength, 0);
+    std::vector<uint8_t> encoded(codewords * ReedSolomon15::kLength);
+    for (size_t j = 0; j < codewords; j++) {
+        ReedSolomon15::Encode(&nibbles[j * ReedSolomon15::kDataLength], &encoded[j * ReedSolomon15::kLength]);
+    }
+    for (size_t i = 0; i < ReedSolomon15::kLength; i++) {
+        for (size_t j = 0; j < codewords; j++) {
+            symbols.push_back(encoded[j * ReedSolomon15::kLength + i]);
+        }
+    }
+    symbols.push_back(0);
+    symbols.push_back(0);
+    return symbols;
+}
+
+// How the captures are made: a phone plays the page in a room, the device records at 16 kHz
+struct Channel {
+    float gain = 0.3f;
+    float snr_db = 20.0f;
+    double clock_ppm = 0.0;     // Sender clock against the microphone clock
+    bool echoes = false;        // Reflections at 4 ms and 11 ms
+    size_t lead_samples = 8000;
+    uint32_t seed = 1;
+};
+
+std::vector<int16_t> Capture(SonicMode mode, const std::vector<uint8_t>& symbols, const Channel& channel, int repeats = 1) {
+    const auto& config = GetSonicModeConfig(mode);
+    double symbol_seconds = double(config.symbol_samples) / kAudioSampleRate;
+    double bin_hz = double(kAudioSampleRate) / config.symbol_samples;
+    double speed = 1.0 + channel.clock_ppm * 1e-6;
+
+    std::vector<float> clean(channel.lead_samples, 0.0f);
+    for (int r = 0; r < repeats; r++) {
+        size_t samples = size_t(symbols.size() * symbol_seconds * kAudioSampleRate / speed);
+        double phase = 0.0;
+        for (size_t n = 0; n < samples; n++) {
+            // Time on the sender's clock at the n-th microphone sample
+            double t = n * speed / kAudioSampleRate;
+            size_t index = std::min(symbols.size() - 1, size_t(t / symbol_seconds));
+            double frequency = (config.first_bin + symbols[index] * config.bin_step) * bin_hz;
+            phase += 2.0 * M_PI * frequency * speed / kAudioSampleRate;
+            clean.push_back(float(std::sin(phase)));
+        }
+        clean.resize(clean.size() + 4000, 0.0f);
+    }
+
+    std::vector<float> room(clean);
+    if (channel.echoes) {
+        for (size_t n = 0; n < room.size(); n++) {
+            if (n >= 64) room[n] += 0.5f * clean[n - 64];
+            if (n >= 176) room[n] += 0.25f * clean[n - 176];
+        }
+    }
+
+    std::mt19937 random(channel.seed);
+    float noise_rms = channel.gain * std::sqrt(0.5f) / std::pow(10.0f, channel.snr_db / 20.0f);
+    std::normal_distribution<float> noise(0.0f, noise_rms);
+    std::vector<int16_t> pcm(room.size());
+    for (size_t n = 0; n < room.size(); n++) {
+        float value = (channel.gain * room[n] + noise(random)) * 32767.0f;
+        pcm[n] = int16_t(std::max(-32768.0f, std::min(32767.0f, value)));
+    }
+    return pcm;
+}
+
+// Fed in 30 ms blocks like ReceiveWifiCredentialsFromAudio() does
+std::vector<std::string> Receive(SonicReceiver& receiver, const std::vector<int16_t>& pcm, SonicMode* mode = nullptr) {
+    std::vector<std::string> texts;
+    for (size_t offset = 0; offset < pcm.size(); offset += 480) {
+        size_t count = std::min<size_t>(480, pcm.size() - offset);
+        if (receiver.ProcessSamples(pcm.data() + offset, count)) {
+            texts.push_back(*receiver.decoded_text);
+            if (mode != nullptr) {
+                *mode = receiver.decoded_mode;
+            }
+            receiver.decoded_text.reset();
+        }
+    }
+    return texts;
+}
+
+TEST(SlidingGoertzelTest, MatchesTheDftOfTheLastWindow) {
+    const size_t window = 160;
+    SlidingGoertzelBank bank;
+    bank.Configure(window, 8, 3, 5);
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<float> signal(5000);
+    for (auto& sample : signal) {
+        sample = uniform(random);
+    }
+
+    for (size_t n = 0; n < signal.size(); n++) {
+        bank.ProcessSample(signal[n]);
+        if (n < window || n % 37 != 0) {
+            continue;
+        }
+        for (size_t tone = 0; tone < 5; tone++) {
+            double w = 2.0 * M_PI * (8 + 3 * tone) / window;
+            std::complex<double> sum = 0.0;
+            for (size_t m = 0; m < window; m++) {
+                sum += double(signal[n - m]) * std::polar(std::pow(0.9999, double(m)), w * m);
+            }
+            EXPECT_NEAR(bank.GetPower(tone), std::norm(sum), 1e-3 * std::norm(sum) + 1e-2) << "n " << n;
+        }
+    }
+}
+
+TEST(ReedSolomonTest, CorrectsUpToTwoWrongNibbles) {
+    std::mt19937 random(3);
+    for (int trial = 0; trial < 500; trial++) {
+        uint8_t data[ReedSolomon15::kDataLength];
+        for (auto& nibble : data) {
+            nibble = random() & 0x0F;
+        }
+        uint8_t sent[ReedSolomon15::kLength];
+        ReedSolomon15::Encode(data, sent);
+        ASSERT_EQ(ReedSolomon15::Decode(std::vector<uint8_t>(sent, sent + 15).data()), 0);
+
+        int errors = trial % 3;
+        uint8_t received[ReedSolomon15::kLength];
+        std::copy(sent, sent + 15, received);
+        size_t first = random() % 15;
+        size_t second = (first + 1 + random() % 14) % 15;
+        if (errors >= 1) received[first] ^= 1 + random() % 15;
+        if (errors >= 2) received[second] ^= 1 + random() % 15;
+
+        ASSERT_EQ(ReedSolomon15::Decode(received), errors) << "trial " << trial;
+        EXPECT_TRUE(std::equal(sent, sent + 15, received)) << "trial " << trial;
+    }
+}
+
+TEST(ReedSolomonTest, ReportsThreeWrongNibblesOrAnotherCodeword) {
+    std::mt19937 random(5);
+    int detected = 0;
+    for (int trial = 0; trial < 500; trial++) {
+        uint8_t data[ReedSolomon15::kDataLength];
+        for (auto& nibble : data) {
+            nibble = random() & 0x0F;
+        }
+        uint8_t sent[ReedSolomon15::kLength];
+        ReedSolomon15::Encode(data, sent);
+        uint8_t received[ReedSolomon15::kLength];
+        std::copy(sent, sent + 15, received);
+        for (size_t i = 0; i < 3; i++) {
+            received[(trial + 5 * i) % 15] ^= 1 + random() % 15;
+        }
+        int result = ReedSolomon15::Decode(received);
+        if (result < 0) {
+            detected++;
+        } else {
+            // Never "corrected" back to what was sent, and always to a valid codeword
+            EXPECT_FALSE(std::equal(sent, sent + 15, received));
+            EXPECT_EQ(ReedSolomon15::Decode(received), 0);
+        }
+    }
+    EXPECT_GT(detected, 0);
+}
+
+class SonicModeTest : public testing::TestWithParam<SonicMode> {};
+
+TEST_P(SonicModeTest, DecodesACleanCapture) {
+    SonicReceiver receiver;
+    SonicMode mode = SonicMode::kCount;
+    Channel channel;
+    channel.snr_db = 40.0f;
+    auto texts = Receive(receiver, Capture(GetParam(), BuildSymbols(GetParam(), kCredentials), channel), &mode);
+    ASSERT_EQ(texts.size(), 1u);
+    EXPECT_EQ(texts[0], kCredentials);
+    EXPECT_EQ(mode, GetParam());
+}
+
+TEST_P(SonicModeTest, DecodesANoisyRoomCapture) {
+    // 10 dB SNR with reflections and a 300 ppm sender clock, every seed must decode
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        Channel channel;
+        channel.snr_db = 10.0f;
+        channel.echoes = true;
+        channel.clock_ppm = 300.0;
+        channel.lead_samples = 3000 + seed * 1013;
+        channel.seed = seed;
+        SonicReceiver receiver;
+        auto texts = Receive(receiver, Capture(GetParam(), BuildSymbols(GetParam(), kCredentials), channel));
+        ASSERT_EQ(texts.size(), 1u) << "seed " << seed;
+        EXPECT_EQ(texts[0], kCredentials) << "seed " << seed;
+    }
+}
+
+TEST_P(SonicModeTest, DecodesEveryRepetitionOfALoop) {
+    SonicReceiver receiver;
+    Channel channel;
+    channel.snr_db = 20.0f;
+    auto texts = Receive(receiver, Capture(GetParam(), BuildSymbols(GetParam(), kCredentials), channel, 3));
+    ASSERT_EQ(texts.size(), 3u);
+    for (auto& text : texts) {
+        EXPECT_EQ(text, kCredentials);
+    }
+}
+
+TEST_P(SonicModeTest, IgnoresATruncatedCapture) {
+    SonicReceiver receiver;
+    auto pcm = Capture(GetParam(), BuildSymbols(GetParam(), kCredentials), Channel());
+    pcm.resize(pcm.size() * 2 / 3);
+    EXPECT_TRUE(Receive(receiver, pcm).empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, SonicModeTest,
+    testing::Values(SonicMode::kAfsk100, SonicMode::kMfsk16Robust, SonicMode::kMfsk16Fast),
+    [](const testing::TestParamInfo<SonicMode>& info) {
+        switch (info.param) {
+        case SonicMode::kAfsk100: return std::string("Afsk100");
+        case SonicMode::kMfsk16Robust: return std::string("Mfsk16Robust");
+        default: return std::string("Mfsk16Fast");
+        }
+    });
+
+TEST(SonicReceiverTest, DecodesAfskFromPagesWithoutPreamble) {
+    SonicReceiver receiver;
+    Channel channel;
+    channel.snr_db = 30.0f;
+    auto texts = Receive(receiver, Capture(SonicMode::kAfsk100, BuildSymbols(SonicMode::kAfsk100, kCredentials, false),
+        channel, 2));
+    ASSERT_FALSE(texts.empty());
+    EXPECT_EQ(texts.back(), kCredentials);
+}
+
+TEST(SonicReceiverTest, CorrectsSymbolsLostToAKnock) {
+    // A 40 ms burst over a fast frame: the interleaving turns it into one error per codeword
+    Channel channel;
+    channel.snr_db = 30.0f;
+    auto pcm = Capture(SonicMode::kMfsk16Fast, BuildSymbols(SonicMode::kMfsk16Fast, kCredentials), channel);
+    size_t start = channel.lead_samples + (8 + 6 + 15 + 20) * 160;
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> knock(-20000, 20000);
+    for (size_t n = start; n < start + 640; n++) {
+        pcm[n] = int16_t(knock(random));
+    }
+
+    SonicReceiver receiver;
+    auto texts = Receive(receiver, pcm);
+    ASSERT_EQ(texts.size(), 1u);
+    EXPECT_EQ(texts[0], kCredentials);
+    EXPECT_GT(receiver.corrected_symbols, 0u);
+}
+
+TEST(SonicReceiverTest, StaysQuietOnNoise) {
+    Channel channel;
+    channel.gain = 0.0f;
+    SonicReceiver receiver;
+    std::mt19937 random(13);
+    std::normal_distribution<float> noise(0.0f, 3000.0f);
+    std::vector<int16_t> pcm(kAudioSampleRate * 20);
+    for (auto& sample : pcm) {
+        sample = int16_t(noise(random));
+    }
+    EXPECT_TRUE(Receive(receiver, pcm).empty());
+}
+
+} // namespace
@@ -0,0 +1,210 @@
+#include "audio_channel_policy.h"
+
+#include <gtest/gtest.h>
+
+static AudioChannelBudget MakeBudget(uint32_t hold_ms, uint32_t warm_ms, bool prewarm = false) {
+    AudioChannelBudget budget;
+    budget.idle_hold_ms = hold_ms;
+    budget.warm_ms_per_period = warm_ms;
+    budget.prewarm = prewarm;
+    return budget;
+}
+
+// Drives the policy the way Application does, with Update() every second while idle
+struct Device {
+    AudioChannelPolicy policy;
+    bool open = false;
+    int64_t now = 0;
+
+    explicit Device(const AudioChannelBudget& budget) : policy(budget) {
+        policy.Update(now, open);
+    }
+
+    void Interact(int64_t duration_ms, int64_t connect_ms = 300) {
+        policy.OnInteractionStart(now, open);
+        policy.OnActive(now);
+        if (!open) {
+            now += connect_ms;
+            open = true;
+        }
+        policy.OnAudioSent(now + 5);
+        now += duration_ms;
+        policy.OnIdle(now);
+    }
+
+    // Returns the first action taken
+    AudioChannelAction IdleFor(int64_t ms) {
+        AudioChannelAction first = kAudioChannelActionNone;
+        for (int64_t end = now + ms; now < end;) {
+            now += 1000;
+            auto action = policy.Update(now, open);
+            if (action == kAudioChannelActionClose) {
+                open = false;
+            } else if (action == kAudioChannelActionOpen) {
+                open = true;
+            }
+            if (first == kAudioChannelActionNone) {
+                first = action;
+            }
+        }
+        return first;
+    }
+};
+
+TEST(AudioChannelPolicyTest, ClosesAfterTheHold) {
+    Device device(MakeBudget(60000, 600000));
+    device.Interact(5000);
+    EXPECT_EQ(device.IdleFor(59000), kAudioChannelActionNone);
+    EXPECT_TRUE(device.open);
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionClose);
+    EXPECT_FALSE(device.open);
+    EXPECT_EQ(device.policy.stats().hold_closes, 1u);
+    EXPECT_EQ(device.policy.stats().warm_idle_ms, 60000u);
+    // Nothing more to do until the next interaction
+    EXPECT_EQ(device.IdleFor(120000), kAudioChannelActionNone);
+}
+
+TEST(AudioChannelPolicyTest, ZeroHoldClosesAtOnce) {
+    Device device(MakeBudget(0, 600000));
+    device.Interact(5000);
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionClose);
+    EXPECT_EQ(device.policy.stats().hold_closes, 1u);
+}
+
+TEST(AudioChannelPolicyTest, FollowUpWithinTheHoldIsWarm) {
+    Device device(MakeBudget(60000, 600000));
+    device.Interact(5000);
+    device.IdleFor(20000);
+    device.Interact(5000);
+    auto& stats = device.policy.stats();
+    EXPECT_EQ(stats.cold_starts, 1u);
+    EXPECT_EQ(stats.warm_starts, 1u);
+    EXPECT_EQ(stats.ttfab_cold.count, 1u);
+    EXPECT_EQ(stats.ttfab_cold.last_ms, 305u);
+    EXPECT_EQ(stats.ttfab_warm.count, 1u);
+    EXPECT_EQ(stats.ttfab_warm.last_ms, 5u);
+}
+
+TEST(AudioChannelPolicyTest, TimeToFirstByteOncePerInteraction) {
+    AudioChannelPolicy policy;
+    policy.Update(0, false);
+    policy.OnInteractionStart(0, false);
+    policy.OnActive(0);
+    policy.OnAudioSent(400);
+    policy.OnAudioSent(460);
+    policy.OnAudioSent(520);
+    EXPECT_EQ(policy.stats().ttfab_cold.count, 1u);
+    EXPECT_EQ(policy.stats().ttfab_cold.max_ms, 400u);
+
+    // Failed to connect, no audio: nothing is recorded, and the next packet is not counted
+    policy.OnIdle(1000);
+    policy.OnInteractionStart(2000, false);
+    policy.OnActive(2000);
+    policy.OnIdle(7000);
+    policy.OnAudioSent(8000);
+    EXPECT_EQ(policy.stats().ttfab_cold.count, 1u);
+    EXPECT_EQ(policy.stats().cold_starts, 2u);
+}
+
+TEST(AudioChannelPolicyTest, EmptyBudgetClosesEarly) {
+    Device device(MakeBudget(60000, 30000));
+    device.Interact(5000);
+    EXPECT_EQ(device.IdleFor(29000), kAudioChannelActionNone);
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionClose);
+    EXPECT_EQ(device.policy.stats().budget_closes, 1u);
+    EXPECT_EQ(device.policy.stats().hold_closes, 0u);
+    EXPECT_EQ(device.policy.budget_left_ms(), 0u);
+
+    // The next interaction finds nothing left, the channel closes right after it
+    device.Interact(5000);
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionClose);
+    EXPECT_EQ(device.policy.stats().budget_closes, 2u);
+}
+
+TEST(AudioChannelPolicyTest, BudgetRefillsOverThePeriod) {
+    Device device(MakeBudget(60000, 30000));
+    device.Interact(5000);
+    device.IdleFor(30000);
+    EXPECT_EQ(device.policy.budget_left_ms(), 0u);
+
+    // Half an hour closed refills half of it
+    device.IdleFor(AUDIO_CHANNEL_BUDGET_PERIOD_MS / 2);
+    EXPECT_NEAR(device.policy.budget_left_ms(), 15000, 1000);
+    // ...and the refill stops at the full budget
+    device.IdleFor(AUDIO_CHANNEL_BUDGET_PERIOD_MS);
+    EXPECT_EQ(device.policy.budget_left_ms(), 30000u);
+}
+
+TEST(AudioChannelPolicyTest, NoPrewarmByDefault) {
+    Device device(MakeBudget(60000, 600000));
+    device.Interact(5000);
+    device.IdleFor(5000);
+    device.open = false;  // The server closed it
+    EXPECT_EQ(device.IdleFor(55000), kAudioChannelActionNone);
+    EXPECT_EQ(device.policy.stats().prewarm_opens, 0u);
+}
+
+TEST(AudioChannelPolicyTest, PrewarmReopensOnceAndCountsTheHit) {
+    Device device(MakeBudget(60000, 600000, true));
+    device.Interact(5000);
+    device.IdleFor(5000);
+    device.open = false;
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionOpen);
+    EXPECT_TRUE(device.open);
+
+    // Closed again: not chased a second time in this idle period
+    device.open = false;
+    EXPECT_EQ(device.IdleFor(40000), kAudioChannelActionNone);
+    EXPECT_EQ(device.policy.stats().prewarm_opens, 1u);
+    EXPECT_EQ(device.policy.stats().prewarm_misses, 1u);
+
+    // A new idle period may try again, and this time it carries the interaction
+    device.Interact(5000);
+    device.IdleFor(5000);
+    device.open = false;
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionOpen);
+    device.IdleFor(5000);
+    device.Interact(5000);
+    auto& stats = device.policy.stats();
+    EXPECT_EQ(stats.prewarm_opens, 2u);
+    EXPECT_EQ(stats.prewarm_hits, 1u);
+    EXPECT_EQ(stats.prewarm_misses, 1u);
+}
+
+TEST(AudioChannelPolicyTest, PrewarmedChannelClosedUnusedIsAMiss) {
+    Device device(MakeBudget(60000, 600000, true));
+    device.Interact(5000);
+    device.IdleFor(5000);
+    device.open = false;
+    EXPECT_EQ(device.IdleFor(1000), kAudioChannelActionOpen);
+    EXPECT_EQ(device.IdleFor(60000), kAudioChannelActionClose);
+    EXPECT_EQ(device.policy.stats().prewarm_misses, 1u);
+    EXPECT_EQ(device.policy.stats().hold_closes, 1u);
+}
+
+TEST(AudioChannelPolicyTest, NoPrewarmNearTheEndOfTheHoldOrBudget) {
+    Device late(MakeBudget(60000, 600000, true));
+    late.Interact(5000);
+    late.IdleFor(52000);
+    late.open = false;
+    EXPECT_EQ(late.IdleFor(8000), kAudioChannelActionNone);
+
+    Device poor(MakeBudget(60000, 12000, true));
+    poor.Interact(5000);
+    poor.IdleFor(5000);
+    poor.open = false;
+    EXPECT_EQ(poor.IdleFor(1000), kAudioChannelActionNone);
+    EXPECT_EQ(poor.policy.stats().prewarm_opens, 0u);
+}
+
+TEST(AudioChannelPolicyTest, NothingHappensWhileActive) {
+    Device device(MakeBudget(0, 600000, true));
+    device.policy.OnInteractionStart(device.now, false);
+    device.policy.OnActive(device.now);
+    device.open = true;
+    for (int i = 0; i < 10; ++i) {
+        device.now += 1000;
+        EXPECT_EQ(device.policy.Update(device.now, device.open), kAudioChannelActionNone);
+    }
+    EXPECT_EQ(device.policy.stats().warm_idle_ms, 0u);
+}
@@ -0,0 +1,180 @@
+// Bytes copied and time per packet to frame the uplink audio for each transport, the copying
+// framing it replaced against the in-place framing of audio_framing.h. The cipher of MQTT+UDP
+// is stood in for by an XOR, both variants run it over the same bytes.
+//
+//   ./audio_framing_benchmark [iterations]
+
+#include "audio_framing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 60 ms frames at 16 kbps
+constexpr size_t kOpusBytes = 120;
+constexpr size_t kFrameMs = 60;
+
+size_t copied_bytes;
+volatile uint8_t sink;
+
+void CountedCopy(void* dest, const void* src, size_t size) {
+    std::memcpy(dest, src, size);
+    copied_bytes += size;
+}
+
+void Cipher(const uint8_t* in, uint8_t* out, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = in[i] ^ 0x5A;
+    }
+}
+
+void Send(const void* data, size_t size) {
+    sink = static_cast<const uint8_t*>(data)[size - 1];
+}
+
+// The encoder's output copied into the packet, as Encode() did with its own buffer
+void CopyFromEncoder(const std::vector<uint8_t>& encoded, AudioStreamPacket& packet) {
+    packet.headroom = 0;
+    packet.payload.resize(encoded.size());
+    CountedCopy(packet.payload.data(), encoded.data(), encoded.size());
+}
+
+// Encoded in place after the headroom
+void EncodeInPlace(const std::vector<uint8_t>& encoded, AudioStreamPacket& packet) {
+    packet.headroom = AUDIO_PACKET_HEADROOM;
+    packet.payload.resize(AUDIO_PACKET_HEADROOM + encoded.size());
+    std::memcpy(packet.data(), encoded.data(), encoded.size());
+}
+
+void CopyingProtocol2(AudioStreamPacket& packet) {
+    std::string serialized;
+    serialized.resize(sizeof(BinaryProtocol2) + packet.payload.size());
+    auto bp2 = reinterpret_cast<BinaryProtocol2*>(serialized.data());
+    bp2->version = htons(2);
+    bp2->type = 0;
+    bp2->reserved = 0;
+    bp2->timestamp = htonl(packet.timestamp);
+    bp2->payload_size = htonl(packet.payload.size());
+    CountedCopy(bp2->payload, packet.payload.data(), packet.payload.size());
+    Send(serialized.data(), serialized.size());
+}
+
+void CopyingProtocol3(AudioStreamPacket& packet) {
+    std::string serialized;
+    serialized.resize(sizeof(BinaryProtocol3) + packet.payload.size());
+    auto bp3 = reinterpret_cast<BinaryProtocol3*>(serialized.data());
+    bp3->type = 0;
+    bp3->reserved = 0;
+    bp3->payload_size = htons(packet.payload.size());
+    CountedCopy(bp3->payload, packet.payload.data(), packet.payload.size());
+    Send(serialized.data(), serialized.size());
+}
+
+void CopyingUdp(AudioStreamPacket& packet, const std::string& session_nonce, uint32_t sequence) {
+    std::string nonce(session_nonce);
+    copied_bytes += nonce.size();
+    WriteUdpNonce(reinterpret_cast<uint8_t*>(nonce.data()), session_nonce, packet.payload.size(), packet.timestamp,
+        sequence);
+    std::string encrypted;
+    encrypted.resize(nonce.size() + packet.payload.size());
+    CountedCopy(encrypted.data(), nonce.data(), nonce.size());
+    Cipher(packet.payload.data(), reinterpret_cast<uint8_t*>(&encrypted[nonce.size()]), packet.payload.size());
+    Send(encrypted.data(), encrypted.size());
+}
+
+void InPlaceUdp(AudioStreamPacket& packet, const std::string& session_nonce, uint32_t sequence,
+    std::string& send_buffer) {
+    send_buffer.resize(UDP_AUDIO_NONCE_SIZE + packet.size());
+    auto frame = reinterpret_cast<uint8_t*>(send_buffer.data());
+    WriteUdpNonce(frame, session_nonce, packet.size(), packet.timestamp, sequence);
+    uint8_t counter[UDP_AUDIO_NONCE_SIZE];
+    CountedCopy(counter, frame, sizeof(counter));
+    Cipher(packet.data(), frame + UDP_AUDIO_NONCE_SIZE, packet.size());
+    Send(send_buffer.data(), send_buffer.size());
+}
+
+struct Result {
+    double ns;
+    size_t bytes;
+};
+
+Result Measure(size_t iterations, const std::function<void()>& body) {
+    copied_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / iterations, copied_bytes / iterations};
+}
+
+void Report(const char* name, Result before, Result after) {
+    std::printf("%-10s before %5zu B/s %6.0f ns  after %5zu B/s %6.0f ns  x%.2f\n", name,
+        before.bytes * 1000 / kFrameMs, before.ns, after.bytes * 1000 / kFrameMs, after.ns, before.ns / after.ns);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::vector<uint8_t> encoded(kOpusBytes);
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        encoded[i] = uint8_t(i * 7);
+    }
+    std::string session_nonce(UDP_AUDIO_NONCE_SIZE, '\x11');
+    std::string send_buffer;
+    AudioStreamPacket packet;
+    packet.payload.reserve(AUDIO_PACKET_HEADROOM + kOpusBytes);
+    uint32_t sequence = 0;
+
+    std::printf("Bytes copied per second of speech (%zu B Opus packets every %zu ms) and time per packet\n",
+        kOpusBytes, kFrameMs);
+    auto v1_before = Measure(iterations, [&] {
+        CopyFromEncoder(encoded, packet);
+        Send(packet.payload.data(), packet.payload.size());
+    });
+    auto v1_after = Measure(iterations, [&] {
+        EncodeInPlace(encoded, packet);
+        Send(packet.data(), packet.size());
+    });
+    Report("v1", v1_before, v1_after);
+
+    auto v2_before = Measure(iterations, [&] {
+        CopyFromEncoder(encoded, packet);
+        CopyingProtocol2(packet);
+    });
+    auto v2_after = Measure(iterations, [&] {
+        EncodeInPlace(encoded, packet);
+        FrameBinaryProtocol2(packet, 2);
+        Send(packet.data(), packet.size());
+    });
+    Report("v2", v2_before, v2_after);
+
+    auto v3_before = Measure(iterations, [&] {
+        CopyFromEncoder(encoded, packet);
+        CopyingProtocol3(packet);
+    });
+    auto v3_after = Measure(iterations, [&] {
+        EncodeInPlace(encoded, packet);
+        FrameBinaryProtocol3(packet);
+        Send(packet.data(), packet.size());
+    });
+    Report("v3", v3_before, v3_after);
+
+    auto udp_before = Measure(iterations, [&] {
+        CopyFromEncoder(encoded, packet);
+        CopyingUdp(packet, session_nonce, ++sequence);
+    });
+    auto udp_after = Measure(iterations, [&] {
+        EncodeInPlace(encoded, packet);
+        InPlaceUdp(packet, session_nonce, ++sequence, send_buffer);
+    });
+    Report("mqtt+udp", udp_before, udp_after);
+    return 0;
+}
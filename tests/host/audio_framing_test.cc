@@ -0,0 +1,160 @@
+#include "audio_framing.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+// A packet as the uplink encoder leaves it: headroom, then the Opus data
+AudioStreamPacket EncodedPacket(size_t opus_bytes, size_t headroom = AUDIO_PACKET_HEADROOM) {
+    AudioStreamPacket packet;
+    packet.timestamp = 0x01020304;
+    packet.headroom = headroom;
+    packet.payload.assign(headroom, 0xEE);
+    for (size_t i = 0; i < opus_bytes; ++i) {
+        packet.payload.push_back(uint8_t(i));
+    }
+    return packet;
+}
+
+bool HasOpusData(const uint8_t* data, size_t opus_bytes) {
+    for (size_t i = 0; i < opus_bytes; ++i) {
+        if (data[i] != uint8_t(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST(AudioFramingTest, Protocol2HeaderInTheHeadroom) {
+    auto packet = EncodedPacket(120);
+    const uint8_t* opus = packet.data();
+    const uint8_t* storage = packet.payload.data();
+
+    FrameBinaryProtocol2(packet, 2);
+    ASSERT_EQ(packet.size(), sizeof(BinaryProtocol2) + 120);
+    // Written in place, the Opus data did not move
+    EXPECT_EQ(packet.payload.data(), storage);
+    EXPECT_EQ(packet.data() + sizeof(BinaryProtocol2), opus);
+
+    auto bp2 = reinterpret_cast<const BinaryProtocol2*>(packet.data());
+    EXPECT_EQ(ntohs(bp2->version), 2);
+    EXPECT_EQ(bp2->type, 0);
+    EXPECT_EQ(bp2->reserved, 0u);
+    EXPECT_EQ(ntohl(bp2->timestamp), 0x01020304u);
+    EXPECT_EQ(ntohl(bp2->payload_size), 120u);
+    EXPECT_TRUE(HasOpusData(bp2->payload, 120));
+}
+
+TEST(AudioFramingTest, Protocol3HeaderInTheHeadroom) {
+    auto packet = EncodedPacket(80);
+    const uint8_t* opus = packet.data();
+
+    FrameBinaryProtocol3(packet);
+    ASSERT_EQ(packet.size(), sizeof(BinaryProtocol3) + 80);
+    EXPECT_EQ(packet.data() + sizeof(BinaryProtocol3), opus);
+    EXPECT_EQ(packet.headroom, size_t(AUDIO_PACKET_HEADROOM) - sizeof(BinaryProtocol3));
+
+    auto bp3 = reinterpret_cast<const BinaryProtocol3*>(packet.data());
+    EXPECT_EQ(bp3->type, 0);
+    EXPECT_EQ(ntohs(bp3->payload_size), 80);
+    EXPECT_TRUE(HasOpusData(bp3->payload, 80));
+}
+
+TEST(AudioFramingTest, PacketWithoutHeadroomMakesRoom) {
+    // The wake word packets are not from the uplink encoder
+    auto packet = EncodedPacket(50, 0);
+    FrameBinaryProtocol2(packet, 2);
+    ASSERT_EQ(packet.size(), sizeof(BinaryProtocol2) + 50);
+    EXPECT_EQ(packet.headroom, 0u);
+    auto bp2 = reinterpret_cast<const BinaryProtocol2*>(packet.data());
+    EXPECT_EQ(ntohl(bp2->payload_size), 50u);
+    EXPECT_TRUE(HasOpusData(bp2->payload, 50));
+}
+
+TEST(AudioFramingTest, UdpNonce) {
+    std::string session_nonce(UDP_AUDIO_NONCE_SIZE, '\0');
+    for (size_t i = 0; i < session_nonce.size(); ++i) {
+        session_nonce[i] = char(0xA0 + i);
+    }
+    uint8_t nonce[UDP_AUDIO_NONCE_SIZE];
+    WriteUdpNonce(nonce, session_nonce, 0x0102, 0x03040506, 0x0708090A);
+
+    const uint8_t expected[UDP_AUDIO_NONCE_SIZE] = {
+        0xA0, 0xA1, 0x01, 0x02, 0xA4, 0xA5, 0xA6, 0xA7,
+        0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+    };
+    EXPECT_EQ(std::vector<uint8_t>(nonce, nonce + UDP_AUDIO_NONCE_SIZE),
+        std::vector<uint8_t>(expected, expected + UDP_AUDIO_NONCE_SIZE));
+}
+
+namespace {
+
+// Spaces are only for reading
+std::vector<uint8_t> Hex(const char* hex) {
+    std::string digits;
+    for (const char* p = hex; *p != '\0'; ++p) {
+        if (*p != ' ') {
+            digits += *p;
+        }
+    }
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < digits.size(); i += 2) {
+        bytes.push_back(uint8_t(std::stoi(digits.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+}  // namespace
+
+// Downlink frames as a server sends them, the Opus data shortened to a few bytes
+TEST(AudioFramingTest, ReadsCapturedDownlinkFrames) {
+    struct Frame {
+        int version;
+        const char* hex;
+        bool valid;
+        uint32_t timestamp;
+        const char* opus;
+    };
+    const Frame frames[] = {
+        {1, "58 0b e4 c1 36", true, 0, "580be4c136"},
+        {2, "0002 0000 00000000 0001e240 00000004 58 0b e4 c1", true, 123456, "580be4c1"},
+        // Bytes after the payload are ignored
+        {2, "0002 0000 00000000 00000000 00000002 58 0b e4 c1", true, 0, "580b"},
+        // Claims more than it carries, or a cut header
+        {2, "0002 0000 00000000 00000000 00000005 58 0b e4 c1", false, 0, ""},
+        {2, "0002 0000 0000", false, 0, ""},
+        {3, "00 00 0003 78 0a 11", true, 0, "780a11"},
+        {3, "00 00 0000", true, 0, ""},
+        {3, "00 00 0004 78 0a 11", false, 0, ""},
+        {3, "00 00", false, 0, ""},
+    };
+
+    FramePool<AudioStreamPacket> pool(4);
+    pool.Initialize(INCOMING_AUDIO_POOL_PAYLOAD_BYTES, 2);
+    for (int round = 0; round < 10; ++round) {
+        for (const auto& frame : frames) {
+            auto bytes = Hex(frame.hex);
+            auto received = bytes;
+            auto packet = ReadBinaryFrame(pool, received.data(), received.size(), frame.version);
+            // The receive buffer is left as it was
+            EXPECT_EQ(received, bytes);
+            if (!frame.valid) {
+                EXPECT_EQ(packet, nullptr) << frame.hex;
+                continue;
+            }
+            ASSERT_NE(packet, nullptr) << frame.hex;
+            EXPECT_EQ(packet->timestamp, frame.timestamp);
+            EXPECT_EQ(packet->headroom, 0u);
+            EXPECT_EQ(packet->payload, Hex(frame.opus)) << frame.hex;
+        }
+    }
+
+    // One packet at a time was in use, every frame after the first reused it
+    auto stats = pool.GetStats();
+    EXPECT_EQ(stats.allocated, 0u);
+    EXPECT_EQ(stats.grown, 0u);
+}
@@ -0,0 +1,330 @@
+#include "audio_mixer.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+struct TestFrame {
+    std::vector<int16_t> pcm;
+};
+
+static std::vector<int16_t>& FrameBuffer(TestFrame& frame) {
+    return frame.pcm;
+}
+
+using TestFramePtr = std::unique_ptr<TestFrame>;
+using TestMixer = AudioMixer<TestFramePtr, 4>;
+
+static constexpr size_t kFrameSamples = 96;
+
+// A deterministic signal, different for every stream
+static int16_t Signal(int stream, size_t n) {
+    return int16_t(((n * (7 + stream * 5) + stream * 1000) % 20000) - 10000);
+}
+
+static TestFramePtr MakeFrame(int stream, size_t start, size_t samples) {
+    auto frame = std::make_unique<TestFrame>();
+    for (size_t i = 0; i < samples; i++) {
+        frame->pcm.push_back(Signal(stream, start + i));
+    }
+    return frame;
+}
+
+// The Q16 gain step of the mixer, written out
+static int32_t Scale(int16_t sample, int32_t gain_q16) {
+    return (int32_t(sample) * gain_q16 + 0x8000) >> 16;
+}
+
+static int16_t Saturate(int32_t value) {
+    return int16_t(std::clamp<int32_t>(value, INT16_MIN, INT16_MAX));
+}
+
+class AudioMixerTest : public ::testing::Test {
+protected:
+    TestMixer mixer;
+    std::vector<int16_t> output;
+    std::vector<const std::vector<int16_t>*> blocks;
+    std::vector<std::pair<MixerStream, int16_t>> released;
+    size_t fed[kMixerStreamCount] = {};
+
+    void SetUp() override {
+        mixer.Configure(kFrameSamples, 0);
+    }
+
+    // Queues `frames` frames of `samples` samples, continuing the stream's signal
+    void Feed(MixerStream stream, size_t samples, int frames = 1) {
+        for (int i = 0; i < frames; i++) {
+            ASSERT_TRUE(mixer.Push(stream, MakeFrame(stream, fed[stream], samples)));
+            fed[stream] += samples;
+        }
+    }
+
+    bool MixOnce() {
+        return mixer.Mix([this](const std::vector<int16_t>& pcm) {
+            blocks.push_back(&pcm);
+            output.insert(output.end(), pcm.begin(), pcm.end());
+        }, [this](MixerStream stream, TestFramePtr& frame) {
+            released.push_back({stream, frame->pcm.front()});
+        });
+    }
+
+    void MixAll() {
+        while (MixOnce()) {
+        }
+    }
+};
+
+TEST_F(AudioMixerTest, NothingToPlay) {
+    EXPECT_FALSE(MixOnce());
+    EXPECT_TRUE(output.empty());
+}
+
+TEST_F(AudioMixerTest, LoneStreamIsPassedThrough) {
+    auto frame = MakeFrame(kMixerStreamVoice, 0, 200);
+    const std::vector<int16_t>* buffer = &frame->pcm;
+    ASSERT_TRUE(mixer.Push(kMixerStreamVoice, std::move(frame)));
+
+    ASSERT_TRUE(MixOnce());
+    ASSERT_EQ(blocks.size(), 1u);
+    // The frame itself, longer than a mix block, without a copy
+    EXPECT_EQ(blocks[0], buffer);
+    EXPECT_EQ(output.size(), 200u);
+    ASSERT_EQ(released.size(), 1u);
+    EXPECT_EQ(released[0].first, kMixerStreamVoice);
+    EXPECT_TRUE(mixer.Empty());
+}
+
+TEST_F(AudioMixerTest, MixesMisalignedFramesSampleAccurately) {
+    // 100-sample voice frames against 64-sample sound frames
+    Feed(kMixerStreamVoice, 100, 3);
+    Feed(kMixerStreamSound, 64, 4);
+    MixAll();
+
+    ASSERT_EQ(output.size(), 300u);
+    for (size_t n = 0; n < output.size(); n++) {
+        int32_t expected = Signal(kMixerStreamVoice, n);
+        if (n < 256) {
+            expected += Signal(kMixerStreamSound, n);
+        }
+        ASSERT_EQ(output[n], Saturate(expected)) << n;
+    }
+    for (auto block : blocks) {
+        EXPECT_LE(block->size(), kFrameSamples);
+    }
+    EXPECT_EQ(released.size(), 7u);
+    EXPECT_TRUE(mixer.Empty());
+}
+
+TEST_F(AudioMixerTest, HigherPriorityDucksLowerStreams) {
+    mixer.SetStreamConfig(kMixerStreamMedia, {0, AUDIO_MIXER_UNITY_GAIN, false});
+    mixer.SetStreamConfig(kMixerStreamVoice, {1, 16384, false});
+    mixer.SetStreamConfig(kMixerStreamSound, {2, 32768, false});
+    mixer.SetGain(kMixerStreamSound, 49152);
+
+    Feed(kMixerStreamMedia, kFrameSamples, 3);
+    Feed(kMixerStreamVoice, kFrameSamples, 2);
+    Feed(kMixerStreamSound, kFrameSamples, 1);
+    MixAll();
+
+    ASSERT_EQ(output.size(), 3 * kFrameSamples);
+    for (size_t n = 0; n < output.size(); n++) {
+        int32_t expected;
+        if (n < kFrameSamples) {
+            // The sound ducks everything below it to 0.5, the lowest duck gain wins
+            expected = Scale(Signal(kMixerStreamMedia, n), 16384) + Scale(Signal(kMixerStreamVoice, n), 32768) +
+                Scale(Signal(kMixerStreamSound, n), 49152);
+        } else if (n < 2 * kFrameSamples) {
+            expected = Scale(Signal(kMixerStreamMedia, n), 16384) + Signal(kMixerStreamVoice, n);
+        } else {
+            expected = Signal(kMixerStreamMedia, n);
+        }
+        ASSERT_EQ(output[n], Saturate(expected)) << n;
+    }
+}
+
+TEST_F(AudioMixerTest, PreemptionHoldsLowerStreams) {
+    mixer.SetStreamConfig(kMixerStreamVoice, {1, AUDIO_MIXER_UNITY_GAIN, false});
+    mixer.SetStreamConfig(kMixerStreamSound, {2, AUDIO_MIXER_UNITY_GAIN, true});
+
+    Feed(kMixerStreamVoice, 100, 2);
+    ASSERT_TRUE(MixOnce());     // Passed through: voice 0..99
+    Feed(kMixerStreamSound, 150);
+    MixAll();
+
+    // The sound alone, then the voice continues where it stopped
+    ASSERT_EQ(output.size(), 350u);
+    for (size_t n = 0; n < 100; n++) {
+        ASSERT_EQ(output[n], Signal(kMixerStreamVoice, n));
+    }
+    for (size_t n = 0; n < 150; n++) {
+        ASSERT_EQ(output[100 + n], Signal(kMixerStreamSound, n));
+    }
+    for (size_t n = 0; n < 100; n++) {
+        ASSERT_EQ(output[250 + n], Signal(kMixerStreamVoice, 100 + n));
+    }
+}
+
+TEST_F(AudioMixerTest, GainChangesAreRamped) {
+    mixer.Configure(kFrameSamples, 64);
+    mixer.SetStreamConfig(kMixerStreamVoice, {1, AUDIO_MIXER_UNITY_GAIN, false});
+    mixer.SetStreamConfig(kMixerStreamSound, {2, 0, false});
+
+    auto constant = [](int16_t value, size_t samples) {
+        auto frame = std::make_unique<TestFrame>();
+        frame->pcm.assign(samples, value);
+        return frame;
+    };
+    mixer.Push(kMixerStreamVoice, constant(16000, 96));
+    mixer.Push(kMixerStreamVoice, constant(16000, 96));
+    ASSERT_TRUE(MixOnce());
+    mixer.Push(kMixerStreamSound, constant(0, 96));
+    ASSERT_TRUE(MixOnce());
+
+    // The voice fades from full level to silence over 64 samples, never stepping up
+    ASSERT_EQ(output.size(), 192u);
+    EXPECT_EQ(output[95], 16000);
+    for (size_t n = 97; n < 192; n++) {
+        EXPECT_LE(output[n], output[n - 1]) << n;
+    }
+    EXPECT_GT(output[96], 15000);
+    EXPECT_EQ(output[96 + 64], 0);
+}
+
+TEST_F(AudioMixerTest, MixingSaturates) {
+    auto constant = [](int16_t value) {
+        auto frame = std::make_unique<TestFrame>();
+        frame->pcm.assign(kFrameSamples, value);
+        return frame;
+    };
+    mixer.Push(kMixerStreamVoice, constant(30000));
+    mixer.Push(kMixerStreamSound, constant(30000));
+    mixer.Push(kMixerStreamMedia, constant(-30000));
+    mixer.Push(kMixerStreamMedia, constant(-30000));
+    MixAll();
+    ASSERT_EQ(output.size(), 2 * kFrameSamples);
+    EXPECT_EQ(output[0], 30000);
+    EXPECT_EQ(output[kFrameSamples], -30000);
+
+    output.clear();
+    mixer.Push(kMixerStreamVoice, constant(30000));
+    mixer.Push(kMixerStreamSound, constant(30000));
+    MixAll();
+    EXPECT_EQ(output[0], INT16_MAX);
+}
+
+TEST_F(AudioMixerTest, ClearDropsThePartlyPlayedFrame) {
+    Feed(kMixerStreamVoice, 200);
+    Feed(kMixerStreamSound, 50);
+    ASSERT_TRUE(MixOnce());     // Mixed: voice 0..95
+    mixer.Clear(kMixerStreamVoice);
+    output.clear();
+    MixAll();
+    EXPECT_TRUE(output.empty());
+
+    // A new frame starts from its first sample
+    auto frame = MakeFrame(kMixerStreamVoice, 1000, 100);
+    ASSERT_TRUE(mixer.Push(kMixerStreamVoice, std::move(frame)));
+    MixAll();
+    ASSERT_EQ(output.size(), 100u);
+    EXPECT_EQ(output[0], Signal(kMixerStreamVoice, 1000));
+}
+
+// Returns frames to a LIFO free list like FramePool, so the next frame reuses the last one's address
+struct RecycleFrame {
+    static inline std::vector<TestFrame*> free_list;
+    // Runs as a frame is returned, standing in for the producer task acquiring it right away
+    static inline std::function<void()> on_release;
+
+    void operator()(TestFrame* frame) const {
+        free_list.push_back(frame);
+        if (auto callback = std::exchange(on_release, nullptr)) {
+            callback();
+        }
+    }
+};
+
+using RecycledFramePtr = std::unique_ptr<TestFrame, RecycleFrame>;
+
+static RecycledFramePtr MakeRecycledFrame(int stream, size_t start, size_t samples) {
+    TestFrame* frame;
+    if (RecycleFrame::free_list.empty()) {
+        frame = new TestFrame();
+    } else {
+        frame = RecycleFrame::free_list.back();
+        RecycleFrame::free_list.pop_back();
+    }
+    frame->pcm.clear();
+    for (size_t i = 0; i < samples; i++) {
+        frame->pcm.push_back(Signal(stream, start + i));
+    }
+    return RecycledFramePtr(frame);
+}
+
+TEST(AudioMixerRecycleTest, RecycledFrameAfterClearStartsFromItsFirstSample) {
+    AudioMixer<RecycledFramePtr, 4> mixer;
+    mixer.Configure(kFrameSamples, 0);
+    std::vector<int16_t> output;
+    auto mix_all = [&]() {
+        while (mixer.Mix([&](const std::vector<int16_t>& pcm) {
+            output.insert(output.end(), pcm.begin(), pcm.end());
+        }, [](MixerStream, RecycledFramePtr&) {})) {
+        }
+    };
+
+    auto first = MakeRecycledFrame(kMixerStreamVoice, 0, 200);
+    TestFrame* address = first.get();
+    ASSERT_TRUE(mixer.Push(kMixerStreamVoice, std::move(first)));
+    ASSERT_TRUE(mixer.Push(kMixerStreamSound, MakeRecycledFrame(kMixerStreamSound, 0, 50)));
+    // Mixed: voice 0..95, the voice frame is partly played
+    ASSERT_TRUE(mixer.Mix([](const std::vector<int16_t>&) {}, [](MixerStream, RecycledFramePtr&) {}));
+
+    // The output task drops the cleared frame and the producer pushes it again, recycled,
+    // before the output task looks at the queue
+    mixer.Clear(kMixerStreamVoice);
+    TestFrame* recycled = nullptr;
+    RecycleFrame::on_release = [&]() {
+        auto second = MakeRecycledFrame(kMixerStreamVoice, 1000, 100);
+        recycled = second.get();
+        mixer.Push(kMixerStreamVoice, std::move(second));
+    };
+    mix_all();
+    ASSERT_EQ(recycled, address);
+
+    ASSERT_EQ(output.size(), 100u);
+    for (size_t n = 0; n < output.size(); n++) {
+        ASSERT_EQ(output[n], Signal(kMixerStreamVoice, 1000 + n)) << n;
+    }
+
+    for (auto frame : RecycleFrame::free_list) {
+        delete frame;
+    }
+    RecycleFrame::free_list.clear();
+}
+
+TEST_F(AudioMixerTest, SpansLocateEverySampleOfAFrame) {
+    Feed(kMixerStreamVoice, 100, 2);
+    Feed(kMixerStreamSound, 40);
+
+    // Block position of the first sample of every voice sample run, as {first signal index, block start}
+    std::vector<std::pair<int16_t, size_t>> runs;
+    size_t block_start = 0;
+    while (mixer.Mix([&](const std::vector<int16_t>& pcm) {
+        mixer.ForEachSpan(kMixerStreamVoice, [&](TestFrame& frame, size_t frame_offset, size_t block_offset,
+            size_t samples) {
+            ASSERT_LE(block_offset + samples, pcm.size());
+            ASSERT_LE(frame_offset + samples, frame.pcm.size());
+            runs.push_back({frame.pcm[frame_offset], block_start + block_offset});
+        });
+        block_start += pcm.size();
+    }, [](MixerStream, TestFramePtr&) {})) {
+    }
+
+    // 96 mixed samples, then the rest of frame 0 and frame 1 across the next block, then nothing left
+    ASSERT_EQ(runs.size(), 3u);
+    EXPECT_EQ(runs[0], std::make_pair(Signal(kMixerStreamVoice, 0), size_t(0)));
+    EXPECT_EQ(runs[1], std::make_pair(Signal(kMixerStreamVoice, 96), size_t(96)));
+    EXPECT_EQ(runs[2], std::make_pair(Signal(kMixerStreamVoice, 100), size_t(100)));
+    EXPECT_EQ(block_start, 200u);
+}
@@ -0,0 +1,115 @@
+#include "host_audio_pipeline.h"
+#include "opus_uplink_encoder.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+static std::vector<int16_t> Tone(int sample_rate, int frequency, size_t samples) {
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        pcm[i] = int16_t(8000 * std::sin(2 * M_PI * frequency * i / sample_rate));
+    }
+    return pcm;
+}
+
+static double Rms(const std::vector<int16_t>& pcm, size_t begin, size_t end) {
+    double sum = 0;
+    for (size_t i = begin; i < end; i++) {
+        sum += double(pcm[i]) * pcm[i];
+    }
+    return end > begin ? std::sqrt(sum / (end - begin)) : 0;
+}
+
+TEST(AudioPipelineTest, LoopsCaptureBackToPlayback) {
+    // 3 s of a tone, plus half a frame that is never sent
+    HostAudioPipeline pipeline(Tone(16000, 440, 16000 * 3 + 480), 16000, 24000);
+
+    PipelineStageStats capture;
+    auto packets = pipeline.Capture(capture);
+    EXPECT_EQ(capture.frames, 50u);
+    int encoded_ms = 0;
+    for (auto& packet : packets) {
+        EXPECT_EQ(packet.sample_rate, 16000);
+        EXPECT_GT(packet.size(), 0u);
+        // Room left for the transport header
+        EXPECT_EQ(packet.headroom, size_t(AUDIO_PACKET_HEADROOM));
+        encoded_ms += packet.frame_duration;
+    }
+    EXPECT_GE(encoded_ms, 3000);
+
+    PipelineStageStats playback;
+    ASSERT_TRUE(pipeline.Playback(packets, {}, playback));
+    auto output = pipeline.codec().GetOutput();
+    // Resampled to the output rate, every frame played
+    ASSERT_GE(output.size(), size_t(encoded_ms) * 24);
+    // The tone came through, away from the edges the codec needs to settle
+    EXPECT_GT(Rms(output, 24000, 48000), 8000 / std::sqrt(2.0) / 2);
+
+    auto peaks = pipeline.service().GetQueuePeaks();
+    EXPECT_GE(peaks.encode, 1u);
+    EXPECT_LE(peaks.encode, size_t(MAX_ENCODE_TASKS_IN_QUEUE));
+    EXPECT_GE(peaks.decode, 1u);
+    EXPECT_LE(peaks.playback, size_t(MAX_PLAYBACK_TASKS_IN_QUEUE));
+}
+
+TEST(AudioPipelineTest, StagedPacketsAreSentFirstOnceReleased) {
+    HostAudioPipeline pipeline(Tone(16000, 440, 16000 * 3), 16000, 16000);
+    auto& service = pipeline.service();
+    service.StageUplink();
+    service.EnableVoiceProcessing(true);
+
+    // Nothing goes out while the channel opens
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (service.GetUplinkStageStats().staged < 5) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        EXPECT_EQ(service.PopPacketFromSendQueue(), nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(service.IsUplinkStaged());
+
+    service.ReleaseStagedUplink();
+    EXPECT_FALSE(service.IsUplinkStaged());
+    auto stats = service.GetUplinkStageStats();
+    size_t staged = stats.staged - stats.dropped;
+    // The staged packets go out first, while the encoder goes on filling the send queue
+    for (size_t popped = 0; popped < staged;) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        if (service.PopPacketFromSendQueue() != nullptr) {
+            popped++;
+            ASSERT_EQ(service.GetUplinkStageStats().flushed, popped);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    service.EnableVoiceProcessing(false);
+    EXPECT_EQ(service.GetUplinkStageStats().flushed, staged);
+}
+
+TEST(AudioPipelineTest, PlaysWithoutPacketsOrSounds) {
+    HostAudioPipeline pipeline({}, 16000, 16000);
+    PipelineStageStats playback;
+    EXPECT_TRUE(pipeline.Playback({}, {}, playback, 2000));
+    EXPECT_EQ(playback.frames, 0u);
+    EXPECT_TRUE(pipeline.codec().GetOutput().empty());
+}
+
+TEST(AudioPipelineTest, SuppressedFramesAreLibopusDtxFrames) {
+    OpusUplinkEncoder encoder(16000, 0, LinkRateController::ProfileOf(kLinkQualityNormal));
+    std::vector<int16_t> silence(encoder.frame_samples());
+    std::vector<uint8_t> opus;
+    size_t dtx = 0;
+    // 3 s: libopus needs some silence before it switches to DTX, then sends a comfort noise update now and then
+    for (int i = 0; i < 50; i++) {
+        ASSERT_TRUE(encoder.EncodeSilence(silence.data(), opus, AUDIO_PACKET_HEADROOM));
+        dtx += opus.size() - AUDIO_PACKET_HEADROOM <= 2 ? 1 : 0;
+    }
+    EXPECT_GE(dtx, 30u);
+
+    // Speech after it is encoded as usual, with the profile's DTX setting
+    auto tone = Tone(16000, 440, encoder.frame_samples());
+    ASSERT_TRUE(encoder.Encode(tone.data(), opus));
+    EXPECT_GT(opus.size(), 2u);
+}
@@ -0,0 +1,211 @@
+#include "audio_power_policy.h"
+
+#include <gtest/gtest.h>
+
+/*
+ * A codec driven by the policy the way AudioService does: the timer asks every second, and the
+ * directions carry audio only when the test says so.
+ */
+class SimulatedCodec {
+public:
+    AudioPowerPolicy policy;
+    int64_t now_ms = 0;
+    bool on[kAudioPowerDirectionCount] = {true, true};
+    int64_t last_audio_ms[kAudioPowerDirectionCount] = {0, 0};
+
+    AudioPowerState State() const {
+        AudioPowerState state;
+        for (int i = 0; i < kAudioPowerDirectionCount; ++i) {
+            state.on[i] = on[i];
+            state.idle_ms[i] = now_ms - last_audio_ms[i];
+        }
+        return state;
+    }
+
+    void Apply(const AudioPowerAction& action) {
+        for (int i = 0; i < kAudioPowerDirectionCount; ++i) {
+            EXPECT_FALSE(action.power_on[i] && action.power_off[i]);
+            if (action.power_on[i]) {
+                on[i] = true;
+            } else if (action.power_off[i]) {
+                on[i] = false;
+            }
+        }
+    }
+
+    void SetMode(AudioPowerMode mode) { Apply(policy.SetMode(mode, now_ms, State())); }
+    void Hint(AudioPowerHint hint) { Apply(policy.OnHint(hint, now_ms, State())); }
+
+    void Audio(AudioPowerDirection direction) {
+        if (!on[direction]) {
+            policy.OnDemand(direction, now_ms);
+            on[direction] = true;
+        }
+        last_audio_ms[direction] = now_ms;
+    }
+
+    void Run(int64_t ms) {
+        for (int64_t end = now_ms + ms; now_ms < end;) {
+            now_ms += AUDIO_POWER_CHECK_INTERVAL_MS;
+            Apply(policy.Update(now_ms, State()));
+        }
+    }
+
+    // Powered off after exactly this idle time, from the last audio on
+    int64_t OutputOffAfter() {
+        int64_t start = now_ms;
+        while (on[kAudioPowerOutput] && now_ms - start < 60000) {
+            Run(AUDIO_POWER_CHECK_INTERVAL_MS);
+        }
+        return now_ms - last_audio_ms[kAudioPowerOutput];
+    }
+
+    // One interaction: the user comes back after `away_ms` in idle, talks and gets a reply
+    void Interaction(int64_t away_ms) {
+        SetMode(kAudioPowerModeIdle);
+        Run(away_ms);
+        SetMode(kAudioPowerModeSession);
+        Audio(kAudioPowerInput);
+        Run(2000);
+        Audio(kAudioPowerOutput);
+        Run(2000);
+        Audio(kAudioPowerOutput);
+    }
+};
+
+TEST(AudioPowerPolicyTest, DefaultModeKeepsTheFixedTimeout) {
+    SimulatedCodec codec;
+    EXPECT_EQ(codec.OutputOffAfter(), AUDIO_POWER_TIMEOUT_MS);
+    EXPECT_FALSE(codec.on[kAudioPowerInput]);
+    EXPECT_EQ(codec.policy.stats().decisions[kAudioPowerReasonTimeout], 2u);
+}
+
+TEST(AudioPowerPolicyTest, SessionStaysPoweredAndPowersUpOnEntry) {
+    SimulatedCodec codec;
+    codec.on[kAudioPowerInput] = false;
+    codec.on[kAudioPowerOutput] = false;
+    codec.SetMode(kAudioPowerModeSession);
+    EXPECT_TRUE(codec.on[kAudioPowerInput]);
+    EXPECT_TRUE(codec.on[kAudioPowerOutput]);
+    EXPECT_EQ(codec.policy.stats().decisions[kAudioPowerReasonSession], 2u);
+
+    codec.Run(60000);
+    EXPECT_TRUE(codec.on[kAudioPowerInput]);
+    EXPECT_TRUE(codec.on[kAudioPowerOutput]);
+    EXPECT_EQ(codec.policy.TimeoutMs(), -1);
+}
+
+TEST(AudioPowerPolicyTest, IdleUsesTheFixedTimeoutUntilThereIsHistory) {
+    SimulatedCodec codec;
+    for (int i = 0; i < AUDIO_POWER_MIN_HISTORY - 1; ++i) {
+        codec.Interaction(60000);
+    }
+    codec.SetMode(kAudioPowerModeIdle);
+    EXPECT_EQ(codec.OutputOffAfter(), AUDIO_POWER_TIMEOUT_MS);
+}
+
+TEST(AudioPowerPolicyTest, DeepIdlePowersDownSooner) {
+    SimulatedCodec codec;
+    for (int i = 0; i < AUDIO_POWER_HISTORY_SIZE; ++i) {
+        codec.Interaction(10 * 60000);
+    }
+    codec.SetMode(kAudioPowerModeIdle);
+    EXPECT_EQ(codec.policy.TimeoutMs(), AUDIO_POWER_MIN_TIMEOUT_MS);
+    EXPECT_EQ(codec.OutputOffAfter(), AUDIO_POWER_MIN_TIMEOUT_MS);
+
+    AudioPowerDecision decisions[AUDIO_POWER_LOG_SIZE];
+    size_t count = codec.policy.GetDecisions(decisions, AUDIO_POWER_LOG_SIZE);
+    ASSERT_GT(count, 0u);
+    const AudioPowerDecision& last = decisions[count - 1];
+    EXPECT_EQ(last.direction, kAudioPowerOutput);
+    EXPECT_FALSE(last.power_on);
+    EXPECT_EQ(last.reason, kAudioPowerReasonDeepIdle);
+    EXPECT_EQ(last.mode, kAudioPowerModeIdle);
+    EXPECT_EQ(last.idle_ms, uint32_t(AUDIO_POWER_MIN_TIMEOUT_MS));
+}
+
+TEST(AudioPowerPolicyTest, QuickReturnsKeepTheCodecWarmJustLongEnough) {
+    SimulatedCodec codec;
+    // The user follows up within 5-7 s most of the time
+    const int64_t aways[] = {5000, 7000, 6000, 600000, 5000, 7000};
+    for (int64_t away : aways) {
+        codec.Interaction(away);
+    }
+    codec.SetMode(kAudioPowerModeIdle);
+    EXPECT_EQ(codec.policy.TimeoutMs(), 7000 + AUDIO_POWER_RETURN_MARGIN_MS);
+    EXPECT_EQ(codec.OutputOffAfter(), 7000 + AUDIO_POWER_RETURN_MARGIN_MS);
+    AudioPowerDecision last;
+    ASSERT_EQ(codec.policy.GetDecisions(&last, 1), 1u);
+    EXPECT_EQ(last.reason, kAudioPowerReasonExpected);
+}
+
+TEST(AudioPowerPolicyTest, ColdStartsAndPrewarm) {
+    SimulatedCodec codec;
+    // A sound long after the timeout pays the power-up
+    codec.Run(60000);
+    codec.Audio(kAudioPowerOutput);
+    uint32_t cold_output = codec.policy.stats().cold_starts[kAudioPowerOutput];
+    EXPECT_EQ(cold_output, 1u);
+
+    // Wake word in idle: the amplifier is powered before the reply, which then finds it warm
+    codec.SetMode(kAudioPowerModeIdle);
+    codec.Run(60000);
+    ASSERT_FALSE(codec.on[kAudioPowerOutput]);
+    codec.Audio(kAudioPowerInput);
+    EXPECT_EQ(codec.policy.stats().cold_starts[kAudioPowerInput], 1u);
+    codec.Hint(kAudioPowerHintWakeWord);
+    EXPECT_TRUE(codec.on[kAudioPowerOutput]);
+    codec.Run(2000);
+    codec.Audio(kAudioPowerOutput);
+    codec.Run(AUDIO_POWER_CHECK_INTERVAL_MS);
+    EXPECT_EQ(codec.policy.stats().cold_starts[kAudioPowerOutput], cold_output);
+    EXPECT_EQ(codec.policy.stats().prewarm_hits, 1u);
+
+    // A button press that leads nowhere: held for the prewarm time, then counted as a miss
+    codec.Run(60000);
+    ASSERT_FALSE(codec.on[kAudioPowerInput]);
+    ASSERT_FALSE(codec.on[kAudioPowerOutput]);
+    codec.Hint(kAudioPowerHintButton);
+    EXPECT_TRUE(codec.on[kAudioPowerInput]);
+    EXPECT_TRUE(codec.on[kAudioPowerOutput]);
+    codec.Run(AUDIO_POWER_PREWARM_HOLD_MS - AUDIO_POWER_CHECK_INTERVAL_MS);
+    EXPECT_TRUE(codec.on[kAudioPowerOutput]);
+    codec.Run(AUDIO_POWER_CHECK_INTERVAL_MS);
+    EXPECT_FALSE(codec.on[kAudioPowerInput]);
+    EXPECT_FALSE(codec.on[kAudioPowerOutput]);
+    EXPECT_EQ(codec.policy.stats().prewarm_misses, 2u);
+    EXPECT_EQ(codec.policy.stats().decisions[kAudioPowerReasonButton], 2u);
+}
+
+TEST(AudioPowerPolicyTest, HintsDoNothingWhenAlreadyPowered) {
+    SimulatedCodec codec;
+    codec.Hint(kAudioPowerHintButton);
+    codec.Run(AUDIO_POWER_TIMEOUT_MS);
+    EXPECT_FALSE(codec.on[kAudioPowerOutput]);
+    EXPECT_EQ(codec.policy.stats().prewarm_hits + codec.policy.stats().prewarm_misses, 0u);
+}
+
+TEST(AudioPowerPolicyTest, CountsPoweredTime) {
+    SimulatedCodec codec;
+    codec.SetMode(kAudioPowerModeSession);
+    codec.Run(10000);
+    codec.SetMode(kAudioPowerModeDefault);
+    codec.Run(60000);
+    // Powered until the timeout after the last audio at 0, all of it idle
+    EXPECT_EQ(codec.policy.stats().powered_ms[kAudioPowerOutput], uint64_t(AUDIO_POWER_TIMEOUT_MS - 1000));
+    EXPECT_EQ(codec.policy.stats().idle_powered_ms[kAudioPowerOutput], uint64_t(AUDIO_POWER_TIMEOUT_MS - 1000));
+}
+
+TEST(AudioPowerPolicyTest, DecisionLogKeepsTheLatest) {
+    SimulatedCodec codec;
+    for (int i = 0; i < AUDIO_POWER_LOG_SIZE; ++i) {
+        codec.Interaction(60000);
+    }
+    AudioPowerDecision decisions[AUDIO_POWER_LOG_SIZE + 4];
+    size_t count = codec.policy.GetDecisions(decisions, AUDIO_POWER_LOG_SIZE + 4);
+    EXPECT_EQ(count, size_t(AUDIO_POWER_LOG_SIZE));
+    for (size_t i = 1; i < count; ++i) {
+        EXPECT_LE(decisions[i - 1].time_ms, decisions[i].time_ms);
+    }
+    EXPECT_EQ(decisions[count - 1].time_ms, uint32_t(codec.now_ms - 4000));
+}
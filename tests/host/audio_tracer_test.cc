@@ -0,0 +1,89 @@
+#include "audio_tracer.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class AudioTracerTest : public ::testing::Test {
+protected:
+    AudioTracer tracer_;
+
+    void SetUp() override {
+        host_time_us = 1000000;
+    }
+};
+
+} // namespace
+
+TEST_F(AudioTracerTest, DisabledTracerRecordsNothing) {
+    EXPECT_EQ(tracer_.Timestamp(), 0);
+    tracer_.Record(kAudioTraceEncoded, 1000);
+    EXPECT_EQ(tracer_.GetPercentiles(kAudioTraceEncoded).count, 0u);
+    tracer_.OnProcessorInput(960);
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), 0);
+}
+
+TEST_F(AudioTracerTest, RecordsLatencySinceOrigin) {
+    tracer_.SetEnabled(true);
+    int64_t origin = tracer_.Timestamp();
+    EXPECT_EQ(origin, host_time_us);
+    host_time_us += 40000;
+    tracer_.Record(kAudioTraceDecoded, origin);
+    // Frames without origin (local sounds, concealed frames) are ignored
+    tracer_.Record(kAudioTraceDecoded, 0);
+
+    auto percentiles = tracer_.GetPercentiles(kAudioTraceDecoded);
+    EXPECT_EQ(percentiles.count, 1u);
+    EXPECT_EQ(percentiles.max_us, 40000u);
+    EXPECT_EQ(tracer_.GetPercentiles(kAudioTraceOutput).count, 0u);
+}
+
+TEST_F(AudioTracerTest, MapsRechunkedProcessorOutputToItsInput) {
+    tracer_.SetEnabled(true);
+    // 512-sample blocks in, 960-sample frames out
+    int64_t block_times[4];
+    for (int i = 0; i < 4; ++i) {
+        block_times[i] = host_time_us;
+        tracer_.OnProcessorInput(512);
+        host_time_us += 32000;
+    }
+    // Samples 0-959 start in block 0, samples 960-1919 start in block 1
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), block_times[0]);
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), block_times[1]);
+}
+
+TEST_F(AudioTracerTest, EnablingMidStreamSkipsUntracedFrames) {
+    // Fed while disabled, the processor still holds these samples
+    tracer_.OnProcessorInput(960);
+    tracer_.SetEnabled(true);
+    int64_t traced = host_time_us;
+    tracer_.OnProcessorInput(960);
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), 0);
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), traced);
+}
+
+TEST_F(AudioTracerTest, ResetProcessorClockRealigns) {
+    tracer_.SetEnabled(true);
+    tracer_.OnProcessorInput(960);
+    tracer_.OnProcessorInput(960);
+    tracer_.OnProcessorOutput(960);
+    // The processor restarted and dropped the second block
+    tracer_.ResetProcessorClock();
+    host_time_us += 100000;
+    int64_t fed = host_time_us;
+    tracer_.OnProcessorInput(960);
+    EXPECT_EQ(tracer_.OnProcessorOutput(960), fed);
+}
+
+TEST_F(AudioTracerTest, WindowsRotateAndOldOnesExpire) {
+    tracer_.SetEnabled(true);
+    int64_t origin = host_time_us;
+    host_time_us += 1000;
+    tracer_.Record(kAudioTraceSent, origin);
+    for (int i = 0; i < AUDIO_TRACE_WINDOWS - 1; ++i) {
+        tracer_.PrintStatistics();
+    }
+    EXPECT_EQ(tracer_.GetPercentiles(kAudioTraceSent).count, 1u);
+    tracer_.PrintStatistics();
+    EXPECT_EQ(tracer_.GetPercentiles(kAudioTraceSent).count, 0u);
+}
@@ -0,0 +1,138 @@
+#include "capture_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Interleaved frames whose samples are (frame number * channels + channel)
+std::vector<int16_t> Frames(uint64_t first, size_t count, size_t channels) {
+    std::vector<int16_t> pcm(count * channels);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t c = 0; c < channels; ++c) {
+            pcm[i * channels + c] = int16_t((first + i) * channels + c);
+        }
+    }
+    return pcm;
+}
+
+}  // namespace
+
+TEST(CaptureRingTest, ReadersTakeTheirOwnChunksFromOneCapture) {
+    CaptureRing ring;
+    ring.Configure(2, 512);
+    ring.SetActive(0, true);
+    ring.SetActive(1, true);
+
+    // The wake word takes 480 frames, the processor 512; the capture is read only as far as needed
+    const size_t chunks[2] = {480, 512};
+    uint64_t written = 0;
+    uint64_t read[2] = {0, 0};
+    int reads = 0;
+    while (read[1] < 20 * 512) {
+        size_t missing = 512;
+        for (int r = 0; r < 2; ++r) {
+            missing = std::min(missing, chunks[r] - std::min(chunks[r], ring.Available(r)));
+        }
+        if (missing > 0) {
+            auto pcm = Frames(written, missing, 2);
+            ring.Write(pcm.data(), missing, 0);
+            written += missing;
+            reads++;
+        }
+        for (int r = 0; r < 2; ++r) {
+            const int16_t* chunk = ring.Peek(r, chunks[r]);
+            if (chunk == nullptr) {
+                continue;
+            }
+            // Contiguous and in order, also across the end of the ring
+            auto expected = Frames(read[r], chunks[r], 2);
+            ASSERT_TRUE(std::equal(expected.begin(), expected.end(), chunk)) << "reader " << r << " at " << read[r];
+            ring.Consume(r, chunks[r]);
+            read[r] += chunks[r];
+        }
+    }
+    EXPECT_EQ(written, read[1]);
+    EXPECT_GE(read[0] + 480, written);
+    // One read per chunk boundary of either reader, instead of one per chunk of each
+    EXPECT_LE(reads, 20 + int(written / 480) + 1);
+    EXPECT_EQ(ring.overrun_frames(0), 0u);
+    EXPECT_EQ(ring.overrun_frames(1), 0u);
+}
+
+TEST(CaptureRingTest, PeekNeedsAWholeChunk) {
+    CaptureRing ring;
+    ring.Configure(1, 160);
+    ring.SetActive(0, true);
+    auto pcm = Frames(0, 100, 1);
+    ring.Write(pcm.data(), 100, 0);
+    EXPECT_EQ(ring.Peek(0, 160), nullptr);
+    EXPECT_NE(ring.Peek(0, 100), nullptr);
+    EXPECT_EQ(ring.Peek(0, 0), nullptr);
+    EXPECT_EQ(ring.Peek(0, 161), nullptr);
+}
+
+TEST(CaptureRingTest, ActivatedReaderStartsAtTheNewestFrame) {
+    CaptureRing ring;
+    ring.Configure(1, 160);
+    ring.SetActive(0, true);
+    auto pcm = Frames(0, 100, 1);
+    ring.Write(pcm.data(), 100, 0);
+
+    ring.SetActive(1, true);
+    EXPECT_EQ(ring.Available(0), 100u);
+    EXPECT_EQ(ring.Available(1), 0u);
+
+    // Inactive readers hold nothing, and start over when active again
+    ring.SetActive(0, false);
+    pcm = Frames(100, 100, 1);
+    ring.Write(pcm.data(), 100, 0);
+    ring.SetActive(0, true);
+    EXPECT_EQ(ring.Available(0), 0u);
+    EXPECT_EQ(ring.Available(1), 100u);
+    EXPECT_EQ(*ring.Peek(1, 100), 100);
+}
+
+TEST(CaptureRingTest, ReaderThatFallsBehindLosesTheOldestFrames) {
+    CaptureRing ring;
+    ring.Configure(1, 100);
+    ring.SetActive(0, true);
+    for (uint64_t i = 0; i < 4; ++i) {
+        auto pcm = Frames(i * 100, 100, 1);
+        ring.Write(pcm.data(), 100, 0);
+    }
+    EXPECT_EQ(ring.Available(0), ring.capacity());
+    EXPECT_EQ(ring.overrun_frames(0), 400u - ring.capacity());
+    EXPECT_EQ(*ring.Peek(0, 100), int16_t(400 - ring.capacity()));
+}
+
+TEST(CaptureRingTest, EndTimeOfAChunk) {
+    CaptureRing ring;
+    ring.Configure(1, 320);
+    ring.SetActive(0, true);
+    auto pcm = Frames(0, 480, 1);
+    ring.Write(pcm.data(), 480, 1000000);
+    // The first 160 frames end 320 frames (20 ms at 16 kHz) before the last one
+    EXPECT_EQ(ring.EndTimeUs(0, 160, 16000), 1000000 - 20000);
+    ring.Consume(0, 160);
+    EXPECT_EQ(ring.EndTimeUs(0, 320, 16000), 1000000);
+}
+
+TEST(CaptureRingTest, GrowsForALargerChunk) {
+    CaptureRing ring;
+    ring.Configure(1, 160);
+    size_t capacity = ring.capacity();
+    ring.Configure(1, 100);
+    EXPECT_EQ(ring.capacity(), capacity);
+    ring.Configure(1, 960);
+    EXPECT_GE(ring.capacity(), 960u * 2);
+
+    ring.SetActive(0, true);
+    auto pcm = Frames(0, 960, 1);
+    ring.Write(pcm.data(), 960, 0);
+    const int16_t* chunk = ring.Peek(0, 960);
+    ASSERT_NE(chunk, nullptr);
+    EXPECT_TRUE(std::equal(pcm.begin(), pcm.end(), chunk));
+}
@@ -0,0 +1,49 @@
+#ifndef HOST_SHIM_MBEDTLS_AES_H
+#define HOST_SHIM_MBEDTLS_AES_H
+
+// The part of the mbedtls AES API the protocols use, on the OpenSSL block cipher of the host.
+// mbedtls itself is only a runtime library on most hosts, without headers.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/aes.h>
+
+#include <cstddef>
+#include <cstring>
+
+#define MBEDTLS_ERR_AES_INVALID_KEY_LENGTH -0x0020
+
+struct mbedtls_aes_context {
+    AES_KEY key;
+};
+
+inline void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    std::memset(ctx, 0, sizeof(*ctx));
+}
+
+inline void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    std::memset(ctx, 0, sizeof(*ctx));
+}
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    return AES_set_encrypt_key(key, keybits, &ctx->key) == 0 ? 0 : MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+}
+
+// Same contract as mbedtls: the counter block is a big-endian 128-bit counter advanced per block,
+// *nc_off and stream_block carry a partly used key stream block over to the next call
+inline int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off,
+    unsigned char nonce_counter[16], unsigned char stream_block[16], const unsigned char* input,
+    unsigned char* output) {
+    size_t n = *nc_off;
+    for (size_t i = 0; i < length; ++i) {
+        if (n == 0) {
+            AES_encrypt(nonce_counter, stream_block, &ctx->key);
+            for (int j = 15; j >= 0 && ++nonce_counter[j] == 0; --j) {
+            }
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 0x0F;
+    }
+    *nc_off = n;
+    return 0;
+}
+
+#endif // HOST_SHIM_MBEDTLS_AES_H
@@ -0,0 +1,103 @@
+#include "decoder_cache.h"
+
+#include <gtest/gtest.h>
+
+struct FakeDecoder {
+    static int instances;
+    int sample_rate;
+    int frame_duration;
+    int resets = 0;
+
+    FakeDecoder(int sample_rate, int channels, int frame_duration)
+        : sample_rate(sample_rate), frame_duration(frame_duration) {
+        instances++;
+    }
+    ~FakeDecoder() { instances--; }
+    void ResetState() { resets++; }
+};
+
+int FakeDecoder::instances = 0;
+
+struct FakeResampler {
+    int input_rate = 0;
+    int output_rate = 0;
+    int configured = 0;
+
+    void Configure(int input, int output) {
+        input_rate = input;
+        output_rate = output;
+        configured++;
+    }
+};
+
+using TestCache = DecoderCache<FakeDecoder, FakeResampler, 2>;
+
+class DecoderCacheTest : public ::testing::Test {
+protected:
+    TestCache cache;
+
+    void SetUp() override {
+        FakeDecoder::instances = 0;
+        cache.Initialize(24000);
+    }
+};
+
+TEST_F(DecoderCacheTest, SameFormatKeepsTheDecoder) {
+    auto& first = cache.Select(24000, 60);
+    auto* decoder = first.decoder.get();
+    for (int i = 0; i < 5; i++) {
+        auto& entry = cache.Select(24000, 60);
+        EXPECT_EQ(entry.decoder.get(), decoder);
+    }
+    EXPECT_EQ(decoder->resets, 0);
+    EXPECT_EQ(cache.stats().created, 1u);
+    EXPECT_EQ(cache.stats().hits, 0u);
+    // At the output rate, no resampling
+    EXPECT_EQ(first.resampler.configured, 0);
+    EXPECT_EQ(cache.current(), &first);
+}
+
+TEST_F(DecoderCacheTest, SwitchingBackIsALookup) {
+    auto* voice = cache.Select(24000, 60).decoder.get();
+    auto& sound = cache.Select(16000, 60);
+    EXPECT_EQ(sound.resampler.input_rate, 16000);
+    EXPECT_EQ(sound.resampler.output_rate, 24000);
+    auto* sound_decoder = sound.decoder.get();
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(cache.Select(24000, 60).decoder.get(), voice);
+        EXPECT_EQ(cache.Select(16000, 60).decoder.get(), sound_decoder);
+    }
+    EXPECT_EQ(cache.stats().created, 2u);
+    EXPECT_EQ(cache.stats().hits, 8u);
+    EXPECT_EQ(cache.stats().evicted, 0u);
+    EXPECT_EQ(FakeDecoder::instances, 2);
+    // The resampler was configured once, a cached decoder starts a new stream every time
+    EXPECT_EQ(sound.resampler.configured, 1);
+    EXPECT_EQ(sound_decoder->resets, 4);
+}
+
+TEST_F(DecoderCacheTest, FrameDurationIsPartOfTheKey) {
+    auto* a = cache.Select(16000, 60).decoder.get();
+    auto* b = cache.Select(16000, 20).decoder.get();
+    EXPECT_NE(a, b);
+    EXPECT_EQ(b->frame_duration, 20);
+    EXPECT_EQ(cache.stats().created, 2u);
+}
+
+TEST_F(DecoderCacheTest, EvictsTheLeastRecentlyUsedFormat) {
+    cache.Select(24000, 60);
+    cache.Select(16000, 60);
+    cache.Select(24000, 60);
+    // 16 kHz was used last longest ago
+    cache.Select(48000, 60);
+    EXPECT_EQ(cache.stats().evicted, 1u);
+    EXPECT_EQ(FakeDecoder::instances, 2);
+
+    cache.Select(24000, 60);
+    EXPECT_EQ(cache.stats().hits, 2u);
+    cache.Select(16000, 60);
+    EXPECT_EQ(cache.stats().created, 4u);
+    EXPECT_EQ(cache.stats().evicted, 2u);
+    EXPECT_EQ(cache.current()->sample_rate, 16000);
+}
@@ -0,0 +1,135 @@
+// Compares the DSP kernels with the per-sample loops they replaced, on one 60 ms stereo frame.
+//
+//   ./dsp_kernels_benchmark [iterations]
+
+#include "dsp_kernels.h"
+#include "output_gain.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace {
+
+constexpr size_t kFrames = 960;
+
+volatile int16_t sink;
+
+double MeasureNs(size_t iterations, const std::function<void()>& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+void Report(const char* name, double scalar_ns, double kernel_ns) {
+    std::printf("%-22s scalar %8.0f ns  kernel %8.0f ns  x%.2f\n", name, scalar_ns, kernel_ns, scalar_ns / kernel_ns);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    std::vector<int16_t> stereo(kFrames * 2);
+    for (size_t i = 0; i < stereo.size(); ++i) {
+        stereo[i] = static_cast<int16_t>(i * 7919);
+    }
+    std::vector<int16_t> left(kFrames), right(kFrames), out(kFrames * 2);
+    std::vector<float> floats(kFrames + 1);
+
+    Report("deinterleave2",
+        MeasureNs(iterations, [&]() {
+            for (size_t i = 0, j = 0; i < kFrames; ++i, j += 2) {
+                left[i] = stereo[j];
+                right[i] = stereo[j + 1];
+            }
+            sink = left[kFrames / 2];
+        }),
+        MeasureNs(iterations, [&]() {
+            DspDeinterleave2(stereo.data(), left.data(), right.data(), kFrames);
+            sink = left[kFrames / 2];
+        }));
+
+    Report("interleave2",
+        MeasureNs(iterations, [&]() {
+            for (size_t i = 0, j = 0; i < kFrames; ++i, j += 2) {
+                out[j] = left[i];
+                out[j + 1] = right[i];
+            }
+            sink = out[kFrames];
+        }),
+        MeasureNs(iterations, [&]() {
+            DspInterleave2(left.data(), right.data(), out.data(), kFrames);
+            sink = out[kFrames];
+        }));
+
+    Report("extract left",
+        MeasureNs(iterations, [&]() {
+            for (size_t i = 0, j = 0; i < kFrames; ++i, j += 2) {
+                left[i] = stereo[j];
+            }
+            sink = left[kFrames / 2];
+        }),
+        MeasureNs(iterations, [&]() {
+            DspExtractChannel(stereo.data(), left.data(), kFrames, 2, 0);
+            sink = left[kFrames / 2];
+        }));
+
+    Report("int16 to float",
+        MeasureNs(iterations, [&]() {
+            std::vector<float> result;
+            for (size_t i = 0; i < kFrames; ++i) {
+                result.push_back(static_cast<float>(left[i]));
+            }
+            sink = static_cast<int16_t>(result[kFrames / 2]);
+        }),
+        MeasureNs(iterations, [&]() {
+            DspInt16ToFloat(left.data(), floats.data(), kFrames);
+            sink = static_cast<int16_t>(floats[kFrames / 2]);
+        }));
+
+    // NoAudioCodec::Write: the volume factor from pow() on every write, then a 64-bit multiply per sample
+    std::vector<int32_t> slots(kFrames);
+    volatile int volume = 70;
+    OutputGain output_gain;
+    output_gain.Configure(16000, volume);
+    Report("volume to 32-bit",
+        MeasureNs(iterations, [&]() {
+            int32_t volume_factor = pow(double(volume) / 100.0, 2) * 65536;
+            for (size_t i = 0; i < kFrames; i++) {
+                int64_t temp = int64_t(left[i]) * volume_factor;
+                if (temp > INT32_MAX) {
+                    slots[i] = INT32_MAX;
+                } else if (temp < INT32_MIN) {
+                    slots[i] = INT32_MIN;
+                } else {
+                    slots[i] = static_cast<int32_t>(temp);
+                }
+            }
+            sink = static_cast<int16_t>(slots[kFrames / 2] >> 16);
+        }),
+        MeasureNs(iterations, [&]() {
+            output_gain.Process(left.data(), slots.data(), kFrames);
+            sink = static_cast<int16_t>(slots[kFrames / 2] >> 16);
+        }));
+
+    // The lilygo codecs: a float multiply per sample
+    Report("volume to 16-bit",
+        MeasureNs(iterations, [&]() {
+            for (size_t i = 0; i < kFrames; i++) {
+                right[i] = (float)left[i] * (float)(volume / 100.0);
+            }
+            sink = right[kFrames / 2];
+        }),
+        MeasureNs(iterations, [&]() {
+            output_gain.Process(left.data(), right.data(), kFrames);
+            sink = right[kFrames / 2];
+        }));
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "dsp_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// The loops the kernels replaced, kept as the reference
+void ReferenceDeinterleave2(const std::vector<int16_t>& data, std::vector<int16_t>& mic, std::vector<int16_t>& reference) {
+    mic.resize(data.size() / 2);
+    reference.resize(data.size() / 2);
+    for (size_t i = 0, j = 0; i < mic.size(); ++i, j += 2) {
+        mic[i] = data[j];
+        reference[i] = data[j + 1];
+    }
+}
+
+void ReferenceInterleave2(const std::vector<int16_t>& mic, const std::vector<int16_t>& reference, std::vector<int16_t>& data) {
+    data.resize(mic.size() + reference.size());
+    for (size_t i = 0, j = 0; i < mic.size(); ++i, j += 2) {
+        data[j] = mic[i];
+        data[j + 1] = reference[i];
+    }
+}
+
+void ReferenceLeftChannel(std::vector<int16_t>& data) {
+    for (size_t i = 0, j = 0; j < data.size(); ++i, j += 2) {
+        data[i] = data[j];
+    }
+    data.resize(data.size() / 2);
+}
+
+std::vector<float> ReferenceToFloat(const std::vector<int16_t>& audio_data) {
+    std::vector<float> result;
+    for (int16_t sample : audio_data) {
+        result.push_back(static_cast<float>(sample));
+    }
+    return result;
+}
+
+std::vector<int16_t> RandomSamples(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+    std::vector<int16_t> samples(count);
+    for (auto& sample : samples) {
+        sample = dist(rng);
+    }
+    // Make sure the extremes are covered
+    if (count >= 2) {
+        samples[0] = INT16_MIN;
+        samples[count - 1] = INT16_MAX;
+    }
+    return samples;
+}
+
+// Odd sizes exercise the scalar tail, offsets exercise the unaligned fallback
+const size_t kSizes[] = {0, 1, 2, 3, 7, 480, 961, 1920};
+const size_t kOffsets[] = {0, 1};
+
+} // namespace
+
+TEST(DspKernelsTest, DeinterleaveMatchesReference) {
+    for (size_t frames : kSizes) {
+        for (size_t offset : kOffsets) {
+            auto data = RandomSamples(frames * 2 + offset, frames);
+            std::vector<int16_t> input(data.begin() + offset, data.end());
+            std::vector<int16_t> mic, reference;
+            ReferenceDeinterleave2(input, mic, reference);
+
+            std::vector<int16_t> left(frames + offset), right(frames + 1);
+            DspDeinterleave2(data.data() + offset, left.data() + offset, right.data(), frames);
+            EXPECT_EQ(std::vector<int16_t>(left.begin() + offset, left.end()), mic) << frames << "/" << offset;
+            EXPECT_EQ(std::vector<int16_t>(right.begin(), right.begin() + frames), reference) << frames << "/" << offset;
+        }
+    }
+}
+
+TEST(DspKernelsTest, InterleaveMatchesReference) {
+    for (size_t frames : kSizes) {
+        for (size_t offset : kOffsets) {
+            auto mic = RandomSamples(frames, frames + 1);
+            auto reference = RandomSamples(frames, frames + 2);
+            std::vector<int16_t> expected;
+            ReferenceInterleave2(mic, reference, expected);
+
+            std::vector<int16_t> out(frames * 2 + offset);
+            DspInterleave2(mic.data(), reference.data(), out.data() + offset, frames);
+            EXPECT_EQ(std::vector<int16_t>(out.begin() + offset, out.end()), expected) << frames << "/" << offset;
+        }
+    }
+}
+
+TEST(DspKernelsTest, ExtractLeftChannelInPlaceMatchesReference) {
+    for (size_t frames : kSizes) {
+        auto expected = RandomSamples(frames * 2, frames + 3);
+        auto data = expected;
+        ReferenceLeftChannel(expected);
+        DspExtractChannel(data.data(), data.data(), data.size() / 2, 2, 0);
+        data.resize(data.size() / 2);
+        EXPECT_EQ(data, expected) << frames;
+    }
+}
+
+TEST(DspKernelsTest, ExtractAnyChannel) {
+    std::vector<int16_t> data = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    std::vector<int16_t> out(3);
+    DspExtractChannel(data.data(), out.data(), 3, 3, 2);
+    EXPECT_EQ(out, std::vector<int16_t>({3, 6, 9}));
+}
+
+TEST(DspKernelsTest, Int16ToFloatMatchesReference) {
+    for (size_t count : kSizes) {
+        auto data = RandomSamples(count, count + 4);
+        std::vector<float> out(count);
+        DspInt16ToFloat(data.data(), out.data(), count);
+        EXPECT_EQ(out, ReferenceToFloat(data)) << count;
+    }
+}
+
+// The sonic WiFi demodulator's former loop: static_cast<float>(sample) / 32768.0f
+TEST(DspKernelsTest, Int16ToFloatScaledMatchesDivision) {
+    for (size_t count : kSizes) {
+        auto data = RandomSamples(count, count + 5);
+        data.push_back(INT16_MIN);
+        data.push_back(INT16_MAX);
+        std::vector<float> out(data.size());
+        DspInt16ToFloat(data.data(), out.data(), data.size(), 1.0f / 32768.0f);
+        for (size_t i = 0; i < data.size(); ++i) {
+            ASSERT_EQ(out[i], static_cast<float>(data[i]) / 32768.0f) << count << " " << i;
+        }
+    }
+}
+
+TEST(DspKernelsTest, GainQ16MatchesReference) {
+    for (int32_t gain : {0, 1, 4096, 32112, 65535, 65536}) {
+        for (size_t count : kSizes) {
+            for (size_t offset : kOffsets) {
+                auto storage = RandomSamples(count + offset, uint32_t(count + gain));
+                const int16_t* in = storage.data() + offset;
+                std::vector<int16_t> expected(count);
+                std::vector<int32_t> expected32(count);
+                for (size_t i = 0; i < count; ++i) {
+                    expected[i] = int16_t((in[i] * gain + 0x8000) >> 16);
+                    expected32[i] = int32_t(in[i]) * gain;
+                }
+                std::vector<int16_t> out(count);
+                DspGainQ16(in, out.data(), count, gain);
+                EXPECT_EQ(out, expected) << gain << "/" << count << "/" << offset;
+
+                std::vector<int32_t> out32(count);
+                DspGainQ16ToInt32(in, out32.data(), count, gain);
+                EXPECT_EQ(out32, expected32) << gain << "/" << count << "/" << offset;
+
+                // In place
+                std::vector<int16_t> in_place(in, in + count);
+                DspGainQ16(in_place.data(), in_place.data(), count, gain);
+                EXPECT_EQ(in_place, expected) << gain << "/" << count << "/" << offset;
+            }
+        }
+    }
+}
+
+TEST(DspKernelsTest, MixGainQ16MatchesReference) {
+    for (int32_t gain : {0, 1, 4096, 32112, 65535, 65536}) {
+        for (size_t count : kSizes) {
+            for (size_t offset : kOffsets) {
+                auto storage = RandomSamples(count + offset, uint32_t(count + gain + 1));
+                const int16_t* in = storage.data() + offset;
+                auto mix = RandomSamples(count, uint32_t(count + 2));
+                std::vector<int32_t> expected(mix.begin(), mix.end());
+                for (size_t i = 0; i < count; ++i) {
+                    expected[i] += (in[i] * gain + 0x8000) >> 16;
+                }
+                std::vector<int32_t> acc(mix.begin(), mix.end());
+                DspMixGainQ16(in, acc.data(), count, gain);
+                EXPECT_EQ(acc, expected) << gain << "/" << count << "/" << offset;
+            }
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "frame_assembler.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+// 60 ms at 16 kHz
+static constexpr size_t kFrameSamples = 960;
+
+TEST(FrameAssemblerTest, OddChunksKeepFrameBoundaries) {
+    FrameAssembler assembler;
+    assembler.Configure(kFrameSamples);
+
+    std::vector<int16_t> stream(kFrameSamples * 7 + 123);
+    std::iota(stream.begin(), stream.end(), 0);
+
+    const size_t chunk_sizes[] = {1, 511, 512, 7, 960, 1000, 2000, 3};
+    std::vector<std::vector<int16_t>> frames;
+    size_t offset = 0;
+    for (size_t i = 0; offset < stream.size(); ++i) {
+        size_t n = std::min(chunk_sizes[i % std::size(chunk_sizes)], stream.size() - offset);
+        assembler.Append(stream.data() + offset, n, [&](std::vector<int16_t>& frame) {
+            frames.push_back(frame);
+        });
+        offset += n;
+    }
+
+    ASSERT_EQ(frames.size(), 7u);
+    for (size_t f = 0; f < frames.size(); ++f) {
+        ASSERT_EQ(frames[f].size(), kFrameSamples);
+        EXPECT_EQ(frames[f].front(), int16_t(f * kFrameSamples));
+        EXPECT_EQ(frames[f].back(), int16_t((f + 1) * kFrameSamples - 1));
+        EXPECT_TRUE(std::equal(frames[f].begin(), frames[f].end(), stream.begin() + f * kFrameSamples));
+    }
+    EXPECT_EQ(assembler.pending(), 123u);
+}
+
+TEST(FrameAssemblerTest, FramesAreReusedWithoutAllocation) {
+    FrameAssembler assembler;
+    assembler.Configure(kFrameSamples, 2);
+
+    std::vector<int16_t> chunk(kFrameSamples / 2 + 17, 1);
+    std::vector<const int16_t*> buffers;
+    for (int i = 0; i < 20; ++i) {
+        assembler.Append(chunk.data(), chunk.size(), [&](std::vector<int16_t>& frame) {
+            buffers.push_back(frame.data());
+        });
+    }
+
+    ASSERT_GE(buffers.size(), 4u);
+    EXPECT_NE(buffers[0], buffers[1]);
+    for (size_t i = 2; i < buffers.size(); ++i) {
+        EXPECT_EQ(buffers[i], buffers[i % 2]);
+    }
+}
+
+TEST(FrameAssemblerTest, MovedOutFrameIsReallocated) {
+    FrameAssembler assembler;
+    assembler.Configure(4, 1);
+
+    std::vector<int16_t> taken;
+    int16_t samples[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    int count = 0;
+    assembler.Append(samples, 8, [&](std::vector<int16_t>& frame) {
+        taken = std::move(frame);
+        EXPECT_EQ(taken.size(), 4u);
+        EXPECT_EQ(taken[0], samples[count * 4]);
+        ++count;
+    });
+    EXPECT_EQ(count, 2);
+}
+
+TEST(FrameAssemblerTest, ResetDropsThePartialFrame) {
+    FrameAssembler assembler;
+    assembler.Configure(4);
+
+    std::vector<std::vector<int16_t>> frames;
+    auto collect = [&](std::vector<int16_t>& frame) { frames.push_back(frame); };
+    int16_t stale[] = {9, 9, 9};
+    assembler.Append(stale, 3, collect);
+    assembler.Reset();
+
+    int16_t fresh[] = {1, 2, 3, 4};
+    assembler.Append(fresh, 4, collect);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0], std::vector<int16_t>({1, 2, 3, 4}));
+    EXPECT_EQ(assembler.pending(), 0u);
+}
+
+TEST(FrameAssemblerTest, RefusedFrameKeepsItsSlot) {
+    FrameAssembler assembler;
+    assembler.Configure(4, 2);
+
+    // The consumer holds the first frame and refuses the next ones, as a full queue does
+    std::vector<int16_t> stream(4 * 6);
+    std::iota(stream.begin(), stream.end(), 0);
+    const int16_t* held = nullptr;
+    std::vector<const int16_t*> refused;
+    assembler.Append(stream.data(), stream.size(), [&](std::vector<int16_t>& frame) {
+        if (held == nullptr) {
+            held = frame.data();
+            return true;
+        }
+        refused.push_back(frame.data());
+        return false;
+    });
+
+    ASSERT_EQ(refused.size(), 5u);
+    for (auto data : refused) {
+        EXPECT_NE(data, held);
+    }
+    // The held frame was not written over
+    EXPECT_TRUE(std::equal(held, held + 4, stream.begin()));
+}
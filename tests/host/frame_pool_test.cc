@@ -0,0 +1,113 @@
+#include "audio_stream_packet.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+
+// Heap allocations made by this test binary, to check that a warm pool does not allocate
+static size_t allocations;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+TEST(FramePoolTest, RecyclesTheSameObjectWithItsBuffer) {
+    FramePool<AudioStreamPacket> pool(4);
+    pool.Initialize(256, 1);
+
+    auto packet = pool.Acquire();
+    auto object = packet.get();
+    auto storage = packet->payload.data();
+    EXPECT_GE(packet->payload.capacity(), 256u);
+    packet->sequence = 7;
+    packet->headroom = 16;
+    packet->payload.resize(100);
+    packet.reset();
+
+    packet = pool.Acquire();
+    EXPECT_EQ(packet.get(), object);
+    EXPECT_EQ(packet->payload.data(), storage);
+    // Every field but the buffer storage is reset
+    EXPECT_EQ(packet->sequence, 0u);
+    EXPECT_EQ(packet->headroom, 0u);
+    EXPECT_TRUE(packet->payload.empty());
+    EXPECT_GE(packet->payload.capacity(), 256u);
+}
+
+TEST(FramePoolTest, CountsAllocationsAndGrownBuffers) {
+    FramePool<AudioStreamPacket> pool(4);
+    pool.Initialize(64, 2);
+    {
+        auto a = pool.Acquire();
+        auto b = pool.Acquire();
+        auto c = pool.Acquire();  // The pool is empty, this one is created
+        b->payload.resize(1000);  // Outgrows its buffer
+    }
+    auto stats = pool.GetStats();
+    EXPECT_EQ(stats.acquired, 3u);
+    EXPECT_EQ(stats.allocated, 1u);
+    EXPECT_EQ(stats.grown, 1u);
+    EXPECT_EQ(stats.released, 0u);
+    EXPECT_EQ(stats.cached, 3u);
+}
+
+TEST(FramePoolTest, DeletesFramesBeyondMaxCached) {
+    FramePool<AudioStreamPacket> pool(2);
+    {
+        std::vector<AudioStreamPacketPtr> packets;
+        for (int i = 0; i < 5; ++i) {
+            packets.push_back(pool.Acquire());
+        }
+    }
+    auto stats = pool.GetStats();
+    EXPECT_EQ(stats.allocated, 5u);
+    EXPECT_EQ(stats.cached, 2u);
+    EXPECT_EQ(stats.released, 3u);
+}
+
+TEST(FramePoolTest, PlainHandlesAreDeletedAsUsual) {
+    FramePool<AudioStreamPacket> pool(2);
+    AudioStreamPacketPtr packet = std::make_unique<AudioStreamPacket>();
+    packet.reset();
+    EXPECT_EQ(pool.GetStats().cached, 0u);
+}
+
+TEST(FramePoolTest, WarmPoolDoesNotAllocate) {
+    constexpr size_t kInFlight = 6;
+    FramePool<AudioStreamPacket> pool(kInFlight);
+    pool.Initialize(256, kInFlight);
+    std::vector<AudioStreamPacketPtr> in_flight;
+    in_flight.reserve(kInFlight);
+
+    // A pipeline at steady state: frames are acquired, filled within the reserved size and released
+    allocations = 0;
+    for (int round = 0; round < 1000; ++round) {
+        while (in_flight.size() < kInFlight) {
+            auto packet = pool.Acquire();
+            packet->headroom = AUDIO_PACKET_HEADROOM;
+            packet->payload.resize(AUDIO_PACKET_HEADROOM + 120 + round % 100);
+            in_flight.push_back(std::move(packet));
+        }
+        in_flight.erase(in_flight.begin(), in_flight.begin() + round % kInFlight + 1);
+    }
+    in_flight.clear();
+    EXPECT_EQ(allocations, 0u);
+
+    auto stats = pool.GetStats();
+    EXPECT_EQ(stats.allocated, 0u);
+    EXPECT_EQ(stats.grown, 0u);
+    EXPECT_EQ(stats.cached, kInFlight);
+}
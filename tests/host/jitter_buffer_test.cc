@@ -0,0 +1,241 @@
+#include "jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+class JitterBufferTest : public ::testing::Test {
+protected:
+    FramePool<AudioStreamPacket> pool_{32};
+    JitterBuffer buffer_;
+
+    void Put(uint32_t sequence, int64_t now_ms, int frame_duration = 60) {
+        auto packet = pool_.Acquire();
+        packet->sequence = sequence;
+        packet->frame_duration = frame_duration;
+        packet->payload.assign(1, uint8_t(sequence));
+        buffer_.Put(std::move(packet), now_ms);
+    }
+
+    // Sequence of the packet to decode, 0 to conceal, -1 to wait
+    int64_t Get(int64_t now_ms) {
+        AudioStreamPacketPtr packet;
+        switch (buffer_.Get(packet, now_ms)) {
+            case kJitterBufferPacket:
+                return packet->sequence;
+            case kJitterBufferConceal:
+                return 0;
+            default:
+                return -1;
+        }
+    }
+};
+
+} // namespace
+
+TEST_F(JitterBufferTest, WaitsWhenEmpty) {
+    EXPECT_EQ(Get(0), -1);
+    EXPECT_TRUE(buffer_.Empty());
+}
+
+TEST_F(JitterBufferTest, PutsReorderedPacketsBackInOrder) {
+    Put(1, 0);
+    Put(3, 1);
+    Put(2, 2);
+    EXPECT_EQ(Get(3), 1);
+    EXPECT_EQ(Get(63), 2);
+    EXPECT_EQ(Get(123), 3);
+    auto stats = buffer_.GetStats();
+    EXPECT_EQ(stats.lost, 0u);
+    EXPECT_EQ(stats.late, 0u);
+    EXPECT_EQ(stats.concealed, 0u);
+}
+
+TEST_F(JitterBufferTest, DropsLateAndDuplicatePackets) {
+    Put(1, 0);
+    Put(2, 60);
+    EXPECT_EQ(Get(60), 1);
+    EXPECT_EQ(Get(120), 2);
+    // Its turn has passed
+    Put(1, 130);
+    // Already buffered
+    Put(3, 180);
+    Put(3, 181);
+    EXPECT_EQ(Get(181), 3);
+    EXPECT_EQ(Get(240), -1);
+    EXPECT_EQ(buffer_.GetStats().late, 2u);
+}
+
+TEST_F(JitterBufferTest, ConcealsAMissingPacket) {
+    Put(1, 0);
+    Put(3, 120);
+    EXPECT_EQ(Get(0), 1);
+    EXPECT_EQ(Get(120), 0);
+    EXPECT_EQ(Get(180), 3);
+    auto stats = buffer_.GetStats();
+    EXPECT_EQ(stats.lost, 1u);
+    EXPECT_EQ(stats.concealed, 1u);
+}
+
+TEST_F(JitterBufferTest, SkipsABurstLongerThanTheConcealment) {
+    Put(1, 0);
+    Put(7, 360);
+    EXPECT_EQ(Get(0), 1);
+    for (int i = 0; i < JITTER_BUFFER_MAX_CONCEALED_FRAMES; ++i) {
+        EXPECT_EQ(Get(360), 0);
+    }
+    // 2 to 4 were concealed, 5 and 6 are skipped
+    EXPECT_EQ(Get(360), 7);
+    auto stats = buffer_.GetStats();
+    EXPECT_EQ(stats.concealed, uint32_t(JITTER_BUFFER_MAX_CONCEALED_FRAMES));
+    EXPECT_EQ(stats.lost, 5u);
+}
+
+TEST_F(JitterBufferTest, CountsAnUnderrun) {
+    Put(1, 0);
+    EXPECT_EQ(Get(0), 1);
+    EXPECT_EQ(Get(60), -1);
+    EXPECT_EQ(buffer_.GetStats().underruns, 1u);
+    // Playback restarts at the next packet once it has buffered again, the gap is not a loss
+    Put(2, 200);
+    EXPECT_EQ(Get(200 + JITTER_BUFFER_MAX_DEPTH * 60), 2);
+    EXPECT_EQ(buffer_.GetStats().lost, 0u);
+}
+
+TEST_F(JitterBufferTest, TargetDepthFollowsTheJitter) {
+    // Packets on time keep the minimum depth
+    for (uint32_t sequence = 1; sequence <= 20; ++sequence) {
+        Put(sequence, sequence * 60);
+        Get(sequence * 60);
+    }
+    EXPECT_EQ(buffer_.GetStats().target_depth, uint32_t(JITTER_BUFFER_MIN_DEPTH));
+
+    // Arrivals 100 ms early or late raise it
+    for (uint32_t sequence = 21; sequence <= 60; ++sequence) {
+        int64_t offset = sequence % 2 ? 100 : -100;
+        Put(sequence, sequence * 60 + offset);
+        Get(sequence * 60 + offset);
+    }
+    auto stats = buffer_.GetStats();
+    EXPECT_GT(stats.jitter_ms, 100u);
+    EXPECT_GT(stats.target_depth, uint32_t(JITTER_BUFFER_MIN_DEPTH));
+    EXPECT_LE(stats.target_depth, uint32_t(JITTER_BUFFER_MAX_DEPTH));
+}
+
+TEST_F(JitterBufferTest, BuffersToTheTargetDepthBeforePlaying) {
+    for (uint32_t sequence = 1; sequence <= 40; ++sequence) {
+        int64_t offset = sequence % 2 ? 150 : -150;
+        Put(sequence, sequence * 60 + offset);
+        Get(sequence * 60 + offset);
+    }
+    uint32_t target_depth = buffer_.GetStats().target_depth;
+    ASSERT_GT(target_depth, 1u);
+
+    // A new stream starts buffering again
+    buffer_.Reset();
+    int64_t now_ms = 10000;
+    Put(100, now_ms);
+    EXPECT_EQ(Get(now_ms), -1);
+    // Plays once the target depth is reached
+    for (uint32_t i = 1; i < target_depth; ++i) {
+        Put(100 + i, now_ms);
+    }
+    EXPECT_EQ(Get(now_ms), 100);
+}
+
+TEST_F(JitterBufferTest, StartsPlayingAfterWaitingForTheTargetDepth) {
+    for (uint32_t sequence = 1; sequence <= 40; ++sequence) {
+        int64_t offset = sequence % 2 ? 150 : -150;
+        Put(sequence, sequence * 60 + offset);
+        Get(sequence * 60 + offset);
+    }
+    uint32_t target_depth = buffer_.GetStats().target_depth;
+    buffer_.Reset();
+    Put(100, 10000);
+    EXPECT_EQ(Get(10000), -1);
+    // A short stream is not held back for longer than the target depth would take to play
+    EXPECT_EQ(Get(10000 + target_depth * 60), 100);
+}
+
+TEST_F(JitterBufferTest, ResynchronizesOnASequenceJump) {
+    Put(1, 0);
+    EXPECT_EQ(Get(0), 1);
+    Put(1000, 60);
+    EXPECT_EQ(Get(60), 1000);
+    EXPECT_EQ(buffer_.GetStats().lost, 0u);
+}
+
+TEST_F(JitterBufferTest, NumbersPacketsWithoutASequenceInArrivalOrder) {
+    Put(0, 0);
+    Put(0, 1);
+    Put(0, 2);
+    EXPECT_EQ(Get(2), 1);
+    EXPECT_EQ(Get(62), 2);
+    EXPECT_EQ(Get(122), 3);
+}
+
+TEST_F(JitterBufferTest, GivesUpTheOldestFramesWhenFallingBehind) {
+    Put(1, 0);
+    EXPECT_EQ(Get(0), 1);
+    // The sender ran a whole buffer ahead of the playback
+    for (uint32_t sequence = 2; sequence <= 2 + JITTER_BUFFER_SLOTS; ++sequence) {
+        Put(sequence, 60);
+    }
+    EXPECT_EQ(Get(60), 3);
+    EXPECT_EQ(buffer_.GetStats().lost, 1u);
+}
+
+TEST_F(JitterBufferTest, ReplaysALossyTraceInOrder) {
+    // A lossy cellular link: 60 ms frames, up to 250 ms of jitter, 5% loss and a 6 frame burst
+    constexpr uint32_t kPackets = 2000;
+    struct Arrival {
+        int64_t time_ms;
+        uint32_t sequence;
+    };
+    std::vector<Arrival> trace;
+    uint32_t seed = 12345;
+    auto random = [&seed](uint32_t range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    };
+    for (uint32_t sequence = 1; sequence <= kPackets; ++sequence) {
+        if (random(100) < 5 || (sequence >= 1000 && sequence < 1006)) {
+            continue;
+        }
+        trace.push_back({int64_t(sequence) * 60 + random(250), sequence});
+    }
+    std::stable_sort(trace.begin(), trace.end(), [](const Arrival& a, const Arrival& b) {
+        return a.time_ms < b.time_ms;
+    });
+
+    size_t next_arrival = 0;
+    uint32_t last_played = 0;
+    uint32_t played = 0;
+    bool in_order = true;
+    for (int64_t now_ms = 0; now_ms < int64_t(kPackets + 20) * 60; now_ms += 60) {
+        while (next_arrival < trace.size() && trace[next_arrival].time_ms <= now_ms) {
+            Put(trace[next_arrival].sequence, trace[next_arrival].time_ms);
+            next_arrival++;
+        }
+        int64_t sequence = Get(now_ms);
+        if (sequence > 0) {
+            in_order = in_order && uint32_t(sequence) > last_played;
+            last_played = sequence;
+            played++;
+        }
+    }
+
+    auto stats = buffer_.GetStats();
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(last_played, kPackets);
+    // Every frame was played, arrived too late, or is counted as lost
+    EXPECT_EQ(played + stats.lost, kPackets);
+    EXPECT_LE(stats.concealed, stats.lost);
+    EXPECT_GT(stats.concealed, 0u);
+    EXPECT_EQ(stats.depth, 0u);
+    // The target depth absorbs most of the jitter
+    EXPECT_LT(stats.late, kPackets / 20);
+}
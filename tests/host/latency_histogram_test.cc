@@ -0,0 +1,64 @@
+#include "latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+TEST(LatencyHistogramTest, BucketsAreContiguous) {
+    for (uint32_t us = 0; us < 100000; ++us) {
+        size_t bucket = LatencyHistogram::BucketOf(us);
+        ASSERT_LE(LatencyHistogram::LowerBound(bucket), us);
+        ASSERT_GT(LatencyHistogram::LowerBound(bucket + 1), us);
+    }
+    EXPECT_EQ(LatencyHistogram::BucketOf(UINT32_MAX), size_t(LATENCY_HISTOGRAM_BUCKETS - 1));
+}
+
+TEST(LatencyHistogramTest, EmptyHistogramReportsZero) {
+    LatencyHistogram histogram;
+    auto percentiles = histogram.GetPercentiles();
+    EXPECT_EQ(percentiles.count, 0u);
+    EXPECT_EQ(percentiles.p50_us, 0u);
+    EXPECT_EQ(percentiles.max_us, 0u);
+}
+
+TEST(LatencyHistogramTest, PercentilesAreWithinABucket) {
+    LatencyHistogram histogram;
+    for (uint32_t i = 1; i <= 1000; ++i) {
+        histogram.Record(i * 100);
+    }
+    auto percentiles = histogram.GetPercentiles();
+    EXPECT_EQ(percentiles.count, 1000u);
+    EXPECT_EQ(percentiles.max_us, 100000u);
+    EXPECT_GE(percentiles.p50_us, 50000u);
+    EXPECT_LE(percentiles.p50_us, 50000u * 5 / 4);
+    EXPECT_GE(percentiles.p90_us, 90000u);
+    EXPECT_LE(percentiles.p90_us, 90000u * 5 / 4);
+    EXPECT_GE(percentiles.p99_us, 99000u);
+    EXPECT_LE(percentiles.p99_us, 99000u * 5 / 4);
+}
+
+TEST(LatencyHistogramTest, OutliersGoToTheLastBucket) {
+    LatencyHistogram histogram;
+    histogram.Record(10);
+    histogram.Record(60000000);
+    EXPECT_EQ(histogram.Percentile(100), 60000000u);
+    EXPECT_LT(histogram.Percentile(50), 12u);
+}
+
+TEST(LatencyHistogramTest, ResetClearsEverything) {
+    LatencyHistogram histogram;
+    histogram.Record(1234);
+    histogram.Reset();
+    EXPECT_EQ(histogram.GetPercentiles().count, 0u);
+    EXPECT_EQ(histogram.Percentile(99), 0u);
+}
+
+TEST(LatencyHistogramTest, AddMergesHistograms) {
+    LatencyHistogram a, b;
+    a.Record(100);
+    b.Record(5000);
+    b.Record(5000);
+    a.Add(b);
+    EXPECT_EQ(a.GetPercentiles().count, 3u);
+    EXPECT_EQ(a.GetPercentiles().max_us, 5000u);
+    EXPECT_LT(a.Percentile(30), 200u);
+    EXPECT_GE(a.Percentile(50), 5000u);
+}
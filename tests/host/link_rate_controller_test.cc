@@ -0,0 +1,181 @@
+#include "link_rate_controller.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+static constexpr size_t kSendQueueCapacity = 40;
+// IP + UDP headers and the 16-byte nonce of the MQTT+UDP transport
+static constexpr int kPacketOverheadBytes = 20 + 8 + 16;
+
+// The encoder queues one packet per 60 ms frame of the audio processor
+static constexpr int kTaskMs = 60;
+
+/*
+ * A link with a fixed uplink bandwidth in front of the device's send queue, and a downlink that
+ * drops a fixed share of the server's 60 ms packets. Each Step() is one second of talking.
+ */
+class SimulatedLink {
+public:
+    SimulatedLink(int bandwidth_bytes_per_second, int loss_percent)
+        : bandwidth_(bandwidth_bytes_per_second), loss_percent_(loss_percent) {}
+
+    void SetBandwidth(int bytes_per_second) { bandwidth_ = bytes_per_second; }
+    void SetLoss(int percent) { loss_percent_ = percent; }
+
+    LinkSample Step(const LinkAudioProfile& profile) {
+        LinkSample sample;
+        sample.send_queue_capacity = kSendQueueCapacity;
+
+        int packet_bytes = LinkAudioBitrate(profile) / 8 * profile.frame_duration_ms / 1000 + kPacketOverheadBytes;
+        double drain_per_task = double(bandwidth_) * kTaskMs / 1000 / packet_bytes;
+        for (int i = 0; i < 1000 / kTaskMs; ++i) {
+            if (backlog_ + 1 > kSendQueueCapacity) {
+                sample.send_failures++;
+            } else {
+                backlog_ += 1;
+            }
+            sample.packets_sent++;
+            sample.send_queue_peak = std::max(sample.send_queue_peak, size_t(backlog_ + 0.999));
+            backlog_ = std::max(0.0, backlog_ - drain_per_task);
+        }
+
+        for (int i = 0; i < 1000 / kTaskMs; ++i) {
+            loss_accumulator_ += loss_percent_;
+            if (loss_accumulator_ >= 100) {
+                loss_accumulator_ -= 100;
+                sample.packets_lost++;
+            } else {
+                sample.packets_received++;
+            }
+        }
+        return sample;
+    }
+
+private:
+    int bandwidth_;
+    int loss_percent_;
+    double backlog_ = 0;
+    int loss_accumulator_ = 0;
+};
+
+struct RunResult {
+    LinkQuality final_quality;
+    int changes;
+};
+
+static RunResult RunLink(LinkRateController& controller, SimulatedLink& link, int seconds) {
+    RunResult result{controller.quality(), 0};
+    for (int i = 0; i < seconds; ++i) {
+        if (controller.Update(link.Step(controller.profile()))) {
+            result.changes++;
+        }
+    }
+    result.final_quality = controller.quality();
+    return result;
+}
+
+TEST(LinkRateControllerTest, GoodLinkKeepsTheDefaultProfile) {
+    LinkRateController controller;
+    SimulatedLink link(100000, 0);
+    auto result = RunLink(controller, link, 60);
+    // Nothing to step up to, the server is never sent a new profile
+    EXPECT_EQ(result.final_quality, kLinkQualityNormal);
+    EXPECT_EQ(result.changes, 0);
+}
+
+TEST(LinkRateControllerTest, NarrowLinkSettlesOnALevelItCanCarry) {
+    LinkRateController controller;
+    // 16 kbit/s: the normal profile needs 2.8 kB/s, the poor one 2.2 kB/s, the bad one 1.7 kB/s
+    SimulatedLink link(2000, 0);
+    RunLink(controller, link, 20);
+    EXPECT_EQ(controller.quality(), kLinkQualityBad);
+    EXPECT_TRUE(controller.profile().fec);
+    EXPECT_TRUE(controller.profile().dtx);
+
+    // Failed probes of the poor level back off, so it does not flap
+    auto result = RunLink(controller, link, 600);
+    EXPECT_LE(result.changes, 12);
+    EXPECT_EQ(result.final_quality, kLinkQualityBad);
+}
+
+TEST(LinkRateControllerTest, LossTurnsOnFec) {
+    LinkRateController controller;
+    SimulatedLink link(100000, 5);
+    auto result = RunLink(controller, link, 120);
+    EXPECT_EQ(result.final_quality, kLinkQualityPoor);
+    EXPECT_EQ(result.changes, 1);
+    EXPECT_TRUE(controller.profile().fec);
+    EXPECT_GT(controller.profile().packet_loss_percent, 0);
+}
+
+TEST(LinkRateControllerTest, HeavyLossStepsDownToBad) {
+    LinkRateController controller;
+    SimulatedLink link(100000, 20);
+    auto result = RunLink(controller, link, 30);
+    EXPECT_EQ(result.final_quality, kLinkQualityBad);
+}
+
+TEST(LinkRateControllerTest, RecoversWhenTheLinkImproves) {
+    LinkRateController controller;
+    SimulatedLink link(1500, 20);
+    RunLink(controller, link, 30);
+    EXPECT_EQ(controller.quality(), kLinkQualityBad);
+
+    link.SetBandwidth(100000);
+    link.SetLoss(0);
+    RunLink(controller, link, 120);
+    EXPECT_EQ(controller.quality(), kLinkQualityNormal);
+}
+
+TEST(LinkRateControllerTest, IdleWindowsChangeNothing) {
+    LinkRateController controller;
+    for (int i = 0; i < 100; ++i) {
+        LinkSample idle;
+        idle.send_queue_capacity = kSendQueueCapacity;
+        EXPECT_FALSE(controller.Update(idle));
+    }
+    EXPECT_EQ(controller.quality(), kLinkQualityNormal);
+}
+
+TEST(LinkRateControllerTest, LossWhileIdleCountsInTheNextActiveWindow) {
+    LinkRateController controller;
+    LinkSample speaking;
+    speaking.packets_received = 90;
+    speaking.packets_lost = 10;
+    EXPECT_FALSE(controller.Update(speaking));
+
+    LinkSample listening;
+    listening.packets_sent = 16;
+    listening.send_queue_capacity = kSendQueueCapacity;
+    EXPECT_TRUE(controller.Update(listening));
+    EXPECT_EQ(controller.quality(), kLinkQualityPoor);
+}
+
+TEST(LinkRateControllerTest, SendFailureStepsDownAtOnce) {
+    LinkRateController controller;
+    LinkSample sample;
+    sample.packets_sent = 50;
+    sample.send_failures = 1;
+    sample.send_queue_capacity = kSendQueueCapacity;
+    EXPECT_TRUE(controller.Update(sample));
+    EXPECT_EQ(controller.quality(), kLinkQualityPoor);
+    // The next windows let the queue drain before judging again
+    EXPECT_FALSE(controller.Update(sample));
+}
+
+TEST(LinkRateControllerTest, DefaultProfileMatchesTheFixedEncoder) {
+    LinkRateController controller;
+    EXPECT_EQ(controller.profile().frame_duration_ms, 60);
+    EXPECT_FALSE(controller.profile().fec);
+    EXPECT_FALSE(controller.profile().dtx);
+    // The bitrate is left to libopus, as before
+    EXPECT_EQ(controller.profile().bitrate, LINK_AUDIO_BITRATE_AUTO);
+    EXPECT_EQ(LinkAudioBitrate(controller.profile()), 17000);
+}
+
+TEST(LinkRateControllerTest, EveryProfileKeepsTheProcessorFrames) {
+    for (int quality = 0; quality < kLinkQualityCount; ++quality) {
+        EXPECT_EQ(LinkRateController::ProfileOf(LinkQuality(quality)).frame_duration_ms, 60) << quality;
+    }
+}
@@ -0,0 +1,56 @@
+#include "opus_packet_ring.h"
+
+#include <gtest/gtest.h>
+
+static std::vector<uint8_t> Packet(uint8_t id, size_t size = 3) {
+    return std::vector<uint8_t>(size, id);
+}
+
+TEST(OpusPacketRingTest, PopsInOrder) {
+    OpusPacketRing ring(4, 16);
+    ring.Push(Packet(1));
+    ring.Push(Packet(2, 5));
+    std::vector<uint8_t> packet;
+    ASSERT_TRUE(ring.Pop(packet));
+    EXPECT_EQ(packet, Packet(1));
+    ASSERT_TRUE(ring.Pop(packet));
+    EXPECT_EQ(packet, Packet(2, 5));
+    EXPECT_FALSE(ring.Pop(packet));
+}
+
+TEST(OpusPacketRingTest, KeepsTheMostRecentPackets) {
+    OpusPacketRing ring(3, 16);
+    for (uint8_t i = 0; i < 10; ++i) {
+        ring.Push(Packet(i));
+    }
+    EXPECT_EQ(ring.Size(), 3u);
+    EXPECT_EQ(ring.overwritten(), 7u);
+    std::vector<uint8_t> packet;
+    for (uint8_t i = 7; i < 10; ++i) {
+        ASSERT_TRUE(ring.Pop(packet));
+        EXPECT_EQ(packet[0], i);
+    }
+    EXPECT_TRUE(ring.Empty());
+}
+
+TEST(OpusPacketRingTest, BuffersAreRecycled) {
+    OpusPacketRing ring(2, 64);
+    std::vector<uint8_t> packet;
+    packet.reserve(64);
+    for (int round = 0; round < 10; ++round) {
+        ring.Push(Packet(uint8_t(round)));
+        ASSERT_TRUE(ring.Pop(packet));
+        EXPECT_GE(packet.capacity(), 64u);
+    }
+}
+
+TEST(OpusPacketRingTest, ClearDropsEverything) {
+    OpusPacketRing ring(2, 16);
+    ring.Push(Packet(1));
+    ring.Clear();
+    std::vector<uint8_t> packet;
+    EXPECT_FALSE(ring.Pop(packet));
+    ring.Push(Packet(2));
+    ASSERT_TRUE(ring.Pop(packet));
+    EXPECT_EQ(packet[0], 2);
+}
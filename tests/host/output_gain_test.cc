@@ -0,0 +1,104 @@
+#include "output_gain.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// The loop NoAudioCodec::Write ran before, kept as the reference
+void ReferenceVolume(const int16_t* data, int32_t* buffer, int samples, int volume) {
+    int32_t volume_factor = pow(double(volume) / 100.0, 2) * 65536;
+    for (int i = 0; i < samples; i++) {
+        int64_t temp = int64_t(data[i]) * volume_factor;
+        if (temp > INT32_MAX) {
+            buffer[i] = INT32_MAX;
+        } else if (temp < INT32_MIN) {
+            buffer[i] = INT32_MIN;
+        } else {
+            buffer[i] = static_cast<int32_t>(temp);
+        }
+    }
+}
+
+std::vector<int16_t> Frame(size_t count) {
+    std::vector<int16_t> frame(count);
+    for (size_t i = 0; i < count; ++i) {
+        frame[i] = int16_t(i * 7919);
+    }
+    frame[0] = INT16_MIN;
+    frame[1] = INT16_MAX;
+    return frame;
+}
+
+} // namespace
+
+TEST(OutputGainTest, VolumeCurveMatchesFormerFloatingPoint) {
+    for (int volume = 0; volume <= 100; ++volume) {
+        EXPECT_EQ(OutputGain::VolumeToGain(volume), int32_t(pow(double(volume) / 100.0, 2) * 65536)) << volume;
+    }
+    EXPECT_EQ(OutputGain::VolumeToGain(-5), 0);
+    EXPECT_EQ(OutputGain::VolumeToGain(120), OUTPUT_GAIN_UNITY);
+}
+
+TEST(OutputGainTest, SettledGainIsBitExactWithFormerLoop) {
+    auto frame = Frame(960);
+    for (int volume : {0, 10, 33, 70, 100}) {
+        OutputGain gain;
+        gain.Configure(16000, volume);
+        std::vector<int32_t> expected(frame.size()), out(frame.size());
+        ReferenceVolume(frame.data(), expected.data(), frame.size(), volume);
+        gain.Process(frame.data(), out.data(), frame.size());
+        EXPECT_EQ(out, expected) << volume;
+    }
+}
+
+TEST(OutputGainTest, VolumeChangeRampsOverTheRampTime) {
+    OutputGain gain;
+    gain.Configure(16000, 100);
+    gain.SetVolume(0);
+
+    // A full-scale constant: the output follows the gain, one step per sample
+    const size_t ramp_samples = 16000 * OUTPUT_GAIN_RAMP_MS / 1000;
+    std::vector<int16_t> frame(ramp_samples * 2, 16384);
+    std::vector<int16_t> out(frame.size());
+    gain.Process(frame.data(), out.data(), frame.size());
+
+    for (size_t i = 1; i < out.size(); ++i) {
+        EXPECT_LE(out[i], out[i - 1]) << i;
+        // No step larger than the ramp allows
+        EXPECT_LE(out[i - 1] - out[i], 16384 / int(ramp_samples) + 1) << i;
+    }
+    EXPECT_GT(out[ramp_samples / 2], 0);
+    EXPECT_EQ(out[ramp_samples + 1], 0);
+    EXPECT_EQ(gain.gain(), 0);
+}
+
+TEST(OutputGainTest, RampContinuesAcrossWrites) {
+    OutputGain gain;
+    gain.Configure(24000, 0);
+    gain.SetVolume(100);
+
+    std::vector<int16_t> frame(64, 1000);
+    std::vector<int32_t> out(frame.size());
+    int32_t last = -1;
+    for (int write = 0; write < 20; ++write) {
+        gain.Process(frame.data(), out.data(), frame.size());
+        for (int32_t sample : out) {
+            EXPECT_GE(sample, last);
+            last = sample;
+        }
+    }
+    EXPECT_EQ(gain.gain(), OUTPUT_GAIN_UNITY);
+    EXPECT_EQ(last, 1000 * OUTPUT_GAIN_UNITY);
+}
+
+TEST(OutputGainTest, UnityPassesThroughInPlace) {
+    OutputGain gain;
+    gain.Configure(16000, 100);
+    auto frame = Frame(961);
+    auto data = frame;
+    gain.Process(data.data(), data.data(), data.size());
+    EXPECT_EQ(data, frame);
+}
@@ -0,0 +1,102 @@
+#include "host_audio_pipeline.h"
+#include "host_rtos.h"
+
+#include <chrono>
+#include <thread>
+
+static int64_t WallTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HostAudioPipeline::HostAudioPipeline(std::vector<int16_t> input, int input_sample_rate, int output_sample_rate)
+    : codec_(std::move(input), input_sample_rate, output_sample_rate) {
+    service_.Initialize(&codec_);
+
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        send_cv_.notify_all();
+    };
+    service_.SetCallbacks(callbacks);
+    service_.Start();
+}
+
+HostAudioPipeline::~HostAudioPipeline() {
+    service_.Stop();
+    HostJoinTasks();
+}
+
+std::vector<AudioStreamPacket> HostAudioPipeline::Capture(PipelineStageStats& stats) {
+    // Every complete frame of the input, the silence read after its end is not waited for
+    size_t frame_samples = size_t(codec_.input_sample_rate()) * OPUS_FRAME_DURATION_MS / 1000;
+    size_t frames = codec_.input_size() / frame_samples;
+    int target_ms = frames * OPUS_FRAME_DURATION_MS;
+    std::vector<AudioStreamPacket> packets;
+
+    service_.EnableVoiceProcessing(true);
+    // The input task sleeps a while before the first read (the microphone warmup), that is not measured
+    while (codec_.input_read() == 0 && codec_.input_size() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int64_t cpu_start = HostTaskCpuTimeUs("audio_input") + HostTaskCpuTimeUs("opus_encode");
+    int64_t wall_start = WallTimeUs();
+    int encoded_ms = 0;
+    while (encoded_ms < target_ms) {
+        auto packet = service_.PopPacketFromSendQueue();
+        if (packet) {
+            encoded_ms += packet->frame_duration;
+            packets.push_back(*packet);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        send_cv_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    service_.EnableVoiceProcessing(false);
+
+    stats.frames = frames;
+    stats.wall_us = WallTimeUs() - wall_start;
+    stats.cpu_us = HostTaskCpuTimeUs("audio_input") + HostTaskCpuTimeUs("opus_encode") - cpu_start;
+    return packets;
+}
+
+bool HostAudioPipeline::Playback(const std::vector<AudioStreamPacket>& packets, std::string_view sound,
+    PipelineStageStats& stats, int timeout_ms) {
+    int64_t cpu_start = HostTaskCpuTimeUs("opus_decode") + HostTaskCpuTimeUs("audio_output");
+    int64_t wall_start = WallTimeUs();
+    size_t written_start = codec_.output_written();
+
+    if (!sound.empty()) {
+        service_.PlaySound(sound);
+    }
+    uint32_t sequence = 1;
+    int64_t voice_ms = 0;
+    for (auto& source : packets) {
+        auto packet = std::make_unique<AudioStreamPacket>(source);
+        // Captured packets keep the transport headroom, a received packet is the Opus data alone
+        packet->payload.erase(packet->payload.begin(), packet->payload.begin() + packet->headroom);
+        packet->headroom = 0;
+        packet->sequence = sequence++;
+        voice_ms += packet->frame_duration;
+        service_.PushPacketToDecodeQueue(AudioStreamPacketPtr(packet.release()), true);
+    }
+
+    size_t expected = written_start + voice_ms * codec_.output_sample_rate() / 1000;
+    int64_t deadline = wall_start + int64_t(timeout_ms) * 1000;
+    while (codec_.output_written() < expected || !service_.IsIdle()) {
+        if (WallTimeUs() > deadline) {
+            return false;
+        }
+        if (!codec_.WaitForOutput(expected, 10)) {
+            // Nothing moves the clock while the pipeline waits (e.g. for the jitter buffer to fill), let time pass
+            HostClockAdvanceTo(esp_timer_get_time() + 10000);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    stats.frames = voice_ms / OPUS_FRAME_DURATION_MS;
+    stats.wall_us = WallTimeUs() - wall_start;
+    stats.cpu_us = HostTaskCpuTimeUs("opus_decode") + HostTaskCpuTimeUs("audio_output") - cpu_start;
+    return true;
+}
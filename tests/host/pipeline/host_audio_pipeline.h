@@ -0,0 +1,48 @@
+#ifndef HOST_AUDIO_PIPELINE_H
+#define HOST_AUDIO_PIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+
+struct PipelineStageStats {
+    size_t frames = 0;      // OPUS_FRAME_DURATION_MS frames through the stage
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;     // Used by the tasks of the stage
+};
+
+/*
+ * AudioService on a WavAudioCodec, run one direction at a time:
+ *   Capture():  codec input -> audio_input -> NoAudioProcessor -> opus_encode -> send queue
+ *   Playback(): decode queue -> opus_decode -> mixer -> audio_output -> codec output
+ * Both run as fast as the tasks go, the stats say how fast that was.
+ */
+class HostAudioPipeline {
+public:
+    HostAudioPipeline(std::vector<int16_t> input, int input_sample_rate, int output_sample_rate);
+    ~HostAudioPipeline();
+
+    // Encodes the whole input, returns the packets in order
+    std::vector<AudioStreamPacket> Capture(PipelineStageStats& stats);
+    // Plays the packets as the voice stream, and `sound` (an Ogg Opus file) over it if given. Packets
+    // from Capture() are stripped of their transport headroom, as the server would receive them.
+    // Returns once everything has been written to the codec, false on timeout.
+    bool Playback(const std::vector<AudioStreamPacket>& packets, std::string_view sound, PipelineStageStats& stats,
+        int timeout_ms = 60000);
+
+    AudioService& service() { return service_; }
+    WavAudioCodec& codec() { return codec_; }
+
+private:
+    WavAudioCodec codec_;
+    AudioService service_;
+    std::mutex mutex_;
+    std::condition_variable send_cv_;
+};
+
+#endif // HOST_AUDIO_PIPELINE_H
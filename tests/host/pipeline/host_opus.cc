@@ -0,0 +1,65 @@
+#include "opus_decoder.h"
+#include "opus_resampler.h"
+
+OpusDecoderWrapper::OpusDecoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+    int error;
+    audio_dec_ = opus_decoder_create(sample_rate, channels, &error);
+    frame_size_ = sample_rate / 1000 * channels * duration_ms;
+}
+
+OpusDecoderWrapper::~OpusDecoderWrapper() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_dec_ != nullptr) {
+        opus_decoder_destroy(audio_dec_);
+    }
+}
+
+bool OpusDecoderWrapper::Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_dec_ == nullptr) {
+        return false;
+    }
+    pcm.resize(frame_size_);
+    const uint8_t* data = opus.empty() ? nullptr : opus.data();
+    int samples = opus_decode(audio_dec_, data, opus.size(), pcm.data(), frame_size_ / channels_, 0);
+    if (samples < 0) {
+        return false;
+    }
+    pcm.resize(samples * channels_);
+    return true;
+}
+
+void OpusDecoderWrapper::ResetState() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio_dec_ != nullptr) {
+        opus_decoder_ctl(audio_dec_, OPUS_RESET_STATE);
+    }
+}
+
+void OpusResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    last_sample_ = 0;
+}
+
+int OpusResampler::GetOutputSamples(int input_samples) const {
+    return int(int64_t(input_samples) * output_sample_rate_ / input_sample_rate_);
+}
+
+void OpusResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    if (input_samples <= 0) {
+        return;
+    }
+    // Output sample i sits at input position i * in / out, between the input sample before it and the one at it
+    int output_samples = GetOutputSamples(input_samples);
+    for (int i = 0; i < output_samples; i++) {
+        int64_t position = int64_t(i) * input_sample_rate_ * 65536 / output_sample_rate_;
+        int index = int(position >> 16);
+        int32_t fraction = int32_t(position & 0xFFFF);
+        int32_t before = index > 0 ? input[index - 1] : last_sample_;
+        int32_t at = input[index];
+        output[i] = int16_t(before + (((at - before) * fraction) >> 16));
+    }
+    last_sample_ = input[input_samples - 1];
+}
@@ -0,0 +1,312 @@
+#include "host_rtos.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <esp_timer.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Tasks */
+
+struct HostTask {
+    std::string name;
+    std::thread thread;
+    bool finished = false;
+    int64_t cpu_time_us = 0;    // Set when the task returns
+
+    // A task that never returns (a worker of an object that lives until the process exits) is left running
+    ~HostTask() {
+        if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+};
+
+static std::mutex tasks_mutex;
+static std::list<std::unique_ptr<HostTask>> tasks;
+
+static int64_t ThreadCpuTimeUs(clockid_t clock) {
+    timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    auto task = std::make_unique<HostTask>();
+    HostTask* self = task.get();
+    self->name = name;
+    self->thread = std::thread([self, function, arg]() {
+        function(arg);
+        // Taken while the thread still exists, HostTaskCpuTimeUs() reads it from here on
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        self->cpu_time_us = ThreadCpuTimeUs(CLOCK_THREAD_CPUTIME_ID);
+        self->finished = true;
+    });
+    if (handle != nullptr) {
+        *handle = self;
+    }
+    tasks.push_back(std::move(task));
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* task_buffer) {
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, &handle, tskNO_AFFINITY);
+    return handle;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return TickType_t(esp_timer_get_time() / 1000);
+}
+
+void HostJoinTasks() {
+    while (true) {
+        HostTask* task = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            for (auto& t : tasks) {
+                if (t->thread.joinable()) {
+                    task = t.get();
+                    break;
+                }
+            }
+        }
+        if (task == nullptr) {
+            return;
+        }
+        task->thread.join();
+    }
+}
+
+int64_t HostTaskCpuTimeUs(const char* name) {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    int64_t total = 0;
+    for (auto& task : tasks) {
+        if (task->name != name) {
+            continue;
+        }
+        if (task->finished) {
+            total += task->cpu_time_us;
+            continue;
+        }
+        clockid_t clock;
+        if (pthread_getcpuclockid(task->thread.native_handle(), &clock) == 0) {
+            total += ThreadCpuTimeUs(clock);
+        }
+    }
+    return total;
+}
+
+/* Event groups */
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [&]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool met;
+    if (ticks == portMAX_DELAY) {
+        group->cv.wait(lock, satisfied);
+        met = true;
+    } else {
+        met = group->cv.wait_for(lock, std::chrono::milliseconds(ticks), satisfied);
+    }
+    // Like FreeRTOS, the bits as they were before clearing
+    EventBits_t result = group->bits;
+    if (met && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+/* Timers, fired in real time by one dispatcher thread */
+
+struct HostTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed = false;
+    bool periodic = false;
+    std::chrono::microseconds period{0};
+    std::chrono::steady_clock::time_point deadline;
+};
+
+class TimerDispatcher {
+public:
+    ~TimerDispatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+            cv_.notify_all();
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    std::mutex& mutex() { return mutex_; }
+
+    // Call with the mutex held after arming a timer
+    void Wake() {
+        if (!thread_.joinable()) {
+            thread_ = std::thread([this]() { Loop(); });
+        }
+        cv_.notify_all();
+    }
+
+    void Add(HostTimer* timer) { timers_.push_back(timer); }
+    void Remove(HostTimer* timer) { timers_.remove(timer); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::list<HostTimer*> timers_;
+    std::thread thread_;
+    bool stopped_ = false;
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopped_) {
+            HostTimer* next = nullptr;
+            for (auto timer : timers_) {
+                if (timer->armed && (next == nullptr || timer->deadline < next->deadline)) {
+                    next = timer;
+                }
+            }
+            if (next == nullptr) {
+                cv_.wait(lock);
+                continue;
+            }
+            if (std::chrono::steady_clock::now() < next->deadline) {
+                cv_.wait_until(lock, next->deadline);
+                continue;
+            }
+
+            if (next->periodic) {
+                next->deadline += next->period;
+            } else {
+                next->armed = false;
+            }
+            // The callback may stop or restart its own timer
+            auto callback = next->callback;
+            auto arg = next->arg;
+            lock.unlock();
+            callback(arg);
+            lock.lock();
+        }
+    }
+};
+
+static TimerDispatcher& Dispatcher() {
+    static TimerDispatcher dispatcher;
+    return dispatcher;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    auto timer = new HostTimer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    std::lock_guard<std::mutex> lock(Dispatcher().mutex());
+    Dispatcher().Add(timer);
+    *handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t StartTimer(esp_timer_handle_t timer, uint64_t period_us, bool periodic) {
+    std::lock_guard<std::mutex> lock(Dispatcher().mutex());
+    if (timer->armed) {
+        return ESP_FAIL;
+    }
+    timer->armed = true;
+    timer->periodic = periodic;
+    timer->period = std::chrono::microseconds(period_us);
+    timer->deadline = std::chrono::steady_clock::now() + timer->period;
+    Dispatcher().Wake();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return StartTimer(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return StartTimer(timer, period_us, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(Dispatcher().mutex());
+    if (!timer->armed) {
+        return ESP_FAIL;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    {
+        std::lock_guard<std::mutex> lock(Dispatcher().mutex());
+        Dispatcher().Remove(timer);
+    }
+    delete timer;
+    return ESP_OK;
+}
@@ -0,0 +1,14 @@
+#ifndef HOST_RTOS_H
+#define HOST_RTOS_H
+
+#include <cstdint>
+
+// Host pipeline extensions to the FreeRTOS shim
+
+// Waits until every task created so far has returned
+void HostJoinTasks();
+
+// CPU time used by the tasks with this name so far, running or finished
+int64_t HostTaskCpuTimeUs(const char* name);
+
+#endif // HOST_RTOS_H
@@ -0,0 +1,37 @@
+#include "wake_words/esp_wake_word.h"
+
+// The host build has no wake word engine, AudioService only refers to EspWakeWord when models are found
+
+EspWakeWord::EspWakeWord() {
+}
+
+EspWakeWord::~EspWakeWord() {
+}
+
+bool EspWakeWord::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
+    return false;
+}
+
+void EspWakeWord::Feed(const int16_t* data, size_t samples) {
+}
+
+void EspWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) {
+    wake_word_detected_callback_ = callback;
+}
+
+void EspWakeWord::Start() {
+}
+
+void EspWakeWord::Stop() {
+}
+
+size_t EspWakeWord::GetFeedSize() {
+    return 0;
+}
+
+void EspWakeWord::EncodeWakeWordData() {
+}
+
+bool EspWakeWord::GetWakeWordOpus(std::vector<uint8_t>& opus) {
+    return false;
+}
@@ -0,0 +1,6 @@
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+// The host pipeline has no board, AudioCodec only includes this for the firmware build
+
+#endif // HOST_BOARD_H
@@ -0,0 +1,20 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <cstdint>
+#include <cstdlib>
+
+// One heap on the host, the capabilities are ignored
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return std::malloc(size);
+}
+
+inline void heap_caps_free(void* ptr) {
+    std::free(ptr);
+}
+
+#endif // HOST_ESP_HEAP_CAPS_H
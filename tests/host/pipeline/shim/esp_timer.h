@@ -0,0 +1,49 @@
+#ifndef HOST_PIPELINE_ESP_TIMER_H
+#define HOST_PIPELINE_ESP_TIMER_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "esp_err.h"
+
+/*
+ * The fake clock of the host pipeline: esp_timer_get_time() is the furthest any audio source has
+ * got (see HostClockAdvanceTo()), so the pipeline sees audio time however fast it runs.
+ * Timers are not driven by it, they fire in real time on a dispatcher thread (see host_rtos.cc).
+ */
+inline std::atomic<int64_t> host_time_us{0};
+
+inline int64_t esp_timer_get_time() {
+    return host_time_us.load(std::memory_order_relaxed);
+}
+
+// Moves the clock forward to `time_us`, never backwards
+inline void HostClockAdvanceTo(int64_t time_us) {
+    int64_t now = host_time_us.load(std::memory_order_relaxed);
+    while (time_us > now && !host_time_us.compare_exchange_weak(now, time_us, std::memory_order_relaxed)) {
+    }
+}
+
+typedef struct HostTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+#endif // HOST_PIPELINE_ESP_TIMER_H
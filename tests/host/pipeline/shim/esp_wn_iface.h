@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_WN_IFACE_H
+#define HOST_ESP_WN_IFACE_H
+
+// Opaque on the host, EspWakeWord is declared but never created
+typedef struct esp_wn_iface_t esp_wn_iface_t;
+typedef struct model_iface_data_t model_iface_data_t;
+
+#endif // HOST_ESP_WN_IFACE_H
@@ -0,0 +1,4 @@
+#ifndef HOST_ESP_WN_MODELS_H
+#define HOST_ESP_WN_MODELS_H
+
+#endif // HOST_ESP_WN_MODELS_H
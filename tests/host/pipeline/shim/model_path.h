@@ -0,0 +1,17 @@
+#ifndef HOST_MODEL_PATH_H
+#define HOST_MODEL_PATH_H
+
+// No speech models on the host, so no wake word engine is ever selected
+typedef struct {
+    char** model_name;
+    int num;
+} srmodel_list_t;
+
+#define ESP_WN_PREFIX "wn"
+#define ESP_MN_PREFIX "mn"
+
+inline char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2) {
+    return nullptr;
+}
+
+#endif // HOST_MODEL_PATH_H
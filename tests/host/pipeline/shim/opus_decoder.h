@@ -0,0 +1,32 @@
+#ifndef HOST_OPUS_DECODER_H
+#define HOST_OPUS_DECODER_H
+
+#include <opus.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// The esp-opus-encoder decoder wrapper, on the system libopus (see host_opus.cc)
+class OpusDecoderWrapper {
+public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    // An empty packet conceals a lost frame
+    bool Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+private:
+    std::mutex mutex_;
+    OpusDecoder* audio_dec_ = nullptr;
+    int frame_size_;
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+};
+
+#endif // HOST_OPUS_DECODER_H
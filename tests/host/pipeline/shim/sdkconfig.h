@@ -0,0 +1,12 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+// The Kconfig defaults the audio pipeline reads, for a board without an audio processor
+#define CONFIG_OPUS_ENCODE_TASK_CORE 1
+#define CONFIG_OPUS_ENCODE_TASK_PRIORITY 2
+#define CONFIG_OPUS_ENCODE_TASK_STACK_SIZE 26624
+#define CONFIG_OPUS_DECODE_TASK_CORE 0
+#define CONFIG_OPUS_DECODE_TASK_PRIORITY 2
+#define CONFIG_OPUS_DECODE_TASK_STACK_SIZE 12288
+
+#endif // HOST_SDKCONFIG_H
@@ -0,0 +1,134 @@
+#include "wav_audio_codec.h"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+WavAudioCodec::WavAudioCodec(std::vector<int16_t> input, int input_sample_rate, int output_sample_rate)
+    : input_(std::move(input)) {
+    duplex_ = true;
+    input_reference_ = false;
+    input_channels_ = 1;
+    output_channels_ = 1;
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+}
+
+WavAudioCodec::~WavAudioCodec() {
+}
+
+int WavAudioCodec::Read(int16_t* dest, int samples) {
+    int64_t time_us;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = std::min<size_t>(samples, input_.size() - input_position_);
+        std::copy_n(input_.data() + input_position_, count, dest);
+        std::fill(dest + count, dest + samples, 0);
+        input_position_ += count;
+        input_total_ += samples;
+        time_us = int64_t(input_total_) * 1000000 / input_sample_rate_;
+    }
+    HostClockAdvanceTo(time_us);
+    return samples;
+}
+
+int WavAudioCodec::Write(const int16_t* data, int samples) {
+    int64_t time_us;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        output_.insert(output_.end(), data, data + samples);
+        time_us = int64_t(output_.size()) * 1000000 / output_sample_rate_;
+    }
+    output_cv_.notify_all();
+    HostClockAdvanceTo(time_us);
+    return samples;
+}
+
+size_t WavAudioCodec::input_read() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return input_position_;
+}
+
+size_t WavAudioCodec::output_written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return output_.size();
+}
+
+bool WavAudioCodec::WaitForOutput(size_t samples, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return output_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, samples]() {
+        return output_.size() >= samples;
+    });
+}
+
+std::vector<int16_t> WavAudioCodec::GetOutput() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return output_;
+}
+
+/* RIFF / WAVE, little-endian hosts only */
+
+struct WavFormat {
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+};
+
+bool WavAudioCodec::LoadWav(const std::string& path, std::vector<int16_t>& samples, int& sample_rate) {
+    std::ifstream file(path, std::ios::binary);
+    char riff[12];
+    if (!file.read(riff, sizeof(riff)) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    WavFormat format = {};
+    bool has_format = false;
+    char id[4];
+    uint32_t size;
+    while (file.read(id, 4) && file.read(reinterpret_cast<char*>(&size), 4)) {
+        if (memcmp(id, "fmt ", 4) == 0 && size >= sizeof(WavFormat)) {
+            file.read(reinterpret_cast<char*>(&format), sizeof(WavFormat));
+            file.seekg(size - sizeof(WavFormat) + (size & 1), std::ios::cur);
+            has_format = true;
+        } else if (memcmp(id, "data", 4) == 0) {
+            if (!has_format || format.format != 1 || format.bits_per_sample != 16 || format.channels == 0) {
+                return false;
+            }
+            std::vector<int16_t> data(size / 2);
+            file.read(reinterpret_cast<char*>(data.data()), data.size() * 2);
+            data.resize(file.gcount() / 2);
+            samples.resize(data.size() / format.channels);
+            for (size_t i = 0; i < samples.size(); i++) {
+                samples[i] = data[i * format.channels];
+            }
+            sample_rate = format.sample_rate;
+            return true;
+        } else {
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return false;
+}
+
+bool WavAudioCodec::SaveWav(const std::string& path, const std::vector<int16_t>& samples, int sample_rate) {
+    std::ofstream file(path, std::ios::binary);
+    uint32_t data_size = samples.size() * 2;
+    uint32_t riff_size = 4 + 8 + sizeof(WavFormat) + 8 + data_size;
+    WavFormat format = {1, 1, uint32_t(sample_rate), uint32_t(sample_rate) * 2, 2, 16};
+    uint32_t format_size = sizeof(WavFormat);
+    file.write("RIFF", 4);
+    file.write(reinterpret_cast<const char*>(&riff_size), 4);
+    file.write("WAVEfmt ", 8);
+    file.write(reinterpret_cast<const char*>(&format_size), 4);
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write("data", 4);
+    file.write(reinterpret_cast<const char*>(&data_size), 4);
+    file.write(reinterpret_cast<const char*>(samples.data()), data_size);
+    return bool(file);
+}
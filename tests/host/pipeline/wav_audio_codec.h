@@ -0,0 +1,47 @@
+#ifndef WAV_AUDIO_CODEC_H
+#define WAV_AUDIO_CODEC_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio_codec.h"
+
+/*
+ * A mono codec for the host pipeline: the microphone plays back a PCM buffer (e.g. loaded from a
+ * WAV file) once and then hears silence, and the speaker output is collected in memory.
+ *
+ * Reads and writes never block, the pipeline runs as fast as the CPU allows. The codec is the
+ * fake clock: every read and write moves esp_timer_get_time() to the audio time it has reached.
+ */
+class WavAudioCodec : public AudioCodec {
+public:
+    WavAudioCodec(std::vector<int16_t> input, int input_sample_rate, int output_sample_rate);
+    virtual ~WavAudioCodec();
+
+    // 16-bit PCM WAV files, a stereo file is read as its left channel
+    static bool LoadWav(const std::string& path, std::vector<int16_t>& samples, int& sample_rate);
+    static bool SaveWav(const std::string& path, const std::vector<int16_t>& samples, int sample_rate);
+
+    size_t input_size() const { return input_.size(); }
+    // Samples of the input read so far, silence after its end not counted
+    size_t input_read() const;
+    size_t output_written() const;
+    // Waits until at least `samples` samples were written, false on timeout
+    bool WaitForOutput(size_t samples, int timeout_ms);
+    std::vector<int16_t> GetOutput() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable output_cv_;
+    std::vector<int16_t> input_;
+    size_t input_position_ = 0;
+    size_t input_total_ = 0;        // Including silence, for the clock
+    std::vector<int16_t> output_;
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+};
+
+#endif // WAV_AUDIO_CODEC_H
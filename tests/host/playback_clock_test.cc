@@ -0,0 +1,102 @@
+#include "playback_clock.h"
+
+#include <gtest/gtest.h>
+
+static constexpr int kOutputRate = 24000;
+static constexpr uint32_t kFrameSamples = kOutputRate * 60 / 1000;
+static constexpr int64_t kBaseUs = 5000000;
+
+// Plays `frames` 60 ms frames of contiguous server time, each `frame_us` long on the local clock
+static void Play(PlaybackClock& clock, uint32_t server_ms, int64_t start_us, int frames, double frame_us = 60000) {
+    for (int i = 0; i < frames; i++) {
+        clock.OnPlayout(server_ms + i * 60, start_us + int64_t(i * frame_us), kFrameSamples, kOutputRate);
+    }
+}
+
+TEST(PlaybackClockTest, StampsTheVoicePlayingAtCapture) {
+    PlaybackClock clock;
+    Play(clock, 1000, kBaseUs, 5);
+
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs, 60000), 1000u);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 30000, 60000), 1030u);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 4 * 60000 + 59000, 60000), 1299u);
+    // Not aligned to frames: the stamp follows the sample, not the queue order
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 125000, 60000), 1125u);
+    EXPECT_EQ(clock.GetStats().stamped, 4u);
+}
+
+TEST(PlaybackClockTest, FrameOverlappingTheStartOfTheVoice) {
+    PlaybackClock clock;
+    Play(clock, 1000, kBaseUs, 2);
+    // Captured from 20 ms before the first sample played
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs - 20000, 60000), 980u);
+    // Entirely before or after the voice
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs - 80000, 60000), 0u);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 120000, 60000), 0u);
+    EXPECT_EQ(clock.GetStats().unstamped, 2u);
+}
+
+TEST(PlaybackClockTest, ForgetsOldAndFlushedPlayout) {
+    PlaybackClock clock;
+    Play(clock, 1000, kBaseUs, PLAYBACK_CLOCK_SEGMENTS + 4);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 10000, 60000), 0u);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 4 * 60000, 60000), 1240u);
+
+    clock.ResetPlayout();
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 10 * 60000, 60000), 0u);
+}
+
+TEST(PlaybackClockTest, MeasuresDriftAgainstTheServerTimeline) {
+    PlaybackClock clock;
+    // The DAC runs 200 ppm slow: every frame lasts a little longer on the local clock
+    Play(clock, 1000, kBaseUs, 50, 60000 * 1.0002);
+    auto stats = clock.GetStats();
+    EXPECT_NEAR(stats.drift_ppm, 200, 5);
+    EXPECT_NEAR(stats.slip_us, 49 * 12, 2);
+    EXPECT_EQ(stats.resyncs, 0u);
+}
+
+TEST(PlaybackClockTest, SpansWithinAFrameAddUp) {
+    PlaybackClock clock;
+    // A frame played in two runs, split by the mixer at a block boundary
+    clock.OnPlayout(1000, kBaseUs, 1000, kOutputRate);
+    clock.OnPlayout(1000 + 1000 * 1000 / kOutputRate, kBaseUs + 1000 * 1000000LL / kOutputRate,
+        kFrameSamples - 1000, kOutputRate);
+    clock.OnPlayout(1060, kBaseUs + 60000, kFrameSamples, kOutputRate);
+    auto stats = clock.GetStats();
+    EXPECT_EQ(stats.resyncs, 0u);
+    EXPECT_LE(std::abs(stats.slip_us), 1);
+}
+
+TEST(PlaybackClockTest, JumpsStartANewRun) {
+    PlaybackClock clock;
+    Play(clock, 1000, kBaseUs, 10);
+    // A new response: the server timestamps restart
+    Play(clock, 0, kBaseUs + 10 * 60000, 10);
+    EXPECT_EQ(clock.GetStats().resyncs, 1u);
+    // An underrun: the same server timeline continues 100 ms late
+    Play(clock, 600, kBaseUs + 20 * 60000 + 100000, 10);
+    auto stats = clock.GetStats();
+    EXPECT_EQ(stats.resyncs, 2u);
+    EXPECT_EQ(stats.slip_us, 0);
+    EXPECT_EQ(clock.ServerTimeAt(kBaseUs + 20 * 60000 + 100000, 60000), 600u);
+}
+
+TEST(PlaybackClockTest, CaptureTimeFollowsTheSamplePosition) {
+    PlaybackClock clock;
+    EXPECT_EQ(clock.OnCaptureOutput(960), 0);
+    clock.ResetCapture();
+
+    // Reads of 512 samples (32 ms), processed frames of 960 (60 ms)
+    int64_t now = kBaseUs;
+    for (int i = 0; i < 4; i++) {
+        now += 32000;
+        clock.OnCapture(512, now);
+    }
+    EXPECT_EQ(clock.OnCaptureOutput(960), kBaseUs);
+    EXPECT_EQ(clock.OnCaptureOutput(960), kBaseUs + 60000);
+    // Later reads do not change the time of earlier samples
+    now += 32000;
+    clock.OnCapture(512, now);
+    EXPECT_EQ(clock.OnCaptureOutput(960), kBaseUs + 120000);
+}
@@ -0,0 +1,168 @@
+#include "record_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+RecordHeader MakeHeader(uint32_t samples, int64_t time_us, uint32_t sample_rate = 16000) {
+    RecordHeader header;
+    header.sample_rate = sample_rate;
+    header.samples = samples;
+    header.time_us = time_us;
+    return header;
+}
+
+std::vector<int16_t> Ramp(size_t count, int16_t first) {
+    std::vector<int16_t> pcm(count);
+    for (size_t i = 0; i < count; ++i) {
+        pcm[i] = int16_t(first + i);
+    }
+    return pcm;
+}
+
+}  // namespace
+
+TEST(RecordRingTest, RoundsCapacityDownToPowerOfTwo) {
+    std::vector<uint8_t> buffer(1000);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+    EXPECT_EQ(ring.capacity(), 512u);
+    ring.Attach(buffer.data(), 512);
+    EXPECT_EQ(ring.capacity(), 512u);
+}
+
+TEST(RecordRingTest, PopsRecordsInPushOrder) {
+    std::vector<uint8_t> buffer(4096);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+
+    auto first = Ramp(160, 0);
+    auto second = Ramp(80, 1000);
+    ASSERT_TRUE(ring.Push(MakeHeader(160, 10000), first.data()));
+    ASSERT_TRUE(ring.Push(MakeHeader(80, 20000, 24000), second.data()));
+
+    RecordHeader header;
+    std::vector<int16_t> pcm;
+    ASSERT_TRUE(ring.Pop(header, pcm));
+    EXPECT_EQ(header.samples, 160u);
+    EXPECT_EQ(header.time_us, 10000);
+    EXPECT_EQ(pcm, first);
+    ASSERT_TRUE(ring.Pop(header, pcm));
+    EXPECT_EQ(header.sample_rate, 24000u);
+    EXPECT_EQ(pcm, second);
+    EXPECT_FALSE(ring.Pop(header, pcm));
+    EXPECT_EQ(ring.Used(), 0u);
+}
+
+TEST(RecordRingTest, KeepsOneChannelOfInterleavedPcm) {
+    std::vector<uint8_t> buffer(4096);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+
+    // More frames than the gather block, mic on even samples and reference on odd ones
+    std::vector<int16_t> interleaved(2 * 150);
+    for (size_t i = 0; i < 150; ++i) {
+        interleaved[2 * i] = int16_t(i);
+        interleaved[2 * i + 1] = int16_t(-int(i));
+    }
+    ASSERT_TRUE(ring.Push(MakeHeader(150, 0), interleaved.data(), 2, 0));
+    ASSERT_TRUE(ring.Push(MakeHeader(150, 0), interleaved.data(), 2, 1));
+
+    RecordHeader header;
+    std::vector<int16_t> pcm;
+    ASSERT_TRUE(ring.Pop(header, pcm));
+    ASSERT_EQ(pcm.size(), 150u);
+    for (size_t i = 0; i < 150; ++i) {
+        EXPECT_EQ(pcm[i], int16_t(i));
+    }
+    ASSERT_TRUE(ring.Pop(header, pcm));
+    for (size_t i = 0; i < 150; ++i) {
+        EXPECT_EQ(pcm[i], int16_t(-int(i)));
+    }
+}
+
+TEST(RecordRingTest, DropsRecordsThatDoNotFit) {
+    std::vector<uint8_t> buffer(1024);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+
+    // 16 bytes of header and 320 of PCM: three records fit in 1024 bytes, the fourth does not
+    auto frame = Ramp(160, 0);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(ring.Push(MakeHeader(160, i), frame.data()));
+    }
+    EXPECT_FALSE(ring.Push(MakeHeader(160, 3), frame.data()));
+    EXPECT_EQ(ring.dropped(), 1u);
+
+    // The records already in the ring are untouched
+    EXPECT_TRUE(ring.Drop());
+    EXPECT_TRUE(ring.Push(MakeHeader(160, 4), frame.data()));
+    RecordHeader header;
+    ASSERT_TRUE(ring.Peek(header));
+    EXPECT_EQ(header.time_us, 1);
+}
+
+TEST(RecordRingTest, RecordsWrapAroundTheEnd) {
+    std::vector<uint8_t> buffer(1024);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+
+    // Record sizes that do not divide the capacity, so headers and PCM straddle the end
+    int64_t next_push = 0;
+    int64_t next_pop = 0;
+    std::vector<int16_t> pcm;
+    for (int round = 0; round < 500; ++round) {
+        size_t samples = 37 + round % 101;
+        auto frame = Ramp(samples, int16_t(next_push));
+        while (ring.Push(MakeHeader(samples, next_push), frame.data())) {
+            next_push++;
+            frame = Ramp(samples, int16_t(next_push));
+        }
+        RecordHeader header;
+        ASSERT_TRUE(ring.Pop(header, pcm));
+        EXPECT_EQ(header.time_us, next_pop);
+        EXPECT_EQ(pcm, Ramp(header.samples, int16_t(next_pop)));
+        next_pop++;
+    }
+}
+
+TEST(RecordRingTest, ProducerAndConsumerOnTwoThreads) {
+    std::vector<uint8_t> buffer(8192);
+    RecordRing ring;
+    ring.Attach(buffer.data(), buffer.size());
+
+    const int kRecords = 20000;
+    int pushed = 0;
+    std::thread producer([&]() {
+        for (int i = 0; i < kRecords; ++i) {
+            auto frame = Ramp(1 + i % 200, int16_t(i));
+            if (ring.Push(MakeHeader(frame.size(), i), frame.data())) {
+                pushed++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Records come out whole and in order; the ones that found the ring full are missing
+    int popped = 0;
+    int64_t last = -1;
+    std::vector<int16_t> pcm;
+    RecordHeader header;
+    while (popped + int(ring.dropped()) < kRecords) {
+        if (!ring.Pop(header, pcm)) {
+            continue;
+        }
+        bool intact = header.time_us > last && pcm.size() == size_t(1 + header.time_us % 200) &&
+            pcm == Ramp(pcm.size(), int16_t(header.time_us));
+        EXPECT_TRUE(intact) << "record " << header.time_us << " after " << last;
+        last = header.time_us;
+        popped++;
+    }
+    producer.join();
+    EXPECT_EQ(popped, pushed);
+    EXPECT_EQ(pushed + int(ring.dropped()), kRecords);
+}
@@ -0,0 +1,111 @@
+#include "silence_gate.h"
+
+#include <gtest/gtest.h>
+
+static constexpr size_t kFrameSamples = 960;
+
+struct Emitted {
+    int64_t id;
+    bool silent;
+};
+
+// Frame i carries i as its tag, and i in its first sample
+class SilenceGateTest : public ::testing::Test {
+protected:
+    SilenceGate<> gate;
+    std::vector<Emitted> emitted;
+    int64_t next_id = 0;
+
+    void SetUp() override {
+        gate.Configure(kFrameSamples, 3, 2);
+    }
+
+    void Feed(bool speaking, int frames = 1) {
+        for (int i = 0; i < frames; ++i) {
+            std::vector<int16_t> pcm(kFrameSamples, 0);
+            pcm[0] = int16_t(next_id);
+            gate.Process(pcm, next_id, speaking, [this](const std::vector<int16_t>& frame, int64_t id, bool silent) {
+                ASSERT_EQ(frame.size(), kFrameSamples);
+                ASSERT_EQ(frame[0], int16_t(id));
+                emitted.push_back({id, silent});
+            });
+            next_id++;
+        }
+    }
+};
+
+TEST_F(SilenceGateTest, OffPassesEverything) {
+    Feed(false, 20);
+    ASSERT_EQ(emitted.size(), 20u);
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(emitted[i].id, i);
+        EXPECT_FALSE(emitted[i].silent);
+    }
+}
+
+TEST_F(SilenceGateTest, HangoverKeepsTheGateOpen) {
+    gate.SetMode(kSilenceGateDrop);
+    Feed(true, 2);
+    Feed(false, 2);
+    EXPECT_EQ(emitted.size(), 4u);
+    Feed(false, 10);
+    EXPECT_EQ(emitted.size(), 4u);
+    EXPECT_EQ(gate.stats().passed, 4u);
+    EXPECT_EQ(gate.stats().dropped, 7u);
+    EXPECT_EQ(gate.held_frames(), 3u);
+}
+
+TEST_F(SilenceGateTest, OnsetFlushesThePreroll) {
+    gate.SetMode(kSilenceGateDrop);
+    Feed(false, 10);  // 0, 1 hangover; 2..6 dropped; 7, 8, 9 held
+    emitted.clear();
+    Feed(true);
+    ASSERT_EQ(emitted.size(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(emitted[i].id, 7 + i);
+        EXPECT_FALSE(emitted[i].silent);
+    }
+    EXPECT_EQ(gate.held_frames(), 0u);
+}
+
+TEST_F(SilenceGateTest, DtxModeKeepsEveryFrameInOrder) {
+    gate.SetMode(kSilenceGateDtx);
+    Feed(true, 3);
+    Feed(false, 12);
+    Feed(true, 2);
+    Feed(false, 1);
+
+    ASSERT_EQ(emitted.size(), size_t(next_id));
+    for (size_t i = 0; i < emitted.size(); ++i) {
+        EXPECT_EQ(emitted[i].id, int64_t(i));
+    }
+    // 3 speech, 2 hangover, then 7 frames leave the ring as silence before the pre-roll is flushed
+    for (int64_t i = 0; i < next_id; ++i) {
+        EXPECT_EQ(emitted[i].silent, i >= 5 && i < 12) << i;
+    }
+    EXPECT_EQ(gate.stats().silent, 7u);
+    EXPECT_EQ(gate.stats().dropped, 0u);
+}
+
+TEST_F(SilenceGateTest, ResetOpensTheGateAndDropsHeldFrames) {
+    gate.SetMode(kSilenceGateDrop);
+    Feed(false, 10);
+    EXPECT_EQ(gate.held_frames(), 3u);
+    gate.Reset();
+    emitted.clear();
+    Feed(false);
+    ASSERT_EQ(emitted.size(), 1u);
+    EXPECT_EQ(emitted[0].id, 10);
+    EXPECT_EQ(gate.held_frames(), 0u);
+}
+
+TEST_F(SilenceGateTest, TurningTheGateOffFlushesHeldFrames) {
+    gate.SetMode(kSilenceGateDrop);
+    Feed(false, 10);
+    gate.SetMode(kSilenceGateOff);
+    emitted.clear();
+    Feed(false);
+    ASSERT_EQ(emitted.size(), 4u);
+    EXPECT_EQ(emitted.front().id, 7);
+    EXPECT_EQ(emitted.back().id, 10);
+}
@@ -0,0 +1,50 @@
+#ifndef HOST_SLOW_OPUS_UPLINK_ENCODER_H
+#define HOST_SLOW_OPUS_UPLINK_ENCODER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "link_rate_controller.h"
+
+#define OPUS_UPLINK_MAX_PACKET_BYTES 1500
+
+/*
+ * Stands in for the libopus encoder in wake_word_preroll_test. Every frame takes encode_ms,
+ * and the frame is checked to be the same at the end as at the start of the encode. The
+ * "packet" is the frame's first sample, the test feeds frames of one value each.
+ */
+class OpusUplinkEncoder {
+public:
+    static inline std::atomic<int> encode_ms{0};
+    static inline std::atomic<uint32_t> frames_changed{0};
+
+    OpusUplinkEncoder(int sample_rate, int complexity, const LinkAudioProfile& profile)
+        : sample_rate_(sample_rate), frame_duration_ms_(profile.frame_duration_ms) {}
+
+    size_t frame_samples() const { return sample_rate_ / 1000 * frame_duration_ms_; }
+
+    bool Encode(const int16_t* pcm, std::vector<uint8_t>& opus, size_t headroom = 0) {
+        frame_.assign(pcm, pcm + frame_samples());
+        std::this_thread::sleep_for(std::chrono::milliseconds(encode_ms.load()));
+        if (!std::equal(frame_.begin(), frame_.end(), pcm)) {
+            frames_changed++;
+        }
+        opus.assign(headroom, 0);
+        opus.push_back(uint8_t(pcm[0]));
+        opus.push_back(uint8_t(pcm[0] >> 8));
+        return true;
+    }
+
+    void ResetState() {}
+
+private:
+    int sample_rate_;
+    int frame_duration_ms_;
+    std::vector<int16_t> frame_;
+};
+
+#endif // HOST_SLOW_OPUS_UPLINK_ENCODER_H
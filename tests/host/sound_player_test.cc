@@ -0,0 +1,211 @@
+#include "sound_player.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Builds an Ogg/Opus stream: OpusHead, OpusTags, then one page per entry of `pages`
+class OggBuilder {
+public:
+    explicit OggBuilder(uint32_t sample_rate = 24000) {
+        std::string head("OpusHead", 8);
+        head += char(1);    // version
+        head += char(1);    // channels
+        head += std::string(2, '\0');   // pre_skip
+        for (int i = 0; i < 4; ++i) {
+            head += char((sample_rate >> (8 * i)) & 0xFF);
+        }
+        head += std::string(3, '\0');   // output_gain, mapping_family
+        AddPage({head});
+        AddPage({std::string("OpusTags", 8) + std::string(8, '\0')});
+    }
+
+    void AddPage(const std::vector<std::string>& packets, uint8_t header_type = 0, bool last_continues = false) {
+        std::string lacing;
+        std::string body;
+        for (size_t i = 0; i < packets.size(); ++i) {
+            size_t len = packets[i].size();
+            while (len >= 255) {
+                lacing += char(255);
+                len -= 255;
+            }
+            if (!(last_continues && i + 1 == packets.size())) {
+                lacing += char(len);
+            }
+            body += packets[i];
+        }
+        std::string header("OggS", 4);
+        header += char(0);
+        header += char(header_type);
+        header += std::string(20, '\0');
+        header += char(lacing.size());
+        data_ += header + lacing + body;
+    }
+
+    void AddGarbage(const std::string& garbage) { data_ += garbage; }
+    std::string_view data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+std::string Packet(char tag, size_t size = 20) {
+    return std::string(size, tag);
+}
+
+class SoundPlayerTest : public ::testing::Test {
+protected:
+    SoundPlayer player_;
+    AudioStreamPacket packet_;
+
+    // First payload byte of the next frame, 0 when nothing is pending
+    char Next(bool* first = nullptr) {
+        bool is_first = false;
+        if (!player_.Next(packet_, is_first)) {
+            return 0;
+        }
+        if (first != nullptr) {
+            *first = is_first;
+        }
+        return char(packet_.payload[0]);
+    }
+};
+
+} // namespace
+
+TEST(SoundIndexTest, IndexesAudioPackets) {
+    OggBuilder ogg(24000);
+    ogg.AddPage({Packet('a'), Packet('b', 300)});
+    ogg.AddPage({Packet('c')});
+
+    SoundIndex index;
+    ASSERT_TRUE(SoundIndex::Build(ogg.data(), index));
+    EXPECT_EQ(index.sample_rate, 24000);
+    ASSERT_EQ(index.packets.size(), 3u);
+    EXPECT_EQ(index.packets[1].size, 300u);
+    EXPECT_EQ(index.data[index.packets[1].offset], 'b');
+    EXPECT_EQ(index.data[index.packets[2].offset], 'c');
+}
+
+TEST(SoundIndexTest, SkipsGarbageBetweenPages) {
+    OggBuilder ogg;
+    ogg.AddGarbage("xxOgxx");
+    ogg.AddPage({Packet('a')});
+
+    SoundIndex index;
+    ASSERT_TRUE(SoundIndex::Build(ogg.data(), index));
+    ASSERT_EQ(index.packets.size(), 1u);
+    EXPECT_EQ(index.data[index.packets[0].offset], 'a');
+}
+
+TEST(SoundIndexTest, SkipsPacketsSplitAcrossPages) {
+    OggBuilder ogg;
+    ogg.AddPage({Packet('a'), Packet('b', 255)}, 0, true);
+    ogg.AddPage({Packet('b', 10), Packet('c')}, 0x01);
+
+    SoundIndex index;
+    ASSERT_TRUE(SoundIndex::Build(ogg.data(), index));
+    ASSERT_EQ(index.packets.size(), 2u);
+    EXPECT_EQ(index.data[index.packets[0].offset], 'a');
+    EXPECT_EQ(index.data[index.packets[1].offset], 'c');
+}
+
+TEST(SoundIndexTest, RejectsTruncatedOrEmptySounds) {
+    OggBuilder ogg;
+    SoundIndex index;
+    EXPECT_FALSE(SoundIndex::Build(ogg.data(), index));
+    ogg.AddPage({Packet('a')});
+    EXPECT_FALSE(SoundIndex::Build(ogg.data().substr(0, ogg.data().size() - 1), index));
+}
+
+TEST_F(SoundPlayerTest, PlaysFramesInOrderAndReportsCompletion) {
+    OggBuilder ogg(16000);
+    ogg.AddPage({Packet('a'), Packet('b')});
+    int completed = 0;
+    EXPECT_NE(player_.Play(ogg.data(), kSoundPriorityNormal, [&](bool ok) { completed += ok ? 1 : -100; }), 0u);
+
+    bool first = false;
+    EXPECT_EQ(Next(&first), 'a');
+    EXPECT_TRUE(first);
+    EXPECT_EQ(packet_.sample_rate, 16000);
+    EXPECT_EQ(packet_.frame_duration, SOUND_FRAME_DURATION_MS);
+    EXPECT_EQ(completed, 0);
+    EXPECT_EQ(Next(&first), 'b');
+    EXPECT_FALSE(first);
+    EXPECT_EQ(completed, 1);
+    EXPECT_TRUE(player_.Empty());
+    EXPECT_EQ(Next(), 0);
+}
+
+TEST_F(SoundPlayerTest, QueuesSoundsByPriority) {
+    OggBuilder one, two, alert;
+    one.AddPage({Packet('1')});
+    two.AddPage({Packet('2')});
+    alert.AddPage({Packet('!')});
+
+    player_.Play(one.data());
+    player_.Play(two.data());
+    player_.Play(alert.data(), kSoundPriorityAlert);
+    EXPECT_EQ(Next(), '!');
+    EXPECT_EQ(Next(), '1');
+    EXPECT_EQ(Next(), '2');
+    EXPECT_EQ(Next(), 0);
+}
+
+TEST_F(SoundPlayerTest, AlertInterruptsPlayingSound) {
+    OggBuilder digits, alert;
+    digits.AddPage({Packet('1'), Packet('2'), Packet('3')});
+    alert.AddPage({Packet('!')});
+    bool digits_result = true;
+    player_.Play(digits.data(), kSoundPriorityNormal, [&](bool ok) { digits_result = ok; });
+    EXPECT_EQ(Next(), '1');
+
+    player_.Play(alert.data(), kSoundPriorityAlert);
+    EXPECT_FALSE(digits_result);
+    bool first = false;
+    EXPECT_EQ(Next(&first), '!');
+    EXPECT_TRUE(first);
+    EXPECT_EQ(Next(), 0);
+}
+
+TEST_F(SoundPlayerTest, CancelsQueuedAndPlayingSounds) {
+    OggBuilder one, two;
+    one.AddPage({Packet('1'), Packet('1')});
+    two.AddPage({Packet('2')});
+    std::vector<bool> results;
+    auto id1 = player_.Play(one.data(), kSoundPriorityNormal, [&](bool ok) { results.push_back(ok); });
+    auto id2 = player_.Play(two.data(), kSoundPriorityNormal, [&](bool ok) { results.push_back(ok); });
+
+    player_.Cancel(id2);
+    EXPECT_EQ(Next(), '1');
+    player_.Cancel(id1);
+    EXPECT_EQ(Next(), 0);
+    EXPECT_EQ(results, std::vector<bool>({false, false}));
+
+    player_.Play(one.data(), kSoundPriorityNormal, [&](bool ok) { results.push_back(ok); });
+    player_.CancelAll();
+    EXPECT_TRUE(player_.Empty());
+    EXPECT_EQ(results.size(), 3u);
+}
+
+TEST_F(SoundPlayerTest, ReportsInvalidSound) {
+    bool result = true;
+    EXPECT_EQ(player_.Play("not an ogg", kSoundPriorityNormal, [&](bool ok) { result = ok; }), 0u);
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(player_.Empty());
+}
+
+TEST_F(SoundPlayerTest, ReusesTheIndexOfAnAsset) {
+    OggBuilder ogg;
+    ogg.AddPage({Packet('a')});
+    player_.Play(ogg.data());
+    EXPECT_EQ(Next(), 'a');
+    // The cached index points into the same buffer
+    player_.Play(ogg.data());
+    EXPECT_EQ(Next(), 'a');
+    EXPECT_EQ(packet_.payload.size(), 20u);
+}
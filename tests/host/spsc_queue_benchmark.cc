@@ -0,0 +1,135 @@
+// Throughput of the SpscQueue rings against the std::mutex + std::deque + std::condition_variable
+// queues AudioService used before, with the same item type (a moved unique_ptr) and capacity.
+// "uncontended" pushes and pops on one thread, the cost every queue operation pays; "two tasks"
+// runs a producer and a consumer thread the way the audio tasks do.
+//
+//   ./spsc_queue_benchmark [items]
+
+#include "spsc_queue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCapacity = 40;  // MAX_DECODE_PACKETS_IN_QUEUE
+
+using Item = std::unique_ptr<uint32_t>;
+
+// The previous queues: one mutex for all of them, one condition variable waking every waiter
+class MutexQueue {
+public:
+    void Push(Item&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return queue_.size() < kCapacity; });
+        queue_.push_back(std::move(item));
+        cv_.notify_all();
+    }
+
+    Item Pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !queue_.empty(); });
+        auto item = std::move(queue_.front());
+        queue_.pop_front();
+        cv_.notify_all();
+        return item;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Item> queue_;
+};
+
+// The ring does not block, the firmware waits on an event group bit instead; yielding stands in for it
+class RingQueue {
+public:
+    void Push(Item&& item) {
+        while (!queue_.Push(std::move(item))) {
+            std::this_thread::yield();
+        }
+    }
+
+    Item Pop() {
+        Item item;
+        while (!queue_.Pop(item)) {
+            std::this_thread::yield();
+        }
+        return item;
+    }
+
+private:
+    SpscQueue<Item, kCapacity> queue_;
+};
+
+volatile uint32_t sink;
+
+// Items are allocated up front so that only the queue is timed
+std::vector<Item> MakeItems(size_t count) {
+    std::vector<Item> items(count);
+    for (size_t i = 0; i < count; ++i) {
+        items[i] = std::make_unique<uint32_t>(i);
+    }
+    return items;
+}
+
+template <typename Queue>
+double Uncontended(size_t count) {
+    Queue queue;
+    auto items = MakeItems(count);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        queue.Push(std::move(items[i]));
+        items[i] = queue.Pop();
+        sink = *items[i];
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / count;
+}
+
+template <typename Queue>
+double TwoTasks(size_t count) {
+    Queue queue;
+    auto items = MakeItems(count);
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            queue.Push(std::move(items[i]));
+        }
+    });
+    uint32_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto item = queue.Pop();
+        if (*item != expected++) {
+            std::fprintf(stderr, "out of order at %zu\n", i);
+            std::exit(1);
+        }
+    }
+    producer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    std::printf("%zu items, capacity %zu\n", count, kCapacity);
+    std::printf("%-22s %16s %18s\n", "", "uncontended", "two tasks");
+    double mutex_ns = Uncontended<MutexQueue>(count);
+    double mutex_rate = TwoTasks<MutexQueue>(count);
+    std::printf("%-22s %13.1f ns %14.2f M/s\n", "mutex + deque + cv", mutex_ns, mutex_rate / 1e6);
+    double ring_ns = Uncontended<RingQueue>(count);
+    double ring_rate = TwoTasks<RingQueue>(count);
+    std::printf("%-22s %13.1f ns %14.2f M/s\n", "SpscQueue", ring_ns, ring_rate / 1e6);
+    std::printf("%-22s %15.1fx %17.1fx\n", "speedup", mutex_ns / ring_ns, ring_rate / mutex_rate);
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "spsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+TEST(SpscQueueTest, PopsInPushOrder) {
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.Push(int(i)));
+    }
+    for (int i = 0; i < 4; ++i) {
+        int item = -1;
+        ASSERT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, i);
+    }
+    int item;
+    EXPECT_FALSE(queue.Pop(item));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SpscQueueTest, RejectsPushWhenFull) {
+    // 3 rounds up to 4 slots, the capacity is still 3
+    SpscQueue<int, 3> queue;
+    EXPECT_TRUE(queue.Push(1));
+    EXPECT_TRUE(queue.Push(2));
+    EXPECT_TRUE(queue.Push(3));
+    EXPECT_TRUE(queue.Full());
+    EXPECT_FALSE(queue.Push(4));
+    EXPECT_EQ(queue.Size(), 3u);
+
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_FALSE(queue.Full());
+    EXPECT_TRUE(queue.Push(4));
+    EXPECT_FALSE(queue.Push(5));
+    for (int expected : {2, 3, 4}) {
+        ASSERT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, expected);
+    }
+}
+
+TEST(SpscQueueTest, WrapsAroundTheRing) {
+    SpscQueue<int, 3> queue;
+    int next_push = 0;
+    int next_pop = 0;
+    // Keep the ring partly filled so that head and tail cross the end of the slots many times
+    for (int round = 0; round < 1000; ++round) {
+        while (queue.Push(int(next_push))) {
+            next_push++;
+        }
+        EXPECT_EQ(queue.Size(), 3u);
+        for (int i = 0; i < 1 + round % 3; ++i) {
+            int item;
+            ASSERT_TRUE(queue.Pop(item));
+            EXPECT_EQ(item, next_pop++);
+        }
+    }
+    int item;
+    while (queue.Pop(item)) {
+        EXPECT_EQ(item, next_pop++);
+    }
+    EXPECT_EQ(next_pop, next_push);
+}
+
+TEST(SpscQueueTest, FrontPeeksWithoutPopping) {
+    SpscQueue<int, 2> queue;
+    EXPECT_EQ(queue.Front(), nullptr);
+    queue.Push(7);
+    ASSERT_NE(queue.Front(), nullptr);
+    EXPECT_EQ(*queue.Front(), 7);
+    EXPECT_EQ(queue.Size(), 1u);
+}
+
+TEST(SpscQueueTest, PopReleasesTheSlot) {
+    SpscQueue<std::shared_ptr<int>, 2> queue;
+    auto value = std::make_shared<int>(1);
+    queue.Push(std::shared_ptr<int>(value));
+    EXPECT_EQ(value.use_count(), 2);
+    std::shared_ptr<int> item;
+    queue.Pop(item);
+    item.reset();
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(SpscQueueTest, ClearKeepsLaterPushes) {
+    SpscQueue<int, 4> queue;
+    queue.Push(1);
+    queue.Push(2);
+    queue.Clear();
+    EXPECT_TRUE(queue.Empty());
+    // Slots awaiting the clear belong to the consumer until its next access, the ring is not full
+    queue.Push(3);
+    queue.Push(4);
+    EXPECT_EQ(queue.Size(), 2u);
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 3);
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 4);
+    EXPECT_FALSE(queue.Pop(item));
+}
+
+TEST(SpscQueueTest, ClearOfAFullRingMakesRoomOnlyAfterTheConsumer) {
+    SpscQueue<int, 2> queue;
+    queue.Push(1);
+    queue.Push(2);
+    queue.Clear();
+    EXPECT_TRUE(queue.Empty());
+    // The consumer has not dropped the cleared items yet, their slots are still taken
+    EXPECT_FALSE(queue.Push(3));
+    int item;
+    EXPECT_FALSE(queue.Pop(item));
+    EXPECT_TRUE(queue.Push(3));
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 3);
+}
+
+TEST(SpscQueueTest, KeepsOrderAcrossThreads) {
+    constexpr uint32_t kItems = 1000000;
+    SpscQueue<uint32_t, 16> queue;
+    std::thread producer([&queue]() {
+        for (uint32_t i = 0; i < kItems;) {
+            if (queue.Push(uint32_t(i))) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < kItems) {
+        uint32_t item;
+        if (queue.Pop(item)) {
+            in_order = in_order && item == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(queue.Empty());
+}
@@ -0,0 +1,15 @@
+#ifndef HOST_STUB_ESP_LOG_H
+#define HOST_STUB_ESP_LOG_H
+
+// Host builds drop the log output. The formats are not checked: uint32_t is not unsigned long here.
+template <typename... Args>
+inline void esp_host_log(const char* tag, const char* format, const Args&... args) {
+}
+
+#define ESP_LOGE(tag, format, ...) esp_host_log(tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_host_log(tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_host_log(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_host_log(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_host_log(tag, format, ##__VA_ARGS__)
+
+#endif // HOST_STUB_ESP_LOG_H
@@ -0,0 +1,13 @@
+#ifndef HOST_STUB_ESP_TIMER_H
+#define HOST_STUB_ESP_TIMER_H
+
+#include <cstdint>
+
+// Host tests drive the clock by setting this
+inline int64_t host_time_us = 0;
+
+inline int64_t esp_timer_get_time() {
+    return host_time_us;
+}
+
+#endif // HOST_STUB_ESP_TIMER_H
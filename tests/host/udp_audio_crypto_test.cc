@@ -0,0 +1,193 @@
+#include "udp_audio_crypto.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> Hex(const std::string& hex) {
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(uint8_t(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+std::string HexString(const std::string& hex) {
+    auto bytes = Hex(hex);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+// The session from the server hello: type 1, ssrc a1b2c3d4
+const char* kKey = "000102030405060708090a0b0c0d0e0f";
+const char* kSessionNonce = "01000000a1b2c3d40000000000000000";
+
+std::vector<uint8_t> Payload() {
+    std::vector<uint8_t> payload;
+    for (uint8_t i = 0x30; i < 0x44; ++i) {
+        payload.push_back(i);
+    }
+    return payload;
+}
+
+UdpAudioCrypto& Session(UdpAudioCrypto& crypto) {
+    EXPECT_TRUE(crypto.Configure(HexString(kKey), HexString(kSessionNonce)));
+    return crypto;
+}
+
+}  // namespace
+
+// NIST SP 800-38A F.5.1, CTR-AES128.Encrypt: the cipher the session runs on
+TEST(UdpAudioCryptoTest, CipherMatchesSp80038a) {
+    auto key = Hex("2b7e151628aed2a6abf7158809cf4f3c");
+    auto counter = Hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    auto plain = Hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                     "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    auto expected = Hex("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                        "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+
+    mbedtls_aes_context aes;
+    mbedtls_aes_init(&aes);
+    ASSERT_EQ(mbedtls_aes_setkey_enc(&aes, key.data(), 128), 0);
+    std::vector<uint8_t> output(plain.size());
+    size_t nc_off = 0;
+    uint8_t stream_block[16];
+    // In two uneven calls, as a stream
+    ASSERT_EQ(mbedtls_aes_crypt_ctr(&aes, 23, &nc_off, counter.data(), stream_block, plain.data(), output.data()), 0);
+    ASSERT_EQ(mbedtls_aes_crypt_ctr(&aes, plain.size() - 23, &nc_off, counter.data(), stream_block,
+        plain.data() + 23, output.data() + 23), 0);
+    mbedtls_aes_free(&aes);
+    EXPECT_EQ(output, expected);
+}
+
+TEST(UdpAudioCryptoTest, SealKnownAnswer) {
+    UdpAudioCrypto crypto;
+    Session(crypto);
+    auto payload = Payload();
+
+    auto frame = crypto.Seal(payload.data(), payload.size(), 0x12345);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(std::vector<uint8_t>(frame->begin(), frame->end()),
+        Hex("01000014a1b2c3d40001234500000001" "e37164a7937a3b08d349e5468099b9be88d6befc"));
+
+    // The send frame is reused, the next packet has the next sequence
+    const void* storage = frame->data();
+    frame = crypto.Seal(payload.data(), payload.size(), 0x12345);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->data(), storage);
+    EXPECT_EQ(std::vector<uint8_t>(frame->begin(), frame->end()),
+        Hex("01000014a1b2c3d40001234500000002" "f8a6ce8cd67d7c7ec8e9bade832d0d6a66e4596d"));
+    EXPECT_EQ(crypto.stats().sealed, 2u);
+}
+
+TEST(UdpAudioCryptoTest, OpenKnownAnswer) {
+    UdpAudioCrypto crypto;
+    Session(crypto);
+    // The counter carries out of the sequence into the timestamp between the two blocks
+    auto frame = Hex("01000014a1b2c3d400012345ffffffff" "22fde0642121eb35e3f1c975d26ada2131187845");
+    std::vector<uint8_t> payload;
+    UdpAudioHeader header;
+    ASSERT_EQ(crypto.Open(frame.data(), frame.size(), payload, header), kUdpAudioOpenOk);
+    EXPECT_EQ(payload, Payload());
+    EXPECT_EQ(header.timestamp, 0x12345u);
+    EXPECT_EQ(header.sequence, 0xffffffffu);
+}
+
+TEST(UdpAudioCryptoTest, RoundTrip) {
+    UdpAudioCrypto sender;
+    UdpAudioCrypto receiver;
+    Session(sender);
+    Session(receiver);
+    for (size_t size : {0, 1, 15, 16, 17, 120, 500}) {
+        std::vector<uint8_t> opus(size);
+        for (size_t i = 0; i < size; ++i) {
+            opus[i] = uint8_t(i * 31 + size);
+        }
+        auto frame = sender.Seal(opus.data(), opus.size(), uint32_t(size));
+        ASSERT_NE(frame, nullptr);
+        std::vector<uint8_t> payload;
+        UdpAudioHeader header;
+        ASSERT_EQ(receiver.Open(reinterpret_cast<const uint8_t*>(frame->data()), frame->size(), payload, header),
+            kUdpAudioOpenOk) << size;
+        EXPECT_EQ(payload, opus);
+        EXPECT_EQ(header.timestamp, uint32_t(size));
+    }
+}
+
+TEST(UdpAudioCryptoTest, RejectsDuplicatesAndAcceptsReordered) {
+    UdpAudioCrypto sender;
+    UdpAudioCrypto receiver;
+    Session(sender);
+    Session(receiver);
+    auto payload = Payload();
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < 100; ++i) {
+        auto frame = sender.Seal(payload.data(), payload.size(), 0);
+        frames.emplace_back(frame->begin(), frame->end());
+    }
+
+    std::vector<uint8_t> decrypted;
+    UdpAudioHeader header;
+    auto open = [&](int sequence) {
+        auto& frame = frames[sequence - 1];
+        return receiver.Open(frame.data(), frame.size(), decrypted, header);
+    };
+    EXPECT_EQ(open(1), kUdpAudioOpenOk);
+    EXPECT_EQ(open(3), kUdpAudioOpenOk);
+    EXPECT_EQ(open(2), kUdpAudioOpenOk);
+    EXPECT_EQ(open(2), kUdpAudioOpenReplayed);
+    EXPECT_EQ(open(3), kUdpAudioOpenReplayed);
+    EXPECT_EQ(open(80), kUdpAudioOpenOk);
+    // 80 - 17 = 63 is the oldest still in the window
+    EXPECT_EQ(open(17), kUdpAudioOpenOk);
+    EXPECT_EQ(open(16), kUdpAudioOpenTooOld);
+    EXPECT_EQ(open(79), kUdpAudioOpenOk);
+    EXPECT_EQ(open(80), kUdpAudioOpenReplayed);
+
+    auto& stats = receiver.stats();
+    EXPECT_EQ(stats.opened, 6u);
+    EXPECT_EQ(stats.reordered, 3u);
+    EXPECT_EQ(stats.replayed, 3u);
+    EXPECT_EQ(stats.too_old, 1u);
+}
+
+TEST(UdpAudioCryptoTest, RejectsMalformedPackets) {
+    UdpAudioCrypto crypto;
+    Session(crypto);
+    std::vector<uint8_t> payload;
+    UdpAudioHeader header;
+    auto short_frame = Hex("01000014a1b2c3d4000123450000");
+    EXPECT_EQ(crypto.Open(short_frame.data(), short_frame.size(), payload, header), kUdpAudioOpenInvalid);
+    auto wrong_type = Hex("02000014a1b2c3d40001234500000001" "00");
+    EXPECT_EQ(crypto.Open(wrong_type.data(), wrong_type.size(), payload, header), kUdpAudioOpenInvalid);
+    auto no_sequence = Hex("01000014a1b2c3d40001234500000000" "00");
+    EXPECT_EQ(crypto.Open(no_sequence.data(), no_sequence.size(), payload, header), kUdpAudioOpenInvalid);
+    EXPECT_EQ(crypto.stats().invalid, 3u);
+
+    UdpAudioCrypto unconfigured;
+    auto frame = Hex("01000014a1b2c3d40001234500000001" "00");
+    EXPECT_EQ(unconfigured.Open(frame.data(), frame.size(), payload, header), kUdpAudioOpenFailed);
+    EXPECT_EQ(unconfigured.Seal(frame.data(), frame.size(), 0), nullptr);
+    EXPECT_FALSE(unconfigured.Configure("short", HexString(kSessionNonce)));
+}
+
+TEST(UdpReplayWindowTest, SlidesAcrossSequenceWrap) {
+    UdpReplayWindow window;
+    window.Accept(0xfffffffe);
+    EXPECT_EQ(window.Check(0xffffffff), kUdpAudioOpenOk);
+    window.Accept(0xffffffff);
+    // Sequence 0 is never sent, 1 follows the wrap
+    EXPECT_EQ(window.Check(1), kUdpAudioOpenOk);
+    window.Accept(1);
+    EXPECT_EQ(window.highest(), 1u);
+    EXPECT_EQ(window.Check(0xfffffffe), kUdpAudioOpenReplayed);
+    EXPECT_EQ(window.Check(0xfffffffd), kUdpAudioOpenOk);
+    EXPECT_EQ(window.Check(1 - UDP_AUDIO_REPLAY_WINDOW), kUdpAudioOpenTooOld);
+
+    // A jump further than the window forgets everything behind it
+    window.Accept(1000);
+    EXPECT_EQ(window.Check(999), kUdpAudioOpenOk);
+    EXPECT_EQ(window.Check(1000), kUdpAudioOpenReplayed);
+}
@@ -0,0 +1,122 @@
+#include "uplink_stage.h"
+
+#include <gtest/gtest.h>
+
+class UplinkStageTest : public ::testing::Test {
+protected:
+    FramePool<AudioStreamPacket> pool_{16};
+
+    AudioStreamPacketPtr Packet(uint32_t sequence, int frame_duration = 60) {
+        auto packet = pool_.Acquire();
+        packet->sequence = sequence;
+        packet->frame_duration = frame_duration;
+        packet->timestamp = 1000 + sequence * frame_duration;
+        packet->trace_time_us = sequence * 1000;
+        return packet;
+    }
+};
+
+TEST_F(UplinkStageTest, PassesPacketsThroughWhenNotStaging) {
+    UplinkStage stage(1000, 32);
+    auto packet = Packet(1);
+    EXPECT_FALSE(stage.Push(packet, 0));
+    ASSERT_NE(packet, nullptr);
+    EXPECT_EQ(stage.Pop(), nullptr);
+    EXPECT_EQ(stage.stats().staged, 0u);
+}
+
+TEST_F(UplinkStageTest, HoldsPacketsUntilReleased) {
+    UplinkStage stage(1000, 32);
+    stage.Start(0);
+    for (uint32_t i = 1; i <= 5; i++) {
+        auto packet = Packet(i);
+        EXPECT_TRUE(stage.Push(packet, i * 60000));
+        EXPECT_EQ(packet, nullptr);
+    }
+    EXPECT_EQ(stage.duration_ms(), 300u);
+    // Not while the channel is still opening
+    EXPECT_EQ(stage.Pop(), nullptr);
+
+    stage.Release(500000);
+    EXPECT_EQ(stage.stats().last_wait_ms, 440u);
+    // Later packets go to the send queue
+    auto live = Packet(6);
+    EXPECT_FALSE(stage.Push(live, 510000));
+
+    for (uint32_t i = 1; i <= 5; i++) {
+        auto packet = stage.Pop();
+        ASSERT_NE(packet, nullptr);
+        EXPECT_EQ(packet->sequence, i);
+        // Timestamps survive the wait
+        EXPECT_EQ(packet->timestamp, 1000 + i * 60);
+        EXPECT_EQ(packet->trace_time_us, int64_t(i) * 1000);
+    }
+    EXPECT_EQ(stage.Pop(), nullptr);
+    EXPECT_EQ(stage.stats().staged, 5u);
+    EXPECT_EQ(stage.stats().flushed, 5u);
+    EXPECT_EQ(stage.stats().dropped, 0u);
+}
+
+TEST_F(UplinkStageTest, DropsTheOldestOverTheDurationLimit) {
+    UplinkStage stage(300, 32);
+    stage.Start(0);
+    for (uint32_t i = 1; i <= 8; i++) {
+        auto packet = Packet(i);
+        stage.Push(packet, 0);
+    }
+    EXPECT_EQ(stage.Size(), 5u);
+    EXPECT_EQ(stage.duration_ms(), 300u);
+    EXPECT_EQ(stage.stats().dropped, 3u);
+    EXPECT_EQ(stage.stats().peak_ms, 300u);
+
+    stage.Release(0);
+    EXPECT_EQ(stage.Pop()->sequence, 4u);
+}
+
+TEST_F(UplinkStageTest, DropsTheOldestWhenOutOfSlots) {
+    // 20 ms packets run out of slots before the duration limit
+    UplinkStage stage(1000, 4);
+    stage.Start(0);
+    for (uint32_t i = 1; i <= 6; i++) {
+        auto packet = Packet(i, 20);
+        stage.Push(packet, 0);
+    }
+    EXPECT_EQ(stage.Size(), 4u);
+    EXPECT_EQ(stage.duration_ms(), 80u);
+    EXPECT_EQ(stage.stats().dropped, 2u);
+    stage.Release(0);
+    EXPECT_EQ(stage.Pop()->sequence, 3u);
+}
+
+TEST_F(UplinkStageTest, DiscardsWhenTheChannelDoesNotOpen) {
+    UplinkStage stage(1000, 32);
+    stage.Start(0);
+    for (uint32_t i = 1; i <= 3; i++) {
+        auto packet = Packet(i);
+        stage.Push(packet, 0);
+    }
+    stage.Discard();
+    EXPECT_FALSE(stage.active());
+    EXPECT_TRUE(stage.Empty());
+    EXPECT_EQ(stage.duration_ms(), 0u);
+    EXPECT_EQ(stage.stats().discarded, 3u);
+    // The packets went back to the pool
+    EXPECT_EQ(pool_.GetStats().cached, 3u);
+
+    // The next interaction starts empty
+    stage.Start(0);
+    auto packet = Packet(4);
+    EXPECT_TRUE(stage.Push(packet, 0));
+    EXPECT_EQ(stage.stats().sessions, 2u);
+}
+
+TEST_F(UplinkStageTest, WaitIsFromTheStartWithoutPackets) {
+    UplinkStage stage(1000, 32);
+    stage.Start(100000);
+    stage.Release(350000);
+    EXPECT_EQ(stage.stats().last_wait_ms, 250u);
+    stage.Start(1000000);
+    stage.Release(1100000);
+    EXPECT_EQ(stage.stats().last_wait_ms, 100u);
+    EXPECT_EQ(stage.stats().max_wait_ms, 250u);
+}
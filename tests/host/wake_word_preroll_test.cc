@@ -0,0 +1,78 @@
+#include "wake_word_preroll.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+// 60 ms at 16 kHz
+static constexpr size_t kFrameSamples = 960;
+
+// The encode task never returns, so the pre-roll lives until the process exits
+static WakeWordPreroll* NewPreroll() {
+    auto preroll = new WakeWordPreroll();
+    preroll->Initialize(60);
+    return preroll;
+}
+
+TEST(WakeWordPrerollTest, SlowEncoderDropsFramesWithoutCorruptingThem) {
+    // Three times slower than the frames are fed
+    OpusUplinkEncoder::encode_ms = 30;
+    OpusUplinkEncoder::frames_changed = 0;
+    auto preroll = NewPreroll();
+    preroll->Reset();
+
+    // 30 frames of one value each, in AFE sized chunks of 32 ms every 10 ms
+    constexpr int kFrames = 30;
+    std::vector<int16_t> stream(kFrameSamples * kFrames);
+    for (size_t i = 0; i < stream.size(); ++i) {
+        stream[i] = int16_t(i / kFrameSamples + 1);
+    }
+    for (size_t offset = 0; offset < stream.size(); offset += 512) {
+        preroll->Feed(stream.data() + offset, std::min<size_t>(512, stream.size() - offset));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    preroll->Finish();
+
+    std::vector<int> values;
+    std::vector<uint8_t> opus;
+    while (preroll->Pop(opus)) {
+        ASSERT_EQ(opus.size(), 2u);
+        values.push_back(opus[0] | (opus[1] << 8));
+    }
+
+    // The encoder could not keep up, frames were dropped
+    EXPECT_GT(values.size(), 3u);
+    EXPECT_LT(values.size(), size_t(kFrames));
+    // ...but none of the frames it encoded was written over while it worked on it
+    EXPECT_EQ(OpusUplinkEncoder::frames_changed, 0u);
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_GE(values[i], 1);
+        EXPECT_LE(values[i], kFrames);
+        if (i > 0) {
+            EXPECT_GT(values[i], values[i - 1]);
+        }
+    }
+}
+
+TEST(WakeWordPrerollTest, FastEncoderKeepsEveryFrame) {
+    OpusUplinkEncoder::encode_ms = 0;
+    auto preroll = NewPreroll();
+    preroll->Reset();
+
+    constexpr int kFrames = 10;
+    std::vector<int16_t> frame(kFrameSamples);
+    for (int i = 1; i <= kFrames; ++i) {
+        std::fill(frame.begin(), frame.end(), int16_t(i));
+        preroll->Feed(frame.data(), frame.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    preroll->Finish();
+
+    std::vector<uint8_t> opus;
+    for (int i = 1; i <= kFrames; ++i) {
+        ASSERT_TRUE(preroll->Pop(opus));
+        EXPECT_EQ(opus[0], i);
+    }
+    EXPECT_FALSE(preroll->Pop(opus));
+}